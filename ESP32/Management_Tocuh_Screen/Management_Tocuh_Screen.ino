@@ -99,7 +99,6 @@ lv_obj_t *password_screen =NULL;
 static lv_obj_t *textarea = NULL;
 static lv_obj_t* msg_close_btm = NULL;
 
-char selected_text_to_title[32]; 
 
 
 
@@ -310,16 +309,6 @@ lv_obj_t* create_new_matrix_btn_choose_one(lv_obj_t * parent, char *** map, int
     return btnm;
 }
 
-int get_gest_num(){
-    int num_gest =0;
-    for (const auto& function : functions) {
-        if(function.protocol_type == FUNC_TYPE_GESTURE){
-          num_gest++;
-        }
-    }
-    return num_gest;
-}
-
 void create_controls_for_main(lv_obj_t* parent) {
 // Add the "Return" button to home tab
     lv_obj_t* return_btn = create_new_btn(parent, 80, 40, LV_ALIGN_BOTTOM_MID, -110, 0, "Return", HEX_RED , HEX_WHITE,&lv_font_montserrat_16);
@@ -371,20 +360,17 @@ void create_controls_for_main(lv_obj_t* parent) {
     lv_obj_set_style_text_font(label_home_BLE_1,&lv_font_montserrat_22,0);
     lv_obj_set_style_text_font(label_home_BLE_2,&lv_font_montserrat_22,0);
 
-    int num_gest = get_gest_num();
-    int num_function_total = functions.size();
+    uint8_t num_gest = 0;
+    const uint8_t* gesture_ids = config_index_of_type(HandIndex(), CONFIG_INDEX_FUNCTIONS, config_model_find(&handConfig, FUNC_TYPE_GESTURE), &num_gest);
 
     lv_obj_t** gestures_matrix = (lv_obj_t**)malloc((num_gest)*sizeof(lv_obj_t*));
     int max_in_row = 2;
 
 
     int j = 0;
-    for(int i=0; i< num_function_total; i++){
-      if(functions[i].protocol_type == FUNC_TYPE_GESTURE){
-        const char* temp_str = (functions[i].name).c_str();
+    for(; j < num_gest; j++){
+        const char* temp_str = ConfigName(handConfig.functions[gesture_ids[j]].name);
         gestures_matrix[j] = create_new_btn(parent, 90, 30, LV_ALIGN_TOP_RIGHT, -7 - (j%max_in_row)*95, 20 + (j/max_in_row)*35 , temp_str,HEX_DARK_BLUE,HEX_WHITE );
-        j++;
-      }
     }
 
     lv_obj_t * info_label = lv_label_create(parent);
@@ -413,8 +399,8 @@ void create_controls_for_main(lv_obj_t* parent) {
 }
 std::vector<int> find_new_off_sensor(){
   std::vector<int> ret_vec;
-  for (int i=0; i< sensors.size(); i++) {
-    if((sensors[i].status.equalsIgnoreCase("ON")) && (!lv_obj_has_state(sensorSwitchVec[i],LV_STATE_CHECKED))){
+  for (int i=0; i< handConfig.sensor_count; i++) {
+    if((handConfig.sensors[i].status == CONFIG_STATUS_ON) && (!lv_obj_has_state(sensorSwitchVec[i],LV_STATE_CHECKED))){
       ret_vec.push_back(i);
     }
   }
@@ -423,15 +409,70 @@ std::vector<int> find_new_off_sensor(){
 
 std::vector<int> find_new_on_sensor(){
   std::vector<int> ret_vec;
-  for (int i=0; i< sensors.size(); i++) {
-    if((sensors[i].status.equalsIgnoreCase("OFF")) && (lv_obj_has_state(sensorSwitchVec[i],LV_STATE_CHECKED))){
+  for (int i=0; i< handConfig.sensor_count; i++) {
+    if((handConfig.sensors[i].status == CONFIG_STATUS_OFF) && (lv_obj_has_state(sensorSwitchVec[i],LV_STATE_CHECKED))){
       ret_vec.push_back(i);
     }
   }
   return ret_vec;
 }
 
+// Live values on the Status tab: while the tab is shown, one STATS_REQ every
+// STATS_REFRESH_MS brings the statistics of every sensor (see rolling_stats.h).
+#define STATS_REFRESH_MS 500
+#define STAT_TAB_INDEX 1
+static lv_obj_t* stat_value_labels[ROLLING_STATS_MAX_CHANNELS];   // by sensor id, NULL if not shown
+static lv_timer_t* stat_timer = NULL;
+
+static void update_stat_values(lv_timer_t *t) {
+  struct rolling_stats_value values[ROLLING_STATS_MAX_CHANNELS];
+  int count = TakeStats(values, ROLLING_STATS_MAX_CHANNELS);
+  for (int c = 0; c < count; c++) {
+    int id = values[c].channel.id;
+    if (values[c].channel.is_motor || id >= ROLLING_STATS_MAX_CHANNELS || !stat_value_labels[id]) {
+      continue;
+    }
+    if (values[c].count == 0) {
+      lv_label_set_text(stat_value_labels[id], "--");
+    } else {
+      lv_label_set_text_fmt(stat_value_labels[id], "%d [%d..%d]", values[c].mean, values[c].min, values[c].max);
+    }
+  }
+  if (lv_tabview_get_tab_act(tabview) != STAT_TAB_INDEX) {
+    return;
+  }
+  if (has_client.test_and_set()) {
+    SendStatsReq(pCharacteristic);
+  } else {
+    has_client.clear();
+  }
+}
+
+// Mean [min..max] of the last window, between the name and the state of a sensor
+static void create_stat_value_label(lv_obj_t* parent, size_t id, int y_offset) {
+  if (id >= ROLLING_STATS_MAX_CHANNELS) {
+    return;
+  }
+  lv_obj_t* label = lv_label_create(parent);
+  lv_label_set_text(label, "--");
+  lv_obj_align(label, LV_ALIGN_TOP_RIGHT, -80, y_offset + 2);
+  lv_obj_set_style_text_font(label, &lv_font_montserrat_12, 0);
+  stat_value_labels[id] = label;
+}
+
+static void stop_stat_updates() {
+  if (stat_timer) {
+    lv_timer_del(stat_timer);
+    stat_timer = NULL;
+  }
+  memset(stat_value_labels, 0, sizeof(stat_value_labels));
+}
+
 void create_controls_for_stat(lv_obj_t* parent){
+  memset(stat_value_labels, 0, sizeof(stat_value_labels));
+  if (!stat_timer) {
+    stat_timer = lv_timer_create(update_stat_values, STATS_REFRESH_MS, NULL);
+  }
 
   // Create a title label
   lv_obj_t* title_label = lv_label_create(parent); 
@@ -442,16 +483,17 @@ void create_controls_for_stat(lv_obj_t* parent){
   int y_offset = 40; // Vertical spacing between rows
 
   // Loop through each sensor
-  for (const auto& sensor : sensors) { 
+  for (uint8_t id = 0; id < handConfig.sensor_count; id++) { 
+      const struct config_model_sensor& sensor = handConfig.sensors[id];
       // Replace "_" in the name with spaces
-      String display_name = sensor.name;
+      String display_name = ConfigName(sensor.name);
       display_name.replace("_", " ");
       display_name[0] = toupper(display_name[0]);
 
 
 
       // Set the style of the status label based on the sensor status
-      if (sensor.status.equalsIgnoreCase("ON")) {
+      if (sensor.status == CONFIG_STATUS_ON) {
           // Create a label for the sensor name
           lv_obj_t* sensor_name_label = lv_label_create(parent); 
           lv_label_set_text(sensor_name_label, (display_name + ":").c_str()); 
@@ -466,18 +508,20 @@ void create_controls_for_stat(lv_obj_t* parent){
           lv_label_set_text(sensor_status_label, "ON " LV_SYMBOL_OK); 
           lv_obj_set_style_text_color(sensor_status_label, HEX_GREEN, 0); // Green for ON
           lv_obj_set_style_text_font(sensor_status_label, &lv_font_montserrat_16, 0);  // Slightly larger font
+          create_stat_value_label(parent, id, y_offset);
           y_offset += 28;
       } 
 
       // Update the vertical offset for the next sensor
       
   }
-  for (const auto& sensor : sensors){
-      String display_name = sensor.name;
+  for (uint8_t id = 0; id < handConfig.sensor_count; id++) {
+      const struct config_model_sensor& sensor = handConfig.sensors[id];
+      String display_name = ConfigName(sensor.name);
       display_name.replace("_", " ");
       display_name[0] = toupper(display_name[0]);
 
-    if (sensor.status.equalsIgnoreCase("OFF")) {
+    if (sensor.status == CONFIG_STATUS_OFF) {
           // Create a label for the sensor name
           lv_obj_t* sensor_name_label = lv_label_create(parent); 
           lv_label_set_text(sensor_name_label, (display_name + ":").c_str()); 
@@ -492,6 +536,7 @@ void create_controls_for_stat(lv_obj_t* parent){
           lv_label_set_text(sensor_status_label, "OFF " LV_SYMBOL_CLOSE); 
           lv_obj_set_style_text_color(sensor_status_label,HEX_RED, 0); // Red for OFF
           lv_obj_set_style_text_font(sensor_status_label, &lv_font_montserrat_16, 0);  // Slightly larger font
+          create_stat_value_label(parent, id, y_offset);
 
           y_offset += 28;
 
@@ -501,15 +546,12 @@ void create_controls_for_stat(lv_obj_t* parent){
 
 void discard_btn_click_event(lv_event_t * e){
 
-  for (int i=0; i< sensors.size(); i++) {
-        if(sensors[i].status.equalsIgnoreCase("ON")){
+  for (int i=0; i< handConfig.sensor_count; i++) {
+        if(handConfig.sensors[i].status == CONFIG_STATUS_ON){
           lv_obj_add_state(sensorSwitchVec[i], LV_STATE_CHECKED);
         }
-        else if(sensors[i].status.equalsIgnoreCase("OFF")){
-          lv_obj_clear_state(sensorSwitchVec[i], LV_STATE_CHECKED);
-        }
         else{
-          Serial.printf("ERROR PLEASE CHECK");
+          lv_obj_clear_state(sensorSwitchVec[i], LV_STATE_CHECKED);
         }
   }
   
@@ -519,13 +561,13 @@ void discard_sensor_btn_click_event(lv_event_t * e){
   struct Return_unsaved_param unsave_struct = check_unsave_sensor_param();
   if(unsave_struct.params_id.size() > 0){
     // int param_slider_id = 0;
-    int i = 0;
-    for (const auto& [paramName, param] : sensors[current_edit_sensor_id].function.parameters){
-      if(param.current_val != lv_slider_get_value(current_edit_sensor_sliders_vec[i])){
-        lv_slider_set_value(current_edit_sensor_sliders_vec[i], param.current_val, LV_ANIM_ON);
+    const struct config_model_sensor& sensor = handConfig.sensors[current_edit_sensor_id];
+    const struct config_model_param* params = config_model_sensor_params(&handConfig, &sensor);
+    for (int i = 0; i < sensor.param_count; i++){
+      if(params[i].current_val != lv_slider_get_value(current_edit_sensor_sliders_vec[i])){
+        lv_slider_set_value(current_edit_sensor_sliders_vec[i], params[i].current_val, LV_ANIM_ON);
         lv_event_send(current_edit_sensor_sliders_vec[i], LV_EVENT_VALUE_CHANGED, NULL);
       }
-      i++;
     }
     
 
@@ -537,38 +579,27 @@ void discard_sensor_btn_click_event(lv_event_t * e){
 void discard_motor_btn_click_event(lv_event_t * e){
   struct Return_unsaved_param unsave_tsh = check_unsave_motor_param();
   if(unsave_tsh.params_id.size() > 0){
-    lv_slider_set_value(current_edit_motor_sliders_vec[0], motors[current_edit_motor_id].safety_threshold.current_val, LV_ANIM_ON);
+    lv_slider_set_value(current_edit_motor_sliders_vec[0], handConfig.motors[current_edit_motor_id].safety_threshold.current_val, LV_ANIM_ON);
     lv_event_send(current_edit_motor_sliders_vec[0], LV_EVENT_VALUE_CHANGED, NULL);
   }
 }
 
 void save_new_switch_btms_to_struct(){
-  for (int i=0; i< sensors.size(); i++) {
-    if(!lv_obj_has_state(sensorSwitchVec[i],LV_STATE_CHECKED)){
-      sensors[i].status = "off";
-    }
-    else if(lv_obj_has_state(sensorSwitchVec[i],LV_STATE_CHECKED)){
-      sensors[i].status = "on";
-    }
-    else{
-      Serial.printf("PROBLEM IN SAVE NEW BTM");
-    }
+  for (int i=0; i< handConfig.sensor_count; i++) {
+    handConfig.sensors[i].status = lv_obj_has_state(sensorSwitchVec[i],LV_STATE_CHECKED) ? CONFIG_STATUS_ON : CONFIG_STATUS_OFF;
   }
 }
 
 void save_new_motor_val_to_struct(struct Return_unsaved_param motor_ths_struct){
-    motors[motor_ths_struct.sensor_id].safety_threshold.current_val = motor_ths_struct.new_vals[0];
+    handConfig.motors[motor_ths_struct.sensor_id].safety_threshold.current_val = motor_ths_struct.new_vals[0];
 }
 
 void save_new_sensors_val_to_struct(struct Return_unsaved_param sensors_struct){
-    int i = 0;
-    int j = 0;
-    for(auto& [name, param] : sensors[sensors_struct.sensor_id].function.parameters){
-      if(sensors_struct.params_id[i] == j){
-        param.current_val = sensors_struct.new_vals[i];
-        i++;
+    const struct config_model_sensor& sensor = handConfig.sensors[sensors_struct.sensor_id];
+    for(size_t i = 0; i < sensors_struct.params_id.size(); i++){
+      if(sensors_struct.params_id[i] < sensor.param_count){
+        handConfig.params[sensor.first_param + sensors_struct.params_id[i]].current_val = sensors_struct.new_vals[i];
       }
-      j++;
     }
 }
 
@@ -779,9 +810,10 @@ void create_controls_for_setup(lv_obj_t* parent){
 
 
   // Loop through each sensor
-  for (const auto& sensor : sensors) { 
+  for (uint8_t id = 0; id < handConfig.sensor_count; id++) { 
+      const struct config_model_sensor& sensor = handConfig.sensors[id];
       // Replace "_" in the name with spaces
-      String display_name = sensor.name;
+      String display_name = ConfigName(sensor.name);
       display_name.replace("_", " ");
       display_name[0] = toupper(display_name[0]);
       
@@ -800,17 +832,14 @@ void create_controls_for_setup(lv_obj_t* parent){
       lv_obj_add_style(sensor_switch, &style_indic_on, LV_PART_INDICATOR | LV_STATE_CHECKED);
       lv_obj_add_style(sensor_switch, &style_indic_off, LV_PART_INDICATOR | LV_STATE_DEFAULT);
 
-      if(sensor.status.equalsIgnoreCase("ON")){
+      if(sensor.status == CONFIG_STATUS_ON){
         lv_obj_clear_state(sensor_switch, LV_STATE_DEFAULT);
         lv_obj_add_state(sensor_switch, LV_STATE_CHECKED);
       }
-      else if(sensor.status.equalsIgnoreCase("OFF")){
+      else{
         lv_obj_clear_state(sensor_switch, LV_STATE_CHECKED);
         lv_obj_add_state(sensor_switch, LV_STATE_DEFAULT);
       }
-      else{
-        Serial.printf("ERROR PLEASE CHECK");
-      }
       y_offset += 37;  
   }
   save_btn = create_new_btn(parent, 90, 40, LV_ALIGN_TOP_MID, -50, y_offset+8, "Save", HEX_GREEN, HEX_WHITE, &lv_font_montserrat_16);
@@ -822,6 +851,18 @@ void create_controls_for_setup(lv_obj_t* parent){
 
 
 int num_points = 80; // Number of points in the chart
+int chart_push_period_ms = 20; // Chart refresh period while telemetry is pushed
+// Pushed telemetry is downsampled to min/max buckets (downsample.h): the point count
+// stays 2 x chart_push_columns at most whatever window is shown
+uint16_t chart_push_columns = 140; // Bucket pairs across the 280 px chart
+uint16_t chart_push_gap = 4; // Empty buckets after the newest one
+static const uint32_t chart_windows_ms[] = {1000, 2000, 5000, 30000, 60000};
+// The longer windows are the tiers of chart_history (history.h): 1 s, 10 s and 1 min
+// buckets, drawn at once from what was received so far instead of starting empty
+#define CHART_LIVE_WINDOWS 5
+#define CHART_HISTORY_REDRAW_MS 1000
+static const char* chart_window_options = "1 s\n2 s\n5 s\n30 s\n1 min\n5 min\n1 h\n4 h";
+static int chart_window = 1; // 2 s
 static lv_obj_t *show_chart_btn;
 
 
@@ -830,42 +871,271 @@ static int get_sensor_value() {
     return lv_rand(10, 90); // Simulated sensor value between 10 and 90
 }
 
+// Series colours in channel order (HEX_DARK_BLUE, HEX_RED, HEX_PURPLE, HEX_SKY_BLUE); the title
+// shows each channel name in the colour of its series
+static const uint32_t chart_series_colors[TELEMETRY_MAX_CHANNELS] = {0x00008b, 0xc30a12, 0x800080, 0x00bfff};
+static bool chart_push_telemetry = false;
+
+// Pushed samples go to the bucket of their time (screen time / bucket length, modulo
+// the bucket count), so the x axis is real time: late batches land where they belong
+// and lost samples leave their buckets empty. The series draw straight from these:
+static struct downsample_series chart_traces[TELEMETRY_MAX_CHANNELS];
+
+// Every pushed sample also goes to the history of its channel, kept across charts
+static struct history_store chart_history;
+static int16_t chart_history_points[TELEMETRY_MAX_CHANNELS][2 * DOWNSAMPLE_MAX_BUCKETS];
+static uint32_t chart_history_drawn_ms = 0;
+
+static bool chart_shows_history() {
+  return chart_window >= CHART_LIVE_WINDOWS;
+}
+
+// Draws the chosen history tier, min and max per column like the live traces;
+// only the columns that changed are marked for redrawing
+static void draw_chart_history() {
+  int tier = chart_window - CHART_LIVE_WINDOWS;
+  struct history_value columns[DOWNSAMPLE_MAX_BUCKETS];
+  uint16_t count = history_columns(tier, chart_push_columns);
+  for (int c = 0; c < chart_series_count; c++) {
+    if (history_query(&chart_history, &chart_channels[c], tier, millis(), chart_push_columns, columns) != count) {
+      memset(columns, 0, sizeof(columns));   // nothing received for this channel yet
+    }
+    for (uint16_t k = 0; k < count; k++) {
+      int16_t lo = columns[k].count ? columns[k].min : LV_CHART_POINT_NONE;
+      int16_t hi = columns[k].count ? columns[k].max : LV_CHART_POINT_NONE;
+      int16_t* pair = &chart_history_points[c][2 * k];
+      if (pair[0] != lo || pair[1] != hi) {
+        pair[0] = lo;
+        pair[1] = hi;
+        plot_damage_mark(&chart_damage, 2 * k, 2);
+      }
+    }
+  }
+  chart_history_drawn_ms = millis();
+}
+
 static void update_chart_req(lv_timer_t *t) {
-  int* arr = static_cast<int*>(t->user_data);
-  char* msg_to_send=(char*)malloc(MAX_MSG_LEN);
-  int pos = 0;
-  String is_motor_str =String(arr[0]);
-  strcpy(&(msg_to_send[pos]), is_motor_str.c_str());
-  pos+=is_motor_str.length();
-  strcpy(&msg_to_send[pos++],"|");
-  String hardware_id_str =String(arr[1]);
-  strcpy(&(msg_to_send[pos]), hardware_id_str.c_str());
+  // One READ_REQ per tick, the channels take turns
+  static int next_channel = 0;
+  if (chart_series_count == 0) {
+    return;
+  }
+  next_channel = (next_channel + 1) % chart_series_count;
+  // is_motor | hardware id, sent every chart tick so keep it off the heap
+  char msg_to_send[MAX_MSG_LEN];
+  snprintf(msg_to_send, sizeof(msg_to_send), "%d|%d", chart_channels[next_channel].is_motor, chart_channels[next_channel].id);
   SendNotifyToClient(msg_to_send, READ_REQ, pCharacteristic);
-  free(msg_to_send);
 }
 
 
 
-// Timer callback to update the chart
-static void update_chart(lv_timer_t *t) {
-    lv_chart_set_next_value(chart, ser, get_sensor_value());
+// Adds a value to one series and leaves a gap after the newest point (invalidate_chart_damage() afterwards)
+static void chart_add_value(lv_chart_series_t* series, lv_coord_t value) {
+    lv_chart_set_next_value(chart, series, value);
 
     // Create a gap by setting the next few points to LV_CHART_POINT_NONE
     uint16_t p = lv_chart_get_point_count(chart);
-    uint16_t s = lv_chart_get_x_start_point(chart, ser);
-    lv_coord_t *a = lv_chart_get_y_array(chart, ser);
+    uint16_t s = lv_chart_get_x_start_point(chart, series);
+    lv_coord_t *a = lv_chart_get_y_array(chart, series);
+    for (int i = 1; i <= 9; i++) {
+      a[(s + i) % p] = LV_CHART_POINT_NONE;
+    }
+    plot_damage_mark(&chart_damage, (s + p - 1) % p, 11);
+}
+
+// Timer callback to update the chart
+static void update_chart(lv_timer_t *t) {
+    if (!chart) {
+      return;
+    }
+    for (int c = 0; c < chart_series_count; c++) {
+      chart_add_value(chart_series[c], get_sensor_value());
+    }
+    invalidate_chart_damage();
+}
+
+// Timer callback that moves the pushed telemetry samples to their series
+static void update_chart_push(lv_timer_t *t) {
+    PollClockSync(pCharacteristic);
+    int16_t values[TELEMETRY_PENDING_SIZE];
+    uint8_t channels[TELEMETRY_PENDING_SIZE];
+    uint32_t times[TELEMETRY_PENDING_SIZE];
+    int count = TakeTelemetry(values, channels, times, TELEMETRY_PENDING_SIZE);
+    uint32_t now_ms = millis();
+    uint32_t now_us = micros();
+    for (int i = 0; i < count; i++) {
+      if (channels[i] < chart_series_count) {
+        history_add(&chart_history, &chart_channels[channels[i]], now_ms - (int32_t)(now_us - times[i]) / 1000, values[i]);
+      }
+    }
+    if (chart && chart_shows_history()) {
+      if (now_ms - chart_history_drawn_ms >= CHART_HISTORY_REDRAW_MS) {
+        draw_chart_history();
+      }
+      invalidate_chart_damage();
+      return;
+    }
+    if (!chart || (count == 0 && !plot_damage_pending(&chart_damage))) {
+      return;
+    }
+    for (int i = 0; i < count; i++) {
+      if (channels[i] < chart_series_count) {
+        downsample_series_add(&chart_traces[channels[i]], times[i], values[i]);
+      }
+    }
+    // Leave a gap after the newest bucket of every series, then redraw what changed
+    for (int c = 0; c < chart_series_count; c++) {
+      downsample_series_gap(&chart_traces[c], chart_push_gap);
+      plot_damage_add_series(&chart_damage, &chart_traces[c]);
+    }
+    invalidate_chart_damage();
+}
+
+static const char* chart_channel_name(const struct telemetry_channel* ch) {
+  return ConfigName(ch->is_motor ? handConfig.motors[ch->id].name : handConfig.sensors[ch->id].name);
+}
+
+// Chart title: the channel names, each in the colour of its series
+static void update_chart_title() {
+  char title[TELEMETRY_MAX_CHANNELS * 40];
+  size_t len = 0;
+  title[0] = '\0';
+  for (int c = 0; c < chart_series_count && len < sizeof(title); c++) {
+    len += snprintf(title + len, sizeof(title) - len, "%s#%06x %s#", c ? "  " : "",
+                    (unsigned)chart_series_colors[c], chart_channel_name(&chart_channels[c]));
+  }
+  lv_label_set_text(title_label_bug, title);
+  lv_obj_set_style_text_font(title_label_bug, chart_series_count > 1 ? &lv_font_montserrat_12 : &lv_font_montserrat_18, 0);
+}
+
+// Sizes the buckets for the chosen window and points every series at its (empty)
+// trace, or at its history for the longer windows
+static void chart_reset_traces() {
+  if (chart_shows_history()) {
+    uint16_t columns = history_columns(chart_window - CHART_LIVE_WINDOWS, chart_push_columns);
+    lv_chart_set_point_count(chart, 2 * columns);
+    reset_chart_damage(2 * columns);
+    for (int c = 0; c < chart_series_count; c++) {
+      for (int i = 0; i < 2 * DOWNSAMPLE_MAX_BUCKETS; i++) {
+        chart_history_points[c][i] = LV_CHART_POINT_NONE;
+      }
+      lv_chart_set_ext_y_array(chart, chart_series[c], chart_history_points[c]);
+      lv_chart_set_x_start_point(chart, chart_series[c], 0);
+    }
+    draw_chart_history();
+    return;
+  }
+  uint32_t window_us = chart_windows_ms[chart_window] * 1000;
+  uint16_t buckets = downsample_bucket_count(window_us, 1000000 / TELEMETRY_RATE_HZ, chart_push_columns);
+  lv_chart_set_point_count(chart, 2 * buckets);
+  reset_chart_damage(2 * buckets);
+  for (int c = 0; c < chart_series_count; c++) {
+    downsample_series_init(&chart_traces[c], window_us, buckets, LV_CHART_POINT_NONE);
+    lv_chart_set_ext_y_array(chart, chart_series[c], chart_traces[c].points);
+    lv_chart_set_x_start_point(chart, chart_series[c], 0);
+  }
+}
+
+// Adds a series for the sensor / motor unless it is shown already. Motors use the
+// secondary axis. Returns false when the chart has TELEMETRY_MAX_CHANNELS series.
+static bool chart_add_channel(bool is_motor, int id) {
+  for (int c = 0; c < chart_series_count; c++) {
+    if (chart_channels[c].is_motor == is_motor && chart_channels[c].id == id) {
+      return true;
+    }
+  }
+  if (chart_series_count == TELEMETRY_MAX_CHANNELS) {
+    return false;
+  }
+  chart_channels[chart_series_count].is_motor = is_motor;
+  chart_channels[chart_series_count].id = id;
+  chart_series[chart_series_count] = lv_chart_add_series(chart, lv_color_hex(chart_series_colors[chart_series_count]),
+                                                         is_motor ? LV_CHART_AXIS_SECONDARY_Y : LV_CHART_AXIS_PRIMARY_Y);
+  chart_series_count++;
+  // Start every series over so they share the time axis
+  if (chart_push_telemetry) {
+    chart_reset_traces();
+  }
+  for (int c = 0; c < chart_series_count; c++) {
+    lv_chart_set_all_value(chart, chart_series[c], LV_CHART_POINT_NONE);
+    lv_chart_set_x_start_point(chart, chart_series[c], 0);
+  }
+  return true;
+}
 
-    a[(s + 1) % p] = LV_CHART_POINT_NONE;
-    a[(s + 2) % p] = LV_CHART_POINT_NONE;
-    a[(s + 3) % p] = LV_CHART_POINT_NONE;
-    a[(s + 4) % p] = LV_CHART_POINT_NONE;
-    a[(s + 5) % p] = LV_CHART_POINT_NONE;
-    a[(s + 6) % p] = LV_CHART_POINT_NONE;
-    a[(s + 7) % p] = LV_CHART_POINT_NONE;
-    a[(s + 8) % p] = LV_CHART_POINT_NONE;
-    a[(s + 9) % p] = LV_CHART_POINT_NONE;
+// Chart window dropdown (pushed telemetry only): the buckets get longer, not more
+static void chart_window_event_cb(lv_event_t * e) {
+    chart_window = lv_dropdown_get_selected(chart_window_dropdown);
+    chart_reset_traces();
+    lv_chart_refresh(chart);   // the point count changed, draw it all once
+}
+
+static lv_obj_t* create_chart_window_dropdown(lv_obj_t* parent) {
+  lv_obj_t * dropdown = lv_dropdown_create(parent);
+  lv_obj_set_width(dropdown, 70);
+  lv_obj_align(dropdown, LV_ALIGN_TOP_LEFT, -10, -10);
+  lv_dropdown_set_options(dropdown, chart_window_options);
+  lv_dropdown_set_selected(dropdown, chart_window);
+  lv_obj_add_event_cb(dropdown, chart_window_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
+  return dropdown;
+}
+
+// (Re)starts the chart timer for the current channels; pushed telemetry is resubscribed
+static void start_chart_updates() {
+    if (chart_timer) {
+      lv_timer_del(chart_timer); // Stop the timer
+      chart_timer = NULL;
+    }
+    if(is_demo_yaml.test_and_set()){
+      chart_timer = lv_timer_create(update_chart, 200, NULL); // update_chart without BLE
 
-    lv_chart_refresh(chart);
+    }else if (chart_push_telemetry){
+      is_demo_yaml.clear();
+      SubscribeTelemetry(chart_channels, chart_series_count, pCharacteristic);
+      chart_timer = lv_timer_create(update_chart_push, chart_push_period_ms, NULL); // samples are pushed, just draw them
+    }else{
+      is_demo_yaml.clear();
+      chart_timer = lv_timer_create(update_chart_req, 200, NULL); // update_chart_req - request
+    }
+}
+
+// "Add" dropdown on the chart: options are all sensors, then all motors
+static void add_series_event_cb(lv_event_t * e) {
+    int selected = lv_dropdown_get_selected(add_series_dropdown);
+    bool is_motor = selected >= (int)handConfig.sensor_count;
+    int id = is_motor ? selected - (int)handConfig.sensor_count : selected;
+    if (is_motor && id >= (int)handConfig.motor_count) {
+      return;
+    }
+    int count_before = chart_series_count;
+    chart_add_channel(is_motor, id);
+    if (chart_series_count == count_before) {
+      return;
+    }
+    update_chart_title();
+    start_chart_updates();
+    if (chart_series_count == TELEMETRY_MAX_CHANNELS) {
+      lv_obj_add_flag(add_series_dropdown, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+static lv_obj_t* create_add_series_dropdown(lv_obj_t* parent) {
+  String options;
+  for (uint8_t i = 0; i < handConfig.sensor_count; i++) {
+    options += options.length() ? "\nSensor: " : "Sensor: ";
+    options += ConfigName(handConfig.sensors[i].name);
+  }
+  for (uint8_t i = 0; i < handConfig.motor_count; i++) {
+    options += options.length() ? "\nMotor: " : "Motor: ";
+    options += ConfigName(handConfig.motors[i].name);
+  }
+  lv_obj_t * dropdown = lv_dropdown_create(parent);
+  lv_obj_set_width(dropdown, 70);
+  lv_obj_align(dropdown, LV_ALIGN_TOP_RIGHT, 10, -10);
+  lv_dropdown_set_options(dropdown, options.c_str());
+  lv_dropdown_set_text(dropdown, "Add");
+  lv_obj_add_event_cb(dropdown, add_series_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
+  return dropdown;
 }
 
 // Button event callback to show the chart
@@ -883,25 +1153,17 @@ static void show_chart_event_cb(bool is_motor, int id) {
     lv_obj_set_size(chart, 280, 125);
     lv_obj_align(chart, LV_ALIGN_BOTTOM_MID, 0, -30);
 
-    // Set chart parameters
-    lv_chart_set_point_count(chart, num_points);
-    ser = lv_chart_add_series(chart, HEX_DARK_BLUE, LV_CHART_AXIS_PRIMARY_Y);
-    lv_obj_set_style_size(chart, 0, LV_PART_INDICATOR);    
-    static int arr[2];  // Declare static array without initialization
-    arr[0] = (int)is_motor;  // Update dynamically
-    arr[1] = id;
-
-    if(is_demo_yaml.test_and_set()){
-      if (chart_timer) {
-        lv_timer_del(chart_timer); // Stop the timer
-        chart_timer = NULL;
-      }
-      chart_timer = lv_timer_create(update_chart, 200, static_cast<void*>(arr)); // update_chart without BLE
-
-    }else{
+    // Set chart parameters; pushed telemetry is denser, keep about 2 s on screen
+    chart_push_telemetry = TELEMETRY_PUSH && !is_demo_yaml.test_and_set();
+    if (chart_push_telemetry) {
       is_demo_yaml.clear();
-      chart_timer = lv_timer_create(update_chart_req, 200, static_cast<void*>(arr)); // update_chart_req - request
     }
+    lv_chart_set_point_count(chart, num_points);   // chart_reset_traces() sets it for pushed telemetry
+    reset_chart_damage(num_points);
+    lv_obj_set_style_size(chart, 0, LV_PART_INDICATOR);    
+    chart_series_count = 0;
+    chart_add_channel(is_motor, id);
+    start_chart_updates();
 
     // Create the "Close Chart" button
     close_chart_btn = lv_btn_create(debug_tab);
@@ -918,11 +1180,20 @@ static void show_chart_event_cb(bool is_motor, int id) {
 
     lv_obj_add_event_cb(close_chart_btn, close_chart_event_cb, LV_EVENT_CLICKED, NULL);
 
+    // Further sensors / motors can be added to the same chart
+    add_series_dropdown = create_add_series_dropdown(debug_tab);
+    if (chart_push_telemetry) {
+      chart_window_dropdown = create_chart_window_dropdown(debug_tab);
+    }
+
     // Create a title label
     title_label_bug = lv_label_create(debug_tab); 
-    lv_label_set_text(title_label_bug, selected_text_to_title);
+    lv_label_set_recolor(title_label_bug, true);
+    lv_label_set_long_mode(title_label_bug, LV_LABEL_LONG_DOT);
+    lv_obj_set_width(title_label_bug, 190);
+    lv_obj_set_style_text_align(title_label_bug, LV_TEXT_ALIGN_CENTER, 0);
     lv_obj_align(title_label_bug, LV_ALIGN_TOP_MID, 0, 0); 
-    lv_obj_set_style_text_font(title_label_bug, &lv_font_montserrat_18, 0);
+    update_chart_title();
 }
 // Button event callback to close the chart
 static void close_chart_event_cb(lv_event_t * e) {
@@ -930,6 +1201,13 @@ static void close_chart_event_cb(lv_event_t * e) {
     lv_timer_del(chart_timer); // Stop the timer
     chart_timer = NULL;
   }
+  if (has_client.test_and_set()) {
+    if (TELEMETRY_PUSH) {
+      UnsubscribeTelemetry(pCharacteristic); // Stop the pushed samples
+    }
+  } else {
+    has_client.clear();
+  }
   
   delay(200); // To make sure that the last message was handled properly
 
@@ -941,7 +1219,15 @@ static void close_chart_event_cb(lv_event_t * e) {
     lv_obj_del(close_chart_btn);
     close_chart_btn = NULL;
   }
-  ser = NULL;
+  if (add_series_dropdown) {
+    lv_obj_del(add_series_dropdown);
+    add_series_dropdown = NULL;
+  }
+  if (chart_window_dropdown) {
+    lv_obj_del(chart_window_dropdown);
+    chart_window_dropdown = NULL;
+  }
+  chart_series_count = 0;
   if(title_label_bug){
     lv_obj_del(title_label_bug);
     title_label_bug = NULL;
@@ -958,92 +1244,28 @@ static void dropdown_event_debug_cb(lv_event_t * e) {
     lv_obj_t * dropdown = lv_event_get_target(e);
     char selected_text[32]; // Buffer for selected item
     lv_dropdown_get_selected_str(dropdown, selected_text, sizeof(selected_text));
-    strcpy(selected_text_to_title,selected_text);
     
-    String selected_text_str = String(selected_text);
-
     // Determine if this is the motors dropdown or sensors dropdown
     bool is_motor = (dropdown == dropdown_motors_bug);
 
-    int id = 0;
-
-    if (is_motor) {
-        for (const auto& motor : motors) { 
-            if (motor.name == selected_text_str) {
-                break;
-            }
-            id++;
-        }
-        if (id == motors.size()){
-          return;
-        }
-    } else {
-        for (const auto& sensor : sensors) {
-            if (sensor.name == selected_text_str) {
-                break;
-            }
-            id++;
-        }
-        if (id == sensors.size()){
-          return;
-        }
-    }    
+    int id = config_index_find(HandIndex(), &handConfig, is_motor ? CONFIG_INDEX_MOTORS : CONFIG_INDEX_SENSORS, selected_text);
+    if (id < 0){
+      return;
+    }
     show_chart_event_cb(is_motor, id);
 }
 
-char* get_options_string(bool is_motors){
-  int totalLength  = 0;
-  if(is_motors){
-
-    for (const auto& motor : motors) {
-      totalLength += motor.name.length() + 1;
-
-    }
-    if (totalLength == 0) return nullptr; // No motors, return nullptr
-    // Allocate memory for the total length + 1 for the null terminator
-    char* result = (char*) malloc(totalLength + 1);
-    if (result == nullptr) return nullptr; // Failed to allocate memory
-
-    // Concatenate all names into the allocated space
-    char* currentPos = result;
-    for (const auto& motor : motors) {
-        strcpy(currentPos, motor.name.c_str()); // Copy the motor name
-        currentPos += motor.name.length();      // Move the pointer
-        *currentPos = '\n';                     // Add a newline character
-        currentPos++;                           // Move past the newline
-    }
-    *(currentPos - 1) = '\0'; // Replace the last newline with a null terminator
-    return result;
-    
-  }
-  else{
-    for (const auto& sensor : sensors) {
-      totalLength += sensor.name.length() + 1;
-
-    }
-    if (totalLength == 0) return nullptr; // No motors, return nullptr
-    // Allocate memory for the total length + 1 for the null terminator
-    char* result = (char*) malloc(totalLength + 1);
-    if (result == nullptr) return nullptr; // Failed to allocate memory
-
-    // Concatenate all names into the allocated space
-    char* currentPos = result;
-    for (const auto& sensor : sensors) {
-        strcpy(currentPos, sensor.name.c_str()); // Copy the motor name
-        currentPos += sensor.name.length();      // Move the pointer
-        *currentPos = '\n';                     // Add a newline character
-        currentPos++;                           // Move past the newline
-    }
-    *(currentPos - 1) = '\0'; // Replace the last newline with a null terminator
-        
-    return result;
-  }
+// The names of the motors or sensors, one per line, as a dropdown takes them (it
+// copies them). Kept by the index, NULL when there are none.
+const char* get_options_string(bool is_motors){
+  const char* options = config_index_options(HandIndex(), is_motors ? CONFIG_INDEX_MOTORS : CONFIG_INDEX_SENSORS);
+  return options[0] ? options : nullptr;
 }
 
 lv_obj_t* create_dropdown_debug(lv_obj_t* parent, bool is_motors){
   lv_obj_t * dropdown = lv_dropdown_create(parent);
   lv_obj_align(dropdown, LV_ALIGN_TOP_LEFT, -10, -10);
-  char* options = get_options_string(is_motors);
+  const char* options = get_options_string(is_motors);
   if(is_motors){
     lv_dropdown_set_text(dropdown, "Motor");
   } else{
@@ -1052,9 +1274,6 @@ lv_obj_t* create_dropdown_debug(lv_obj_t* parent, bool is_motors){
   lv_dropdown_set_options(dropdown,options);
   lv_dropdown_set_selected_highlight(dropdown, true);
   lv_obj_add_event_cb(dropdown, dropdown_event_debug_cb, LV_EVENT_VALUE_CHANGED, NULL); // Attach event
-  if (options){
-    free(options);
-  }
   return dropdown;
 }
 
@@ -1086,28 +1305,20 @@ void create_controls_for_debug(lv_obj_t* parent) {
 lv_obj_t* create_motors_tech(lv_obj_t* parent){
   lv_obj_t * dropdown = lv_dropdown_create(parent);
   lv_obj_align(dropdown, LV_ALIGN_TOP_LEFT, -10, -10);
-  char* options = get_options_string(true);
+  const char* options = get_options_string(true);
   lv_dropdown_set_text(dropdown, "Motor");
   lv_dropdown_set_options(dropdown,options);
   lv_dropdown_set_selected_highlight(dropdown, true);
-  if (options){
-    free(options);
-  }
   return dropdown;
 }
 
 lv_obj_t* create_sensors_tech(lv_obj_t* parent){
   lv_obj_t * dropdown = lv_dropdown_create(parent);
   lv_obj_align(dropdown, LV_ALIGN_TOP_LEFT, -10, -10);
-  char* options = get_options_string(false);
+  const char* options = get_options_string(false);
   lv_dropdown_set_options(dropdown,options);
   lv_dropdown_set_text(dropdown, "Sensor");
   lv_dropdown_set_selected_highlight(dropdown, true);
-
-
-  if (options){
-    free(options);
-  }
   return dropdown;
 }
 
@@ -1143,14 +1354,14 @@ struct Return_unsaved_param check_unsave_sensor_param(){
   std::vector<int> ret_params_id;
   std::vector<int> ret_new_vals;
   ret_struct.sensor_id = current_edit_sensor_id;
-  int i = 0;
   if(current_edit_sensor_sliders_vec.size() > 0){
-    for (const auto& [paramName, param] : sensors[current_edit_sensor_id].function.parameters){
-      if(param.current_val != lv_slider_get_value(current_edit_sensor_sliders_vec[i])){
+    const struct config_model_sensor& sensor = handConfig.sensors[current_edit_sensor_id];
+    const struct config_model_param* params = config_model_sensor_params(&handConfig, &sensor);
+    for (int i = 0; i < sensor.param_count; i++){
+      if(params[i].current_val != lv_slider_get_value(current_edit_sensor_sliders_vec[i])){
         ret_params_id.push_back(i);
         ret_new_vals.push_back(lv_slider_get_value(current_edit_sensor_sliders_vec[i]));
       }
-      i++;
     }
   }
 
@@ -1168,7 +1379,7 @@ struct Return_unsaved_param check_unsave_motor_param(){
   ret_struct.sensor_id = current_edit_motor_id;
   int i = 0;
   if(current_edit_motor_sliders_vec.size() > 0){
-    if(motors[current_edit_motor_id].safety_threshold.current_val != lv_slider_get_value(current_edit_motor_sliders_vec[i])){
+    if(handConfig.motors[current_edit_motor_id].safety_threshold.current_val != lv_slider_get_value(current_edit_motor_sliders_vec[i])){
       ret_params_id.push_back(i);
       ret_new_vals.push_back(lv_slider_get_value(current_edit_motor_sliders_vec[i]));
     }
@@ -1243,7 +1454,7 @@ void event_view_and_edit_motors(lv_event_t* e){
   if(obj){
     id = lv_dropdown_get_selected(obj);
   }
-  Motor& motor = motors[id];
+  const struct config_model_motor& motor = handConfig.motors[id];
   if( ((current_edit_motor_id != -1) && (current_edit_motor_id != id)) || motor_trigged_by_tech_tab ){
 
     if(check_unsave_motor_param().params_id.size() != 0 ){
@@ -1362,8 +1573,8 @@ void event_view_and_edit_motors(lv_event_t* e){
       obj_to_delete_motors.push_back(label_motor_type);
       y_offset += 25;
 
-      lv_label_set_text_fmt(label_motor_name, "Name: %s", motor.name.c_str());
-      lv_label_set_text_fmt(label_motor_type, "Type: %s", motor.type.c_str());
+      lv_label_set_text_fmt(label_motor_name, "Name: %s", ConfigName(motor.name));
+      lv_label_set_text_fmt(label_motor_type, "Type: %s", ConfigName(motor.type));
 
       lv_obj_t * label_motor_PIN = lv_label_create(parent);
       lv_obj_set_width(label_motor_PIN, 180); // Set width for better display
@@ -1375,13 +1586,15 @@ void event_view_and_edit_motors(lv_event_t* e){
       y_offset += 20;
       // Iterate over all parameters
       int i = 0;
-      for (const auto& param: motor.pins) {
+      const struct config_model_pin* pins = config_model_motor_pins(&handConfig, &motor);
+      for (uint8_t p = 0; p < motor.pin_count; p++) {
+            const struct config_model_pin& param = pins[p];
             lv_obj_t * label_pin_type = lv_label_create(parent);
             lv_obj_set_width(label_pin_type, 180); // Set width for better display
             lv_obj_align(label_pin_type, LV_ALIGN_TOP_LEFT, -10, y_offset);
             lv_obj_set_style_text_font(label_pin_type, &lv_font_montserrat_12, 0);
             obj_to_delete_motors.push_back(label_pin_type);
-            lv_label_set_text_fmt(label_pin_type, "Pin Type: %s", param.type.c_str());
+            lv_label_set_text_fmt(label_pin_type, "Pin Type: %s", ConfigName(param.type));
             y_offset += 20; 
 
             lv_obj_t * label_pin_number = lv_label_create(parent);
@@ -1505,8 +1718,8 @@ void event_view_and_edit_motors(lv_event_t* e){
     obj_to_delete_motors.push_back(label_motor_type);
     y_offset += 25;
 
-    lv_label_set_text_fmt(label_motor_name, "Name: %s", motor.name.c_str());
-    lv_label_set_text_fmt(label_motor_type, "Type: %s", motor.type.c_str());
+    lv_label_set_text_fmt(label_motor_name, "Name: %s", ConfigName(motor.name));
+    lv_label_set_text_fmt(label_motor_type, "Type: %s", ConfigName(motor.type));
 
     lv_obj_t * label_motor_PIN = lv_label_create(parent);
     lv_obj_set_width(label_motor_PIN, 180); // Set width for better display
@@ -1518,13 +1731,15 @@ void event_view_and_edit_motors(lv_event_t* e){
     y_offset += 20;
     // Iterate over all parameters
     int i = 0;
-    for (const auto& param: motor.pins) {
+    const struct config_model_pin* pins = config_model_motor_pins(&handConfig, &motor);
+    for (uint8_t p = 0; p < motor.pin_count; p++) {
+          const struct config_model_pin& param = pins[p];
           lv_obj_t * label_pin_type = lv_label_create(parent);
           lv_obj_set_width(label_pin_type, 180); // Set width for better display
           lv_obj_align(label_pin_type, LV_ALIGN_TOP_LEFT, -10, y_offset);
           lv_obj_set_style_text_font(label_pin_type, &lv_font_montserrat_12, 0);
           obj_to_delete_motors.push_back(label_pin_type);
-          lv_label_set_text_fmt(label_pin_type, "Pin Type: %s", param.type.c_str());
+          lv_label_set_text_fmt(label_pin_type, "Pin Type: %s", ConfigName(param.type));
           y_offset += 20; 
 
           lv_obj_t * label_pin_number = lv_label_create(parent);
@@ -1550,7 +1765,7 @@ void event_view_and_edit_sensors(lv_event_t* e){
   if(obj){
     id = lv_dropdown_get_selected(obj);
   }
-  Sensor& sensor = sensors[id];
+  const struct config_model_sensor& sensor = handConfig.sensors[id];
 
   if( ((current_edit_sensor_id != -1) && (current_edit_sensor_id != id)) || sensor_trigged_by_tech_tab ){
 
@@ -1590,19 +1805,21 @@ void event_view_and_edit_sensors(lv_event_t* e){
         y_offset += 20;
         // Iterate over all parameters
         int i = 0;
-        for (const auto& param : sensor.function.parameters) {
+        const struct config_model_param* params = config_model_sensor_params(&handConfig, &sensor);
+        for (uint8_t p = 0; p < sensor.param_count; p++) {
+            const struct config_model_param& param = params[p];
 
             // Create a label for parameter name
             lv_obj_t* param_label = lv_label_create(parent);
-            lv_label_set_text_fmt(param_label, "%s:", param.first.c_str());
+            lv_label_set_text_fmt(param_label, "%s:", ConfigName(param.name));
             lv_obj_align(param_label, LV_ALIGN_TOP_LEFT, -10, y_offset);
             lv_obj_set_style_text_font(param_label,&lv_font_montserrat_12,0);
             obj_to_delete_sensors.push_back(param_label);
 
             y_offset += 20;
             lv_obj_t* slider = lv_slider_create(parent);
-            lv_slider_set_range(slider, param.second.min, param.second.max);
-            lv_slider_set_value(slider, param.second.current_val, LV_ANIM_OFF);
+            lv_slider_set_range(slider, param.min, param.max);
+            lv_slider_set_value(slider, param.current_val, LV_ANIM_OFF);
             lv_obj_add_flag(slider, LV_OBJ_FLAG_ADV_HITTEST);
             lv_obj_set_size(slider, 140, 8);
             lv_obj_align(slider, LV_ALIGN_TOP_LEFT, 10, y_offset);
@@ -1619,13 +1836,13 @@ void event_view_and_edit_sensors(lv_event_t* e){
             lv_obj_set_style_border_color(slider, HEX_BLACK,LV_PART_INDICATOR);
 
             lv_obj_t* min_value_label = lv_label_create(parent);
-            lv_label_set_text_fmt(min_value_label, "%d", param.second.min);
+            lv_label_set_text_fmt(min_value_label, "%d", param.min);
             lv_obj_align(min_value_label, LV_ALIGN_TOP_LEFT, -10, y_offset-5);
             lv_obj_set_style_text_font(min_value_label,&lv_font_montserrat_12,0);
             obj_to_delete_sensors.push_back(min_value_label);
 
             lv_obj_t* max_value_label = lv_label_create(parent);
-            lv_label_set_text_fmt(max_value_label, "%d", param.second.max);
+            lv_label_set_text_fmt(max_value_label, "%d", param.max);
             lv_obj_align(max_value_label, LV_ALIGN_TOP_LEFT, 155, y_offset-5);
             lv_obj_set_style_text_font(max_value_label,&lv_font_montserrat_12,0);
             obj_to_delete_sensors.push_back(max_value_label);
@@ -1634,7 +1851,7 @@ void event_view_and_edit_sensors(lv_event_t* e){
             y_offset += 10;
             // Create a label to display the current value
             lv_obj_t* value_label = lv_label_create(parent);
-            lv_label_set_text_fmt(value_label, "%d", param.second.current_val);
+            lv_label_set_text_fmt(value_label, "%d", param.current_val);
             lv_obj_align(value_label, LV_ALIGN_TOP_LEFT, 75,y_offset);
             obj_to_delete_sensors.push_back(value_label);
             current_edit_sensor_sliders_vec.push_back(slider);
@@ -1648,7 +1865,7 @@ void event_view_and_edit_sensors(lv_event_t* e){
             lv_obj_set_user_data(slider, value_label);
 
             // If parameter is not editable, disable the slider
-            if (!param.second.modify_permission) {
+            if (!param.modify_permission) {
                 lv_obj_add_state(slider, LV_STATE_DISABLED);
             } 
             i++;  
@@ -1686,9 +1903,9 @@ void event_view_and_edit_sensors(lv_event_t* e){
         obj_to_delete_sensors.push_back(label_sensor_type);
         y_offset += 20;
 
-        lv_label_set_text_fmt(label_sensor_name, "Name: %s", sensor.name.c_str());
-        lv_label_set_text_fmt(label_sensor_status, "Status: %s", sensor.status.c_str());
-        lv_label_set_text_fmt(label_sensor_type, "Type: %s", sensor.type.c_str());
+        lv_label_set_text_fmt(label_sensor_name, "Name: %s", ConfigName(sensor.name));
+        lv_label_set_text_fmt(label_sensor_status, "Status: %s", sensor.status == CONFIG_STATUS_ON ? "on" : "off");
+        lv_label_set_text_fmt(label_sensor_type, "Type: %s", ConfigName(sensor.type));
 
         lv_obj_add_event_cb(save_btn_tech_sensors, save_btn_tech_sensor_click_event, LV_EVENT_CLICKED, NULL); // Set the event handler
         lv_obj_add_event_cb(save_btn_tech_sensors, save_btn_tech_sensor_approved, EVENT_SENSOR_CHANGED_SECC, NULL); // Set the event handler
@@ -1723,19 +1940,21 @@ void event_view_and_edit_sensors(lv_event_t* e){
         y_offset += 20;
         // Iterate over all parameters
         int i = 0;
-        for (const auto& param : sensor.function.parameters) {
+        const struct config_model_param* params = config_model_sensor_params(&handConfig, &sensor);
+        for (uint8_t p = 0; p < sensor.param_count; p++) {
+            const struct config_model_param& param = params[p];
 
             // Create a label for parameter name
             lv_obj_t* param_label = lv_label_create(parent);
-            lv_label_set_text_fmt(param_label, "%s:", param.first.c_str());
+            lv_label_set_text_fmt(param_label, "%s:", ConfigName(param.name));
             lv_obj_align(param_label, LV_ALIGN_TOP_LEFT, -10, y_offset);
             lv_obj_set_style_text_font(param_label,&lv_font_montserrat_12,0);
             obj_to_delete_sensors.push_back(param_label);
 
             y_offset += 20;
             lv_obj_t* slider = lv_slider_create(parent);
-            lv_slider_set_range(slider, param.second.min, param.second.max);
-            lv_slider_set_value(slider, param.second.current_val, LV_ANIM_OFF);
+            lv_slider_set_range(slider, param.min, param.max);
+            lv_slider_set_value(slider, param.current_val, LV_ANIM_OFF);
             lv_obj_add_flag(slider, LV_OBJ_FLAG_ADV_HITTEST);
             lv_obj_set_size(slider, 140, 8);
             lv_obj_align(slider, LV_ALIGN_TOP_LEFT, 10, y_offset);
@@ -1752,13 +1971,13 @@ void event_view_and_edit_sensors(lv_event_t* e){
             lv_obj_set_style_border_color(slider, HEX_BLACK,LV_PART_INDICATOR);
 
             lv_obj_t* min_value_label = lv_label_create(parent);
-            lv_label_set_text_fmt(min_value_label, "%d", param.second.min);
+            lv_label_set_text_fmt(min_value_label, "%d", param.min);
             lv_obj_align(min_value_label, LV_ALIGN_TOP_LEFT, -10, y_offset-5);
             lv_obj_set_style_text_font(min_value_label,&lv_font_montserrat_12,0);
             obj_to_delete_sensors.push_back(min_value_label);
 
             lv_obj_t* max_value_label = lv_label_create(parent);
-            lv_label_set_text_fmt(max_value_label, "%d", param.second.max);
+            lv_label_set_text_fmt(max_value_label, "%d", param.max);
             lv_obj_align(max_value_label, LV_ALIGN_TOP_LEFT, 155, y_offset-5);
             lv_obj_set_style_text_font(max_value_label,&lv_font_montserrat_12,0);
             obj_to_delete_sensors.push_back(max_value_label);
@@ -1767,7 +1986,7 @@ void event_view_and_edit_sensors(lv_event_t* e){
             y_offset += 10;
             // Create a label to display the current value
             lv_obj_t* value_label = lv_label_create(parent);
-            lv_label_set_text_fmt(value_label, "%d", param.second.current_val);
+            lv_label_set_text_fmt(value_label, "%d", param.current_val);
             lv_obj_align(value_label, LV_ALIGN_TOP_LEFT, 75,y_offset);
             obj_to_delete_sensors.push_back(value_label);
             current_edit_sensor_sliders_vec.push_back(slider);
@@ -1781,7 +2000,7 @@ void event_view_and_edit_sensors(lv_event_t* e){
             lv_obj_set_user_data(slider, value_label);
 
             // If parameter is not editable, disable the slider
-            if (!param.second.modify_permission) {
+            if (!param.modify_permission) {
                 lv_obj_add_state(slider, LV_STATE_DISABLED);
             } 
             i++;  
@@ -1819,9 +2038,9 @@ void event_view_and_edit_sensors(lv_event_t* e){
         obj_to_delete_sensors.push_back(label_sensor_type);
         y_offset += 20;
 
-        lv_label_set_text_fmt(label_sensor_name, "Name: %s", sensor.name.c_str());
-        lv_label_set_text_fmt(label_sensor_status, "Status: %s", sensor.status.c_str());
-        lv_label_set_text_fmt(label_sensor_type, "Type: %s", sensor.type.c_str());
+        lv_label_set_text_fmt(label_sensor_name, "Name: %s", ConfigName(sensor.name));
+        lv_label_set_text_fmt(label_sensor_status, "Status: %s", sensor.status == CONFIG_STATUS_ON ? "on" : "off");
+        lv_label_set_text_fmt(label_sensor_type, "Type: %s", ConfigName(sensor.type));
 
         lv_obj_add_event_cb(save_btn_tech_sensors, save_btn_tech_sensor_click_event, LV_EVENT_CLICKED, NULL); // Set the event handler
         lv_obj_add_event_cb(save_btn_tech_sensors, save_btn_tech_sensor_approved, EVENT_SENSOR_CHANGED_SECC, NULL); // Set the event handler
@@ -1901,6 +2120,8 @@ void setup()
     delay(1500); // milisec
 
 
+    InitConfigCache();
+    history_init(&chart_history);
     xTaskCreate(Start_BLE_server_NIMBLE,"Initialize", STACK_SIZE, nullptr, 2, nullptr);
     // initial atomic flags
     can_play_gesture.test_and_set();
@@ -2008,35 +2229,55 @@ void setupWelcomeScreen() {
 
 void load_yaml_step(lv_event_t* e){
   if(has_client.test_and_set()){
-      if ( send_yaml_request ) {
-        SendNotifyToClient("Please send YAML data", YAML_REQ, pCharacteristic);
-        Serial.println("Sent yaml request");
+      if ( send_yaml_request && StartConfigLoad(pCharacteristic) ) {
+        Serial.println(config_from_cache ? "Loaded yaml from cache" : "Sent yaml request");
         send_yaml_request = false;
       }
+      if (is_config_snapshot_ready){
+        is_config_snapshot_ready = false;
+        uint32_t start = micros();
+        if (config_snapshot_buffer && config_snapshot_load(&handConfig, config_snapshot_buffer, config_snapshot_len)) {
+          Serial.printf("Config snapshot loaded in %u us: %u bytes, %d sensors, %d motors, %d functions\n", micros() - start,
+                        config_snapshot_len, handConfig.sensor_count, handConfig.motor_count, handConfig.function_count);
+          if (!config_from_cache) SaveConfigSnapshot(config_snapshot_buffer, config_snapshot_len);
+          config_from_snapshot = true;
+          yaml_structs_ready = true;
+        }
+        else{
+          // Corrupted or of another version: the YAML sections are asked for instead
+          Serial.println("Config snapshot rejected, downloading the YAML sections");
+          config_snapshot_rejected = true;
+          config_from_cache = false;
+          BeginConfigCache();
+          RequestYAML(pCharacteristic);
+        }
+        free(config_snapshot_buffer);
+        config_snapshot_buffer = NULL;
+      }
       if (is_yml_sensors_ready){
-          sensors.clear(); // making sure to clear demo yaml data before replacong it with real data
-          splitSensorsField((char*)*pointer_to_sensor_buff);
+          if (!config_from_cache) SaveConfigSection(SENSORS_FIELD, (char*)*pointer_to_sensor_buff);
+          if (!is_yml_sensors_parsed) ReplaceConfigSection(CONFIG_SENSORS, (char*)*pointer_to_sensor_buff); // replaces the demo yaml data with the real data
           is_yml_sensors_ready = false;
           free(*pointer_to_sensor_buff);
       }
 
       if (is_yml_motors_ready){
-        motors.clear(); // making sure to clear demo yaml data before replacong it with real data
-        splitMotorsField((char*)*pointer_to_motors_buff);
+        if (!config_from_cache) SaveConfigSection(MOTORS_FIELD, (char*)*pointer_to_motors_buff);
+        if (!is_yml_motors_parsed) ReplaceConfigSection(CONFIG_MOTORS, (char*)*pointer_to_motors_buff); // replaces the demo yaml data with the real data
         is_yml_motors_ready = false;
         free(*pointer_to_motors_buff);
       }
 
       if (is_yml_functions_ready){
-        functions.clear(); // making sure to clear demo yaml data before replacong it with real data
-        splitFunctionsField((char*)*pointer_to_func_buff);
+        if (!config_from_cache) SaveConfigSection(FUNCTIONS_FIELD, (char*)*pointer_to_func_buff);
+        if (!is_yml_functions_parsed) ReplaceConfigSection(CONFIG_FUNCTIONS, (char*)*pointer_to_func_buff); // replaces the demo yaml data with the real data
         is_yml_functions_ready = false;
         free(*pointer_to_func_buff);
       }
 
       if (is_yml_general_ready){
-        generalEntries.clear(); // making sure to clear demo yaml data before replacong it with real data
-        splitGeneralField((char*)*pointer_to_general_buff);
+        if (!config_from_cache) SaveConfigSection(GENERAL_FIELD, (char*)*pointer_to_general_buff);
+        if (!is_yml_general_parsed) ReplaceConfigSection(CONFIG_GENERAL, (char*)*pointer_to_general_buff); // replaces the demo yaml data with the real data
         is_yml_general_ready = false;
         free(*pointer_to_general_buff);
         yaml_structs_ready=true;
@@ -2044,14 +2285,21 @@ void load_yaml_step(lv_event_t* e){
 
       if(yaml_structs_ready){
         yaml_structs_ready = false;
+        if (!config_from_cache && config_digest_received) {
+          CommitConfigCache(config_digest_value);
+        }
         xTaskCreate(bleNotifyTask, "BLE Notify Task", 2048, NULL, 2, &bleNotifyTaskHandle);
         pinMode(buttonPin, INPUT_PULLUP);
         attachInterrupt(buttonPin, buttonPress, RISING);
+        Serial.printf("Config download (%s): %u ms from connect to setupInitialUserScreen\n",
+                      config_from_cache ? "cached" : config_from_snapshot ? "snapshot" : YAML_STREAMED_DOWNLOAD ? "streamed" : "lock-step",
+                      millis() - client_connected_ms);
         setupInitialUserScreen();
       }
       
       else{
         delay(100);
+        PollReassembly(pCharacteristic);
         load_yaml_step(e);
       }
   }
@@ -2108,12 +2356,7 @@ void search_ble_again_event(lv_event_t * e){
 
 void start_demo_event(lv_event_t * e){
   is_demo_yaml.test_and_set();
-  sensors.clear();
-  motors.clear();
-  functions.clear();
-  communications.clear();
-  generalEntries.clear();
-  fileType.clear();
+  config_model_reset(&handConfig);
 
   init_default_yaml();
   setupInitialUserScreen();
@@ -2258,14 +2501,14 @@ void setupInitialUserScreen() {
 
   lv_obj_t* btnm = create_new_matrix_btn_choose_one(initial_user_screen,map_ptr,num_pointer,LV_ALIGN_CENTER,0,20,HEX_SKY_BLUE,HEX_DARK_BLUE,HEX_WHITE);
 
-  for (const auto& user : generalEntries) {
-      if ((strcmp(user.name.c_str(),"Technician_code"))==0){
-        tech_pass = user.code;
-      }
-      else if ((strcmp(user.name.c_str(),"Debug_code"))==0) {
-        debug_pass = user.code;
-      }
-  } 
+  int tech_code_id = config_index_find(HandIndex(), &handConfig, CONFIG_INDEX_GENERAL, "Technician_code");
+  int debug_code_id = config_index_find(HandIndex(), &handConfig, CONFIG_INDEX_GENERAL, "Debug_code");
+  if (tech_code_id >= 0){
+    tech_pass = handConfig.general[tech_code_id].code;
+  }
+  if (debug_code_id >= 0){
+    debug_pass = handConfig.general[debug_code_id].code;
+  }
 
    // Create a new screen
   password_screen = lv_obj_create(NULL); // NULL creates a new screen
@@ -2386,6 +2629,7 @@ void return_to_main(lv_event_t *e) {
 
       current_edit_sensor_sliders_vec.clear();
       current_edit_motor_sliders_vec.clear();
+      stop_stat_updates();
       if(debug_tab){
         delete_debug();
       }
@@ -2396,5 +2640,7 @@ void return_to_main(lv_event_t *e) {
 
 void loop(){
   lv_timer_handler(); /* let the GUI do its work */
+  PollReassembly(pCharacteristic);
+  PollRecording(pCharacteristic);
   delay(5);
 }
@@ -5,7 +5,7 @@
 #include <string>
 #include <Arduino.h>
 #include <vector>
-#include "shared_com_vars.h"
+#include <ProsthesisProtocol.h>
 #include "shared_yaml_parser.h"
 #include "requests.h"
 #include <atomic>
@@ -39,9 +39,19 @@ static bool main_first_time = true;
 
 
 static lv_obj_t *chart;
-static lv_chart_series_t *ser;
+static lv_chart_series_t *chart_series[TELEMETRY_MAX_CHANNELS]; // one series per telemetry channel
+static struct telemetry_channel chart_channels[TELEMETRY_MAX_CHANNELS];
+static int chart_series_count = 0;
 static lv_timer_t *chart_timer;
 static lv_obj_t *close_chart_btn;
+static lv_obj_t *add_series_dropdown;
+static lv_obj_t *chart_window_dropdown;
+// Chart columns to draw again (plot_damage.h): the chart timer and READ_ANS mark the
+// points they write and invalidate only those columns, at most CHART_REDRAW_BUDGET_PX
+// pixels per refresh, instead of lv_chart_refresh() redrawing all 280 x 125 of them
+#define CHART_REDRAW_BUDGET_PX 5000
+#define CHART_LINE_MARGIN_PX 2
+static struct plot_damage chart_damage;
 lv_obj_t* dropdown_motors_bug;
 lv_obj_t* dropdown_sensors_bug;
 lv_obj_t* debug_tabview;
@@ -68,101 +78,93 @@ void bleNotifyTask(void *parameter) {
 // UUIDs for the service and characteristics
 #define SERVICE_UUID        "12345678-1234-5678-1234-56789abcdef0"
 #define CHARACTERISTIC_UUID "12345678-1234-5678-1234-56789abcdef1"
-#define MSG_SIZE (sizeof(struct msg_interp))
 static NimBLEServer *pServer;
 
 
+// The change requests below are packed into one BATCH_CMD_REQ (see batch_cmd.h in ProsthesisProtocol)
+// built in a stack buffer, and send_msg() encodes the frames into one of its own, so
+// sending a request does not allocate. The prosthesis answers once with BATCH_CMD_ANS.
+
+// batch_cmd_add() that logs when the batch is full
+bool add_batch_cmd(struct batch_cmd_writer* batch, uint8_t kind, int id, int param, int value){
+  if (!batch_cmd_add(batch, kind, id, param, value)) {
+    Serial.println("Request does not fit in MAX_MSG_LEN, not sending it");
+    return false;
+  }
+  return true;
+}
+
+void SendBatchCmdReq(const struct batch_cmd_writer* batch){
+  Serial.printf("Sending %d commands in one batch (%d bytes)\n", batch->count, batch_cmd_len(batch));
+  SendBytesToClient(batch->buf, batch_cmd_len(batch), BATCH_CMD_REQ, pCharacteristic);
+}
+
 void SendStatusChangeReq(std::vector<int> sensors_to_on, std::vector<int> sensors_to_off){
-  char* msg_to_send=(char*)malloc(MAX_MSG_LEN);
-  int pos = 0;
-  if (msg_to_send!=NULL) {
-
-    for (int i=0; i<sensors_to_on.size(); i++){
-      String sensor_id =String(sensors_to_on[i]);
-
-      strcpy(&(msg_to_send[pos]), sensor_id.c_str());
-      pos+=sensor_id.length();
-      strcpy(&msg_to_send[pos++],"|");
-      strcpy(&msg_to_send[pos++],"1");
-      if (sensors_to_off.size()>0 || i<sensors_to_on.size()-1) {
-        strcpy(&msg_to_send[pos++],"|");
-      }
+  uint8_t msg_to_send[MAX_MSG_LEN - 1];
+  struct batch_cmd_writer batch;
+  batch_cmd_begin(&batch, msg_to_send, sizeof(msg_to_send));
+  for (int i=0; i<sensors_to_on.size(); i++){
+    if (!add_batch_cmd(&batch, BATCH_SENSOR_STATE, sensors_to_on[i], 0, 1)) {
+      return;
     }
-
-    for (int i=0; i<sensors_to_off.size(); i++){
-      String sensor_id =String(sensors_to_off[i]);
-      strcpy(&(msg_to_send[pos]), sensor_id.c_str());
-      pos+=sensor_id.length();
-      strcpy(&(msg_to_send[pos++]),"|");
-      strcpy(&(msg_to_send[pos++]),"0");
-      if (i<sensors_to_off.size()-1) {
-        strcpy(&(msg_to_send[pos++]),"|");
-      }
+  }
+  for (int i=0; i<sensors_to_off.size(); i++){
+    if (!add_batch_cmd(&batch, BATCH_SENSOR_STATE, sensors_to_off[i], 0, 0)) {
+      return;
     }
-
-    SendNotifyToClient(msg_to_send, CHANGE_SENSOR_STATE_REQ, pCharacteristic);
-    free(msg_to_send);
   }
+  SendBatchCmdReq(&batch);
 }
 
 void SendSensorParamChangeReq(int id_sensor_to_change, std::vector<int> param_id_to_change, std::vector<int> parameters_to_change){
-  char* msg_to_send=(char*)malloc(MAX_MSG_LEN);
-  
-  int pos = 0;
-  if (msg_to_send!=NULL) {
-    for (int i=0; i<param_id_to_change.size(); i++){
-      String sensor_id =String(id_sensor_to_change);
-      String param_id =String(param_id_to_change[i]);
-      String parameter= String(parameters_to_change[i]);
-      
-      // Copy sensor ID
-      strcpy(&msg_to_send[pos], sensor_id.c_str());
-      pos += sensor_id.length();
-      // Separator
-      msg_to_send[pos++] = '|';
-      // Copy parameter ID
-      strcpy(&msg_to_send[pos], param_id.c_str());
-      pos += param_id.length();
-      // Separator
-      msg_to_send[pos++] = '|';
-      // Copy parameter
-      strcpy(&msg_to_send[pos], parameter.c_str());
-      pos += parameter.length();
-      // Add separator if not the last item
-      if (i < param_id_to_change.size() - 1) {
-          msg_to_send[pos++] = '|';
-      }
+  uint8_t msg_to_send[MAX_MSG_LEN - 1];
+  struct batch_cmd_writer batch;
+  batch_cmd_begin(&batch, msg_to_send, sizeof(msg_to_send));
+  for (int i=0; i<param_id_to_change.size(); i++){
+    if (!add_batch_cmd(&batch, BATCH_SENSOR_PARAM, id_sensor_to_change, param_id_to_change[i], parameters_to_change[i])) {
+      return;
     }
-    SendNotifyToClient(msg_to_send, CHANGE_SENSOR_PARAM_REQ , pCharacteristic);
-    free(msg_to_send);
   }
+  SendBatchCmdReq(&batch);
 }
 
 void SendMotorParamChangeReq(int id_motor_to_change, std::vector<int> parameters_to_change){
-  char* msg_to_send=(char*)malloc(MAX_MSG_LEN);
-  int pos = 0;
-  if (msg_to_send!=NULL) {
-    for (int i=0; i<parameters_to_change.size(); i++){
-      String motor_id =String(id_motor_to_change);
-      String parameter= String(parameters_to_change[i]);
-
-      // Copy motor ID
-      strcpy(&msg_to_send[pos], motor_id.c_str());
-      pos += motor_id.length();
-      // Separator
-      msg_to_send[pos++] = '|';
-      // Copy parameter
-      strcpy(&msg_to_send[pos], parameter.c_str());
-      pos += parameter.length();
-      // Add separator if not the last item
-      if (i < parameters_to_change.size() - 1) {
-          msg_to_send[pos++] = '|';
-      }
+  uint8_t msg_to_send[MAX_MSG_LEN - 1];
+  struct batch_cmd_writer batch;
+  batch_cmd_begin(&batch, msg_to_send, sizeof(msg_to_send));
+  for (int i=0; i<parameters_to_change.size(); i++){
+    if (!add_batch_cmd(&batch, BATCH_MOTOR_PARAM, id_motor_to_change, 0, parameters_to_change[i])) {
+      return;
     }
-    SendNotifyToClient(msg_to_send, CHANGE_MOTOR_PARAM_REQ , pCharacteristic);
-    free(msg_to_send);
+  }
+  SendBatchCmdReq(&batch);
+}
+// Starts tracking the damage of a chart with point_count points (after its size is set)
+static void reset_chart_damage(uint16_t point_count){
+  lv_obj_update_layout(chart);
+  plot_damage_init(&chart_damage, lv_obj_get_content_width(chart), lv_obj_get_height(chart), point_count,
+                   CHART_REDRAW_BUDGET_PX, CHART_LINE_MARGIN_PX);
+  plot_damage_mark_all(&chart_damage);
+}
+
+// Invalidates the chart columns marked in chart_damage, within the budget
+static void invalidate_chart_damage(){
+  struct plot_span spans[PLOT_MAX_SPANS];
+  int count = plot_damage_take(&chart_damage, spans, PLOT_MAX_SPANS);
+  lv_area_t coords;
+  lv_obj_get_coords(chart, &coords);
+  lv_coord_t x_ofs = coords.x1 + lv_obj_get_style_pad_left(chart, LV_PART_MAIN) +
+                     lv_obj_get_style_border_width(chart, LV_PART_MAIN);
+  for (int i = 0; i < count; i++) {
+    lv_area_t area;
+    area.x1 = x_ofs + spans[i].x1;
+    area.x2 = x_ofs + spans[i].x2;
+    area.y1 = coords.y1;
+    area.y2 = coords.y2;
+    lv_obj_invalidate_area(chart, &area);
   }
 }
+
 void delete_debug(){
   if (chart_timer) {
     lv_timer_del(chart_timer); // Stop the timer
@@ -181,6 +183,15 @@ void delete_debug(){
     lv_obj_del(close_chart_btn);
     close_chart_btn = NULL;
   }
+  if (add_series_dropdown) {
+    lv_obj_del(add_series_dropdown);
+    add_series_dropdown = NULL;
+  }
+  if (chart_window_dropdown) {
+    lv_obj_del(chart_window_dropdown);
+    chart_window_dropdown = NULL;
+  }
+  chart_series_count = 0;
   if(dropdown_motors_bug){
     lv_obj_del(dropdown_motors_bug);
     dropdown_motors_bug = NULL;
@@ -205,6 +216,14 @@ void delete_debug(){
 class ServerCallbacks : public NimBLEServerCallbacks {
     void onConnect(BLEServer* pServer, NimBLEConnInfo & 	connInfo) override {
         Serial.println("Client connected!");
+        client_connected_ms = millis();
+        config_digest_received = false;
+        config_snapshot_rejected = false;
+        negotiated_mtu = connInfo.getMTU();
+        // A new connection may be a rebooted prosthesis with a new clock
+        protocol_lock();
+        clock_sync_reset(&telemetry_clock);
+        protocol_unlock();
         if(is_demo_yaml.test_and_set()){
           has_client.clear();
         }
@@ -218,6 +237,12 @@ class ServerCallbacks : public NimBLEServerCallbacks {
     void onDisconnect(BLEServer* pServer, NimBLEConnInfo & 	connInfo, int reason) override {
         Serial.println("Client disconnected! Advertsing again");
         has_client.clear();
+        negotiated_mtu = WIRE_DEFAULT_MTU;
+        reset_reassembly(&yaml_reasm);
+        reset_reassembly(&cmd_reasm);
+        reset_reassembly(&record_reasm);
+        reset_reassembly(&stats_reasm);
+        recording_announced = false;
         if(debug_tab){
            delete_debug();
         }
@@ -237,26 +262,40 @@ class ServerCallbacks : public NimBLEServerCallbacks {
 
         pServer->startAdvertising();
     }
+
+    void onMTUChange(uint16_t MTU, NimBLEConnInfo& connInfo) override {
+        Serial.printf("MTU updated to %d, fragments now carry %d bytes\n", MTU, wire_frag_payload_size(MTU));
+        negotiated_mtu = MTU;
+    }
 };
 
 // Handle return button - test example
 void return_BLE(){
-  uint8_t* msg_bytes = str_to_byte_msg(0,"Hi! How are you today?! Here is a dot . ");
-  uint16_t len = sizeof(struct msg_interp);
-  // print_msg((struct msg_interp*)msg_bytes);
-  pCharacteristic->setValue(msg_bytes, len);
-  pCharacteristic->notify();
-  free(msg_bytes);
+  SendNotifyToClient("Hi! How are you today?! Here is a dot . ", 0, pCharacteristic);
 }
 
 
 // Callback for receiving confirmations from the client
 class MyCallbacks: public NimBLECharacteristicCallbacks {
   void onWrite(NimBLECharacteristic *pCharacteristic, NimBLEConnInfo &connInfo) {
-    const uint8_t* received_data = pCharacteristic->getValue().data();
-    //print_byte_array(MSG_SIZE, received_data); // print byte array for debuging
-    struct msg_interp* received_data_struct = (struct msg_interp*)received_data;
-    switch (received_data_struct->req_type) {
+    uint32_t received_us = micros();   // t4 of a CLOCK_SYNC_ANS
+    NimBLEAttValue received_value = pCharacteristic->getValue();
+    //print_byte_array(received_value.size(), received_value.data()); // print byte array for debuging
+    struct wire_frame frame;
+    if (!decode_frame(received_value.data(), received_value.size(), &frame)) {
+      return;
+    }
+    // YAML sections are collected by ReciveYAMLField, the config snapshot by
+    // ReceiveConfigSnapshot, recordings by ReceiveRecording and statistics by
+    // ReceiveStats, everything else is a short message
+    bool is_yaml_field = (frame.req_type >= YML_SENSOR_ANS && frame.req_type <= YML_GENERAL_ANS) ||
+                         frame.req_type == CONFIG_SNAPSHOT_ANS || frame.req_type == RECORD_DATA;
+    struct msg_interp received_msg;
+    if (!is_yaml_field && frame.req_type != STATS_ANS && !collect_msg(&cmd_reasm, &frame, &received_msg)) {
+      return;
+    }
+    struct msg_interp* received_data_struct = &received_msg;
+    switch (frame.req_type) {
       case CHANGE_SENSOR_STATE_ANS:{
         print_msg(received_data_struct);
         not_finish_update_sensors.clear();
@@ -269,14 +308,14 @@ class MyCallbacks: public NimBLECharacteristicCallbacks {
           break;
       case READ_ANS:
       {       
-        char* received_msg= (char*)malloc(MAX_MSG_LEN);
+        char read_ans_msg[MAX_MSG_LEN];
         int is_motor;
         int hardware_id;
         int hardware_value;
-        if (received_msg){
-          strcpy(received_msg,received_data_struct->msg);
+        {
+          strcpy(read_ans_msg,received_data_struct->msg);
           char* tokened_msg ;
-          tokened_msg=strtok(received_msg, "|");
+          tokened_msg=strtok(read_ans_msg, "|");
           int i=0;
           while(tokened_msg != NULL) {
             if (i==0){
@@ -294,8 +333,17 @@ class MyCallbacks: public NimBLECharacteristicCallbacks {
             }
           tokened_msg = strtok(NULL, "|");
           }
-          if (received_msg) free(received_msg);
 
+          // The series polled for this sensor / motor
+          lv_chart_series_t *ser = NULL;
+          for (int c = 0; c < chart_series_count; c++) {
+            if (chart_channels[c].is_motor == is_motor && chart_channels[c].id == hardware_id) {
+              ser = chart_series[c];
+            }
+          }
+          if (!chart || !ser) {
+            break;
+          }
           lv_chart_set_next_value(chart, ser, hardware_value); // Update chart
 
           // Create a gap by setting the next few points to LV_CHART_POINT_NONE
@@ -313,12 +361,29 @@ class MyCallbacks: public NimBLECharacteristicCallbacks {
           a[(s + 8) % p] = LV_CHART_POINT_NONE;
           a[(s + 9) % p] = LV_CHART_POINT_NONE;
 
-          lv_chart_refresh(chart);
+          // Redraw the new point and the gap only
+          plot_damage_mark(&chart_damage, (s + p - 1) % p, 11);
+          invalidate_chart_damage();
           }
     
 
           break;
           }
+      case TELEMETRY_DATA:
+        QueueTelemetry((const uint8_t*)received_data_struct->msg, received_data_struct->msg_length);
+        break;
+      case CLOCK_SYNC_ANS:
+        HandleClockSyncAns((const uint8_t*)received_data_struct->msg, received_data_struct->msg_length, received_us);
+        break;
+      case RECORD_READY:
+        HandleRecordReady(received_data_struct->msg);
+        break;
+      case RECORD_DATA:
+        ReceiveRecording(&frame);
+        break;
+      case STATS_ANS:
+        ReceiveStats(&frame);
+        break;
       case EDIT_ANS:
           // Add handling for EDIT_ANS here
           break;
@@ -326,46 +391,53 @@ class MyCallbacks: public NimBLECharacteristicCallbacks {
           // Add handling for FUNC_ANS here
           break;
       case YML_SENSOR_ANS:
-        //Check if the msg was received succesfully by comparing the msg length and checksum to the desired values 
         pointer_to_sensor_buff = &sensors_yaml_buffer;
-        ReciveYAMLField(pointer_to_sensor_buff,*received_data_struct);
-        if (received_data_struct->cur_msg_count==received_data_struct->tot_msg_count){
+        if (ReciveYAMLField(pointer_to_sensor_buff, &frame, &is_yml_sensors_parsed)){
           is_yml_sensors_ready = true;
-          SendNotifyToClient("Please send Motors data", YML_MOTORS_REQ, pCharacteristic);
+          if (!YAML_STREAMED_DOWNLOAD) {
+            SendNotifyToClient("Please send Motors data", YML_MOTORS_REQ, pCharacteristic);
+          }
         }
 
         break;
 
       case YML_MOTORS_ANS:
         pointer_to_motors_buff = &motors_yaml_buffer;
-        ReciveYAMLField(pointer_to_motors_buff,*received_data_struct);
-        if (received_data_struct->cur_msg_count==received_data_struct->tot_msg_count){
+        if (ReciveYAMLField(pointer_to_motors_buff, &frame, &is_yml_motors_parsed)){
           is_yml_motors_ready=true;
-          SendNotifyToClient( "Please send functions data", YML_FUNC_REQ, pCharacteristic );
+          if (!YAML_STREAMED_DOWNLOAD) {
+            SendNotifyToClient( "Please send functions data", YML_FUNC_REQ, pCharacteristic );
+          }
         }
         break;
 
       case YML_FUNC_ANS:
           pointer_to_func_buff = &funcs_yaml_buffer;
-          ReciveYAMLField(pointer_to_func_buff,*received_data_struct);
-          if (received_data_struct->cur_msg_count==received_data_struct->tot_msg_count){
+          if (ReciveYAMLField(pointer_to_func_buff, &frame, &is_yml_functions_parsed)){
             is_yml_functions_ready=true;
-            SendNotifyToClient( "Please send general data", YML_GENERAL_REQ, pCharacteristic );
+            if (!YAML_STREAMED_DOWNLOAD) {
+              SendNotifyToClient( "Please send general data", YML_GENERAL_REQ, pCharacteristic );
+            }
           }
           break;     
 
       case YML_GENERAL_ANS:
           pointer_to_general_buff = &general_yaml_buffer;
-          ReciveYAMLField(pointer_to_general_buff,*received_data_struct);
-          if (received_data_struct->cur_msg_count==received_data_struct->tot_msg_count){
+          if (ReciveYAMLField(pointer_to_general_buff, &frame, &is_yml_general_parsed)){
             is_yml_general_ready=true;
           }
           break;     
+      case CONFIG_SNAPSHOT_ANS:
+        ReceiveConfigSnapshot(&frame);
+        break;
       case YAML_ANS:
         
         break;
       case GEST_ANS:
         can_play_gesture.test_and_set();
+        break;
+      case FRAG_RESEND_REQ:
+        ResendFragments(received_data_struct->msg, pCharacteristic);
         break;
 	  case CHANGE_MOTOR_PARAM_ANS:
 	    {
@@ -380,9 +452,34 @@ class MyCallbacks: public NimBLECharacteristicCallbacks {
       not_finish_update_sensors.clear();
       break;
       }
+      case CONFIG_DIGEST_ANS:
+        config_digest_value = strtoul(received_data_struct->msg, NULL, 16);
+        config_digest_received = true;
+        Serial.printf("Prosthesis config digest: %08x\n", config_digest_value);
+        break;
+      case BATCH_CMD_ANS:
+      {
+        const uint8_t* results;
+        int count = batch_cmd_decode_results((const uint8_t*)received_data_struct->msg, received_data_struct->msg_length, &results);
+        for (int i = 0; i < count; i++) {
+          if (results[i] != BATCH_APPLIED) {
+            Serial.printf("Command %d of the batch was not applied (result %d)\n", i, results[i]);
+          }
+        }
+        if (count < 0) {
+          Serial.println("Malformed BATCH_CMD_ANS");
+        }
+        not_finish_update_sensors.clear();
+        break;
+      }
     default:
         break;
     }
+    if (frame.req_type == RECORD_DATA) {
+      AckRecordStream(pCharacteristic);
+    } else if (is_yaml_field) {
+      AckYAMLStream(pCharacteristic);
+    }
   }
 };
 
@@ -390,16 +487,13 @@ class MyCallbacks: public NimBLECharacteristicCallbacks {
 
 
 void sending_gesture(char* gesture_name){
-  uint8_t* byte_msg = str_to_byte_msg(GEST_REQ,gesture_name);
-  // print_byte_array(MSG_SIZE,byte_msg);
-  uint16_t len = MSG_SIZE; 
-  pCharacteristic->setValue(byte_msg, len);
-  pCharacteristic->notify();
+  SendNotifyToClient(gesture_name, GEST_REQ, pCharacteristic);
 }
 
 
 void Start_BLE_server_NIMBLE(void* params) {
   NimBLEDevice::init("");
+  NimBLEDevice::setMTU(WIRE_MAX_MTU);
   pServer = NimBLEDevice::createServer();
   NimBLEService *pService = pServer->createService(SERVICE_UUID);
   pCharacteristic = pService->createCharacteristic(
@@ -0,0 +1,149 @@
+#ifndef CONFIG_CACHE_H
+#define CONFIG_CACHE_H
+
+#include <FS.h>
+#include <SPIFFS.h>
+#include <Arduino.h>
+#include <ProsthesisProtocol.h>
+#include "shared_yaml_parser.h"
+
+// Last configuration downloaded from the prosthesis, kept on the screen's flash.
+// Each YAML section is stored as received in its own file, or the config snapshot
+// if the prosthesis sent one; config.digest holds the digest the prosthesis
+// announced for them. The digest is written last and removed (with the files of
+// the previous download) before a new download, so a download that was cut short
+// never looks valid.
+
+// Indexed by enum yaml_field_type
+static const char* cached_section_paths[] = {"/cfg_sensors.yaml", "/cfg_functions.yaml", "/cfg_motors.yaml", "/cfg_general.yaml"};
+static const char* cached_snapshot_path = "/cfg_snapshot.bin";
+const String cached_config_digest = "/config.digest";
+
+static bool config_cache_ready = false;
+
+void InitConfigCache(){
+  config_cache_ready = SPIFFS.begin(true);
+  if (!config_cache_ready) {
+    Serial.println("Failed to initialize SPIFFS, the configuration will not be cached");
+  }
+}
+
+// Reads a whole file into a NULL terminated buffer (the caller frees it).
+// len_out (optional) receives its length.
+uint8_t* read_cached_file(const char* path, size_t* len_out = NULL){
+  File file = SPIFFS.open(path, FILE_READ);
+  if (!file) {
+    return NULL;
+  }
+  size_t len = file.size();
+  uint8_t* buffer = (uint8_t*)malloc(len + 1);
+  if (buffer) {
+    len = file.read(buffer, len);
+    buffer[len] = '\0';
+    if (len_out) {
+      *len_out = len;
+    }
+  }
+  file.close();
+  return buffer;
+}
+
+// Takes the cached snapshot into config_snapshot_buffer if it was made from the
+// config with this digest.
+static bool load_cached_snapshot(uint32_t digest){
+  size_t len = 0;
+  uint8_t* snapshot = read_cached_file(cached_snapshot_path, &len);
+  struct config_snapshot view;
+  if (snapshot == NULL || !config_snapshot_open(snapshot, len, &view) || view.source_digest != digest) {
+    free(snapshot);
+    return false;
+  }
+  config_snapshot_buffer = snapshot;
+  config_snapshot_len = len;
+  return true;
+}
+
+// Loads the cached snapshot into config_snapshot_buffer, or else the cached sections
+// into the YAML buffers (as if they had just been received), when the cached digest
+// equals digest. Returns false if there is nothing usable.
+bool LoadCachedConfig(uint32_t digest){
+  if (!config_cache_ready || !SPIFFS.exists(cached_config_digest)) {
+    return false;
+  }
+  File file = SPIFFS.open(cached_config_digest, FILE_READ);
+  uint32_t cached_digest = strtoul(file.readString().c_str(), NULL, 16);
+  file.close();
+  if (cached_digest != digest) {
+    Serial.printf("Cached config %08x is outdated (prosthesis has %08x)\n", cached_digest, digest);
+    return false;
+  }
+  if (load_cached_snapshot(digest)) {
+    Serial.printf("Using cached config snapshot %08x\n", digest);
+    return true;
+  }
+  uint8_t* sections[4];
+  for (int i = 0; i < 4; i++) {
+    sections[i] = read_cached_file(cached_section_paths[i]);
+    if (sections[i] == NULL) {
+      for (int j = 0; j < i; j++) {
+        free(sections[j]);
+      }
+      Serial.printf("Cached section %s is missing\n", cached_section_paths[i]);
+      return false;
+    }
+  }
+  sensors_yaml_buffer = sections[SENSORS_FIELD];
+  funcs_yaml_buffer = sections[FUNCTIONS_FIELD];
+  motors_yaml_buffer = sections[MOTORS_FIELD];
+  general_yaml_buffer = sections[GENERAL_FIELD];
+  pointer_to_sensor_buff = &sensors_yaml_buffer;
+  pointer_to_func_buff = &funcs_yaml_buffer;
+  pointer_to_motors_buff = &motors_yaml_buffer;
+  pointer_to_general_buff = &general_yaml_buffer;
+  Serial.printf("Using cached config %08x\n", digest);
+  return true;
+}
+
+// Invalidates the cached config before a download starts.
+void BeginConfigCache(){
+  if (!config_cache_ready) {
+    return;
+  }
+  SPIFFS.remove(cached_config_digest);
+  SPIFFS.remove(cached_snapshot_path);
+  for (int i = 0; i < 4; i++) {
+    SPIFFS.remove(cached_section_paths[i]);
+  }
+}
+
+void SaveConfigSection(int field_type, const char* section){
+  if (!config_cache_ready) {
+    return;
+  }
+  File file = SPIFFS.open(cached_section_paths[field_type], FILE_WRITE);
+  file.print(section);
+  file.close();
+}
+
+void SaveConfigSnapshot(const uint8_t* snapshot, size_t len){
+  if (!config_cache_ready) {
+    return;
+  }
+  File file = SPIFFS.open(cached_snapshot_path, FILE_WRITE);
+  file.write(snapshot, len);
+  file.close();
+}
+
+// Marks the stored sections or snapshot as a complete copy of the configuration with this digest.
+void CommitConfigCache(uint32_t digest){
+  if (!config_cache_ready) {
+    return;
+  }
+  char text[9];
+  snprintf(text, sizeof(text), "%08x", digest);
+  File file = SPIFFS.open(cached_config_digest, FILE_WRITE);
+  file.print(text);
+  file.close();
+}
+
+#endif //CONFIG_CACHE_H
@@ -3,66 +3,580 @@
 #ifndef REQUESTS_H
 #define REQUESTS_H
 
-#include "shared_com_vars.h"
+#include <ProsthesisProtocol.h>
 #include "shared_yaml_parser.h"
+#include "config_cache.h"
 
 // Initialize YAML flags
 static bool is_yml_general_ready = false;
 static bool is_yml_sensors_ready = false;
 static bool is_yml_motors_ready = false;
 static bool is_yml_functions_ready = false;
+static bool is_config_snapshot_ready = false;
 
+// Set with is_yml_*_ready when the section was already parsed into handConfig as it arrived
+static bool is_yml_general_parsed = false;
+static bool is_yml_sensors_parsed = false;
+static bool is_yml_motors_parsed = false;
+static bool is_yml_functions_parsed = false;
+
+// 1: one YAML_REQ, the prosthesis streams all sections (windowed acks).
+// 0: lock-step, YML_SENSOR_REQ -> YML_MOTORS_REQ -> YML_FUNC_REQ -> YML_GENERAL_REQ.
+#define YAML_STREAMED_DOWNLOAD 1
+
+// 1: announce YAML_CAP_LZ in the YAML_REQ, sections may arrive LZ compressed (streamed download only).
+#define YAML_COMPRESSION 1
+
+// 1: announce YAML_CAP_SNAPSHOT in the YAML_REQ, the whole config may arrive as one binary
+// snapshot (config_snapshot.h) that is copied into handConfig without parsing (streamed download only).
+#define CONFIG_SNAPSHOT 1
+
+// 1: parse the YAML sections into handConfig while their fragments arrive (config_stream.h), in
+// the BLE callback, so load_yaml_step only stores them in the cache. A section with a fragment
+// out of order is parsed by load_yaml_step once complete, as with 0.
+#define YAML_PARSE_STREAMED 1
+
+// The section being parsed as it arrives. handConfig is written from the BLE callback then,
+// so every change of handConfig during the download takes protocol_lock().
+static struct config_stream yaml_stream;
+
+// Set when a snapshot could not be loaded; the config is then asked for again as YAML
+// sections, and until the next connection.
+static bool config_snapshot_rejected = false;
+
+// Fragments of the current config download stored / acknowledged so far
+static uint32_t yaml_frags_received = 0;
+static uint32_t yaml_frags_acked = 0;
+
+// millis() at connect, to measure connect -> setupInitialUserScreen
+static uint32_t client_connected_ms = 0;
+
+// Digest of the prosthesis' configuration (CONFIG_DIGEST_ANS), sent right after it connects.
+// Without it after CONFIG_DIGEST_TIMEOUT_MS the config is downloaded as usual.
+#define CONFIG_DIGEST_TIMEOUT_MS 1000
+static volatile bool config_digest_received = false;
+static volatile uint32_t config_digest_value = 0;
+
+// true while the sections being parsed were loaded from the cache (so they are not stored again)
+static bool config_from_cache = false;
+
+// true once the config was taken from a snapshot instead of the YAML sections
+static bool config_from_snapshot = false;
+
+// 1: the Debug chart subscribes once (TELEMETRY_SUB_REQ) and the prosthesis pushes batches of samples.
+// 0: the chart polls one value per READ_REQ every 200 ms, taking the channels in turn.
+#define TELEMETRY_PUSH 1
+#define TELEMETRY_RATE_HZ TELEMETRY_DEFAULT_RATE_HZ
+#define TELEMETRY_BATCH TELEMETRY_DEFAULT_BATCH   // ticks per notification, times the channel count
+
+// Pushed samples not yet on the chart, with the screen time (micros()) they were
+// taken at. Filled by the BLE callback, drained by the chart timer in the LVGL task
+// (oldest samples are dropped if the chart falls behind).
+#define TELEMETRY_PENDING_SIZE 256
+static int16_t telemetry_pending[TELEMETRY_PENDING_SIZE];
+static uint8_t telemetry_pending_channel[TELEMETRY_PENDING_SIZE];
+static uint32_t telemetry_pending_time[TELEMETRY_PENDING_SIZE];
+static int telemetry_pending_count = 0;
+static uint8_t telemetry_channel_count = 0;
+static struct telemetry_receiver telemetry_rx;
+
+// Prosthesis clock -> screen clock for the telemetry timestamps. Exchanges are sent
+// while the chart is open (every CLOCK_SYNC_INTERVAL_MS); take protocol_lock() around it.
+static struct clock_sync telemetry_clock;
+static uint32_t clock_sync_sent_ms = 0;
+
+// ATT MTU of the current connection, updated by the server callbacks
+static uint16_t negotiated_mtu = WIRE_DEFAULT_MTU;
+
+// Reassembly state for incoming YAML sections and for multi-fragment short messages
+static struct wire_reassembler yaml_reasm;
+static struct wire_reassembler cmd_reasm;
+static struct wire_reassembler record_reasm;
+static struct wire_reassembler stats_reasm;
+
+// wire_send_fn for this side of the link: notifies the subscribed client.
+static void notify_frame(const uint8_t* frame, size_t len, void* ctx){
+  NimBLECharacteristic *pCharacteristic = (NimBLECharacteristic*)ctx;
+  pCharacteristic->setValue(frame, len);
+  pCharacteristic->notify();
+  // TODO IN THE FUTURE - think if there is an possible error handling here.
+}
+
+static void notify_frame_logged(const uint8_t* frame, size_t len, void* ctx){
+  Serial.print("Sending msg:");
+  print_frame(frame, len);
+  notify_frame(frame, len, ctx);
+}
+
+// Sends msg_len bytes of msg_bytes (binary payloads may contain zeros).
+void SendBytesToClient(const uint8_t* msg_bytes, size_t msg_len, int msg_type, NimBLECharacteristic *pCharacteristic){
+  send_msg(msg_type, msg_bytes, msg_len, negotiated_mtu, notify_frame_logged, pCharacteristic);
+}
 
 void SendNotifyToClient(char* msg_str, int msg_type, NimBLECharacteristic *pCharacteristic){
-  int total_msg_num = ceil(((float)strlen(msg_str))/((float)(MAX_MSG_LEN-1)));
-  if (total_msg_num>1){Serial.println("The message is too long, dividing into multiple sends");}
-  for (int msg_num=1;msg_num<=total_msg_num;msg_num++){
-    uint8_t* msg_bytes = str_to_byte_msg(msg_type, msg_str,msg_num, total_msg_num);
-    uint16_t len = sizeof(struct msg_interp);
-    Serial.print("Sending msg:");
-    print_msg((struct msg_interp*)msg_bytes);
-    pCharacteristic->setValue(msg_bytes, len);
-    pCharacteristic->notify();
-      // TODO IN THE FUTURE - think if there is an possible error handling here. 
-    free(msg_bytes);
+  SendBytesToClient((const uint8_t*)msg_str, strlen(msg_str), msg_type, pCharacteristic);
+}
+
+// Starts a clock sync exchange. t1 is taken right before the notification, unlogged,
+// so the round trip is mostly the link.
+void SendClockSyncReq(NimBLECharacteristic *pCharacteristic){
+  uint8_t req[CLOCK_SYNC_REQ_LEN];
+  clock_sync_sent_ms = millis();
+  size_t len = clock_sync_req_encode(req, sizeof(req), micros());
+  send_msg(CLOCK_SYNC_REQ, req, len, negotiated_mtu, notify_frame, pCharacteristic);
+}
+
+// Repeats the exchange every CLOCK_SYNC_INTERVAL_MS to follow the drift of the clocks.
+void PollClockSync(NimBLECharacteristic *pCharacteristic){
+  if (millis() - clock_sync_sent_ms >= CLOCK_SYNC_INTERVAL_MS) {
+    SendClockSyncReq(pCharacteristic);
+  }
+}
+
+// Called from the BLE callback with t4, the time CLOCK_SYNC_ANS arrived.
+void HandleClockSyncAns(const uint8_t* payload, size_t len, uint32_t received_us){
+  uint32_t t1, t2, t3;
+  if (!clock_sync_ans_decode(payload, len, &t1, &t2, &t3)) {
+    Serial.println("Malformed CLOCK_SYNC_ANS");
+    return;
   }
+  protocol_lock();
+  bool accepted = clock_sync_add(&telemetry_clock, t1, t2, t3, received_us);
+  uint32_t rtt_us = telemetry_clock.rtt_us;
+  protocol_unlock();
+  if (!accepted) {
+    Serial.printf("Clock sync rejected, round trip %d us\n", (int)(received_us - t1));
+  } else {
+    Serial.printf("Clock sync: round trip %u us, best %u us\n", received_us - t1, rtt_us);
+  }
+}
+
+// (Re)subscribes to the given channels; a running subscription is replaced.
+void SubscribeTelemetry(const struct telemetry_channel* channels, int count, NimBLECharacteristic *pCharacteristic){
+  struct telemetry_sub sub;
+  sub.rate_hz = TELEMETRY_RATE_HZ;
+  int batch = TELEMETRY_BATCH * count;
+  sub.batch = (uint8_t)(batch < TELEMETRY_MAX_BATCH ? batch : TELEMETRY_MAX_BATCH);
+  sub.channel_count = (uint8_t)count;
+  memcpy(sub.channels, channels, count * sizeof(struct telemetry_channel));
+  uint8_t payload[TELEMETRY_SUB_MAX_LEN];
+  size_t len = telemetry_sub_encode(payload, sizeof(payload), &sub);
+  if (len == 0) {
+    return;
+  }
+  protocol_lock();
+  telemetry_pending_count = 0;
+  telemetry_channel_count = sub.channel_count;
+  telemetry_receiver_reset(&telemetry_rx);
+  protocol_unlock();
+  SendClockSyncReq(pCharacteristic);
+  SendBytesToClient(payload, len, TELEMETRY_SUB_REQ, pCharacteristic);
 }
+
+void UnsubscribeTelemetry(NimBLECharacteristic *pCharacteristic){
+  SendBytesToClient(NULL, 0, TELEMETRY_UNSUB_REQ, pCharacteristic);
+  protocol_lock();
+  telemetry_channel_count = 0;
+  protocol_unlock();
+  Serial.printf("Telemetry: %u samples received, %u lost\n", telemetry_rx.received, telemetry_rx.lost);
+}
+
+// Caller holds protocol_lock()
+static void queue_telemetry_sample(uint8_t channel, int16_t value, uint32_t local_us){
+  if (telemetry_pending_count == TELEMETRY_PENDING_SIZE) {
+    memmove(telemetry_pending, telemetry_pending + 1, (TELEMETRY_PENDING_SIZE - 1) * sizeof(int16_t));
+    memmove(telemetry_pending_channel, telemetry_pending_channel + 1, TELEMETRY_PENDING_SIZE - 1);
+    memmove(telemetry_pending_time, telemetry_pending_time + 1, (TELEMETRY_PENDING_SIZE - 1) * sizeof(uint32_t));
+    telemetry_pending_count--;
+  }
+  telemetry_pending_channel[telemetry_pending_count] = channel;
+  telemetry_pending_time[telemetry_pending_count] = local_us;
+  telemetry_pending[telemetry_pending_count++] = value;
+}
+
+// Called from the BLE callback for every TELEMETRY_DATA.
+void QueueTelemetry(const uint8_t* payload, size_t len){
+  struct telemetry_batch batch;
+  protocol_lock();
+  if (telemetry_channel_count == 0) {
+    // Unsubscribed: the batches still on their way are expected, drop them quietly
+    protocol_unlock();
+    return;
+  }
+  if (telemetry_batch_decode(payload, len, telemetry_channel_count, &batch) < 0) {
+    protocol_unlock();
+    Serial.println("Malformed TELEMETRY_DATA");
+    return;
+  }
+  uint32_t missing = telemetry_receiver_push(&telemetry_rx, &batch);
+  if (!telemetry_clock.valid && batch.count > 0) {
+    // No exchange answered yet: assume the newest sample was taken just now
+    clock_sync_seed(&telemetry_clock, telemetry_sample_time(&batch, telemetry_channel_count, batch.count - 1), micros());
+  }
+  // Every sample carries its own time, so lost samples simply leave their slots empty
+  for (int i = 0; i < batch.count; i++) {
+    uint32_t device_us = telemetry_sample_time(&batch, telemetry_channel_count, i);
+    queue_telemetry_sample(batch.channels[i], batch.samples[i], clock_sync_to_local(&telemetry_clock, device_us));
+  }
+  protocol_unlock();
+  if (missing) {
+    Serial.printf("Telemetry: %u samples lost\n", missing);
+  }
+}
+
+// Moves the queued samples, their channel numbers and screen times to out. Returns how many there were.
+int TakeTelemetry(int16_t* out, uint8_t* channels, uint32_t* times, int cap){
+  protocol_lock();
+  int count = telemetry_pending_count < cap ? telemetry_pending_count : cap;
+  memcpy(out, telemetry_pending, count * sizeof(int16_t));
+  memcpy(channels, telemetry_pending_channel, count);
+  memcpy(times, telemetry_pending_time, count * sizeof(uint32_t));
+  memmove(telemetry_pending, telemetry_pending + count, (telemetry_pending_count - count) * sizeof(int16_t));
+  memmove(telemetry_pending_channel, telemetry_pending_channel + count, telemetry_pending_count - count);
+  memmove(telemetry_pending_time, telemetry_pending_time + count, (telemetry_pending_count - count) * sizeof(uint32_t));
+  telemetry_pending_count -= count;
+  protocol_unlock();
+  return count;
+}
+
 // BOOT BUTTON
 void SendEmergencyReq(char* msg_str, int msg_type, NimBLECharacteristic *pCharacteristic){
-    uint8_t* msg_bytes = str_to_byte_msg(msg_type, msg_str,1, 1);
-    Serial.print("Sending msg:");
-    print_msg((struct msg_interp*)msg_bytes);
-    pCharacteristic->setValue(msg_bytes, sizeof(struct msg_interp));
     Serial.println("Notify to client");
-    pCharacteristic->notify();
-      // TODO IN THE FUTURE - think if there is an possible error handling here. 
-    free(msg_bytes);
+    SendNotifyToClient(msg_str, msg_type, pCharacteristic);
     vTaskDelay(1000 / portTICK_PERIOD_MS);  // Avoid spamming notifications
 }
 
-bool isMsgCorrupted(struct msg_interp* struct_val){
-  if ((struct_val->msg_length!=strlen(struct_val->msg))||
-      calculateChecksum(struct_val->msg,struct_val->msg_length)!=(struct_val->checksum)){
-            Serial.printf("Got msg %d out of %d.\n",struct_val->cur_msg_count,struct_val->tot_msg_count);
-            Serial.printf("Received MSG length and desired length are %s, (received length: %d, desired length: %d)\n",
-                            struct_val->msg_length == strlen(struct_val->msg) ? "equal" : "not equal",
-                            strlen(struct_val->msg), struct_val->msg_length);
-            Serial.printf("Calculate MSG checksum is %s to desired cheksum!\n",
-                (struct_val->checksum) == (calculateChecksum(struct_val->msg,struct_val->msg_length)) ? "equal" : "not equal");
+// Collects one fragment of a YAML section. Fragments may arrive in any order.
+// Returns true once the whole section is stored in *buffer_to_use (NULL terminated).
+bool ReciveYAMLField(uint8_t** buffer_to_use, const struct wire_frame* frame, bool* parsed){
+  Serial.printf("Recived msg %d out of %d.\n", frame->frag_idx, frame->frag_cnt);
+  int status;
+  size_t section_len = 0;
+  uint8_t* section = reassemble_fragment(&yaml_reasm, frame, &section_len, &status);
+  int streamed = CONFIG_STREAM_SKIPPED;
+  if (status == WIRE_REASM_IN_PROGRESS || status == WIRE_REASM_DONE) {
+    yaml_frags_received++;
+    if (YAML_PARSE_STREAMED) {
+      protocol_lock();
+      streamed = config_stream_fragment(&yaml_stream, &handConfig, frame);
+      protocol_unlock();
+    }
+  }
+  if (section == NULL) {
+    return false;
+  }
+  *parsed = false;
+  if (streamed == CONFIG_STREAM_DONE) {
+    struct config_parse_result result;
+    uint8_t* text = NULL;
+    size_t text_len = 0;
+    protocol_lock();
+    int entries = config_stream_end(&yaml_stream, &result, &text, &text_len);
+    protocol_unlock();
+    Serial.printf("Section %d parsed as it arrived: %d entries from %u lines, %u bytes on air\n", frame->req_type,
+                  entries, result.lines, section_len);
+    if (result.skipped_lines > 0) {
+      Serial.printf("Config: skipped %u malformed lines, the first is line %u\n", result.skipped_lines, result.first_skipped_line);
+    }
+    if (text != NULL) {
+      // LZ: the stream kept the decompressed text, the cache wants it
+      free(section);
+      section = text;
+    }
+    *buffer_to_use = section;
+    *parsed = true;
+    return true;
+  }
+  if (YAML_PARSE_STREAMED && yaml_stream.active && yaml_stream.req_type == frame->req_type) {
+    protocol_lock();
+    config_stream_reset(&yaml_stream);
+    protocol_unlock();
+  }
+  if (lz_is_compressed(section, section_len)) {
+    size_t raw_len = 0;
+    uint8_t* text = lz_decompress(section, section_len, &raw_len);
+    Serial.printf("Section %d: %u bytes on air, %u after decompression\n", frame->req_type, section_len, raw_len);
+    free(section);
+    if (text == NULL) {
+      Serial.println("Failed to decompress the section");
+      return false;
+    }
+    section = text;
+  }
+  *buffer_to_use = section;
+  return true;
+}
+
+// Replaces a section of handConfig with the text of a section that was not parsed
+// as it arrived (from the cache, or with fragments out of order). The general
+// section brings the communications along.
+void ReplaceConfigSection(uint8_t section, const char* text){
+  protocol_lock();
+  config_model_clear_section(&handConfig, section);
+  if (section == CONFIG_GENERAL) {
+    config_model_clear_section(&handConfig, CONFIG_COMMUNICATIONS);
+  }
+  protocol_unlock();
+  parseConfig(text, strlen(text));
+}
+
+// Collects the fragments of a CONFIG_SNAPSHOT_ANS. The snapshot is handed over
+// even if it does not decompress (as NULL), so the loader falls back to the YAML.
+void ReceiveConfigSnapshot(const struct wire_frame* frame){
+  int status;
+  size_t len = 0;
+  uint8_t* snapshot = reassemble_fragment(&yaml_reasm, frame, &len, &status);
+  if (status == WIRE_REASM_IN_PROGRESS || status == WIRE_REASM_DONE) {
+    yaml_frags_received++;
+  }
+  if (snapshot == NULL) {
+    return;
+  }
+  if (lz_is_compressed(snapshot, len)) {
+    size_t raw_len = 0;
+    uint8_t* raw = lz_decompress(snapshot, len, &raw_len);
+    Serial.printf("Config snapshot: %u bytes on air, %u after decompression\n", len, raw_len);
+    free(snapshot);
+    snapshot = raw;
+    len = raw_len;
+  }
+  config_snapshot_buffer = snapshot;
+  config_snapshot_len = snapshot ? len : 0;
+  is_config_snapshot_ready = true;
+}
+
+// Starts the config download (see YAML_STREAMED_DOWNLOAD).
+void RequestYAML(NimBLECharacteristic *pCharacteristic){
+  yaml_frags_received = 0;
+  yaml_frags_acked = 0;
+  protocol_lock();
+  config_stream_reset(&yaml_stream);
+  protocol_unlock();
+  if (YAML_STREAMED_DOWNLOAD) {
+    char yaml_req[32];
+    uint32_t caps = (YAML_COMPRESSION ? YAML_CAP_LZ : 0) | (CONFIG_SNAPSHOT && !config_snapshot_rejected ? YAML_CAP_SNAPSHOT : 0);
+    snprintf(yaml_req, sizeof(yaml_req), "Please send YAML data caps=%x", caps);
+    SendNotifyToClient(yaml_req, YAML_REQ, pCharacteristic);
+  } else {
+    SendNotifyToClient("Please send sensors data", YML_SENSOR_REQ, pCharacteristic);
+  }
+}
+
+// Takes the config from the cache when the prosthesis announced the digest of the
+// cached copy, otherwise downloads it. Returns false while still waiting for the digest.
+bool StartConfigLoad(NimBLECharacteristic *pCharacteristic){
+  if (config_digest_received && LoadCachedConfig(config_digest_value)) {
+    config_from_cache = true;
+    config_from_snapshot = false;
+    if (config_snapshot_buffer) {
+      is_config_snapshot_ready = true;
+    } else {
+      is_yml_sensors_ready = true;
+      is_yml_motors_ready = true;
+      is_yml_functions_ready = true;
+      is_yml_general_ready = true;
+      is_yml_sensors_parsed = false;
+      is_yml_motors_parsed = false;
+      is_yml_functions_parsed = false;
+      is_yml_general_parsed = false;
+    }
     return true;
+  }
+  if (!config_digest_received && millis() - client_connected_ms < CONFIG_DIGEST_TIMEOUT_MS) {
+    return false;
+  }
+  if (!config_digest_received) {
+    Serial.println("No config digest from the prosthesis, downloading the config");
+  }
+  config_from_cache = false;
+  config_from_snapshot = false;
+  BeginConfigCache();
+  RequestYAML(pCharacteristic);
+  return true;
+}
+
+// Confirms streamed YAML fragments every half window so the prosthesis keeps sending.
+void AckYAMLStream(NimBLECharacteristic *pCharacteristic){
+  uint32_t window = yaml_stream_window(wire_frag_payload_size(negotiated_mtu));
+  if (!YAML_STREAMED_DOWNLOAD || yaml_frags_received - yaml_frags_acked < window / 2) {
+    return;
+  }
+  char ack[12];
+  snprintf(ack, sizeof(ack), "%u", yaml_frags_received);
+  yaml_frags_acked = yaml_frags_received;
+  SendNotifyToClient(ack, YML_STREAM_ACK, pCharacteristic);
+}
+
+/* ---------- Black box recordings of the prosthesis (telemetry_log.h) ---------- */
+
+const String recording_path = "/recording.bin";
+static volatile bool recording_announced = false;
+static uint8_t* volatile received_recording = NULL;
+static volatile size_t received_recording_len = 0;
+
+// Fragments of the current recording download stored / acknowledged so far; kept
+// apart from the config download so the two can overlap.
+static uint32_t record_frags_received = 0;
+static uint32_t record_frags_acked = 0;
+
+// RECORD_READY: "<bytes>|<trigger>". The download is asked for from loop().
+void HandleRecordReady(const char* msg){
+  Serial.printf("The prosthesis recorded an event (%s), downloading it\n", msg);
+  recording_announced = true;
+}
+
+// Collects one fragment of RECORD_DATA; acknowledged by AckRecordStream.
+void ReceiveRecording(const struct wire_frame* frame){
+  int status;
+  size_t len = 0;
+  uint8_t* recording = reassemble_fragment(&record_reasm, frame, &len, &status);
+  if (status == WIRE_REASM_IN_PROGRESS || status == WIRE_REASM_DONE) {
+    record_frags_received++;
+  }
+  if (recording == NULL) {
+    return;
+  }
+  free(received_recording);
+  received_recording_len = len;
+  received_recording = recording;
+}
+
+// Confirms recording fragments every half window, like AckYAMLStream.
+void AckRecordStream(NimBLECharacteristic *pCharacteristic){
+  uint32_t window = yaml_stream_window(wire_frag_payload_size(negotiated_mtu));
+  if (record_frags_received - record_frags_acked < window / 2) {
+    return;
+  }
+  char ack[12];
+  snprintf(ack, sizeof(ack), "%u", record_frags_received);
+  record_frags_acked = record_frags_received;
+  SendNotifyToClient(ack, RECORD_DATA_ACK, pCharacteristic);
+}
+
+// Walks the blocks of a recording and logs what it holds.
+static void summarize_recording(const uint8_t* buf, size_t len){
+  struct telemetry_log_header hdr;
+  size_t pos = telemetry_log_header_decode(buf, len, &hdr);
+  if (pos == 0) {
+    Serial.println("Recording: no valid header");
+    return;
+  }
+  uint32_t ticks = 0, blocks = 0, gaps = 0, next_tick = 0;
+  while (pos < len) {
+    struct telemetry_log_block block;
+    int block_len = telemetry_log_block_decode(&buf[pos], len - pos, hdr.channel_count, &block);
+    if (block_len <= 0) {
+      Serial.printf("Recording: %s block at byte %u, the rest is ignored\n", block_len < 0 ? "corrupted" : "truncated", (unsigned)pos);
+      break;
     }
-  return false;
+    if (blocks > 0 && block.first_tick != next_tick) {
+      gaps++;
+    }
+    next_tick = block.first_tick + block.ticks;
+    ticks += block.ticks;
+    blocks++;
+    pos += block_len;
+  }
+  Serial.printf("Recording: trigger %d, %d channels at %d Hz, %u ticks (%u before the trigger) in %u blocks, %u gaps\n",
+                hdr.trigger, hdr.channel_count, hdr.rate_hz, ticks, hdr.pre_ticks, blocks, gaps);
 }
 
-void ReciveYAMLField(uint8_t** buffer_to_use,struct msg_interp struct_val){
-  Serial.printf("Recived msg %d out of %d.\n", struct_val.cur_msg_count,struct_val.tot_msg_count);
-  if ((struct_val.cur_msg_count)==1) {
-    *buffer_to_use=(uint8_t*)calloc((struct_val.tot_msg_count)*MAX_MSG_LEN, sizeof(uint8_t));    
-    if(!(*buffer_to_use)){
-      Serial.println("calloc failed");
+// Asks for an announced recording and stores a received one. Call from loop().
+void PollRecording(NimBLECharacteristic *pCharacteristic){
+  if (recording_announced) {
+    recording_announced = false;
+    record_frags_received = 0;
+    record_frags_acked = 0;
+    SendNotifyToClient("Please send the recording", RECORD_DUMP_REQ, pCharacteristic);
+  }
+  uint8_t* recording = received_recording;
+  if (recording == NULL) {
+    return;
+  }
+  size_t len = received_recording_len;
+  received_recording = NULL;
+  summarize_recording(recording, len);
+  if (config_cache_ready) {
+    File file = SPIFFS.open(recording_path, FILE_WRITE);
+    if (file) {
+      file.write(recording, len);
+      file.close();
+      Serial.printf("Recording stored in %s (%u bytes)\n", recording_path.c_str(), (unsigned)len);
     }
-  } 
-  memcpy( (*buffer_to_use) + ((struct_val.cur_msg_count-1)*(MAX_MSG_LEN-1)) , struct_val.msg,  struct_val.msg_length );
+  }
+  free(recording);
+}
+
+/* ---------- Status tab statistics of the prosthesis (rolling_stats.h) ---------- */
+
+// Last STATS_ANS, written by the BLE callback and read by the Status tab timer;
+// take protocol_lock() around them.
+static struct rolling_stats_value stats_values[ROLLING_STATS_MAX_CHANNELS];
+static int stats_count = 0;
+static bool stats_fresh = false;
+
+// One request brings the statistics of every sampled channel.
+void SendStatsReq(NimBLECharacteristic *pCharacteristic){
+  send_msg(STATS_REQ, NULL, 0, negotiated_mtu, notify_frame, pCharacteristic);
+}
+
+// Called from the BLE callback for every STATS_ANS.
+void HandleStatsAns(const uint8_t* payload, size_t len){
+  uint16_t window_ms;
+  struct rolling_stats_value values[ROLLING_STATS_MAX_CHANNELS];
+  int count = rolling_stats_decode(payload, len, &window_ms, values, ROLLING_STATS_MAX_CHANNELS);
+  if (count < 0) {
+    Serial.println("Malformed STATS_ANS");
+    return;
+  }
+  protocol_lock();
+  stats_count = count < ROLLING_STATS_MAX_CHANNELS ? count : ROLLING_STATS_MAX_CHANNELS;
+  memcpy(stats_values, values, stats_count * sizeof(struct rolling_stats_value));
+  stats_fresh = true;
+  protocol_unlock();
+}
+
+// Collects one fragment of STATS_ANS, which is longer than a short message once
+// there are more than a few channels. Called from the BLE callback.
+void ReceiveStats(const struct wire_frame* frame){
+  size_t len = 0;
+  uint8_t* payload = reassemble_fragment(&stats_reasm, frame, &len);
+  if (payload == NULL) {
+    return;
+  }
+  HandleStatsAns(payload, len);
+  free(payload);
+}
+
+// Copies the statistics received since the last call to out. Returns how many
+// channels there are, -1 if nothing new arrived.
+int TakeStats(struct rolling_stats_value* out, int cap){
+  protocol_lock();
+  int count = -1;
+  if (stats_fresh) {
+    count = stats_count < cap ? stats_count : cap;
+    memcpy(out, stats_values, count * sizeof(struct rolling_stats_value));
+    stats_fresh = false;
+  }
+  protocol_unlock();
+  return count;
+}
+
+// Answers a FRAG_RESEND_REQ from the client by sending the listed fragments again.
+void ResendFragments(const char* resend_req, NimBLECharacteristic *pCharacteristic){
+  resend_fragments(resend_req, notify_frame, pCharacteristic);
+}
+
+// Asks the client for the fragments missing from stalled transfers. Call periodically.
+void PollReassembly(NimBLECharacteristic *pCharacteristic){
+  char resend_req[MAX_MSG_LEN];
+  if (poll_reassembly(&yaml_reasm, resend_req, sizeof(resend_req)) ||
+      poll_reassembly(&cmd_reasm, resend_req, sizeof(resend_req)) ||
+      poll_reassembly(&record_reasm, resend_req, sizeof(resend_req)) ||
+      poll_reassembly(&stats_reasm, resend_req, sizeof(resend_req))) {
+    Serial.printf("Transfer stalled, asking for fragments %s\n", resend_req);
+    SendNotifyToClient(resend_req, FRAG_RESEND_REQ, pCharacteristic);
+  }
 }
 
 #endif //REQUESTS_H
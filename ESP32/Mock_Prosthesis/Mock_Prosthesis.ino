@@ -1,7 +1,7 @@
 #include <Arduino.h>
 #include <NimBLEDevice.h>
 
-#include "shared_com_vars.h"
+#include <ProsthesisProtocol.h>
 #include "requests.h"
 #include "create_yaml_file.h"
 #include "shared_yaml_parser.h"
@@ -10,9 +10,13 @@
 static const NimBLEAdvertisedDevice* advDevice;
 static bool                          doConnect  = false;
 static uint32_t                      scanTimeMs = 5000; /** scan time in milliseconds, 0 = scan forever */
+static NimBLERemoteCharacteristic*   pServerCharacteristic = nullptr; /** subscribed characteristic, NULL while disconnected */
 #define SERVICE_UUID        "12345678-1234-5678-1234-56789abcdef0"
 #define CHARACTERISTIC_UUID "12345678-1234-5678-1234-56789abcdef1"
 
+// Collects requests that the screen had to split over several notifications
+static struct wire_reassembler cmd_reasm;
+
 /**  None of these are required as they will be handled by the library with defaults. **
  **                       Remove as you see fit for your needs                        */
 class ClientCallbacks : public NimBLEClientCallbacks {
@@ -20,9 +24,25 @@ class ClientCallbacks : public NimBLEClientCallbacks {
 
     void onDisconnect(NimBLEClient* pClient, int reason) override {
         Serial.printf("%s Disconnected, reason = %d - Starting scan\n", pClient->getPeerAddress().toString().c_str(), reason);
+        negotiated_mtu = WIRE_DEFAULT_MTU;
+        pServerCharacteristic = nullptr;
+        yaml_stream_requested = false;
+        telemetry_sub_requested = false;
+        telemetry_unsub_requested = false;
+        telemetry_disconnect_requested = true;
+        clock_sync_requested = false;
+        record_dump_requested = false;
+        stats_requested = false;
+        // A rebooted screen starts its transfer ids at 0 again: forget what it sent
+        reset_reassembly(&cmd_reasm);
         NimBLEDevice::getScan()->start(scanTimeMs, false, false);
     }
 
+    void onMTUChange(NimBLEClient* pClient, uint16_t MTU) override {
+        Serial.printf("MTU updated to %d, fragments now carry %d bytes\n", MTU, wire_frag_payload_size(MTU));
+        negotiated_mtu = MTU;
+    }
+
     /********************* Security handled here *********************/
     void onPassKeyEntry(NimBLEConnInfo& connInfo) override {
         Serial.printf("Server Passkey Entry\n");
@@ -75,24 +95,78 @@ class ScanCallbacks : public NimBLEScanCallbacks {
 
 /** Notification / Indication receiving handler callback */
 void notifyCB(NimBLERemoteCharacteristic* pRemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify) {
+    uint32_t received_us = micros();   // t2 of a CLOCK_SYNC_REQ
     std::string str  = (isNotify == true) ? "Notification" : "Indication";
-    Serial.println("received request");
-    struct msg_interp* received_data = (struct msg_interp*)malloc(sizeof(struct msg_interp));
-    *received_data = *((struct msg_interp*)pData);
-    print_msg(received_data);
-    char* received_msg;
+    if (!usb_export_active) {
+      Serial.println("received request");
+    }
+    struct msg_interp received_msg_struct;
+    struct msg_interp* received_data = &received_msg_struct;
+    struct wire_frame frame;
+    if (!decode_frame(pData, length, &frame) || !collect_msg(&cmd_reasm, &frame, received_data)) {
+      return;
+    }
+    if (!usb_export_active) {
+      print_msg(received_data);
+    }
     switch (received_data->req_type) {
       case EMERGENCY_STOP:
         Serial.println("Recived emergency stop request");
         call_function("EmergencyStop");
+        TriggerRecording(TELEMETRY_LOG_TRIGGER_EMERGENCY_STOP);
         break;
     
     case GEST_REQ:
       SimulateGestureRun(received_data->msg, pRemoteCharacteristic);
       break;
+
+    case FRAG_RESEND_REQ:
+      ResendFragments(received_data->msg, pRemoteCharacteristic);
+      break;
     
     case YAML_REQ:
-      Serial.println("Recivied yaml request, sending sensors data");
+      // Streamed download, see StreamYAML(); runs from loop()
+      yaml_stream_caps = yaml_req_caps(received_data->msg);
+      Serial.printf("Recivied yaml request, streaming %s (%s)\n", (yaml_stream_caps & YAML_CAP_SNAPSHOT) ? "the config snapshot" : "all sections",
+                    (yaml_stream_caps & YAML_CAP_LZ) ? "LZ" : "plain");
+      yaml_stream_requested = true;
+      break;
+
+    case TELEMETRY_SUB_REQ:
+      if (telemetry_sub_decode((const uint8_t*)received_data->msg, received_data->msg_length, &telemetry_pending_sub)) {
+        telemetry_sub_requested = true;
+      } else {
+        Serial.println("Malformed TELEMETRY_SUB_REQ");
+      }
+      break;
+
+    case TELEMETRY_UNSUB_REQ:
+      telemetry_unsub_requested = true;
+      break;
+
+    case CLOCK_SYNC_REQ:
+      QueueClockSync((const uint8_t*)received_data->msg, received_data->msg_length, received_us);
+      break;
+
+    case RECORD_DUMP_REQ:
+      record_dump_requested = true;
+      break;
+
+    case STATS_REQ:
+      stats_requested = true;
+      break;
+
+    case YML_STREAM_ACK:
+      yaml_stream_acked = strtoul(received_data->msg, NULL, 10);
+      break;
+
+    case RECORD_DATA_ACK:
+      record_stream_acked = strtoul(received_data->msg, NULL, 10);
+      break;
+
+    case YML_SENSOR_REQ:
+      // Lock-step download: one section per request
+      Serial.println("Recivied sensors request, sending sensors data");
       char* sensors_splited_field2;
       splitYaml(readYAML().c_str(), NULL, &sensors_splited_field2, NULL, NULL);
       // Sending sensors data
@@ -121,120 +195,48 @@ void notifyCB(NimBLERemoteCharacteristic* pRemoteCharacteristic, uint8_t* pData,
       Serial.println("Finished sending yaml data");
       break;
 
-    case CHANGE_SENSOR_STATE_REQ:
-      // Handling requests to change sensor status on <=> off
-      received_msg = (char*)malloc(MAX_MSG_LEN * (received_data->tot_msg_count));
-      if (received_msg != NULL) {
-        strcpy(received_msg, received_data->msg);
-        char* tokened_msg;
-        tokened_msg = strtok(received_msg, "|");
-        int i = 0;
-        while (tokened_msg != NULL) {
-          if (i == 2 || i == 0) {
-            i = 0;
-            current_sensor_id = atoi(tokened_msg);
-            Serial.printf("New sensor ID is %d, status is %s.\n", current_sensor_id, sensors[current_sensor_id].name.c_str());
-          } else {
-            sensor_status = tokened_msg;
-            call_function("ChangeSensorState");
-          }
-          tokened_msg = strtok(NULL, "|");
-          i++;
-        }
-
-        SendNotifyToServer(received_data->msg, CHANGE_SENSOR_STATE_ANS, pRemoteCharacteristic);
-        free(received_msg);
+    case BATCH_CMD_REQ:{
+      // Sensor state / sensor parameter / motor parameter changes, answered once for the whole batch
+      struct batch_cmd_reader batch;
+      struct batch_cmd cmd;
+      uint8_t results[BATCH_CMD_MAX_COUNT];
+      if (!batch_cmd_open(&batch, (const uint8_t*)received_data->msg, received_data->msg_length)) {
+        Serial.println("Malformed BATCH_CMD_REQ");
+        break;
       }
-      break;
-
-    case CHANGE_SENSOR_PARAM_REQ:
-      received_msg = (char*)malloc(MAX_MSG_LEN * received_data->tot_msg_count);
-      if (received_msg) {
-        strcpy(received_msg, received_data->msg);
-        char* tokened_msg;
-        tokened_msg = strtok(received_msg, "|");
-        int i = 0;
-        int parameter_id;
-        while (tokened_msg != NULL) {
-          if (i == 3 || i == 0) {
-            i = 0;
-            current_sensor_id = atoi(tokened_msg);
-            Serial.printf("New sensor ID is %d, sensor name is %s.\n", current_sensor_id, sensors[current_sensor_id].name.c_str());
-          } else if (i == 1) {
-            parameter_id = atoi(tokened_msg);
-          } else {
-            int new_parameter_val = atoi(tokened_msg);
-            // Finding the corresponding map key inside the struct
-            std::map<String, Parameter> parameter_map = sensors[current_sensor_id].function.parameters;
-            int j = 0;
-            for (const auto& [paramName, param] : parameter_map) {
-              if (j == parameter_id) {
-                int max_val = parameter_map[paramName].max;
-                int min_val = parameter_map[paramName].min;
-                if ((new_parameter_val <= max_val) && (new_parameter_val >= min_val) && (parameter_map[paramName].modify_permission==true)) {
-                  parameter_map[paramName].current_val = new_parameter_val;
-                  Serial.printf("New val %d for key %s in sensor ID %d\n", new_parameter_val, paramName, current_sensor_id);
-                }
-                else{
-                  Serial.printf("New val is not in range or nor permitted\n");
-                }
-                break;
-              }
-              j++;
-            }
+      while (batch_cmd_next(&batch, &cmd)) {
+        int result;
+        if (cmd.kind == BATCH_SENSOR_STATE) {
+          result = BATCH_UNKNOWN_TARGET;
+          if (cmd.id < handConfig.sensor_count) {
+            ChangeSensorState(cmd.id, cmd.value ? "1" : "0");
+            result = BATCH_APPLIED;
           }
-          tokened_msg = strtok(NULL, "|");
-          i++;
+        } else if (cmd.kind == BATCH_SENSOR_PARAM) {
+          result = ChangeSensorParam(cmd.id, cmd.param, cmd.value);
+        } else {
+          result = ChangeMotorParam(cmd.id, cmd.value);
         }
-        SendNotifyToServer(received_data->msg, CHANGE_SENSOR_PARAM_ANS, pRemoteCharacteristic);
-        if (received_msg) { free(received_msg); }
+        results[batch.read - 1] = result;
       }
-      break;
-    
-    case CHANGE_MOTOR_PARAM_REQ:
-      received_msg = (char*)malloc(MAX_MSG_LEN * received_data->tot_msg_count);
-      int current_motor_id;
-      if (received_msg){
-        strcpy(received_msg, received_data->msg);
-        char* tokened_msg ;
-        tokened_msg=strtok(received_msg, "|");
-        int i=0;
-        int parameter_id;
-        while(tokened_msg != NULL) {
-          if (i==2|| i==0){
-            i=0;
-            current_motor_id=atoi(tokened_msg);
-            Serial.printf("new motor id is %d, motor name is %s.\n",current_motor_id,motors[current_motor_id].name.c_str());
-          } 
-          else {
-            int  new_parameter_val = atoi(tokened_msg);
-            // Finding the corrosponding map  key in inside the struct
-            int j=0;
-            int max_val =   motors[current_motor_id].safety_threshold.max;
-            int min_val =   motors[current_motor_id].safety_threshold.min;
-            if (( new_parameter_val <= max_val ) && ( new_parameter_val >= min_val ) && (motors[current_motor_id].safety_threshold.modify_permission==true)) {
-              motors[current_motor_id].safety_threshold.current_val=new_parameter_val;
-              Serial.printf("new safety treshold is %d for motors id %d\n",new_parameter_val, current_motor_id);
-            }
-            else {
-              Serial.printf( "Parameter cant be changed! allowed range: [%d, %d], modification premission: %s\n" , 
-                motors[current_motor_id].safety_threshold.min,  motors[current_motor_id].safety_threshold.max,
-                (motors[current_motor_id].safety_threshold.modify_permission)? "true" :"false");
-            }
-          }
-          tokened_msg = strtok(NULL, "|");
-          i++;
+      if (batch.read != batch.count) {
+        Serial.printf("BATCH_CMD_REQ truncated after %d of %d commands\n", batch.read, batch.count);
+        for (int i = batch.read; i < batch.count; i++) {
+          results[i] = BATCH_UNKNOWN_TARGET;
         }
       }
-      SendNotifyToServer(received_data->msg, CHANGE_MOTOR_PARAM_ANS, pRemoteCharacteristic);
-      if (received_msg){free(received_msg);}
+      uint8_t answer[BATCH_CMD_HDR_LEN + BATCH_CMD_MAX_COUNT];
+      size_t answer_len = batch_cmd_encode_results(answer, sizeof(answer), results, batch.count);
+      SendBytesToServer(answer, answer_len, BATCH_CMD_ANS, pRemoteCharacteristic);
       break;
+    }
 
     case READ_REQ:{
-      char* received_msg= (char*)malloc(MAX_MSG_LEN);
+      // Answered on every chart tick, so the answer is built on the stack
+      char received_msg[MAX_MSG_LEN];
       int is_motor;
       int hardware_id;
-      if (received_msg){
+      {
         strcpy(received_msg,received_data->msg);
         char* tokened_msg ;
         tokened_msg=strtok(received_msg, "|");
@@ -253,14 +255,10 @@ void notifyCB(NimBLERemoteCharacteristic* pRemoteCharacteristic, uint8_t* pData,
           tokened_msg = strtok(NULL, "|");
         }
         int sampled_data=GetRealTimeData(is_motor, hardware_id);
-        String sampled_data_str = String(sampled_data);
-        Serial.printf("sampled data str %s. msg length %d \n",sampled_data_str.c_str(),received_data->msg_length);
-        strcpy(received_msg,received_data->msg);
-        strcpy(&(received_msg[received_data->msg_length]),"|");
-        strcpy(&(received_msg[received_data->msg_length+1]),sampled_data_str.c_str());
+        Serial.printf("sampled data %d. msg length %d \n",sampled_data,received_data->msg_length);
+        snprintf(received_msg, sizeof(received_msg), "%s|%d", received_data->msg, sampled_data);
         SendNotifyToServer(received_msg, READ_ANS, pRemoteCharacteristic); // Send response
         Serial.printf("msg: %s\n",received_msg);
-        if (received_msg){free(received_msg);}
       }   
       break;}
 
@@ -269,7 +267,6 @@ void notifyCB(NimBLERemoteCharacteristic* pRemoteCharacteristic, uint8_t* pData,
         Serial.println("unrecognized respone");
         break;
   } 
-  free(received_data);
 }
 
 
@@ -340,6 +337,7 @@ bool connectToServer() {
     }
 
     Serial.printf("Connected to: %s RSSI: %d\n", pClient->getPeerAddress().toString().c_str(), pClient->getRssi());
+    negotiated_mtu = pClient->getMTU();
 
     /** Now we can read/write/subscribe the characteristics of the services we are interested in */
     NimBLERemoteService*        pSvc = nullptr;
@@ -420,17 +418,25 @@ bool connectToServer() {
         Serial.printf("service not found.\n");
     }
 
+    pServerCharacteristic = pChr;
+    SendConfigDigest(pServerCharacteristic);
     Serial.printf("Done with this device!\n");
     return true;
 }
 
 void setup() {
-    Serial.begin(115200);
+    Serial.setTxBufferSize(SERIAL_TX_BUFFER_SIZE);
+    Serial.begin(SERIAL_LOG_BAUD);
     delay(3000);
     Serial.printf("Starting NimBLE Client\n");
     init_yaml();
+    StartSampler();
+    StartRecorder();
+    StartStats();
     /** Initialize NimBLE and set the device name */
     NimBLEDevice::init("NimBLE-Client");
+    /** Ask for the largest MTU so YAML sections need as few fragments as possible */
+    NimBLEDevice::setMTU(WIRE_MAX_MTU);
     NimBLEScan* pScan = NimBLEDevice::getScan();
     /** Set the callbacks to call when scan events occur, no duplicates */
     pScan->setScanCallbacks(&scanCallbacks, false);
@@ -443,8 +449,10 @@ void setup() {
 }
 
 void loop() {
-  /** Loop here until we find a device we want to connect to */
-  delay(100);
+  /** Loop here until we find a device we want to connect to; short tick so a yaml request is served promptly.
+   *  Telemetry is sampled by its own task, the sample ring holds more than a tick worth of frames */
+  delay(10);
+  PollSerialCommands();
   if (doConnect) {
     doConnect = false;
     /** Found a device we want to connect to, do it now */
@@ -455,4 +463,20 @@ void loop() {
         NimBLEDevice::getScan()->start(scanTimeMs, false, false);      
     }
   }
+  if (pServerCharacteristic && yaml_stream_requested) {
+    yaml_stream_requested = false;
+    StreamYAML(pServerCharacteristic);
+  }
+  PollTelemetry(pServerCharacteristic);
+  if (pServerCharacteristic) {
+    PollClockSync(pServerCharacteristic);
+    PollRecorder(pServerCharacteristic);
+    PollStats(pServerCharacteristic);
+    // Ask for the fragments missing from a stalled multi-fragment request
+    char resend_req[MAX_MSG_LEN];
+    if (poll_reassembly(&cmd_reasm, resend_req, sizeof(resend_req))) {
+      Serial.printf("Transfer stalled, asking for fragments %s\n", resend_req);
+      SendNotifyToServer(resend_req, FRAG_RESEND_REQ, pServerCharacteristic);
+    }
+  }
 }
\ No newline at end of file
@@ -8,6 +8,8 @@
 
 
 const String config_yaml="/config.yaml";
+// Binary snapshot of the config (config_snapshot.h), made from config.yaml by init_yaml()
+const String config_snapshot="/config.bin";
 
 void writeYAMLFile(String yamlContent) {
   // Open or create a file on SPIFFS in write mode
@@ -29,6 +31,31 @@ String readYAML(){
   return yamlContent;
 }
 
+// Reads config.bin into a buffer (the caller frees it). NULL if there is none.
+uint8_t* ReadSnapshotFile(size_t* len){
+  File file = SPIFFS.open(config_snapshot, FILE_READ);
+  if (!file) {
+    return NULL;
+  }
+  *len = file.size();
+  uint8_t* buffer = (uint8_t*)malloc(*len > 0 ? *len : 1);
+  if (buffer) {
+    *len = file.read(buffer, *len);
+  }
+  file.close();
+  return buffer;
+}
+
+void WriteSnapshotFile(const uint8_t* data, size_t len){
+  File file = SPIFFS.open(config_snapshot, FILE_WRITE);
+  if (!file) {
+    Serial.println("Failed to open " + config_snapshot + " for writing");
+    return;
+  }
+  file.write(data, len);
+  file.close();
+}
+
 String ReadYmlUsingSPIFFS(String DefaultYamlContent) {
   if (!SPIFFS.begin(true)) {
       Serial.println("Failed to initialize SPIFFS!");
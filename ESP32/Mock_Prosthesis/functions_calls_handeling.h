@@ -5,6 +5,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include "shared_yaml_parser.h"
+#include <ProsthesisProtocol.h>
  
 int current_sensor_id;
 char* sensor_status;
@@ -18,9 +19,46 @@ void rest(void) { printf("Returning to rest position\n"); }
 // Struct to hold function pointers with parameters
 // Simulating sensor state
 void ChangeSensorState(int current_sensor_id, const char* sensor_status) { 
-  Serial.printf("old status is %s.\n",sensors[current_sensor_id].status.c_str());
-  sensors[current_sensor_id].status=strcmp(sensor_status,"1")==0 ? "on" : "off";
-  Serial.printf("new status is %s.\n",sensors[current_sensor_id].status.c_str());
+  struct config_model_sensor& sensor = handConfig.sensors[current_sensor_id];
+  Serial.printf("old status is %s.\n", sensor.status == CONFIG_STATUS_ON ? "on" : "off");
+  sensor.status = strcmp(sensor_status,"1")==0 ? CONFIG_STATUS_ON : CONFIG_STATUS_OFF;
+  Serial.printf("new status is %s.\n", sensor.status == CONFIG_STATUS_ON ? "on" : "off");
+}
+
+// Sets parameter number param_id (name order, see config_model.h) of a sensor. Returns an enum batch_cmd_result.
+int ChangeSensorParam(int sensor_id, int param_id, int new_val) {
+  if (sensor_id < 0 || sensor_id >= handConfig.sensor_count) {
+    return BATCH_UNKNOWN_TARGET;
+  }
+  const struct config_model_sensor& sensor = handConfig.sensors[sensor_id];
+  if (param_id < 0 || param_id >= sensor.param_count) {
+    return BATCH_UNKNOWN_TARGET;
+  }
+  struct config_model_param& param = handConfig.params[sensor.first_param + param_id];
+  if (new_val > param.max || new_val < param.min || !param.modify_permission) {
+    Serial.printf("Parameter cant be changed! allowed range: [%d, %d], modification premission: %s\n",
+      param.min, param.max, param.modify_permission ? "true" : "false");
+    return BATCH_REJECTED;
+  }
+  param.current_val = new_val;
+  Serial.printf("New val %d for key %s in sensor ID %d\n", new_val, ConfigName(param.name), sensor_id);
+  return BATCH_APPLIED;
+}
+
+// Sets the safety threshold of a motor. Returns an enum batch_cmd_result.
+int ChangeMotorParam(int motor_id, int new_val) {
+  if (motor_id < 0 || motor_id >= handConfig.motor_count) {
+    return BATCH_UNKNOWN_TARGET;
+  }
+  struct config_model_param& threshold = handConfig.motors[motor_id].safety_threshold;
+  if (new_val > threshold.max || new_val < threshold.min || !threshold.modify_permission) {
+    Serial.printf("Parameter cant be changed! allowed range: [%d, %d], modification premission: %s\n",
+      threshold.min, threshold.max, threshold.modify_permission ? "true" : "false");
+    return BATCH_REJECTED;
+  }
+  threshold.current_val = new_val;
+  Serial.printf("new safety treshold is %d for motors id %d\n", new_val, motor_id);
+  return BATCH_APPLIED;
 }
 
 int GetRealTimeData(int is_motor, int hardware_id) { 
@@ -0,0 +1,169 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <FS.h>
+#include <SPIFFS.h>
+#include <Arduino.h>
+#include <ProsthesisProtocol.h>
+#include "sampler.h"
+
+// Black box: the first sensors and motors are recorded from boot (see telemetry_log.h).
+// A trigger keeps RECORDER_PRE_MS before it and RECORDER_POST_MS after it in
+// recording_path, replacing the previous recording. loop() feeds the log from the
+// sample ring and queues the finished blocks; a task of its own writes them to
+// SPIFFS, so a slow flash write (page erase, garbage collection) only delays that
+// task, never the sampler or loop(). A block that finds the queue full is dropped
+// and counted.
+#define RECORDER_RATE_HZ 100
+#define RECORDER_PRE_MS 5000
+#define RECORDER_POST_MS 5000
+#define RECORDER_QUEUE_BLOCKS 32        // 8 KB, the whole pre-trigger history fits at once
+#define RECORDER_TASK_STACK 4096
+#define RECORDER_TASK_PRIORITY 1        // below the sampler
+#define RECORDER_TASK_CORE 0
+
+const String recording_path = "/recording.bin";
+
+// One piece of the log on its way to the writer task; len 0 closes the file.
+struct recorder_piece {
+  uint16_t len;
+  uint8_t data[TELEMETRY_LOG_BLOCK_SIZE];
+};
+
+static struct telemetry_log recorder;
+static struct telemetry_log_config recorder_config;
+static QueueHandle_t recorder_queue = NULL;
+static volatile bool recorder_trigger_requested = false;
+static volatile uint8_t recorder_trigger_reason = TELEMETRY_LOG_TRIGGER_NONE;
+static volatile bool recording_ready = false;      // a recording was closed, announce it
+static volatile bool recording_in_progress = false; // from the trigger until the writer closed the file
+static volatile uint32_t recording_bytes = 0;
+static volatile uint32_t recorder_slowest_write_us = 0;
+
+// telemetry_log_write_fn: never waits, the writer task may be busy with the flash.
+static bool queue_recorder_piece(const uint8_t* data, size_t len, void* ctx){
+  struct recorder_piece piece;
+  piece.len = (uint16_t)len;
+  memcpy(piece.data, data, len);
+  return xQueueSend(recorder_queue, &piece, 0) == pdTRUE;
+}
+
+static void recorder_writer_task(void* parameter){
+  struct recorder_piece piece;
+  File file;
+  while (1) {
+    if (xQueueReceive(recorder_queue, &piece, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    if (piece.len == 0) {
+      if (file) {
+        recording_bytes = file.size();
+        file.close();
+        recording_ready = true;
+      }
+      recording_in_progress = false;
+      continue;
+    }
+    if (!file) {
+      file = SPIFFS.open(recording_path, FILE_WRITE);
+      if (!file) {
+        Serial.println("Recorder: failed to open the recording for writing");
+        continue;
+      }
+    }
+    uint32_t start_us = micros();
+    file.write(piece.data, piece.len);
+    uint32_t took_us = micros() - start_us;
+    if (took_us > recorder_slowest_write_us) {
+      recorder_slowest_write_us = took_us;
+    }
+  }
+}
+
+static int recorder_sample(uint8_t is_motor, uint8_t id, void* ctx){
+  const struct sample_frame* frame = (const struct sample_frame*)ctx;
+  int index = sampler_value_index(is_motor, id);
+  return index >= 0 && index < frame->count ? frame->values[index] : 0;
+}
+
+// Starts the writer task and arms the recorder (after StartSampler()). Sensors and
+// motors take turns for the channels.
+void StartRecorder(){
+  if (recorder_queue) {
+    return;
+  }
+  recorder_config.rate_hz = RECORDER_RATE_HZ;
+  recorder_config.pre_ms = RECORDER_PRE_MS;
+  recorder_config.post_ms = RECORDER_POST_MS;
+  recorder_config.channel_count = 0;
+  for (uint8_t i = 0; recorder_config.channel_count < TELEMETRY_MAX_CHANNELS &&
+                      (i < sampler_sensor_count || i < sampler_motor_count); i++) {
+    for (uint8_t is_motor = 0; is_motor < 2 && recorder_config.channel_count < TELEMETRY_MAX_CHANNELS; is_motor++) {
+      if (i < (is_motor ? sampler_motor_count : sampler_sensor_count)) {
+        recorder_config.channels[recorder_config.channel_count].is_motor = is_motor;
+        recorder_config.channels[recorder_config.channel_count++].id = i;
+      }
+    }
+  }
+  recorder_queue = xQueueCreate(RECORDER_QUEUE_BLOCKS, sizeof(struct recorder_piece));
+  xTaskCreatePinnedToCore(recorder_writer_task, "recorder", RECORDER_TASK_STACK, NULL, RECORDER_TASK_PRIORITY, NULL, RECORDER_TASK_CORE);
+  telemetry_log_arm(&recorder, &recorder_config, sampler_tick_us(sampler_next_tick));
+  Serial.printf("Recorder: %d channels at %d Hz, %d ms before and %d ms after a trigger\n",
+                recorder_config.channel_count, RECORDER_RATE_HZ, RECORDER_PRE_MS, RECORDER_POST_MS);
+}
+
+// Safe from the BLE callback; loop() starts the recording.
+void TriggerRecording(uint8_t reason){
+  recorder_trigger_reason = reason;
+  recorder_trigger_requested = true;
+}
+
+// Records one frame of the sample ring; call from loop() for every frame drained.
+void RecordFrame(const struct sample_frame* frame){
+  if (recorder_queue) {
+    telemetry_log_feed(&recorder, sampler_tick_us(frame->tick), frame->t_us, recorder_sample, queue_recorder_piece, (void*)frame);
+  }
+}
+
+// Applies a pending trigger and closes a finished recording. Call from loop().
+void ServiceRecorder(){
+  if (!recorder_queue) {
+    return;
+  }
+  if (recorder_trigger_requested) {
+    recorder_trigger_requested = false;
+    if (telemetry_log_trigger(&recorder, recorder_trigger_reason, micros(), queue_recorder_piece, NULL)) {
+      recording_in_progress = true;
+      Serial.printf("Recorder: triggered (%d), %d ticks of history\n", recorder_trigger_reason, recorder.tick - recorder.tick_base);
+    }
+  }
+  if (recorder.state == TELEMETRY_LOG_DONE) {
+    struct recorder_piece close_piece;
+    close_piece.len = 0;
+    xQueueSend(recorder_queue, &close_piece, portMAX_DELAY);
+    Serial.printf("Recorder: %u bytes in %u blocks, %u blocks dropped, %u ticks skipped, slowest write %u us\n",
+                  recorder.bytes, recorder.blocks, recorder.dropped_blocks, recorder.skipped_ticks, recorder_slowest_write_us);
+    telemetry_log_arm(&recorder, &recorder_config, sampler_tick_us(sampler_next_tick));
+  }
+}
+
+// Reads the last recording (the caller frees it). NULL if there is none, or while
+// a new one is being written: the writer task replaces the file.
+uint8_t* ReadRecording(size_t* len){
+  if (recording_in_progress) {
+    return NULL;
+  }
+  File file = SPIFFS.open(recording_path, FILE_READ);
+  if (!file) {
+    return NULL;
+  }
+  *len = file.size();
+  uint8_t* buffer = (uint8_t*)malloc(*len > 0 ? *len : 1);
+  if (buffer) {
+    *len = file.read(buffer, *len);
+  }
+  file.close();
+  return buffer;
+}
+
+#endif //RECORDER_H
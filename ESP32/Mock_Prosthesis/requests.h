@@ -7,19 +7,319 @@
 #include <string.h>
 #include <stdint.h>
 #include "functions_calls_handeling.h"
+#include "sampler.h"
+#include "recorder.h"
+#include "usb_export.h"
 
+// ATT MTU of the connection to the screen, updated by the client callbacks
+static uint16_t negotiated_mtu = WIRE_DEFAULT_MTU;
+
+
+// wire_send_fn for this side of the link: writes to the screen's characteristic.
+static void write_frame(const uint8_t* frame, size_t len, void* ctx){
+  NimBLERemoteCharacteristic* pRemoteCharacteristic = (NimBLERemoteCharacteristic*)ctx;
+  pRemoteCharacteristic->writeValue(frame, len);
+  //TO DO- error handling
+}
+
+static void write_frame_logged(const uint8_t* frame, size_t len, void* ctx){
+  print_frame(frame, len);
+  write_frame(frame, len, ctx);
+}
+
+// Sends msg_len bytes of msg_bytes (binary payloads may contain zeros).
+void SendBytesToServer(const uint8_t* msg_bytes, size_t msg_len, int msg_type, NimBLERemoteCharacteristic* pRemoteCharacteristic){
+  send_msg(msg_type, msg_bytes, msg_len, negotiated_mtu, write_frame_logged, pRemoteCharacteristic);
+}
 
 void SendNotifyToServer(char* msg_str, int msg_type, NimBLERemoteCharacteristic* pRemoteCharacteristic){
-  int total_msg_num = ceil(((float)strlen(msg_str))/((float)(MAX_MSG_LEN-1)));
-  if (total_msg_num>1){Serial.println("The message is too long, dividing into multiple sends");}
+  SendBytesToServer((const uint8_t*)msg_str, strlen(msg_str), msg_type, pRemoteCharacteristic);
+}
+
+// Streamed config download state. YAML_REQ only raises the flag; the sections are
+// sent from loop() so the BLE callback returns right away and can keep receiving acks.
+static volatile bool yaml_stream_requested = false;
+static volatile uint32_t yaml_stream_acked = 0;   // fragments the screen confirmed
+static volatile uint32_t record_stream_acked = 0; // the same for the recording download
+static uint32_t yaml_stream_caps = 0;              // YAML_CAP_* from the last YAML_REQ
+
+// Sends one section as part of the stream, never letting more than
+// yaml_stream_window() fragments run ahead of the screen's acknowledgements (acked).
+void SendWindowed(const uint8_t* msg_bytes_in, size_t msg_len, int msg_type, NimBLERemoteCharacteristic* pRemoteCharacteristic, uint32_t* sent, volatile uint32_t* acked){
+  const char* msg_str = (const char*)msg_bytes_in;
+  size_t stride = wire_frag_payload_size(negotiated_mtu);
+  int total_msg_num = wire_frag_count(msg_len, stride);
+  uint32_t window = yaml_stream_window(stride);
+  uint8_t seq = get_next_transfer_seq();
+  if (total_msg_num>1){
+    remember_sent_msg(msg_type, seq, msg_str, msg_len, stride);
+  }
+  uint8_t frame[WIRE_FRAME_MAX_LEN];
   for (int msg_num=1;msg_num<=total_msg_num;msg_num++){
-    uint8_t* msg_bytes = str_to_byte_msg(msg_type, msg_str,msg_num, total_msg_num);
-    uint16_t len = sizeof(struct msg_interp);
-    print_msg((struct msg_interp*)msg_bytes);
+    uint32_t wait_start = millis();
+    while (*sent - *acked >= window) {
+      if (millis() - wait_start > YAML_STREAM_ACK_TIMEOUT_MS) {
+        // The ack was lost, keep going; missing fragments are recovered with FRAG_RESEND_REQ
+        Serial.println("No stream ack, sending the next window anyway");
+        *acked = *sent;
+        break;
+      }
+      delay(1);
+    }
+    size_t len = 0;
+    uint8_t* msg_bytes = str_to_byte_msg(frame, msg_type, msg_str, msg_len, &len, msg_num, seq, stride);
+    if (msg_bytes == NULL) {
+      return;
+    }
     pRemoteCharacteristic->writeValue(msg_bytes, len);
-      //TO DO- error handling
-    free(msg_bytes);
+    (*sent)++;
+  }
+}
+
+// Sends one payload of the stream, as an LZ container when lz is given and that
+// is shorter. Returns the bytes put on air.
+static size_t SendStreamed(const uint8_t* data, size_t len, int msg_type, struct lz_compressor* lz, NimBLERemoteCharacteristic* pRemoteCharacteristic, uint32_t* sent){
+  const uint8_t* payload = data;
+  size_t payload_len = len;
+  uint8_t* packed = lz ? (uint8_t*)malloc(lz_compress_bound(len)) : NULL;
+  if (packed) {
+    size_t packed_len = lz_compress(lz, data, len, packed, lz_compress_bound(len));
+    if (packed_len > 0 && packed_len < len) {
+      payload = packed;
+      payload_len = packed_len;
+    }
+  }
+  SendWindowed(payload, payload_len, msg_type, pRemoteCharacteristic, sent, &yaml_stream_acked);
+  free(packed);
+  return payload_len;
+}
+
+// Streams the configuration. If the screen announced YAML_CAP_SNAPSHOT it is
+// config.bin as one CONFIG_SNAPSHOT_ANS, otherwise the configuration is read and
+// split once and all four sections are sent. If the screen announced YAML_CAP_LZ,
+// a payload is sent as an LZ container whenever that is shorter.
+void StreamYAML(NimBLERemoteCharacteristic* pRemoteCharacteristic){
+  uint32_t start_ms = millis();
+  struct lz_compressor* lz = NULL;
+  if (yaml_stream_caps & YAML_CAP_LZ) {
+    lz = (struct lz_compressor*)malloc(sizeof(struct lz_compressor));
+  }
+  uint32_t sent = 0;
+  size_t raw_total = 0;
+  size_t sent_total = 0;
+  yaml_stream_acked = 0;
+  size_t snapshot_len = 0;
+  uint8_t* snapshot = (yaml_stream_caps & YAML_CAP_SNAPSHOT) ? ReadSnapshotFile(&snapshot_len) : NULL;
+  bool from_snapshot = snapshot != NULL;
+  if (from_snapshot) {
+    raw_total = snapshot_len;
+    sent_total = SendStreamed(snapshot, snapshot_len, CONFIG_SNAPSHOT_ANS, lz, pRemoteCharacteristic, &sent);
+    free(snapshot);
+  } else {
+    char* general = NULL;
+    char* sensors = NULL;
+    char* motors = NULL;
+    char* functions = NULL;
+    splitYaml(readYAML().c_str(), &general, &sensors, &motors, &functions);
+    char* sections[] = {sensors, motors, functions, general};
+    const int section_types[] = {YML_SENSOR_ANS, YML_MOTORS_ANS, YML_FUNC_ANS, YML_GENERAL_ANS};
+    for (int i = 0; i < 4; i++) {
+      // A missing section is sent empty so the screen does not wait for it
+      const char* text = sections[i] ? sections[i] : "";
+      size_t text_len = strlen(text);
+      sent_total += SendStreamed((const uint8_t*)text, text_len, section_types[i], lz, pRemoteCharacteristic, &sent);
+      raw_total += text_len;
+      free(sections[i]);
+    }
+  }
+  free(lz);
+  Serial.printf("Streamed %s, %u of %u bytes, %u fragments in %u ms\n", from_snapshot ? "config snapshot" : "yaml data",
+                sent_total, raw_total, sent, millis() - start_ms);
+}
+
+// Publishes the digest of the configuration right after connecting, so a screen
+// that already holds this configuration can skip the download.
+void SendConfigDigest(NimBLERemoteCharacteristic* pRemoteCharacteristic){
+  String yaml = readYAML();
+  char digest[9];
+  snprintf(digest, sizeof(digest), "%08x", config_digest((const uint8_t*)yaml.c_str(), yaml.length()));
+  Serial.printf("Config digest %s (%u bytes)\n", digest, yaml.length());
+  SendNotifyToServer(digest, CONFIG_DIGEST_ANS, pRemoteCharacteristic);
+}
+
+// Answers a FRAG_RESEND_REQ from the screen by writing the listed fragments again.
+void ResendFragments(const char* resend_req, NimBLERemoteCharacteristic* pRemoteCharacteristic){
+  resend_fragments(resend_req, write_frame, pRemoteCharacteristic);
+}
+
+// Clock sync for the telemetry timestamps. The callback only keeps t1 and t2
+// (when the request arrived); loop() answers. An answer written from the callback
+// always waits almost a whole connection interval while the request did not, which
+// skews the screen's offset by half an interval (see telemetry_sim).
+static volatile bool clock_sync_requested = false;
+static uint32_t clock_sync_t1 = 0;
+static uint32_t clock_sync_t2 = 0;
+
+void QueueClockSync(const uint8_t* req, size_t len, uint32_t received_us){
+  uint32_t t1;
+  if (!clock_sync_req_decode(req, len, &t1)) {
+    Serial.println("Malformed CLOCK_SYNC_REQ");
+    return;
+  }
+  clock_sync_t1 = t1;
+  clock_sync_t2 = received_us;
+  clock_sync_requested = true;
+}
+
+// Sends the pending CLOCK_SYNC_ANS; t3 is taken right before the write.
+void PollClockSync(NimBLERemoteCharacteristic* pRemoteCharacteristic){
+  if (!clock_sync_requested) {
+    return;
+  }
+  clock_sync_requested = false;
+  uint8_t ans[CLOCK_SYNC_ANS_LEN];
+  size_t ans_len = clock_sync_ans_encode(ans, sizeof(ans), clock_sync_t1, clock_sync_t2, micros());
+  send_msg(CLOCK_SYNC_ANS, ans, ans_len, negotiated_mtu, write_frame, pRemoteCharacteristic);
+}
+
+// Status tab statistics (see rolling_stats.h): every sampled frame updates the
+// window of each channel as it is drained from the ring; STATS_REQ only raises
+// the flag and loop() answers with all channels in one STATS_ANS.
+static struct rolling_stats channel_stats;
+static volatile bool stats_requested = false;
+
+// Sensors first, then motors, like the sample frames (after StartSampler()).
+void StartStats(){
+  struct telemetry_channel channels[ROLLING_STATS_MAX_CHANNELS];
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < sampler_sensor_count && count < ROLLING_STATS_MAX_CHANNELS; i++) {
+    channels[count].is_motor = 0;
+    channels[count++].id = i;
+  }
+  for (uint8_t i = 0; i < sampler_motor_count && count < ROLLING_STATS_MAX_CHANNELS; i++) {
+    channels[count].is_motor = 1;
+    channels[count++].id = i;
+  }
+  rolling_stats_init(&channel_stats, channels, count, ROLLING_STATS_DEFAULT_WINDOW_MS);
+  Serial.printf("Statistics: %d channels over %d ms\n", count, ROLLING_STATS_DEFAULT_WINDOW_MS);
+}
+
+static void StatsFrame(const struct sample_frame* frame){
+  for (uint8_t c = 0; c < channel_stats.channel_count && c < frame->count; c++) {
+    rolling_stats_add(&channel_stats, c, frame->t_us, frame->values[c]);
+  }
+}
+
+void PollStats(NimBLERemoteCharacteristic* pRemoteCharacteristic){
+  if (!stats_requested) {
+    return;
+  }
+  stats_requested = false;
+  uint8_t ans[ROLLING_STATS_MAX_LEN];
+  size_t ans_len = rolling_stats_encode(ans, sizeof(ans), &channel_stats, micros());
+  send_msg(STATS_ANS, ans, ans_len, negotiated_mtu, write_frame, pRemoteCharacteristic);
+}
+
+// Debug chart telemetry. TELEMETRY_SUB_REQ / TELEMETRY_UNSUB_REQ only post the
+// change here; loop() applies it and drains the sampler's ring, so the BLE callback
+// and the sender never touch the sender state at the same time.
+static struct telemetry_sender telemetry;
+static struct telemetry_sub telemetry_pending_sub;
+static volatile bool telemetry_sub_requested = false;
+static volatile bool telemetry_unsub_requested = false;
+static volatile bool telemetry_disconnect_requested = false;   // the link is gone, stop without flushing
+static uint32_t telemetry_ring_dropped_at_start = 0;
+
+// ctx of the telemetry callbacks while a frame is fed to the sender
+struct telemetry_feed_ctx {
+  const struct sample_frame* frame;
+  NimBLERemoteCharacteristic* characteristic;
+};
+
+static int sample_from_frame(uint8_t is_motor, uint8_t id, void* ctx){
+  const struct sample_frame* frame = ((struct telemetry_feed_ctx*)ctx)->frame;
+  int index = sampler_value_index(is_motor, id);
+  return index >= 0 && index < frame->count ? frame->values[index] : 0;
+}
+
+static void emit_telemetry(const uint8_t* payload, size_t len, void* ctx){
+  send_msg(TELEMETRY_DATA, payload, len, negotiated_mtu, write_frame, ((struct telemetry_feed_ctx*)ctx)->characteristic);
+}
+
+// Applies pending (un)subscriptions and sends the sampled frames that are due. Call from
+// loop(), also while disconnected (NULL) so the ring keeps being drained.
+void PollTelemetry(NimBLERemoteCharacteristic* pRemoteCharacteristic){
+  struct telemetry_feed_ctx ctx = {NULL, pRemoteCharacteristic};
+  if (telemetry_disconnect_requested) {
+    telemetry_disconnect_requested = false;
+    telemetry.active = false;
+  }
+  if (telemetry_unsub_requested) {
+    telemetry_unsub_requested = false;
+    telemetry_sender_stop(&telemetry, emit_telemetry, &ctx);
+    Serial.printf("Telemetry stopped: %u samples in %u batches, %u dropped (%u frames lost in the sample ring)\n",
+                  telemetry.sampled, telemetry.batches, telemetry.dropped,
+                  sample_ring.dropped.load() - telemetry_ring_dropped_at_start);
+  }
+  if (telemetry_sub_requested) {
+    telemetry_sub_requested = false;
+    uint8_t batch_cap = telemetry_max_batch(wire_frag_payload_size(negotiated_mtu));
+    // The sampler sets the pace, a faster subscription would only repeat frames
+    if (telemetry_pending_sub.rate_hz > SAMPLER_RATE_HZ) {
+      telemetry_pending_sub.rate_hz = SAMPLER_RATE_HZ;
+    }
+    telemetry_sender_start(&telemetry, &telemetry_pending_sub, batch_cap, sampler_tick_us(sampler_next_tick));
+    telemetry_ring_dropped_at_start = sample_ring.dropped.load();
+    Serial.printf("Telemetry started: %d channels at %d Hz, %d samples per notification:",
+                  telemetry.sub.channel_count, telemetry.sub.rate_hz, telemetry.sub.batch);
+    for (int i = 0; i < telemetry.sub.channel_count; i++) {
+      Serial.printf(" %s %d", telemetry.sub.channels[i].is_motor ? "motor" : "sensor", telemetry.sub.channels[i].id);
+    }
+    Serial.println();
+  }
+  // Drain the ring even without a subscription so it holds recent frames only
+  struct sample_frame frame;
+  ctx.frame = &frame;
+  while (sample_ring_pop(&sample_ring, &frame)) {
+    telemetry_sender_feed(&telemetry, sampler_tick_us(frame.tick), frame.t_us, sample_from_frame, emit_telemetry, &ctx);
+    RecordFrame(&frame);
+    StatsFrame(&frame);
+    ExportFrame(&frame);
+  }
+  ServiceRecorder();
+}
+
+/* ---------- Recording download (see recorder.h) ---------- */
+
+static volatile bool record_dump_requested = false;
+
+// Announces a closed recording and sends it when the screen asks for it. The
+// download is windowed like the YAML stream and acknowledged with RECORD_DATA_ACK.
+// A dump asked for while a new recording is written waits until it is closed.
+void PollRecorder(NimBLERemoteCharacteristic* pRemoteCharacteristic){
+  if (recording_ready) {
+    recording_ready = false;
+    char announce[MAX_MSG_LEN];
+    snprintf(announce, sizeof(announce), "%u|%u", recording_bytes, recorder_trigger_reason);
+    SendNotifyToServer(announce, RECORD_READY, pRemoteCharacteristic);
+  }
+  if (!record_dump_requested || recording_in_progress) {
+    return;
+  }
+  record_dump_requested = false;
+  size_t len = 0;
+  uint8_t* recording = ReadRecording(&len);
+  if (recording == NULL || len == 0) {
+    Serial.println("No recording to send");
+    free(recording);
+    return;
   }
+  uint32_t start = millis();
+  uint32_t sent = 0;
+  record_stream_acked = 0;
+  SendWindowed(recording, len, RECORD_DATA, pRemoteCharacteristic, &sent, &record_stream_acked);
+  free(recording);
+  Serial.printf("Recording sent: %u bytes in %u fragments, %u ms\n", (unsigned)len, sent, millis() - start);
 }
 
 void SimulateGestureRun(char* msg_str, NimBLERemoteCharacteristic* pRemoteCharacteristic){
@@ -0,0 +1,74 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <Arduino.h>
+#include <ProsthesisProtocol.h>
+#include "shared_yaml_parser.h"
+#include "functions_calls_handeling.h"
+
+// Fixed rate sampler: a task of its own reads every configured sensor and motor
+// once per tick into sample_ring, independent of BLE timing. PollTelemetry()
+// in loop() drains the ring (see sample_ring.h).
+#define SAMPLER_RATE_HZ 1000
+#define SAMPLER_PERIOD_US (1000000 / SAMPLER_RATE_HZ)
+#define SAMPLER_TASK_STACK 3072
+#define SAMPLER_TASK_PRIORITY 2  // above loop() so BLE traffic does not delay the ticks
+#define SAMPLER_TASK_CORE 1
+
+static struct sample_ring sample_ring;
+static uint8_t sampler_sensor_count = 0;
+static uint8_t sampler_motor_count = 0;
+static volatile uint32_t sampler_next_tick = 0;
+static TaskHandle_t sampler_task_handle = NULL;
+
+// Position of (is_motor, id) in a sample_frame, -1 if it is not sampled.
+static int sampler_value_index(uint8_t is_motor, uint8_t id){
+  if (is_motor) {
+    return id < sampler_motor_count ? sampler_sensor_count + id : -1;
+  }
+  return id < sampler_sensor_count ? id : -1;
+}
+
+// Nominal time of a tick; telemetry schedules on this so the task's jitter does not decimate wrongly.
+static uint32_t sampler_tick_us(uint32_t tick){
+  return tick * SAMPLER_PERIOD_US;
+}
+
+static void sampler_task(void* parameter){
+  TickType_t last_wake = xTaskGetTickCount();
+  const TickType_t period = pdMS_TO_TICKS(1000 / SAMPLER_RATE_HZ) > 0 ? pdMS_TO_TICKS(1000 / SAMPLER_RATE_HZ) : 1;
+  struct sample_frame frame;
+  frame.count = sampler_sensor_count + sampler_motor_count;
+  while (1) {
+    vTaskDelayUntil(&last_wake, period);
+    frame.tick = sampler_next_tick;
+    frame.t_us = micros();
+    for (uint8_t i = 0; i < sampler_sensor_count; i++) {
+      frame.values[i] = GetRealTimeData(0, i);
+    }
+    for (uint8_t i = 0; i < sampler_motor_count; i++) {
+      frame.values[sampler_sensor_count + i] = GetRealTimeData(1, i);
+    }
+    sample_ring_push(&sample_ring, &frame);
+    sampler_next_tick = frame.tick + 1;
+  }
+}
+
+// Starts sampling the sensors and motors of the loaded configuration (after init_yaml()).
+void StartSampler(){
+  if (sampler_task_handle) {
+    return;
+  }
+  size_t sensor_count = handConfig.sensor_count < SAMPLE_FRAME_MAX_VALUES ? handConfig.sensor_count : SAMPLE_FRAME_MAX_VALUES;
+  size_t motor_count = handConfig.motor_count < SAMPLE_FRAME_MAX_VALUES - sensor_count ? handConfig.motor_count : SAMPLE_FRAME_MAX_VALUES - sensor_count;
+  sampler_sensor_count = (uint8_t)sensor_count;
+  sampler_motor_count = (uint8_t)motor_count;
+  if (sensor_count < handConfig.sensor_count || motor_count < handConfig.motor_count) {
+    Serial.printf("Sampler: only the first %d sensors and %d motors are sampled\n", sampler_sensor_count, sampler_motor_count);
+  }
+  sample_ring_reset(&sample_ring);
+  xTaskCreatePinnedToCore(sampler_task, "sampler", SAMPLER_TASK_STACK, NULL, SAMPLER_TASK_PRIORITY, &sampler_task_handle, SAMPLER_TASK_CORE);
+  Serial.printf("Sampler: %d sensors and %d motors at %d Hz\n", sampler_sensor_count, sampler_motor_count, SAMPLER_RATE_HZ);
+}
+
+#endif //SAMPLER_H
@@ -0,0 +1,97 @@
+#ifndef USB_EXPORT_H
+#define USB_EXPORT_H
+
+#include <Arduino.h>
+#include <ProsthesisProtocol.h>
+#include "sampler.h"
+
+// Binary export of every sampled frame over the USB serial port (see
+// serial_export.h), for captures at the full sampler rate that the text log
+// cannot keep up with. 'B' on the serial port switches to the export and to
+// SERIAL_EXPORT_BAUD, 'T' back to the text log at SERIAL_LOG_BAUD; the host side
+// is Unit Tests/host/export_decode. Frames are written from loop() as the ring is
+// drained. A frame that does not fit in the free TX buffer is not written and
+// shows up as a gap in the ticks, it never blocks loop(). The per message logs
+// are left out while exporting; the rest of the text is skipped by the decoder.
+#define SERIAL_LOG_BAUD 115200
+#define SERIAL_EXPORT_BAUD 921600       // ~92 KB/s, a full frame of 16 values at 1000 Hz takes 46 KB/s
+#define SERIAL_TX_BUFFER_SIZE 4096      // ~45 ms at SERIAL_EXPORT_BAUD, rides over a slow loop()
+#define USB_EXPORT_CHANNELS_MS 1000     // channel map repeated for captures started late
+
+static volatile bool usb_export_active = false;
+static uint32_t usb_export_written = 0;
+static uint32_t usb_export_skipped = 0;      // did not fit in the TX buffer
+static uint32_t usb_export_channels_at = 0;
+
+static void ExportChannels(uint32_t next_tick){
+  struct telemetry_channel channels[SAMPLE_FRAME_MAX_VALUES];
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < sampler_sensor_count; i++) {
+    channels[count].is_motor = 0;
+    channels[count++].id = i;
+  }
+  for (uint8_t i = 0; i < sampler_motor_count; i++) {
+    channels[count].is_motor = 1;
+    channels[count++].id = i;
+  }
+  uint8_t out[EXPORT_MAX_FRAME_LEN];
+  size_t len = export_channels_encode(out, sizeof(out), next_tick, SAMPLER_RATE_HZ, channels, count);
+  Serial.write(out, len);
+  usb_export_channels_at = millis();
+}
+
+void StartUsbExport(){
+  if (usb_export_active) {
+    return;
+  }
+  Serial.printf("Binary export of %d channels at %d Hz, switching to %d baud\n",
+                sampler_sensor_count + sampler_motor_count, SAMPLER_RATE_HZ, SERIAL_EXPORT_BAUD);
+  Serial.flush();
+  Serial.updateBaudRate(SERIAL_EXPORT_BAUD);
+  usb_export_written = 0;
+  usb_export_skipped = 0;
+  ExportChannels(sampler_next_tick);
+  usb_export_active = true;
+}
+
+void StopUsbExport(){
+  if (!usb_export_active) {
+    return;
+  }
+  usb_export_active = false;
+  Serial.flush();
+  Serial.updateBaudRate(SERIAL_LOG_BAUD);
+  Serial.printf("Binary export stopped: %u frames written, %u did not fit in the TX buffer\n",
+                usb_export_written, usb_export_skipped);
+}
+
+// Single character commands on the serial port. Call from loop().
+void PollSerialCommands(){
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (c == 'B') {
+      StartUsbExport();
+    } else if (c == 'T') {
+      StopUsbExport();
+    }
+  }
+}
+
+static void ExportFrame(const struct sample_frame* frame){
+  if (!usb_export_active) {
+    return;
+  }
+  if (millis() - usb_export_channels_at >= USB_EXPORT_CHANNELS_MS) {
+    ExportChannels(frame->tick);
+  }
+  uint8_t out[EXPORT_MAX_FRAME_LEN];
+  size_t len = export_samples_encode(out, sizeof(out), frame->tick, frame->t_us, frame->values, frame->count);
+  if ((size_t)Serial.availableForWrite() < len) {
+    usb_export_skipped++;
+    return;
+  }
+  Serial.write(out, len);
+  usb_export_written++;
+}
+
+#endif //USB_EXPORT_H
@@ -0,0 +1,35 @@
+#ifndef PROSTHESIS_PROTOCOL_H
+#define PROSTHESIS_PROTOCOL_H
+
+// BLE protocol shared by the management screen and the prosthesis:
+// message types, framing, fragmentation, CRC, reassembly, command batches,
+// the LZ codec of the config download, Debug chart telemetry, the sample
+// ring that feeds it, the clock sync that times it, the min/max downsampling
+// and damage tracking that draw it, its long term history on the screen, the
+// black box recorder, the rolling statistics of the Status tab, the binary
+// export of the telemetry over USB serial and the parser, the flat
+// in-memory model, its lookup index and the binary snapshot of the hand
+// config, and the parse of its sections as they arrive.
+// See README.md.
+
+#include "protocol_port.h"
+#include "wire_frame.h"
+#include "batch_cmd.h"
+#include "lz_codec.h"
+#include "telemetry.h"
+#include "sample_ring.h"
+#include "clock_sync.h"
+#include "downsample.h"
+#include "plot_damage.h"
+#include "history.h"
+#include "telemetry_log.h"
+#include "rolling_stats.h"
+#include "serial_export.h"
+#include "config_parse.h"
+#include "config_model.h"
+#include "config_index.h"
+#include "config_snapshot.h"
+#include "config_stream.h"
+#include "com_vars.h"
+
+#endif //PROSTHESIS_PROTOCOL_H
@@ -0,0 +1,100 @@
+#include "batch_cmd.h"
+
+void batch_cmd_begin(struct batch_cmd_writer* w, uint8_t* buf, size_t cap){
+  w->buf = buf;
+  w->cap = cap;
+  w->len = cap >= BATCH_CMD_HDR_LEN ? BATCH_CMD_HDR_LEN : 0;
+  w->count = 0;
+  if (w->len) {
+    buf[0] = 0;
+  }
+}
+
+bool batch_cmd_add(struct batch_cmd_writer* w, uint8_t kind, uint8_t id, uint8_t param, int32_t value){
+  if (w->len == 0 || w->count == BATCH_CMD_MAX_COUNT || w->len + 2 > w->cap ||
+      kind >= BATCH_KIND_COUNT || param > BATCH_CMD_MAX_PARAM) {
+    return false;
+  }
+  size_t pos = w->len;
+  uint8_t* out = w->buf;
+  out[pos++] = (uint8_t)(kind << 6 | param);
+  out[pos++] = id;
+  uint32_t zz = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+  do {
+    if (pos >= w->cap) {
+      return false;
+    }
+    uint8_t byte = zz & 0x7F;
+    zz >>= 7;
+    out[pos++] = zz ? (uint8_t)(byte | 0x80) : byte;
+  } while (zz);
+  w->len = pos;
+  w->count++;
+  w->buf[0] = w->count;
+  return true;
+}
+
+size_t batch_cmd_len(const struct batch_cmd_writer* w){
+  return w->len;
+}
+
+bool batch_cmd_open(struct batch_cmd_reader* r, const uint8_t* buf, size_t len){
+  if (buf == NULL || len < BATCH_CMD_HDR_LEN) {
+    return false;
+  }
+  r->buf = buf;
+  r->len = len;
+  r->pos = BATCH_CMD_HDR_LEN;
+  r->count = buf[0];
+  r->read = 0;
+  return true;
+}
+
+bool batch_cmd_next(struct batch_cmd_reader* r, struct batch_cmd* cmd){
+  if (r->read == r->count || r->pos + 2 > r->len) {
+    return false;
+  }
+  const uint8_t* in = r->buf;
+  size_t pos = r->pos;
+  cmd->kind = in[pos] >> 6;
+  cmd->param = in[pos++] & BATCH_CMD_MAX_PARAM;
+  cmd->id = in[pos++];
+  uint32_t zz = 0;
+  for (int shift = 0; ; shift += 7) {
+    if (pos >= r->len || shift > 28) {
+      return false;
+    }
+    uint8_t byte = in[pos++];
+    zz |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      break;
+    }
+  }
+  cmd->value = (int32_t)(zz >> 1) ^ -(int32_t)(zz & 1);
+  if (cmd->kind >= BATCH_KIND_COUNT) {
+    return false;
+  }
+  r->pos = pos;
+  r->read++;
+  return true;
+}
+
+size_t batch_cmd_encode_results(uint8_t* out, size_t cap, const uint8_t* results, uint8_t count){
+  if (out == NULL || cap < (size_t)BATCH_CMD_HDR_LEN + count) {
+    return 0;
+  }
+  out[0] = count;
+  for (uint8_t i = 0; i < count; i++) {
+    out[BATCH_CMD_HDR_LEN + i] = results[i];
+  }
+  return BATCH_CMD_HDR_LEN + count;
+}
+
+int batch_cmd_decode_results(const uint8_t* buf, size_t len, const uint8_t** results){
+  if (buf == NULL || len < BATCH_CMD_HDR_LEN || len != (size_t)BATCH_CMD_HDR_LEN + buf[0]) {
+    return -1;
+  }
+  *results = buf + BATCH_CMD_HDR_LEN;
+  return buf[0];
+}
+
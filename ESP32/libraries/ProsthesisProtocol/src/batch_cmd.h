@@ -0,0 +1,88 @@
+#ifndef PROTOCOL_BATCH_CMD_H
+#define PROTOCOL_BATCH_CMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Packed binary command batch, the payload of BATCH_CMD_REQ / BATCH_CMD_ANS.
+// One request carries any mix of sensor state, sensor parameter and motor
+// parameter changes, so saving several edits costs one frame and one answer.
+//
+// BATCH_CMD_REQ payload:
+//   byte 0     count       number of commands that follow
+//   per command:
+//     byte 0   kind << 6 | param   enum batch_cmd_kind, parameter index (0 for state and motor commands)
+//     byte 1   id                  sensor / motor index
+//     byte 2.. value               zigzag varint, 1 byte for -64..63, 2 bytes up to +-8191
+//
+// BATCH_CMD_ANS payload:
+//   byte 0     count       same count as the request
+//   byte 1..   status      one enum batch_cmd_result per command, in request order
+
+#define BATCH_CMD_HDR_LEN 1
+#define BATCH_CMD_MAX_ENTRY_LEN 7    // kind/param + id + 5 byte varint
+#define BATCH_CMD_MAX_COUNT 255
+#define BATCH_CMD_MAX_PARAM 63
+
+enum batch_cmd_kind {
+  BATCH_SENSOR_STATE,    // value: 1 on, 0 off
+  BATCH_SENSOR_PARAM,    // param: index in the sensor's function.parameters
+  BATCH_MOTOR_PARAM,     // value: new safety threshold
+  BATCH_KIND_COUNT
+};
+
+enum batch_cmd_result {
+  BATCH_APPLIED = 0,
+  BATCH_REJECTED,        // out of range or modification not permitted
+  BATCH_UNKNOWN_TARGET   // id / param does not exist
+};
+
+struct batch_cmd {
+  uint8_t kind;
+  uint8_t id;
+  uint8_t param;
+  int32_t value;
+};
+
+// Appends commands to a caller supplied buffer (usually on the stack).
+struct batch_cmd_writer {
+  uint8_t* buf;
+  size_t cap;
+  size_t len;
+  uint8_t count;
+};
+
+// Walks the commands of a received payload without copying it.
+struct batch_cmd_reader {
+  const uint8_t* buf;
+  size_t len;
+  size_t pos;
+  uint8_t count;
+  uint8_t read;
+};
+
+void batch_cmd_begin(struct batch_cmd_writer* w, uint8_t* buf, size_t cap);
+
+// Returns false (and leaves the batch unchanged) when the command does not fit
+// or param is above BATCH_CMD_MAX_PARAM.
+bool batch_cmd_add(struct batch_cmd_writer* w, uint8_t kind, uint8_t id, uint8_t param, int32_t value);
+
+// Payload length so far, 0 if the buffer could not even hold the header.
+size_t batch_cmd_len(const struct batch_cmd_writer* w);
+
+// Returns false if buf is too short to be a batch.
+bool batch_cmd_open(struct batch_cmd_reader* r, const uint8_t* buf, size_t len);
+
+// Decodes the next command into cmd. Returns false at the end of the batch
+// or if the payload is truncated / malformed (check reader.read against count).
+bool batch_cmd_next(struct batch_cmd_reader* r, struct batch_cmd* cmd);
+
+// Builds a BATCH_CMD_ANS payload. Returns its length, 0 if out is too small.
+size_t batch_cmd_encode_results(uint8_t* out, size_t cap, const uint8_t* results, uint8_t count);
+
+// Points *results at the status bytes of a BATCH_CMD_ANS payload.
+// Returns the number of results, -1 if the payload is malformed.
+int batch_cmd_decode_results(const uint8_t* buf, size_t len, const uint8_t** results);
+
+#endif //PROTOCOL_BATCH_CMD_H
+
@@ -0,0 +1,91 @@
+#include "clock_sync.h"
+
+#include <string.h>
+
+static inline void put_u32(uint8_t* dst, uint32_t val){
+  dst[0] = (uint8_t)(val & 0xFF);
+  dst[1] = (uint8_t)((val >> 8) & 0xFF);
+  dst[2] = (uint8_t)((val >> 16) & 0xFF);
+  dst[3] = (uint8_t)(val >> 24);
+}
+
+static inline uint32_t get_u32(const uint8_t* src){
+  return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+size_t clock_sync_req_encode(uint8_t* out, size_t cap, uint32_t t1){
+  if (out == NULL || cap < CLOCK_SYNC_REQ_LEN) {
+    return 0;
+  }
+  put_u32(out, t1);
+  return CLOCK_SYNC_REQ_LEN;
+}
+
+bool clock_sync_req_decode(const uint8_t* buf, size_t len, uint32_t* t1){
+  if (buf == NULL || len != CLOCK_SYNC_REQ_LEN) {
+    return false;
+  }
+  *t1 = get_u32(buf);
+  return true;
+}
+
+size_t clock_sync_ans_encode(uint8_t* out, size_t cap, uint32_t t1, uint32_t t2, uint32_t t3){
+  if (out == NULL || cap < CLOCK_SYNC_ANS_LEN) {
+    return 0;
+  }
+  put_u32(&out[0], t1);
+  put_u32(&out[4], t2);
+  put_u32(&out[8], t3);
+  return CLOCK_SYNC_ANS_LEN;
+}
+
+bool clock_sync_ans_decode(const uint8_t* buf, size_t len, uint32_t* t1, uint32_t* t2, uint32_t* t3){
+  if (buf == NULL || len != CLOCK_SYNC_ANS_LEN) {
+    return false;
+  }
+  *t1 = get_u32(&buf[0]);
+  *t2 = get_u32(&buf[4]);
+  *t3 = get_u32(&buf[8]);
+  return true;
+}
+
+void clock_sync_reset(struct clock_sync* cs){
+  memset(cs, 0, sizeof(*cs));
+}
+
+bool clock_sync_add(struct clock_sync* cs, uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4){
+  // Both terms are differences on one clock, so wrapping does not matter
+  int32_t round_trip = (int32_t)(t4 - t1) - (int32_t)(t3 - t2);
+  if (round_trip < 0 || (uint32_t)round_trip > CLOCK_SYNC_MAX_RTT_US) {
+    return false;
+  }
+  struct clock_sync_sample* sample = &cs->window[cs->next];
+  // ((t2 - t1) + (t3 - t4)) / 2, written so the clocks may be any distance apart
+  sample->offset_us = (t2 - t1) - (uint32_t)round_trip / 2;
+  sample->rtt_us = (uint32_t)round_trip;
+  cs->next = (cs->next + 1) % CLOCK_SYNC_WINDOW;
+  if (cs->count < CLOCK_SYNC_WINDOW) {
+    cs->count++;
+  }
+  const struct clock_sync_sample* best = &cs->window[0];
+  for (uint8_t i = 1; i < cs->count; i++) {
+    if (cs->window[i].rtt_us < best->rtt_us) {
+      best = &cs->window[i];
+    }
+  }
+  cs->offset_us = best->offset_us;
+  cs->rtt_us = best->rtt_us;
+  cs->valid = true;
+  return true;
+}
+
+void clock_sync_seed(struct clock_sync* cs, uint32_t device_us, uint32_t local_us){
+  if (!cs->valid && !cs->seeded) {
+    cs->offset_us = device_us - local_us;
+    cs->seeded = true;
+  }
+}
+
+uint32_t clock_sync_to_local(const struct clock_sync* cs, uint32_t device_us){
+  return device_us - cs->offset_us;
+}
@@ -0,0 +1,58 @@
+#ifndef PROTOCOL_CLOCK_SYNC_H
+#define PROTOCOL_CLOCK_SYNC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Offset between the prosthesis clock (telemetry timestamps, micros()) and the
+// screen clock, from a four timestamp exchange:
+//
+//   screen  t1 --CLOCK_SYNC_REQ--> t2  prosthesis
+//   screen  t4 <--CLOCK_SYNC_ANS-- t3  prosthesis
+//
+// offset = ((t2 - t1) + (t3 - t4)) / 2 is exact when both legs take equally long.
+// BLE adds up to a connection interval to either leg, so the estimate kept is the
+// one with the shortest round trip among the last CLOCK_SYNC_WINDOW exchanges.
+//
+// CLOCK_SYNC_REQ payload: t1 (u32 little endian)
+// CLOCK_SYNC_ANS payload: t1, t2, t3 (u32 little endian each)
+
+#define CLOCK_SYNC_REQ_LEN 4
+#define CLOCK_SYNC_ANS_LEN 12
+#define CLOCK_SYNC_WINDOW 8
+#define CLOCK_SYNC_INTERVAL_MS 2000     // how often the screen asks while telemetry runs
+#define CLOCK_SYNC_MAX_RTT_US 500000    // answers slower than this are ignored
+
+struct clock_sync_sample {
+  uint32_t offset_us;                   // prosthesis clock - screen clock (wraps like the clocks)
+  uint32_t rtt_us;
+};
+
+struct clock_sync {
+  struct clock_sync_sample window[CLOCK_SYNC_WINDOW];
+  uint8_t count;
+  uint8_t next;
+  bool valid;                           // at least one exchange completed
+  bool seeded;                          // offset holds a rough guess, see clock_sync_seed()
+  uint32_t offset_us;
+  uint32_t rtt_us;
+};
+
+size_t clock_sync_req_encode(uint8_t* out, size_t cap, uint32_t t1);
+bool clock_sync_req_decode(const uint8_t* buf, size_t len, uint32_t* t1);
+size_t clock_sync_ans_encode(uint8_t* out, size_t cap, uint32_t t1, uint32_t t2, uint32_t t3);
+bool clock_sync_ans_decode(const uint8_t* buf, size_t len, uint32_t* t1, uint32_t* t2, uint32_t* t3);
+
+void clock_sync_reset(struct clock_sync* cs);
+
+// Adds one exchange (t4: screen time the answer arrived). Returns false if it was
+// rejected (round trip negative or above CLOCK_SYNC_MAX_RTT_US).
+bool clock_sync_add(struct clock_sync* cs, uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4);
+
+// Until the first exchange completes: takes device_us as if it had been sent at local_us.
+void clock_sync_seed(struct clock_sync* cs, uint32_t device_us, uint32_t local_us);
+
+// Prosthesis time -> screen time.
+uint32_t clock_sync_to_local(const struct clock_sync* cs, uint32_t device_us);
+
+#endif //PROTOCOL_CLOCK_SYNC_H
@@ -0,0 +1,203 @@
+#include "com_vars.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "protocol_port.h"
+
+struct wire_tx_history tx_history;
+
+static uint8_t next_transfer_seq = 0;
+
+uint32_t yaml_stream_window(size_t stride){
+  uint32_t window = YAML_STREAM_WINDOW_BYTES / stride;
+  return window < 4 ? 4 : window;
+}
+
+uint32_t yaml_req_caps(const char* payload){
+  const char* field = strstr(payload, "caps=");
+  return field ? (uint32_t)strtoul(field + 5, NULL, 16) : 0;
+}
+
+uint32_t config_digest(const uint8_t* data, size_t len){
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+uint8_t get_next_transfer_seq(){
+  return next_transfer_seq++;
+}
+
+uint8_t* str_to_byte_msg(uint8_t* frame, int req_type, const char* msg_str, size_t msg_len, size_t* frame_len, int msg_num, uint8_t seq, size_t stride){
+  *frame_len = wire_frag_encode(frame, WIRE_FRAME_MAX_LEN, req_type, seq,
+                                (const uint8_t*)msg_str, msg_len, stride, msg_num);
+  if (*frame_len == 0) {
+      PROTOCOL_LOG("Failed to encode fragment %d of a %u byte message\n", msg_num, (unsigned)msg_len);
+      return NULL;
+  }
+  return frame;
+}
+
+void send_msg(int req_type, const uint8_t* msg, size_t msg_len, uint16_t mtu, wire_send_fn send, void* ctx){
+  const char* msg_str = (const char*)msg;
+  size_t stride = wire_frag_payload_size(mtu);
+  int total_msg_num = wire_frag_count(msg_len, stride);
+  uint8_t seq = get_next_transfer_seq();
+  if (total_msg_num>1){
+    PROTOCOL_LOG("The message is too long, dividing into %d sends\n", total_msg_num);
+    remember_sent_msg(req_type, seq, msg_str, msg_len, stride);
+  }
+  uint8_t frame[WIRE_FRAME_MAX_LEN];
+  for (int msg_num=1;msg_num<=total_msg_num;msg_num++){
+    size_t len = 0;
+    uint8_t* msg_bytes = str_to_byte_msg(frame, req_type, msg_str, msg_len, &len, msg_num, seq, stride);
+    if (msg_bytes == NULL) {
+      return;
+    }
+    send(msg_bytes, len, ctx);
+  }
+}
+
+int resend_fragments(const char* resend_req, wire_send_fn send, void* ctx){
+  uint8_t seq;
+  uint8_t req_type;
+  struct wire_frag_range ranges[WIRE_RESEND_MAX_RANGES];
+  int range_cnt = wire_resend_parse(resend_req, &seq, &req_type, ranges, WIRE_RESEND_MAX_RANGES);
+  if (range_cnt < 0) {
+    PROTOCOL_LOG("Malformed resend request: %s\n", resend_req);
+    return -1;
+  }
+  // Copy the record and send without the lock: the frames go out one radio call
+  // at a time, and the lock also guards the reassembler, telemetry and stats
+  protocol_lock();
+  const struct wire_tx_record* found = wire_tx_history_find(&tx_history, req_type, seq);
+  struct wire_tx_record rec;
+  if (found != NULL) {
+    rec = *found;
+    rec.msg = (uint8_t*)malloc(found->msg_len ? found->msg_len : 1);
+    if (rec.msg != NULL) {
+      memcpy(rec.msg, found->msg, found->msg_len);
+    }
+  }
+  protocol_unlock();
+  if (found == NULL) {
+    PROTOCOL_LOG("Transfer %d is no longer in the history, can't resend it\n", seq);
+    return -1;
+  }
+  if (rec.msg == NULL) {
+    PROTOCOL_LOG("No memory to resend transfer %d\n", seq);
+    return -1;
+  }
+  int sent = 0;
+  uint8_t frame[WIRE_FRAME_MAX_LEN];
+  for (int r = 0; r < range_cnt; r++) {
+    for (uint32_t idx = ranges[r].first; idx <= ranges[r].last; idx++) {
+      size_t len = wire_frag_encode(frame, WIRE_FRAME_MAX_LEN, rec.req_type, rec.seq, rec.msg, rec.msg_len, rec.stride, idx);
+      if (len == 0) {
+        break;
+      }
+      send(frame, len, ctx);
+      sent++;
+    }
+  }
+  free(rec.msg);
+  return sent;
+}
+
+bool decode_frame(const uint8_t* pData, size_t length, struct wire_frame* frame){
+  int status = wire_frame_decode(pData, length, frame);
+  if (status != WIRE_OK) {
+    PROTOCOL_LOG("Dropping corrupted frame (length %u, error %d)\n", (unsigned)length, status);
+    return false;
+  }
+  return true;
+}
+
+uint8_t* reassemble_fragment(struct wire_reassembler* reasm, const struct wire_frame* frame, size_t* len, int* status_out){
+  protocol_lock();
+  int status = wire_reasm_push(reasm, frame, protocol_millis());
+  uint8_t* msg = (status == WIRE_REASM_DONE) ? wire_reasm_take(reasm, len) : NULL;
+  protocol_unlock();
+  if (status == WIRE_REASM_ERROR) {
+    PROTOCOL_LOG("Dropping inconsistent fragment %d/%d of transfer %d\n", frame->frag_idx, frame->frag_cnt, frame->seq);
+  } else if (status == WIRE_REASM_DUPLICATE) {
+    PROTOCOL_LOG("Dropping duplicate fragment %d/%d of transfer %d\n", frame->frag_idx, frame->frag_cnt, frame->seq);
+  }
+  if (status_out) {
+    *status_out = status;
+  }
+  return msg;
+}
+
+bool poll_reassembly(struct wire_reassembler* reasm, char* resend_req, size_t cap){
+  protocol_lock();
+  bool stalled = wire_reasm_poll(reasm, protocol_millis(), resend_req, cap);
+  protocol_unlock();
+  return stalled;
+}
+
+void reset_reassembly(struct wire_reassembler* reasm){
+  protocol_lock();
+  wire_reasm_reset(reasm);
+  protocol_unlock();
+}
+
+void remember_sent_msg(int req_type, uint8_t seq, const char* msg_str, size_t msg_len, size_t stride){
+  protocol_lock();
+  wire_tx_history_add(&tx_history, req_type, seq, (const uint8_t*)msg_str, msg_len, stride);
+  protocol_unlock();
+}
+
+bool collect_msg(struct wire_reassembler* reasm, const struct wire_frame* frame, struct msg_interp* msg_struct){
+  const uint8_t* data = frame->payload;
+  size_t len = frame->payload_len;
+  uint8_t* joined = NULL;
+  if (frame->frag_cnt > 1) {
+    joined = reassemble_fragment(reasm, frame, &len);
+    if (joined == NULL) {
+      return false;
+    }
+    data = joined;
+  }
+  bool fits = len < MAX_MSG_LEN;
+  if (fits) {
+    msg_struct->req_type = frame->req_type;
+    msg_struct->cur_msg_count = 1;
+    msg_struct->tot_msg_count = 1;
+    msg_struct->msg_length = len;
+    memcpy(msg_struct->msg, data, len);
+    msg_struct->msg[len] = '\0';
+  } else {
+    PROTOCOL_LOG("Dropping message, payload of %u bytes does not fit\n", (unsigned)len);
+  }
+  if (joined) {
+    free(joined);
+  }
+  return fits;
+}
+
+void print_byte_array(size_t length, const uint8_t* pData){
+  PROTOCOL_LOG("Byte array: ");
+  for (size_t i = 0; i < length; i++) {
+    PROTOCOL_LOG("%X ", pData[i]);
+  }
+  PROTOCOL_LOG("\n");
+}
+
+void print_msg(struct msg_interp* msg){
+  PROTOCOL_LOG("msg: %s, req_type: %d, cur_msg_count: %d, tot_msg_count: %d, msg_length: %d\n",
+   msg->msg, msg->req_type, msg->cur_msg_count, msg->tot_msg_count, msg->msg_length);
+}
+
+void print_frame(const uint8_t* frame_bytes, size_t length){
+  struct wire_frame frame;
+  if (wire_frame_decode(frame_bytes, length, &frame) != WIRE_OK) {
+    PROTOCOL_LOG("Invalid frame\n");
+    return;
+  }
+  PROTOCOL_LOG("msg: %.*s, req_type: %d, seq: %d, frag: %d/%d, payload_len: %d, frame_len: %u\n",
+   frame.payload_len, (const char*)frame.payload, frame.req_type, frame.seq, frame.frag_idx, frame.frag_cnt, frame.payload_len, (unsigned)length);
+}
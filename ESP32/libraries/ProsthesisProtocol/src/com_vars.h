@@ -0,0 +1,133 @@
+#ifndef PROTOCOL_COM_VARS_H
+#define PROTOCOL_COM_VARS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "wire_frame.h"
+
+#define MAX_MSG_LEN 128
+
+enum msg_type{
+  READ_REQ, EDIT_REQ, FUNC_REQ, YAML_REQ, GEST_REQ,
+  READ_ANS, EDIT_ANS, FUNC_ANS, YAML_ANS, GEST_ANS,
+  YML_SENSOR_REQ, YML_MOTORS_REQ, YML_FUNC_REQ, YML_GENERAL_REQ,
+  YML_SENSOR_ANS, YML_MOTORS_ANS, YML_FUNC_ANS, YML_GENERAL_ANS,
+  CHANGE_SENSOR_STATE_REQ, CHANGE_SENSOR_PARAM_REQ,
+  CHANGE_SENSOR_STATE_ANS, CHANGE_SENSOR_PARAM_ANS,
+  CHANGE_MOTOR_STATE_REQ, CHANGE_MOTOR_PARAM_REQ,
+  CHANGE_MOTOR_STATE_ANS, CHANGE_MOTOR_PARAM_ANS,
+  EMERGENCY_STOP,
+  FRAG_RESEND_REQ,
+  YML_STREAM_ACK,
+  BATCH_CMD_REQ, BATCH_CMD_ANS,
+  CONFIG_DIGEST_ANS,
+  TELEMETRY_SUB_REQ, TELEMETRY_UNSUB_REQ, TELEMETRY_DATA,
+  CLOCK_SYNC_REQ, CLOCK_SYNC_ANS,
+  RECORD_READY, RECORD_DUMP_REQ, RECORD_DATA,
+  STATS_REQ, STATS_ANS,
+  CONFIG_SNAPSHOT_ANS,
+  RECORD_DATA_ACK
+};
+
+// Streamed config download: one YAML_REQ makes the prosthesis send all four
+// sections back to back (or the snapshot of the config, see YAML_CAP_SNAPSHOT).
+// About YAML_STREAM_WINDOW_BYTES may be unacknowledged; the screen answers with
+// YML_STREAM_ACK ("<fragments received>") every half window.
+#define YAML_STREAM_WINDOW_BYTES 1024
+#define YAML_STREAM_ACK_TIMEOUT_MS 500
+
+// Window in fragments for the given stride; both sides derive it from the MTU.
+uint32_t yaml_stream_window(size_t stride);
+
+// Optional features the screen announces in the YAML_REQ payload as "caps=<hex mask>".
+// A prosthesis that does not know the field (or an older screen) falls back to plain text.
+#define YAML_CAP_LZ 0x01   // sections may be sent as LZ containers (lz_codec.h)
+#define YAML_CAP_SNAPSHOT 0x02   // the whole config may be sent as one CONFIG_SNAPSHOT_ANS (config_snapshot.h)
+
+uint32_t yaml_req_caps(const char* payload);
+
+// Digest of the configuration file. The prosthesis sends it unasked right after
+// connecting (CONFIG_DIGEST_ANS, "%08x"); a screen holding a config with the same
+// digest skips the download. FNV-1a, 32 bit.
+uint32_t config_digest(const uint8_t* data, size_t len);
+
+// Black box recordings (telemetry_log.h). The prosthesis announces a finished
+// recording with RECORD_READY ("<bytes>|<trigger>"); RECORD_DUMP_REQ makes it send
+// the log as one RECORD_DATA, streamed like the config download but acknowledged
+// with RECORD_DATA_ACK so it can run next to it.
+
+// Status tab values: STATS_REQ is answered with one STATS_ANS holding the rolling
+// statistics of every sampled channel (rolling_stats.h), fragmented when it is long.
+
+enum yaml_field_type{
+  SENSORS_FIELD, FUNCTIONS_FIELD, MOTORS_FIELD, GENERAL_FIELD
+};
+
+struct msg_interp{
+  int req_type;
+  int cur_msg_count;
+  int tot_msg_count;
+  int msg_length;
+  char msg[MAX_MSG_LEN];
+};
+
+// Multi-fragment messages we sent recently, used to answer FRAG_RESEND_REQ.
+// Take protocol_lock() around any access.
+extern struct wire_tx_history tx_history;
+
+// Every logical message (all of its fragments) shares one transfer id.
+uint8_t get_next_transfer_seq();
+
+// Builds fragment msg_num of msg_str (msg_len bytes) as a compact wire frame,
+// cutting the string every `stride` bytes, into frame (WIRE_FRAME_MAX_LEN bytes).
+// frame_len receives the number of bytes to send. Returns frame, NULL on failure.
+// Senders encode into a buffer on their own stack, reused for every fragment:
+// NimBLE copies the value in setValue()/writeValue(), and a buffer of its own is
+// never overwritten by a sender on another task (a resend in the BLE callback
+// while loop() or the LVGL task is between encoding and sending).
+uint8_t* str_to_byte_msg(uint8_t* frame, int req_type, const char* msg_str, size_t msg_len, size_t* frame_len, int msg_num, uint8_t seq, size_t stride);
+
+// Hands one encoded frame to the BLE stack (setValue + notify on the screen,
+// writeValue on the prosthesis). ctx is passed through unchanged.
+typedef void (*wire_send_fn)(const uint8_t* frame, size_t len, void* ctx);
+
+// Sends msg_len bytes of msg (binary payloads may contain zeros) as req_type,
+// fragmented for the given ATT MTU. Multi-fragment messages are kept in tx_history.
+void send_msg(int req_type, const uint8_t* msg, size_t msg_len, uint16_t mtu, wire_send_fn send, void* ctx);
+
+// Answers a FRAG_RESEND_REQ by sending the listed fragments of a remembered
+// transfer again. Returns the number of frames sent, -1 if the request is
+// malformed or the transfer is no longer in tx_history. The record is copied
+// under protocol_lock() and the frames are sent after releasing it.
+int resend_fragments(const char* resend_req, wire_send_fn send, void* ctx);
+
+// Validates a received frame. Returns false (and logs why) if it is corrupted.
+bool decode_frame(const uint8_t* pData, size_t length, struct wire_frame* frame);
+
+// Feeds one fragment to reasm. Returns the whole message (NULL terminated, the
+// caller frees it) once every fragment has arrived, NULL otherwise.
+// status (optional) receives the wire_reasm_push() result.
+uint8_t* reassemble_fragment(struct wire_reassembler* reasm, const struct wire_frame* frame, size_t* len, int* status_out=NULL);
+
+// Checks reasm for a transfer that stopped making progress. Returns true and fills
+// resend_req with a FRAG_RESEND_REQ payload naming the missing fragments if there is one.
+bool poll_reassembly(struct wire_reassembler* reasm, char* resend_req, size_t cap);
+
+// Drops everything reasm holds (on a disconnect), under the protocol lock like
+// the calls above.
+void reset_reassembly(struct wire_reassembler* reasm);
+
+// Keeps a copy of a multi-fragment message until WIRE_TX_HISTORY_SIZE newer ones were sent.
+void remember_sent_msg(int req_type, uint8_t seq, const char* msg_str, size_t msg_len, size_t stride);
+
+// Collects the fragments of a short request/answer into msg_struct.
+// Returns true once the whole message has arrived and fits in msg_struct.
+bool collect_msg(struct wire_reassembler* reasm, const struct wire_frame* frame, struct msg_interp* msg_struct);
+
+void print_byte_array(size_t length, const uint8_t* pData);
+
+void print_msg(struct msg_interp* msg);
+
+void print_frame(const uint8_t* frame_bytes, size_t length);
+
+#endif //PROTOCOL_COM_VARS_H
@@ -0,0 +1,169 @@
+#include "config_index.h"
+
+#include <string.h>
+
+static uint16_t slot_of(config_name name, uint8_t kind){
+  uint32_t h = ((uint32_t)name | ((uint32_t)kind << 16)) * 2654435761u;   // Knuth's multiplicative hash
+  return (uint16_t)((h >> 16) & (CONFIG_INDEX_SLOTS - 1));
+}
+
+// The slot holding (kind, name), or the free one it would take
+static uint16_t find_slot(const struct config_index* idx, uint8_t kind, config_name name){
+  uint16_t slot = slot_of(name, kind);
+  while (idx->slots[slot].kind != CONFIG_INDEX_FREE &&
+         (idx->slots[slot].kind != kind || idx->slots[slot].name != name)) {
+    slot = (uint16_t)((slot + 1) & (CONFIG_INDEX_SLOTS - 1));
+  }
+  return slot;
+}
+
+static void add_name(struct config_index* idx, uint8_t kind, config_name name, uint8_t id){
+  uint16_t slot = find_slot(idx, kind, name);
+  if (idx->slots[slot].kind == CONFIG_INDEX_FREE) {   // the first entry with a name keeps it
+    idx->slots[slot].name = name;
+    idx->slots[slot].kind = kind;
+    idx->slots[slot].id = id;
+  }
+}
+
+static int group_of(const struct config_index* idx, uint8_t kind, config_name type){
+  for (uint8_t g = 0; g < idx->group_count; g++) {
+    if (idx->groups[g].kind == kind && idx->groups[g].type == type) {
+      return g;
+    }
+  }
+  return -1;
+}
+
+// Counts the entries per (kind, type); the groups are laid out in build_groups()
+static uint8_t count_type(struct config_index* idx, uint8_t kind, config_name type){
+  int g = group_of(idx, kind, type);
+  if (g < 0) {
+    g = idx->group_count++;
+    idx->groups[g].type = type;
+    idx->groups[g].kind = kind;
+    idx->groups[g].count = 0;
+  }
+  idx->groups[g].count++;
+  return (uint8_t)g;
+}
+
+static void build_groups(struct config_index* idx, const struct config_model* m){
+  uint8_t group[CONFIG_INDEX_TYPED];   // of every typed entry, in the order below
+  uint8_t n = 0;
+  idx->group_count = 0;
+  for (uint8_t i = 0; i < m->sensor_count; i++) {
+    group[n++] = count_type(idx, CONFIG_INDEX_SENSORS, m->sensors[i].type);
+  }
+  for (uint8_t i = 0; i < m->motor_count; i++) {
+    group[n++] = count_type(idx, CONFIG_INDEX_MOTORS, m->motors[i].type);
+  }
+  for (uint8_t i = 0; i < m->function_count; i++) {
+    group[n++] = count_type(idx, CONFIG_INDEX_FUNCTIONS, m->functions[i].protocol_type);
+  }
+  uint8_t fill[CONFIG_INDEX_TYPED];
+  uint8_t first = 0;
+  for (uint8_t g = 0; g < idx->group_count; g++) {
+    idx->groups[g].first = first;
+    fill[g] = first;
+    first += idx->groups[g].count;
+  }
+  n = 0;
+  for (uint8_t i = 0; i < m->sensor_count; i++) {
+    idx->by_type[fill[group[n++]]++] = i;
+  }
+  for (uint8_t i = 0; i < m->motor_count; i++) {
+    idx->by_type[fill[group[n++]]++] = i;
+  }
+  for (uint8_t i = 0; i < m->function_count; i++) {
+    idx->by_type[fill[group[n++]]++] = i;
+  }
+}
+
+// Joins the names with '\n' as long as they fit
+static void build_options(char* out, const struct config_model* m, const config_name* names, uint8_t count){
+  size_t len = 0;
+  out[0] = '\0';
+  for (uint8_t i = 0; i < count; i++) {
+    const char* name = config_model_str(m, names[i]);
+    size_t name_len = strlen(name);
+    if (len + (len > 0) + name_len + 1 > CONFIG_INDEX_OPTIONS_SIZE) {
+      break;
+    }
+    if (len > 0) {
+      out[len++] = '\n';
+    }
+    memcpy(&out[len], name, name_len + 1);
+    len += name_len;
+  }
+}
+
+void config_index_build(struct config_index* idx, const struct config_model* m){
+  for (uint16_t i = 0; i < CONFIG_INDEX_SLOTS; i++) {
+    idx->slots[i].kind = CONFIG_INDEX_FREE;
+  }
+  for (uint8_t i = 0; i < m->sensor_count; i++) {
+    add_name(idx, CONFIG_INDEX_SENSORS, m->sensors[i].name, i);
+  }
+  for (uint8_t i = 0; i < m->motor_count; i++) {
+    add_name(idx, CONFIG_INDEX_MOTORS, m->motors[i].name, i);
+  }
+  for (uint8_t i = 0; i < m->function_count; i++) {
+    add_name(idx, CONFIG_INDEX_FUNCTIONS, m->functions[i].name, i);
+  }
+  for (uint8_t i = 0; i < m->general_count; i++) {
+    add_name(idx, CONFIG_INDEX_GENERAL, m->general[i].name, i);
+  }
+  build_groups(idx, m);
+  config_name names[CONFIG_MODEL_MAX_SENSORS > CONFIG_MODEL_MAX_MOTORS ? CONFIG_MODEL_MAX_SENSORS : CONFIG_MODEL_MAX_MOTORS];
+  for (uint8_t i = 0; i < m->sensor_count; i++) {
+    names[i] = m->sensors[i].name;
+  }
+  build_options(idx->sensor_options, m, names, m->sensor_count);
+  for (uint8_t i = 0; i < m->motor_count; i++) {
+    names[i] = m->motors[i].name;
+  }
+  build_options(idx->motor_options, m, names, m->motor_count);
+  idx->version = m->version;
+  idx->valid = true;
+}
+
+bool config_index_refresh(struct config_index* idx, const struct config_model* m){
+  if (idx->valid && idx->version == m->version) {
+    return false;
+  }
+  config_index_build(idx, m);
+  return true;
+}
+
+int config_index_id(const struct config_index* idx, uint8_t kind, config_name name){
+  if (!idx->valid || name == CONFIG_NAME_MISSING) {
+    return -1;
+  }
+  const struct config_index_slot* slot = &idx->slots[find_slot(idx, kind, name)];
+  return slot->kind == CONFIG_INDEX_FREE ? -1 : slot->id;
+}
+
+int config_index_find(const struct config_index* idx, const struct config_model* m, uint8_t kind, const char* name){
+  return config_index_id(idx, kind, config_model_find(m, name));
+}
+
+const uint8_t* config_index_of_type(const struct config_index* idx, uint8_t kind, config_name type, uint8_t* count){
+  int g = idx->valid ? group_of(idx, kind, type) : -1;
+  if (g < 0) {
+    *count = 0;
+    return idx->by_type;
+  }
+  *count = idx->groups[g].count;
+  return &idx->by_type[idx->groups[g].first];
+}
+
+const char* config_index_options(const struct config_index* idx, uint8_t kind){
+  if (!idx->valid) {
+    return "";
+  }
+  if (kind == CONFIG_INDEX_SENSORS) {
+    return idx->sensor_options;
+  }
+  return kind == CONFIG_INDEX_MOTORS ? idx->motor_options : "";
+}
@@ -0,0 +1,79 @@
+#ifndef PROTOCOL_CONFIG_INDEX_H
+#define PROTOCOL_CONFIG_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config_model.h"
+
+// Lookups over a config_model, built once when the config is loaded instead of
+// scanning the arrays on every use (the screen finds the entry a dropdown shows
+// by its name, lists the gesture functions and fills its dropdowns):
+//  - the id of a sensor, motor, function or general entry from its name: one
+//    open addressed hash table keyed by (kind, config_name), so a lookup by text
+//    is config_model_find() and one probe;
+//  - the ids of each kind grouped by type (sensor and motor type, function
+//    protocol_type), in config order: all the "gesture" functions in one list;
+//  - the sensor and motor names joined by '\n', the options of an LVGL dropdown.
+// The index remembers the config_model.version it was built from, and
+// config_index_refresh() rebuilds it only when the model changed since, so it can
+// be called before every use. Of entries sharing a name, the first is found, as
+// with a scan. Fixed size (about 2 KB), nothing is allocated.
+
+#define CONFIG_INDEX_SLOTS 128          // power of two above the named entries (MAX_SENSORS + MOTORS + FUNCTIONS + GENERAL)
+#define CONFIG_INDEX_TYPED (CONFIG_MODEL_MAX_SENSORS + CONFIG_MODEL_MAX_MOTORS + CONFIG_MODEL_MAX_FUNCTIONS)
+#define CONFIG_INDEX_OPTIONS_SIZE 512   // of a dropdown options string; names past it are left out
+
+enum config_index_kind {
+  CONFIG_INDEX_SENSORS,
+  CONFIG_INDEX_MOTORS,
+  CONFIG_INDEX_FUNCTIONS,
+  CONFIG_INDEX_GENERAL
+};
+
+struct config_index_slot {
+  config_name name;
+  uint8_t kind;                         // enum config_index_kind, CONFIG_INDEX_FREE for a free slot
+  uint8_t id;
+};
+#define CONFIG_INDEX_FREE 0xFF
+
+// The entries of one kind and type are by_type[first .. first + count)
+struct config_index_group {
+  config_name type;
+  uint8_t kind;
+  uint8_t first;
+  uint8_t count;
+};
+
+struct config_index {
+  bool valid;
+  uint32_t version;                     // of the model it was built from
+  struct config_index_slot slots[CONFIG_INDEX_SLOTS];
+  uint8_t group_count;
+  struct config_index_group groups[CONFIG_INDEX_TYPED];
+  uint8_t by_type[CONFIG_INDEX_TYPED];
+  char sensor_options[CONFIG_INDEX_OPTIONS_SIZE];
+  char motor_options[CONFIG_INDEX_OPTIONS_SIZE];
+};
+
+// Builds the index of the model. A zeroed index is empty and not valid.
+void config_index_build(struct config_index* idx, const struct config_model* m);
+
+// Builds the index if it was never built or the model changed since. Returns
+// true if it did.
+bool config_index_refresh(struct config_index* idx, const struct config_model* m);
+
+// The id of the entry of that kind with this name, -1 if there is none
+int config_index_id(const struct config_index* idx, uint8_t kind, config_name name);
+
+// The same by the text of the name
+int config_index_find(const struct config_index* idx, const struct config_model* m, uint8_t kind, const char* name);
+
+// The ids of the entries of a kind (sensors, motors or functions) with this
+// type, in config order; *count of them, 0 if none
+const uint8_t* config_index_of_type(const struct config_index* idx, uint8_t kind, config_name type, uint8_t* count);
+
+// The names of the sensors or motors, '\n' between them. "" for no entries or another kind.
+const char* config_index_options(const struct config_index* idx, uint8_t kind);
+
+#endif //PROTOCOL_CONFIG_INDEX_H
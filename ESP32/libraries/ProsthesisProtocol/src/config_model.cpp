@@ -0,0 +1,232 @@
+#include "config_model.h"
+
+#include <string.h>
+
+// FNV-1a
+static uint32_t name_hash(const char* text, size_t len){
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ (uint8_t)text[i]) * 16777619u;
+  }
+  return h;
+}
+
+static bool pool_equals(const struct config_model* m, config_name name, const char* text, size_t len){
+  return name + len < m->pool_len && memcmp(&m->pool[name], text, len) == 0 && m->pool[name + len] == '\0';
+}
+
+// Slot of the string in name_slots: the one holding it, or the free one it would take
+static uint16_t name_slot(const struct config_model* m, const char* text, size_t len){
+  uint16_t slot = (uint16_t)(name_hash(text, len) & (CONFIG_MODEL_NAME_SLOTS - 1));
+  while (m->name_slots[slot] != 0 && !pool_equals(m, (config_name)(m->name_slots[slot] - 1), text, len)) {
+    slot = (uint16_t)((slot + 1) & (CONFIG_MODEL_NAME_SLOTS - 1));
+  }
+  return slot;
+}
+
+void config_model_reset(struct config_model* m){
+  uint32_t version = m->version;
+  memset(m, 0, sizeof(*m));
+  m->pool_len = 1;                     // pool[0] is the empty string
+  m->version = version + 1;
+}
+
+config_name config_model_intern(struct config_model* m, const char* text, size_t len){
+  if (len == 0) {
+    return CONFIG_NAME_EMPTY;
+  }
+  if (m->pool_len == 0) {
+    m->pool_len = 1;                   // a zeroed model, pool[0] stays the empty string
+  }
+  uint16_t slot = name_slot(m, text, len);
+  if (m->name_slots[slot] != 0) {
+    return (config_name)(m->name_slots[slot] - 1);
+  }
+  if (m->name_count >= CONFIG_MODEL_MAX_NAMES || m->pool_len + len + 1 > CONFIG_MODEL_POOL_SIZE) {
+    m->dropped++;
+    return CONFIG_NAME_EMPTY;
+  }
+  config_name name = m->pool_len;
+  memcpy(&m->pool[name], text, len);
+  m->pool[name + len] = '\0';
+  m->pool_len = (uint16_t)(m->pool_len + len + 1);
+  m->name_slots[slot] = (uint16_t)(name + 1);
+  m->name_count++;
+  return name;
+}
+
+config_name config_model_find(const struct config_model* m, const char* s){
+  size_t len = strlen(s);
+  if (len == 0) {
+    return CONFIG_NAME_EMPTY;
+  }
+  uint16_t slot = name_slot(m, s, len);
+  return m->name_slots[slot] != 0 ? (config_name)(m->name_slots[slot] - 1) : CONFIG_NAME_MISSING;
+}
+
+const char* config_model_str(const struct config_model* m, config_name name){
+  return name < m->pool_len ? &m->pool[name] : "";
+}
+
+const struct config_model_param* config_model_sensor_params(const struct config_model* m, const struct config_model_sensor* sensor){
+  return &m->params[sensor->first_param];
+}
+
+const struct config_model_pin* config_model_motor_pins(const struct config_model* m, const struct config_model_motor* motor){
+  return &m->pins[motor->first_pin];
+}
+
+void config_model_clear_section(struct config_model* m, uint8_t section){
+  m->version++;
+  switch (section) {
+    case CONFIG_GENERAL:
+      m->general_count = 0;
+      break;
+    case CONFIG_COMMUNICATIONS:
+      m->communication_count = 0;
+      break;
+    case CONFIG_SENSORS:
+      m->sensor_count = 0;
+      m->param_count = 0;
+      break;
+    case CONFIG_MOTORS:
+      m->motor_count = 0;
+      m->pin_count = 0;
+      break;
+    case CONFIG_FUNCTIONS:
+      m->function_count = 0;
+      break;
+  }
+}
+
+static config_name intern_text(struct config_model* m, const struct config_text* t){
+  return config_model_intern(m, t->text, t->len);
+}
+
+// "on" in any case, anything else is off
+static uint8_t status_of(const struct config_text* t){
+  if (t->len == 2 && (t->text[0] == 'o' || t->text[0] == 'O') && (t->text[1] == 'n' || t->text[1] == 'N')) {
+    return CONFIG_STATUS_ON;
+  }
+  return CONFIG_STATUS_OFF;
+}
+
+static void store_param(struct config_model* m, struct config_model_param* out, const struct config_param* p){
+  out->name = intern_text(m, &p->name);
+  out->modify_permission = p->modify_permission;
+  out->current_val = p->current_val;
+  out->min = p->min;
+  out->max = p->max;
+}
+
+static void store_sensor(struct config_model* m, const struct config_entry* e){
+  if (m->sensor_count >= CONFIG_MODEL_MAX_SENSORS) {
+    m->dropped++;
+    return;
+  }
+  struct config_model_sensor* s = &m->sensors[m->sensor_count++];
+  s->name = intern_text(m, &e->name);
+  s->type = intern_text(m, &e->type);
+  s->function_name = intern_text(m, &e->function_name);
+  s->status = status_of(&e->status);
+  s->first_param = m->param_count;
+  s->param_count = 0;
+  for (uint8_t i = 0; i < e->param_count; i++) {
+    if (m->param_count >= CONFIG_MODEL_MAX_PARAMS) {
+      m->dropped++;
+      continue;
+    }
+    store_param(m, &m->params[m->param_count++], &e->params[i]);
+    s->param_count++;
+  }
+  // Name order: a parameter's id is its place in it
+  struct config_model_param* params = &m->params[s->first_param];
+  for (uint8_t i = 1; i < s->param_count; i++) {
+    struct config_model_param p = params[i];
+    uint8_t j = i;
+    while (j > 0 && strcmp(config_model_str(m, params[j - 1].name), config_model_str(m, p.name)) > 0) {
+      params[j] = params[j - 1];
+      j--;
+    }
+    params[j] = p;
+  }
+}
+
+static void store_motor(struct config_model* m, const struct config_entry* e){
+  if (m->motor_count >= CONFIG_MODEL_MAX_MOTORS) {
+    m->dropped++;
+    return;
+  }
+  struct config_model_motor* motor = &m->motors[m->motor_count++];
+  motor->name = intern_text(m, &e->name);
+  motor->type = intern_text(m, &e->type);
+  motor->first_pin = m->pin_count;
+  motor->pin_count = 0;
+  for (uint8_t i = 0; i < e->pin_count; i++) {
+    if (m->pin_count >= CONFIG_MODEL_MAX_PINS) {
+      m->dropped++;
+      continue;
+    }
+    struct config_model_pin* pin = &m->pins[m->pin_count++];
+    pin->type = intern_text(m, &e->pins[i].type);
+    pin->pin_number = (int16_t)e->pins[i].pin_number;
+    motor->pin_count++;
+  }
+  store_param(m, &motor->safety_threshold, &e->safety_threshold);
+}
+
+void config_model_store(const struct config_entry* entry, void* ctx){
+  struct config_model* m = (struct config_model*)ctx;
+  m->version++;
+  switch (entry->section) {
+    case CONFIG_GENERAL:
+      if (m->general_count >= CONFIG_MODEL_MAX_GENERAL) {
+        m->dropped++;
+        break;
+      }
+      m->general[m->general_count].name = intern_text(m, &entry->name);
+      m->general[m->general_count++].code = entry->code;
+      break;
+    case CONFIG_COMMUNICATIONS: {
+      if (m->communication_count >= CONFIG_MODEL_MAX_COMMUNICATIONS) {
+        m->dropped++;
+        break;
+      }
+      struct config_model_communication* c = &m->communications[m->communication_count++];
+      c->name = intern_text(m, &entry->name);
+      c->status = status_of(&entry->status);
+      c->ssid = intern_text(m, &entry->ssid);
+      c->password = intern_text(m, &entry->password);
+      c->mac = intern_text(m, &entry->mac);
+      c->service_uuid = intern_text(m, &entry->service_uuid);
+      c->characteristic_uuid = intern_text(m, &entry->characteristic_uuid);
+      break;
+    }
+    case CONFIG_SENSORS:
+      store_sensor(m, entry);
+      break;
+    case CONFIG_MOTORS:
+      store_motor(m, entry);
+      break;
+    case CONFIG_FUNCTIONS:
+      if (m->function_count >= CONFIG_MODEL_MAX_FUNCTIONS) {
+        m->dropped++;
+        break;
+      }
+      m->functions[m->function_count].name = intern_text(m, &entry->name);
+      m->functions[m->function_count++].protocol_type = intern_text(m, &entry->protocol_type);
+      break;
+  }
+}
+
+int config_model_load(struct config_model* m, const char* yaml, size_t len, struct config_parse_result* result){
+  struct config_parse_result local;
+  if (result == NULL) {
+    result = &local;
+  }
+  int entries = config_parse(yaml, len, config_model_store, m, result);
+  if (result->file_type.len > 0) {
+    m->file_type = intern_text(m, &result->file_type);
+  }
+  return entries;
+}
@@ -0,0 +1,154 @@
+#ifndef PROTOCOL_CONFIG_MODEL_H
+#define PROTOCOL_CONFIG_MODEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config_parse.h"
+
+// The hand configuration as both devices keep it in RAM, filled from
+// config_parse() (config_model_store() is its callback). Everything is in one
+// fixed size struct, so loading a config does not touch the heap:
+//  - every string is interned once in a pool and referred to by its offset
+//    (config_name), so the "DC_motor", "in1_pin" or "leg_function" repeated by
+//    every entry take their bytes once and compare as integers;
+//  - status is an enum, "on" / "off" are read once when the entry is stored;
+//  - sensors, motors, functions, general and communications entries are arrays
+//    in config order, and the index of an entry is its id (the one the protocol
+//    uses). The parameters of all sensors are one array, as are the pins of all
+//    motors; an entry holds the first index and the count of its own. The
+//    parameters of a sensor are kept in name order, the order of the map they
+//    used to be in, so a parameter id means the same as before.
+// Entries or strings that do not fit the limits below are dropped and counted.
+// Clearing a section frees its entries, the strings stay interned until the
+// model is reset. A zeroed model (a global) is empty and ready to load.
+// version counts the changes of the entries (reset, clear, store, snapshot
+// load), for config_index.h to know when to rebuild; editing a parameter value or
+// a status in place does not count.
+
+#define CONFIG_MODEL_MAX_SENSORS 16     // SAMPLE_FRAME_MAX_VALUES channels in all
+#define CONFIG_MODEL_MAX_MOTORS 16
+#define CONFIG_MODEL_MAX_FUNCTIONS 32
+#define CONFIG_MODEL_MAX_GENERAL 8
+#define CONFIG_MODEL_MAX_COMMUNICATIONS 4
+#define CONFIG_MODEL_MAX_PARAMS 64      // of all sensors
+#define CONFIG_MODEL_MAX_PINS 64        // of all motors
+#define CONFIG_MODEL_MAX_NAMES 96       // distinct strings
+#define CONFIG_MODEL_NAME_SLOTS 128     // hash table of the names, power of two above MAX_NAMES
+#define CONFIG_MODEL_POOL_SIZE 1024     // bytes of the distinct strings, 0 terminated (the example config takes 329)
+
+// Offset of an interned string in the pool. 0 is the empty string.
+typedef uint16_t config_name;
+#define CONFIG_NAME_EMPTY 0
+#define CONFIG_NAME_MISSING 0xFFFF      // config_model_find() of a string never interned
+
+enum config_status {
+  CONFIG_STATUS_OFF,
+  CONFIG_STATUS_ON
+};
+
+struct config_model_param {
+  config_name name;
+  bool modify_permission;
+  int32_t current_val;
+  int32_t min;
+  int32_t max;
+};
+
+struct config_model_pin {
+  config_name type;
+  int16_t pin_number;
+};
+
+struct config_model_sensor {
+  config_name name;
+  config_name type;
+  config_name function_name;
+  uint8_t status;                       // enum config_status
+  uint8_t param_count;
+  uint16_t first_param;                 // in config_model.params
+};
+
+struct config_model_motor {
+  config_name name;
+  config_name type;
+  uint16_t first_pin;                   // in config_model.pins
+  uint8_t pin_count;
+  struct config_model_param safety_threshold;
+};
+
+struct config_model_function {
+  config_name name;
+  config_name protocol_type;
+};
+
+struct config_model_general {
+  config_name name;
+  int32_t code;
+};
+
+struct config_model_communication {
+  config_name name;
+  uint8_t status;                       // enum config_status
+  config_name ssid;
+  config_name password;
+  config_name mac;
+  config_name service_uuid;
+  config_name characteristic_uuid;
+};
+
+struct config_model {
+  config_name file_type;
+  uint8_t sensor_count;
+  uint8_t motor_count;
+  uint8_t function_count;
+  uint8_t general_count;
+  uint8_t communication_count;
+  uint16_t param_count;
+  uint16_t pin_count;
+  uint16_t dropped;                     // entries, parameters, pins or strings that did not fit
+  uint32_t version;                     // bumped by every change of the entries
+  struct config_model_sensor sensors[CONFIG_MODEL_MAX_SENSORS];
+  struct config_model_motor motors[CONFIG_MODEL_MAX_MOTORS];
+  struct config_model_function functions[CONFIG_MODEL_MAX_FUNCTIONS];
+  struct config_model_general general[CONFIG_MODEL_MAX_GENERAL];
+  struct config_model_communication communications[CONFIG_MODEL_MAX_COMMUNICATIONS];
+  struct config_model_param params[CONFIG_MODEL_MAX_PARAMS];
+  struct config_model_pin pins[CONFIG_MODEL_MAX_PINS];
+  uint16_t name_count;
+  uint16_t pool_len;
+  uint16_t name_slots[CONFIG_MODEL_NAME_SLOTS];   // pool offset + 1, 0 for a free slot
+  char pool[CONFIG_MODEL_POOL_SIZE];
+};
+
+// Empties the model and its string pool
+void config_model_reset(struct config_model* m);
+
+// Drops the entries of one section (enum config_section), with the parameters
+// of the sensors or the pins of the motors. The other sections keep their ids.
+void config_model_clear_section(struct config_model* m, uint8_t section);
+
+// config_entry_fn of config_parse(), ctx is the model. Appends the entry.
+void config_model_store(const struct config_entry* entry, void* ctx);
+
+// config_parse() into the model, appending to what it holds. result may be NULL.
+// Returns the number of entries parsed.
+int config_model_load(struct config_model* m, const char* yaml, size_t len, struct config_parse_result* result);
+
+// Interns len bytes of text and returns its name. CONFIG_NAME_EMPTY if the pool
+// is full (counted in dropped).
+config_name config_model_intern(struct config_model* m, const char* text, size_t len);
+
+// The name of an interned string, CONFIG_NAME_MISSING if it was never interned
+// (so no entry can have it)
+config_name config_model_find(const struct config_model* m, const char* s);
+
+// The 0 terminated text of a name
+const char* config_model_str(const struct config_model* m, config_name name);
+
+// The parameters of a sensor, param_count of them (writable through m->params)
+const struct config_model_param* config_model_sensor_params(const struct config_model* m, const struct config_model_sensor* sensor);
+
+// The pins of a motor, pin_count of them
+const struct config_model_pin* config_model_motor_pins(const struct config_model* m, const struct config_model_motor* motor);
+
+#endif //PROTOCOL_CONFIG_MODEL_H
@@ -0,0 +1,530 @@
+#include "config_parse.h"
+
+#include <string.h>
+
+// What the keys of a nested block belong to
+enum config_block {
+  BLOCK_ENTRY,                         // the list entry itself
+  BLOCK_FUNCTION,                      // sensors: function
+  BLOCK_PARAMETERS,                    // sensors: function.parameters
+  BLOCK_PINS,                          // motors: pins
+  BLOCK_OTHER                          // not part of the schema, ignored
+};
+
+static struct config_text make_text(const char* text, size_t len){
+  struct config_text t;
+  t.text = text;
+  t.len = (uint16_t)(len > UINT16_MAX ? UINT16_MAX : len);
+  return t;
+}
+
+bool config_text_equals(const struct config_text* t, const char* s){
+  size_t len = strlen(s);
+  return t->len == len && memcmp(t->text, s, len) == 0;
+}
+
+static bool text_equals_nocase(const struct config_text* t, const char* s){
+  size_t len = strlen(s);
+  if (t->len != len) {
+    return false;
+  }
+  for (size_t i = 0; i < len; i++) {
+    char c = t->text[i];
+    if (c >= 'A' && c <= 'Z') {
+      c = (char)(c - 'A' + 'a');
+    }
+    if (c != s[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static struct config_text trim(const char* text, size_t len){
+  while (len > 0 && (*text == ' ' || *text == '\t')) {
+    text++;
+    len--;
+  }
+  while (len > 0 && (text[len - 1] == ' ' || text[len - 1] == '\t')) {
+    len--;
+  }
+  return make_text(text, len);
+}
+
+// Removes the quotes of a 'single' or "double" quoted scalar
+static struct config_text unquote(struct config_text t){
+  if (t.len >= 2 && (t.text[0] == '\'' || t.text[0] == '"') && t.text[t.len - 1] == t.text[0]) {
+    return make_text(t.text + 1, t.len - 2);
+  }
+  return t;
+}
+
+static bool parse_int(struct config_text t, int* out){
+  size_t i = 0;
+  bool negative = false;
+  if (i < t.len && (t.text[i] == '-' || t.text[i] == '+')) {
+    negative = t.text[i] == '-';
+    i++;
+  }
+  if (i == t.len) {
+    return false;
+  }
+  long value = 0;
+  for (; i < t.len; i++) {
+    if (t.text[i] < '0' || t.text[i] > '9' || value > 100000000L) {
+      return false;
+    }
+    value = value * 10 + (t.text[i] - '0');
+  }
+  *out = (int)(negative ? -value : value);
+  return true;
+}
+
+static bool parse_bool(struct config_text t, bool* out){
+  if (text_equals_nocase(&t, "true") || config_text_equals(&t, "1")) {
+    *out = true;
+    return true;
+  }
+  if (text_equals_nocase(&t, "false") || config_text_equals(&t, "0")) {
+    *out = false;
+    return true;
+  }
+  return false;
+}
+
+// [current, min, max, modify_permission]
+static bool parse_param(struct config_text t, struct config_param* out){
+  if (t.len < 2 || t.text[0] != '[' || t.text[t.len - 1] != ']') {
+    return false;
+  }
+  const char* p = t.text + 1;
+  const char* end = t.text + t.len - 1;
+  struct config_text items[4];
+  int count = 0;
+  while (true) {
+    const char* comma = (const char*)memchr(p, ',', end - p);
+    if (count == 4) {
+      return false;                    // a fifth value
+    }
+    items[count++] = trim(p, (comma ? comma : end) - p);
+    if (!comma) {
+      break;
+    }
+    p = comma + 1;
+  }
+  if (count != 4) {
+    return false;
+  }
+  return parse_int(items[0], &out->current_val) && parse_int(items[1], &out->min) &&
+         parse_int(items[2], &out->max) && parse_bool(items[3], &out->modify_permission);
+}
+
+// Length of a line without its comment: a # outside quotes, at the start or after a blank
+static size_t strip_comment(const char* text, size_t len){
+  char quote = 0;
+  for (size_t i = 0; i < len; i++) {
+    char c = text[i];
+    if (quote) {
+      if (c == quote) {
+        quote = 0;
+      }
+    } else if (c == '\'' || c == '"') {
+      quote = c;
+    } else if (c == '#' && (i == 0 || text[i - 1] == ' ' || text[i - 1] == '\t')) {
+      return i;
+    }
+  }
+  return len;
+}
+
+// Splits "key: value"; false if there is no colon followed by a blank or the end of the line
+static bool split_key(struct config_text line, struct config_text* key, struct config_text* value){
+  char quote = 0;
+  for (size_t i = 0; i < line.len; i++) {
+    char c = line.text[i];
+    if (quote) {
+      if (c == quote) {
+        quote = 0;
+      }
+    } else if (c == '\'' || c == '"') {
+      quote = c;
+    } else if (c == ':' && (i + 1 == line.len || line.text[i + 1] == ' ' || line.text[i + 1] == '\t')) {
+      *key = unquote(trim(line.text, i));
+      *value = trim(line.text + i + 1, line.len - i - 1);
+      return key->len > 0;
+    }
+  }
+  return false;
+}
+
+static uint8_t section_of(const struct config_text* key){
+  if (config_text_equals(key, "general")) return CONFIG_GENERAL;
+  if (config_text_equals(key, "communications")) return CONFIG_COMMUNICATIONS;
+  if (config_text_equals(key, "sensors")) return CONFIG_SENSORS;
+  if (config_text_equals(key, "motors")) return CONFIG_MOTORS;
+  if (config_text_equals(key, "functions")) return CONFIG_FUNCTIONS;
+  return CONFIG_SECTION_NONE;
+}
+
+static void skip_line(struct config_parser* ps){
+  ps->result.skipped_lines++;
+  if (ps->result.first_skipped_line == 0) {
+    ps->result.first_skipped_line = ps->result.lines;
+  }
+}
+
+static void finish_entry(struct config_parser* ps){
+  if (ps->in_entry) {
+    ps->in_entry = false;
+    ps->result.entries++;
+    if (ps->on_entry != NULL) {
+      ps->on_entry(&ps->entry, ps->ctx);
+    }
+  }
+  ps->depth = 0;
+}
+
+static void start_entry(struct config_parser* ps){
+  finish_entry(ps);
+  memset(&ps->entry, 0, sizeof(ps->entry));
+  ps->entry.section = ps->section;
+  ps->in_entry = true;
+  ps->pin_open = false;
+}
+
+static uint8_t current_block(const struct config_parser* ps){
+  return ps->depth > 0 ? ps->block[ps->depth - 1] : (uint8_t)BLOCK_ENTRY;
+}
+
+// Closes the blocks a line at indent is no longer part of
+static void close_blocks(struct config_parser* ps, int indent){
+  while (ps->depth > 0 && ps->block_indent[ps->depth - 1] >= indent) {
+    ps->depth--;
+  }
+}
+
+// Stores a scalar of the entry itself; keys the schema does not know are ignored
+static bool set_entry_field(struct config_entry* e, const struct config_text* key, struct config_text raw){
+  struct config_text value = unquote(raw);
+  if (config_text_equals(key, "name")) {
+    e->name = value;
+  } else if (config_text_equals(key, "status")) {
+    e->status = value;
+  } else if (config_text_equals(key, "type")) {
+    e->type = value;
+  } else if (config_text_equals(key, "code")) {
+    return parse_int(value, &e->code);
+  } else if (config_text_equals(key, "ssid")) {
+    e->ssid = value;
+  } else if (config_text_equals(key, "password")) {
+    e->password = value;
+  } else if (config_text_equals(key, "mac")) {
+    e->mac = value;
+  } else if (config_text_equals(key, "SERVICE1_UUID")) {
+    e->service_uuid = value;
+  } else if (config_text_equals(key, "CHARACTERISTIC1_UUID")) {
+    e->characteristic_uuid = value;
+  } else if (config_text_equals(key, "protocol_type")) {
+    e->protocol_type = value;
+  } else if (config_text_equals(key, "safety_threshold")) {
+    e->has_safety_threshold = parse_param(raw, &e->safety_threshold);
+    return e->has_safety_threshold;
+  }
+  return true;
+}
+
+// "key: value" or "key:" at indent, inside the current entry
+static bool key_line(struct config_parser* ps, struct config_text line, int indent){
+  struct config_text key, value;
+  if (!split_key(line, &key, &value)) {
+    return false;
+  }
+  uint8_t block = current_block(ps);
+  struct config_entry* e = &ps->entry;
+  if (value.len == 0) {
+    // A nested block starts
+    uint8_t inner = BLOCK_OTHER;
+    if (block == BLOCK_ENTRY && config_text_equals(&key, "function")) {
+      inner = BLOCK_FUNCTION;
+    } else if (block == BLOCK_FUNCTION && config_text_equals(&key, "parameters")) {
+      inner = BLOCK_PARAMETERS;
+    } else if (block == BLOCK_ENTRY && config_text_equals(&key, "pins")) {
+      inner = BLOCK_PINS;
+    }
+    if (ps->depth == CONFIG_MAX_DEPTH) {
+      return false;
+    }
+    ps->block_indent[ps->depth] = indent;
+    ps->block[ps->depth++] = inner;
+    return true;
+  }
+  switch (block) {
+    case BLOCK_ENTRY:
+      return set_entry_field(e, &key, value);
+    case BLOCK_FUNCTION:
+      if (config_text_equals(&key, "name")) {
+        e->function_name = unquote(value);
+      }
+      return true;
+    case BLOCK_PARAMETERS: {
+      if (e->param_count == CONFIG_MAX_PARAMS) {
+        return false;
+      }
+      struct config_param* param = &e->params[e->param_count];
+      param->name = key;
+      if (!parse_param(value, param)) {
+        return false;
+      }
+      e->param_count++;
+      return true;
+    }
+    case BLOCK_PINS: {
+      if (!ps->pin_open) {
+        return false;
+      }
+      struct config_pin* pin = &e->pins[e->pin_count - 1];
+      if (config_text_equals(&key, "type")) {
+        pin->type = unquote(value);
+      } else if (config_text_equals(&key, "pin_number")) {
+        return parse_int(unquote(value), &pin->pin_number);
+      }
+      return true;
+    }
+    default:
+      return true;
+  }
+}
+
+static void parse_line(struct config_parser* ps, const char* text, size_t len){
+  if (len > 0 && text[len - 1] == '\r') {
+    len--;
+  }
+  int indent = 0;
+  while ((size_t)indent < len && text[indent] == ' ') {
+    indent++;
+  }
+  struct config_text line = trim(text + indent, strip_comment(text + indent, len - indent));
+  if (line.len == 0) {
+    return;
+  }
+  bool dash = line.text[0] == '-' && (line.len == 1 || line.text[1] == ' ');
+  if (indent == 0 && !dash) {
+    // Top level: a section, or a scalar such as file_type
+    finish_entry(ps);
+    struct config_text key, value;
+    if (!split_key(line, &key, &value)) {
+      ps->section = CONFIG_SECTION_NONE;
+      skip_line(ps);
+      return;
+    }
+    ps->section = value.len == 0 ? section_of(&key) : (uint8_t)CONFIG_SECTION_NONE;
+    ps->item_indent = -1;
+    if (config_text_equals(&key, "file_type")) {
+      ps->result.file_type = unquote(value);
+    }
+    return;
+  }
+  if (ps->section == CONFIG_SECTION_NONE) {
+    return;
+  }
+  if (dash) {
+    struct config_text rest = trim(line.text + 1, line.len - 1);
+    int rest_indent = indent + (int)(rest.text - line.text);
+    if (ps->item_indent < 0 || indent <= ps->item_indent) {
+      ps->item_indent = indent;
+      start_entry(ps);
+    } else {
+      // An item of a nested list: a new pin
+      close_blocks(ps, indent);
+      if (!ps->in_entry || current_block(ps) != BLOCK_PINS) {
+        ps->pin_open = false;
+        skip_line(ps);
+        return;
+      }
+      ps->pin_open = ps->entry.pin_count < CONFIG_MAX_PINS;
+      if (!ps->pin_open) {
+        skip_line(ps);
+        return;
+      }
+      ps->entry.pin_count++;
+    }
+    if (rest.len > 0 && !key_line(ps, rest, rest_indent)) {
+      skip_line(ps);
+    }
+    return;
+  }
+  if (!ps->in_entry) {
+    skip_line(ps);
+    return;
+  }
+  close_blocks(ps, indent);
+  if (!key_line(ps, line, indent)) {
+    skip_line(ps);
+  }
+}
+
+static void init_parser(struct config_parser* ps, config_entry_fn on_entry, void* ctx){
+  memset(&ps->result, 0, sizeof(ps->result));
+  ps->on_entry = on_entry;
+  ps->ctx = ctx;
+  ps->section = CONFIG_SECTION_NONE;
+  ps->item_indent = -1;
+  ps->in_entry = false;
+  ps->pin_open = false;
+  ps->depth = 0;
+}
+
+static void count_line(struct config_parser* ps){
+  if (ps->result.lines < UINT16_MAX) {
+    ps->result.lines++;
+  }
+}
+
+int config_parse(const char* yaml, size_t len, config_entry_fn on_entry, void* ctx, struct config_parse_result* result){
+  struct config_parser ps;
+  init_parser(&ps, on_entry, ctx);
+  size_t pos = 0;
+  while (yaml != NULL && pos < len) {
+    const char* nl = (const char*)memchr(yaml + pos, '\n', len - pos);
+    size_t line_len = nl ? (size_t)(nl - (yaml + pos)) : len - pos;
+    count_line(&ps);
+    parse_line(&ps, yaml + pos, line_len);
+    pos += line_len + 1;
+  }
+  finish_entry(&ps);
+  if (result != NULL) {
+    *result = ps.result;
+  }
+  return ps.result.entries;
+}
+
+void config_parse_begin(struct config_parse_stream* st, config_entry_fn on_entry, void* ctx){
+  init_parser(&st->ps, on_entry, ctx);
+  st->len = 0;
+  st->parsed = 0;
+  st->entry_start = 0;
+  st->discarding = false;
+  st->file_type[0] = '\0';
+}
+
+// Parses one line of the buffer and keeps track of where the current entry starts
+static void parse_stream_line(struct config_parse_stream* st, uint16_t start, uint16_t len){
+  struct config_parser* ps = &st->ps;
+  bool was_in_entry = ps->in_entry;
+  uint16_t entries = ps->result.entries;
+  count_line(ps);
+  parse_line(ps, st->buf + start, len);
+  if (ps->in_entry && (!was_in_entry || ps->result.entries != entries)) {
+    st->entry_start = start;
+  }
+  // file_type is a top level line, gone from the buffer long before the end
+  const char* ft = ps->result.file_type.text;
+  if (ft >= st->buf && ft < st->buf + sizeof(st->buf)) {
+    uint16_t ft_len = ps->result.file_type.len < CONFIG_STREAM_NAME_MAX - 1 ? ps->result.file_type.len : CONFIG_STREAM_NAME_MAX - 1;
+    memcpy(st->file_type, ft, ft_len);
+    st->file_type[ft_len] = '\0';
+    ps->result.file_type = make_text(st->file_type, ft_len);
+  }
+}
+
+static void parse_stream_lines(struct config_parse_stream* st){
+  while (st->parsed < st->len) {
+    const char* line = st->buf + st->parsed;
+    const char* nl = (const char*)memchr(line, '\n', st->len - st->parsed);
+    if (nl == NULL) {
+      return;
+    }
+    uint16_t line_len = (uint16_t)(nl - line);
+    parse_stream_line(st, st->parsed, line_len);
+    st->parsed += line_len + 1;
+  }
+}
+
+static void rebase_text(struct config_text* t, const char* from, const char* to, size_t shift){
+  if (t->len > 0 && t->text >= from && t->text < to) {
+    t->text -= shift;
+  }
+}
+
+// Moves the strings of the current entry along with the buffer
+static void rebase_entry(struct config_entry* e, const char* from, const char* to, size_t shift){
+  rebase_text(&e->name, from, to, shift);
+  rebase_text(&e->status, from, to, shift);
+  rebase_text(&e->type, from, to, shift);
+  rebase_text(&e->ssid, from, to, shift);
+  rebase_text(&e->password, from, to, shift);
+  rebase_text(&e->mac, from, to, shift);
+  rebase_text(&e->service_uuid, from, to, shift);
+  rebase_text(&e->characteristic_uuid, from, to, shift);
+  rebase_text(&e->function_name, from, to, shift);
+  rebase_text(&e->safety_threshold.name, from, to, shift);
+  rebase_text(&e->protocol_type, from, to, shift);
+  for (uint8_t i = 0; i < e->param_count; i++) {
+    rebase_text(&e->params[i].name, from, to, shift);
+  }
+  for (uint8_t i = 0; i < e->pin_count; i++) {
+    rebase_text(&e->pins[i].type, from, to, shift);
+  }
+}
+
+// The buffer is full: drops the lines no entry needs any more, or cuts the
+// entry, or skips a line that does not fit on its own
+static void make_room(struct config_parse_stream* st){
+  uint16_t keep = st->ps.in_entry ? st->entry_start : st->parsed;
+  if (keep == 0 && st->parsed > 0) {
+    finish_entry(&st->ps);
+    keep = st->parsed;
+  }
+  if (keep > 0) {
+    rebase_entry(&st->ps.entry, st->buf + keep, st->buf + st->len, keep);
+    memmove(st->buf, st->buf + keep, st->len - keep);
+    st->len -= keep;
+    st->parsed -= keep;
+    st->entry_start = st->entry_start >= keep ? st->entry_start - keep : 0;
+    return;
+  }
+  count_line(&st->ps);
+  skip_line(&st->ps);
+  st->len = 0;
+  st->discarding = true;
+}
+
+void config_parse_feed(struct config_parse_stream* st, const char* data, size_t len){
+  while (len > 0) {
+    if (st->discarding) {
+      const char* nl = (const char*)memchr(data, '\n', len);
+      if (nl == NULL) {
+        return;
+      }
+      len -= nl + 1 - data;
+      data = nl + 1;
+      st->discarding = false;
+      continue;
+    }
+    if (st->len == sizeof(st->buf)) {
+      make_room(st);
+      continue;
+    }
+    size_t n = sizeof(st->buf) - st->len;
+    if (n > len) {
+      n = len;
+    }
+    memcpy(st->buf + st->len, data, n);
+    st->len += n;
+    data += n;
+    len -= n;
+    parse_stream_lines(st);
+  }
+}
+
+int config_parse_end(struct config_parse_stream* st, struct config_parse_result* result){
+  if (!st->discarding && st->parsed < st->len) {
+    parse_stream_line(st, st->parsed, st->len - st->parsed);
+    st->parsed = st->len;
+  }
+  finish_entry(&st->ps);
+  if (result != NULL) {
+    *result = st->ps.result;
+  }
+  return st->ps.result.entries;
+}
@@ -0,0 +1,142 @@
+#ifndef PROTOCOL_CONFIG_PARSE_H
+#define PROTOCOL_CONFIG_PARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Single pass parser of the hand configuration (Assests/example_hand_configuration.yaml).
+// It walks the text once, line by line, and hands every entry of the general,
+// communications, sensors, motors and functions lists to a callback as soon as
+// the entry ends. Nothing is copied or allocated: the strings of an entry point
+// into the text and are only valid during the callback. The text does not need
+// a terminating 0, and any subset of the sections can be parsed (the screen gets
+// them one at a time).
+//
+// Only the YAML this schema uses is understood: top level "key: value" and
+// "section:" lines, block lists ("- key: value") with nested maps by indentation,
+// 'single' / "double" quoted or plain scalars, flow lists of four values
+// ([current, min, max, modify_permission]) and # comments. A line that does not
+// fit (no colon, a list that is not four values, more parameters or pins than an
+// entry holds) is skipped and counted; the rest of the entry is kept.
+//
+// config_parse_feed() parses the same text as it arrives, in pieces split
+// anywhere (the screen feeds the fragments of a section from the BLE callback).
+// It keeps the lines of the entry being parsed in a buffer of the stream, so the
+// text given to it can go right after the call, and hands out the same entries
+// config_parse() would.
+
+#define CONFIG_MAX_PARAMS 16           // parameters of a sensor function
+#define CONFIG_MAX_PINS 8              // pins of a motor
+#define CONFIG_MAX_DEPTH 4             // nested maps / lists inside an entry
+#define CONFIG_STREAM_BUF_SIZE 1024    // lines of one entry kept by config_parse_feed() (the example's largest takes 365)
+#define CONFIG_STREAM_NAME_MAX 32      // file_type kept by config_parse_feed()
+
+enum config_section {
+  CONFIG_SECTION_NONE,
+  CONFIG_GENERAL,
+  CONFIG_COMMUNICATIONS,
+  CONFIG_SENSORS,
+  CONFIG_MOTORS,
+  CONFIG_FUNCTIONS
+};
+
+// A piece of the parsed text, quotes removed. len 0 if the field was not given.
+struct config_text {
+  const char* text;
+  uint16_t len;
+};
+
+struct config_param {
+  struct config_text name;
+  int current_val;
+  int min;
+  int max;
+  bool modify_permission;
+};
+
+struct config_pin {
+  struct config_text type;
+  int pin_number;
+};
+
+// One list entry. Only the fields of its section are set, the others are empty.
+struct config_entry {
+  uint8_t section;                     // enum config_section
+  struct config_text name;
+  struct config_text status;           // communications, sensors
+  struct config_text type;             // sensors, motors
+  int code;                            // general
+  struct config_text ssid;             // communications
+  struct config_text password;
+  struct config_text mac;
+  struct config_text service_uuid;     // SERVICE1_UUID
+  struct config_text characteristic_uuid;  // CHARACTERISTIC1_UUID
+  struct config_text function_name;    // sensors: function.name
+  uint8_t param_count;                 // sensors: function.parameters
+  struct config_param params[CONFIG_MAX_PARAMS];
+  uint8_t pin_count;                   // motors
+  struct config_pin pins[CONFIG_MAX_PINS];
+  bool has_safety_threshold;           // motors
+  struct config_param safety_threshold;
+  struct config_text protocol_type;    // functions
+};
+
+struct config_parse_result {
+  struct config_text file_type;
+  uint16_t entries;
+  uint16_t lines;
+  uint16_t skipped_lines;              // malformed or beyond the limits above
+  uint16_t first_skipped_line;         // 1 based, 0 if none
+};
+
+typedef void (*config_entry_fn)(const struct config_entry* entry, void* ctx);
+
+// State of the parser between two lines
+struct config_parser {
+  config_entry_fn on_entry;
+  void* ctx;
+  struct config_parse_result result;
+  uint8_t section;
+  int item_indent;                     // indent of the "- " of the section's list, -1 before the first
+  bool in_entry;
+  bool pin_open;                       // the last "- " of a pins list made a pin
+  int depth;
+  int block_indent[CONFIG_MAX_DEPTH];
+  uint8_t block[CONFIG_MAX_DEPTH];
+  struct config_entry entry;
+};
+
+// A parse fed in pieces. Its size is fixed (about 1.7 KB on the ESP32), nothing
+// is allocated. An entry whose lines do not fit in the buffer is handed out with
+// what was read, and the rest of its lines are skipped and counted; a line that
+// alone fills the buffer is skipped.
+struct config_parse_stream {
+  struct config_parser ps;
+  uint16_t len;                        // bytes in buf
+  uint16_t parsed;                     // of buf, whole lines already parsed
+  uint16_t entry_start;                // of buf, first line of the entry being parsed
+  bool discarding;                     // skipping the rest of a line too long for buf
+  char file_type[CONFIG_STREAM_NAME_MAX];
+  char buf[CONFIG_STREAM_BUF_SIZE];
+};
+
+// Parses len bytes of yaml. result may be NULL. Returns the number of entries.
+int config_parse(const char* yaml, size_t len, config_entry_fn on_entry, void* ctx, struct config_parse_result* result);
+
+// Starts a parse fed with config_parse_feed()
+void config_parse_begin(struct config_parse_stream* st, config_entry_fn on_entry, void* ctx);
+
+// Parses the next len bytes of the text; the entries that end in them are handed
+// to the callback before it returns. The strings of an entry point into the
+// stream's buffer.
+void config_parse_feed(struct config_parse_stream* st, const char* data, size_t len);
+
+// Parses what is left after the last newline and hands out the last entry.
+// result may be NULL, its file_type points into the stream. Returns the number
+// of entries, as config_parse() of the whole text would.
+int config_parse_end(struct config_parse_stream* st, struct config_parse_result* result);
+
+// Compares a parsed text with a C string
+bool config_text_equals(const struct config_text* t, const char* s);
+
+#endif //PROTOCOL_CONFIG_PARSE_H
@@ -0,0 +1,216 @@
+#include "config_snapshot.h"
+#include "wire_frame.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// The records are written and read as they are in memory
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "config snapshots are little endian"
+#endif
+static_assert(sizeof(struct config_model_param) == 16 && offsetof(struct config_model_param, current_val) == 4, "config_model_param layout");
+static_assert(sizeof(struct config_model_pin) == 4, "config_model_pin layout");
+static_assert(sizeof(struct config_model_sensor) == 10, "config_model_sensor layout");
+static_assert(sizeof(struct config_model_motor) == 24 && offsetof(struct config_model_motor, safety_threshold) == 8, "config_model_motor layout");
+static_assert(sizeof(struct config_model_function) == 4, "config_model_function layout");
+static_assert(sizeof(struct config_model_general) == 8, "config_model_general layout");
+static_assert(sizeof(struct config_model_communication) == 14, "config_model_communication layout");
+
+static const uint8_t snapshot_magic[4] = {'P', 'H', 'C', 'S'};
+
+static inline void put_u16(uint8_t* dst, uint16_t val){
+  dst[0] = (uint8_t)(val & 0xFF);
+  dst[1] = (uint8_t)(val >> 8);
+}
+
+static inline uint16_t get_u16(const uint8_t* src){
+  return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static inline void put_u32(uint8_t* dst, uint32_t val){
+  put_u16(&dst[0], (uint16_t)(val & 0xFFFF));
+  put_u16(&dst[2], (uint16_t)(val >> 16));
+}
+
+static inline uint32_t get_u32(const uint8_t* src){
+  return (uint32_t)get_u16(&src[0]) | ((uint32_t)get_u16(&src[2]) << 16);
+}
+
+// Byte lengths of the sections after the header, in file order
+#define SNAPSHOT_SECTIONS 9
+
+static void section_lengths(size_t* lens, uint8_t sensors, uint8_t motors, uint8_t functions, uint8_t general,
+                            uint8_t communications, uint16_t params, uint16_t pins, uint16_t pool_len){
+  lens[0] = sensors * sizeof(struct config_model_sensor);
+  lens[1] = motors * sizeof(struct config_model_motor);
+  lens[2] = functions * sizeof(struct config_model_function);
+  lens[3] = general * sizeof(struct config_model_general);
+  lens[4] = communications * sizeof(struct config_model_communication);
+  lens[5] = params * sizeof(struct config_model_param);
+  lens[6] = pins * sizeof(struct config_model_pin);
+  lens[7] = CONFIG_MODEL_NAME_SLOTS * sizeof(uint16_t);
+  lens[8] = pool_len;
+}
+
+static size_t total_length(const size_t* lens){
+  size_t total = CONFIG_SNAPSHOT_HDR_LEN;
+  for (int i = 0; i < SNAPSHOT_SECTIONS; i++) {
+    total += CONFIG_SNAPSHOT_ALIGN(lens[i]);
+  }
+  return total;
+}
+
+static uint16_t model_pool_len(const struct config_model* m){
+  return m->pool_len == 0 ? 1 : m->pool_len;   // a zeroed model still has the empty string
+}
+
+size_t config_snapshot_size(const struct config_model* m){
+  size_t lens[SNAPSHOT_SECTIONS];
+  section_lengths(lens, m->sensor_count, m->motor_count, m->function_count, m->general_count,
+                  m->communication_count, m->param_count, m->pin_count, model_pool_len(m));
+  return total_length(lens);
+}
+
+size_t config_snapshot_encode(const struct config_model* m, uint32_t source_digest, uint8_t* out, size_t cap){
+  size_t lens[SNAPSHOT_SECTIONS];
+  uint16_t pool_len = model_pool_len(m);
+  section_lengths(lens, m->sensor_count, m->motor_count, m->function_count, m->general_count,
+                  m->communication_count, m->param_count, m->pin_count, pool_len);
+  size_t total = total_length(lens);
+  if (out == NULL || cap < total) {
+    return 0;
+  }
+  memcpy(out, snapshot_magic, sizeof(snapshot_magic));
+  out[4] = CONFIG_SNAPSHOT_VERSION;
+  out[5] = m->communication_count;
+  put_u16(&out[6], CONFIG_MODEL_NAME_SLOTS);
+  put_u32(&out[8], (uint32_t)total);
+  put_u32(&out[12], source_digest);
+  put_u16(&out[18], m->file_type);
+  out[20] = m->sensor_count;
+  out[21] = m->motor_count;
+  out[22] = m->function_count;
+  out[23] = m->general_count;
+  put_u16(&out[24], m->param_count);
+  put_u16(&out[26], m->pin_count);
+  put_u16(&out[28], m->name_count);
+  put_u16(&out[30], pool_len);
+  const void* sections[SNAPSHOT_SECTIONS] = {m->sensors, m->motors, m->functions, m->general, m->communications,
+                                             m->params, m->pins, m->name_slots, m->pool};
+  size_t pos = CONFIG_SNAPSHOT_HDR_LEN;
+  for (int i = 0; i < SNAPSHOT_SECTIONS; i++) {
+    size_t padded = CONFIG_SNAPSHOT_ALIGN(lens[i]);
+    memcpy(&out[pos], sections[i], lens[i]);
+    memset(&out[pos + lens[i]], 0, padded - lens[i]);
+    pos += padded;
+  }
+  put_u16(&out[16], wire_crc16(&out[18], total - 18));
+  return total;
+}
+
+bool config_snapshot_open(const uint8_t* buf, size_t len, struct config_snapshot* view){
+  if (buf == NULL || ((uintptr_t)buf & 3) != 0 || len < CONFIG_SNAPSHOT_HDR_LEN ||
+      memcmp(buf, snapshot_magic, sizeof(snapshot_magic)) != 0 || buf[4] != CONFIG_SNAPSHOT_VERSION ||
+      get_u16(&buf[6]) != CONFIG_MODEL_NAME_SLOTS) {
+    return false;
+  }
+  struct config_snapshot v;
+  v.total_len = get_u32(&buf[8]);
+  v.source_digest = get_u32(&buf[12]);
+  v.file_type = get_u16(&buf[18]);
+  v.communication_count = buf[5];
+  v.sensor_count = buf[20];
+  v.motor_count = buf[21];
+  v.function_count = buf[22];
+  v.general_count = buf[23];
+  v.param_count = get_u16(&buf[24]);
+  v.pin_count = get_u16(&buf[26]);
+  v.name_count = get_u16(&buf[28]);
+  v.pool_len = get_u16(&buf[30]);
+  if (v.sensor_count > CONFIG_MODEL_MAX_SENSORS || v.motor_count > CONFIG_MODEL_MAX_MOTORS ||
+      v.function_count > CONFIG_MODEL_MAX_FUNCTIONS || v.general_count > CONFIG_MODEL_MAX_GENERAL ||
+      v.communication_count > CONFIG_MODEL_MAX_COMMUNICATIONS || v.param_count > CONFIG_MODEL_MAX_PARAMS ||
+      v.pin_count > CONFIG_MODEL_MAX_PINS || v.name_count > CONFIG_MODEL_MAX_NAMES ||
+      v.pool_len == 0 || v.pool_len > CONFIG_MODEL_POOL_SIZE) {
+    return false;
+  }
+  size_t lens[SNAPSHOT_SECTIONS];
+  section_lengths(lens, v.sensor_count, v.motor_count, v.function_count, v.general_count,
+                  v.communication_count, v.param_count, v.pin_count, v.pool_len);
+  if (v.total_len != total_length(lens) || v.total_len > len ||
+      get_u16(&buf[16]) != wire_crc16(&buf[18], v.total_len - 18)) {
+    return false;
+  }
+  const uint8_t* sections[SNAPSHOT_SECTIONS];
+  size_t pos = CONFIG_SNAPSHOT_HDR_LEN;
+  for (int i = 0; i < SNAPSHOT_SECTIONS; i++) {
+    sections[i] = &buf[pos];
+    pos += CONFIG_SNAPSHOT_ALIGN(lens[i]);
+  }
+  v.sensors = (const struct config_model_sensor*)sections[0];
+  v.motors = (const struct config_model_motor*)sections[1];
+  v.functions = (const struct config_model_function*)sections[2];
+  v.general = (const struct config_model_general*)sections[3];
+  v.communications = (const struct config_model_communication*)sections[4];
+  v.params = (const struct config_model_param*)sections[5];
+  v.pins = (const struct config_model_pin*)sections[6];
+  v.name_slots = (const uint16_t*)sections[7];
+  v.pool = (const char*)sections[8];
+  // Every string ends inside the pool, every entry's parameters and pins inside
+  // their arrays, and the name table has a free slot to end a lookup
+  if (v.pool[0] != '\0' || v.pool[v.pool_len - 1] != '\0') {
+    return false;
+  }
+  uint16_t used_slots = 0;
+  for (uint16_t i = 0; i < CONFIG_MODEL_NAME_SLOTS; i++) {
+    used_slots += v.name_slots[i] != 0;
+  }
+  if (used_slots != v.name_count) {
+    return false;
+  }
+  for (uint8_t i = 0; i < v.sensor_count; i++) {
+    if (v.sensors[i].first_param + v.sensors[i].param_count > v.param_count) {
+      return false;
+    }
+  }
+  for (uint8_t i = 0; i < v.motor_count; i++) {
+    if (v.motors[i].first_pin + v.motors[i].pin_count > v.pin_count) {
+      return false;
+    }
+  }
+  *view = v;
+  return true;
+}
+
+const char* config_snapshot_str(const struct config_snapshot* view, config_name name){
+  return name < view->pool_len ? &view->pool[name] : "";
+}
+
+bool config_snapshot_load(struct config_model* m, const uint8_t* buf, size_t len){
+  struct config_snapshot v;
+  if (!config_snapshot_open(buf, len, &v)) {
+    return false;
+  }
+  m->file_type = v.file_type;
+  m->sensor_count = v.sensor_count;
+  m->motor_count = v.motor_count;
+  m->function_count = v.function_count;
+  m->general_count = v.general_count;
+  m->communication_count = v.communication_count;
+  m->param_count = v.param_count;
+  m->pin_count = v.pin_count;
+  m->dropped = 0;
+  m->version++;
+  memcpy(m->sensors, v.sensors, v.sensor_count * sizeof(struct config_model_sensor));
+  memcpy(m->motors, v.motors, v.motor_count * sizeof(struct config_model_motor));
+  memcpy(m->functions, v.functions, v.function_count * sizeof(struct config_model_function));
+  memcpy(m->general, v.general, v.general_count * sizeof(struct config_model_general));
+  memcpy(m->communications, v.communications, v.communication_count * sizeof(struct config_model_communication));
+  memcpy(m->params, v.params, v.param_count * sizeof(struct config_model_param));
+  memcpy(m->pins, v.pins, v.pin_count * sizeof(struct config_model_pin));
+  m->name_count = v.name_count;
+  m->pool_len = v.pool_len;
+  memcpy(m->name_slots, v.name_slots, sizeof(m->name_slots));
+  memcpy(m->pool, v.pool, v.pool_len);
+  return true;
+}
@@ -0,0 +1,96 @@
+#ifndef PROTOCOL_CONFIG_SNAPSHOT_H
+#define PROTOCOL_CONFIG_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config_model.h"
+
+// Binary snapshot of a config_model, for the prosthesis to store next to
+// config.yaml and send instead of the YAML text. The records are the structs of
+// config_model.h as they are in memory, so a snapshot is read where it lies:
+// config_snapshot_open() only checks the header and the CRC and points into the
+// buffer, config_snapshot_load() copies the arrays into a model. Nothing is
+// parsed and nothing is interned again. Both devices are little endian with the
+// same struct layout (checked at compile time); a snapshot of another version
+// is rejected and the YAML is used instead.
+//
+// Layout (little endian):
+//   header  32 bytes
+//     byte 0-3   magic "PHCS"
+//     byte 4     version
+//     byte 5     communication_count
+//     byte 6-7   name_slots          CONFIG_MODEL_NAME_SLOTS of the writer
+//     byte 8-11  total_len           header included
+//     byte 12-15 source_digest       config_digest() of the YAML it was made from
+//     byte 16-17 crc                 CRC-16/CCITT of bytes 18..total_len (wire_crc16)
+//     byte 18-19 file_type           config_name
+//     byte 20-23 sensor_count, motor_count, function_count, general_count
+//     byte 24-25 param_count
+//     byte 26-27 pin_count
+//     byte 28-29 name_count
+//     byte 30-31 pool_len
+//   then each on a 4 byte boundary, zero padded:
+//     sensors, motors, functions, general, communications, params, pins
+//     (count x the config_model_* record), name_slots (name_slots x uint16),
+//     pool (pool_len bytes)
+// The example config takes 976 bytes (625 LZ compressed) against 3.8 KB of YAML
+// (1.1 KB LZ compressed), see make bench.
+
+#define CONFIG_SNAPSHOT_VERSION 1
+#define CONFIG_SNAPSHOT_HDR_LEN 32
+#define CONFIG_SNAPSHOT_ALIGN(len) (((len) + 3) & ~(size_t)3)
+#define CONFIG_SNAPSHOT_MAX_LEN (CONFIG_SNAPSHOT_HDR_LEN + \
+  CONFIG_SNAPSHOT_ALIGN(CONFIG_MODEL_MAX_SENSORS * sizeof(struct config_model_sensor)) + \
+  CONFIG_SNAPSHOT_ALIGN(CONFIG_MODEL_MAX_MOTORS * sizeof(struct config_model_motor)) + \
+  CONFIG_SNAPSHOT_ALIGN(CONFIG_MODEL_MAX_FUNCTIONS * sizeof(struct config_model_function)) + \
+  CONFIG_SNAPSHOT_ALIGN(CONFIG_MODEL_MAX_GENERAL * sizeof(struct config_model_general)) + \
+  CONFIG_SNAPSHOT_ALIGN(CONFIG_MODEL_MAX_COMMUNICATIONS * sizeof(struct config_model_communication)) + \
+  CONFIG_SNAPSHOT_ALIGN(CONFIG_MODEL_MAX_PARAMS * sizeof(struct config_model_param)) + \
+  CONFIG_SNAPSHOT_ALIGN(CONFIG_MODEL_MAX_PINS * sizeof(struct config_model_pin)) + \
+  CONFIG_SNAPSHOT_ALIGN(CONFIG_MODEL_NAME_SLOTS * sizeof(uint16_t)) + CONFIG_MODEL_POOL_SIZE)
+
+// A snapshot opened in place. The pointers are into the buffer given to
+// config_snapshot_open() and are valid as long as it is.
+struct config_snapshot {
+  uint32_t total_len;
+  uint32_t source_digest;
+  config_name file_type;
+  uint8_t sensor_count;
+  uint8_t motor_count;
+  uint8_t function_count;
+  uint8_t general_count;
+  uint8_t communication_count;
+  uint16_t param_count;
+  uint16_t pin_count;
+  uint16_t name_count;
+  uint16_t pool_len;
+  const struct config_model_sensor* sensors;
+  const struct config_model_motor* motors;
+  const struct config_model_function* functions;
+  const struct config_model_general* general;
+  const struct config_model_communication* communications;
+  const struct config_model_param* params;
+  const struct config_model_pin* pins;
+  const uint16_t* name_slots;
+  const char* pool;
+};
+
+// Bytes config_snapshot_encode() writes for the model
+size_t config_snapshot_size(const struct config_model* m);
+
+// Writes the snapshot of the model. Returns its length, 0 if cap is too small.
+size_t config_snapshot_encode(const struct config_model* m, uint32_t source_digest, uint8_t* out, size_t cap);
+
+// Checks the snapshot at buf (4 byte aligned, e.g. from malloc) and fills view
+// with pointers into it. Returns false if it is truncated, corrupted, of another
+// version or does not fit a config_model; view is then left untouched.
+bool config_snapshot_open(const uint8_t* buf, size_t len, struct config_snapshot* view);
+
+// The 0 terminated text of a name of the snapshot
+const char* config_snapshot_str(const struct config_snapshot* view, config_name name);
+
+// Replaces the content of the model with the snapshot. Returns false (and leaves
+// the model alone) if config_snapshot_open() rejects it.
+bool config_snapshot_load(struct config_model* m, const uint8_t* buf, size_t len);
+
+#endif //PROTOCOL_CONFIG_SNAPSHOT_H
@@ -0,0 +1,105 @@
+#include "config_stream.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "com_vars.h"
+
+// The section of the model a YAML_ANS type replaces, CONFIG_SECTION_NONE for others
+static uint8_t section_of(uint8_t req_type){
+  switch (req_type) {
+    case YML_SENSOR_ANS: return CONFIG_SENSORS;
+    case YML_MOTORS_ANS: return CONFIG_MOTORS;
+    case YML_FUNC_ANS: return CONFIG_FUNCTIONS;
+    case YML_GENERAL_ANS: return CONFIG_GENERAL;
+    default: return CONFIG_SECTION_NONE;
+  }
+}
+
+void config_stream_reset(struct config_stream* cs){
+  free(cs->raw);
+  cs->raw = NULL;
+  cs->active = false;
+}
+
+static bool start_section(struct config_stream* cs, struct config_model* m, const struct wire_frame* frame){
+  config_stream_reset(cs);
+  cs->lz = lz_is_compressed(frame->payload, frame->payload_len);
+  if (cs->lz) {
+    if (frame->payload_len < LZ_HDR_LEN) {
+      return false;
+    }
+    cs->raw_len = lz_raw_len(frame->payload);
+    cs->raw = (uint8_t*)malloc(cs->raw_len + 1);
+    if (cs->raw == NULL) {
+      return false;
+    }
+    lz_decoder_init(&cs->dec, cs->raw, cs->raw_len);
+    cs->raw_parsed = 0;
+  }
+  cs->active = true;
+  cs->req_type = frame->req_type;
+  cs->seq = frame->seq;
+  cs->frag_cnt = frame->frag_cnt;
+  cs->next_frag = 1;
+  cs->model = m;
+  // The section is replaced even if the new text has no entries for it, as the
+  // screen does with a section parsed whole (ReplaceConfigSection())
+  uint8_t section = section_of(frame->req_type);
+  if (section != CONFIG_SECTION_NONE) {
+    config_model_clear_section(m, section);
+  }
+  if (section == CONFIG_GENERAL) {
+    config_model_clear_section(m, CONFIG_COMMUNICATIONS);   // sent in the general section
+  }
+  config_parse_begin(&cs->parser, config_model_store, m);
+  return true;
+}
+
+int config_stream_fragment(struct config_stream* cs, struct config_model* m, const struct wire_frame* frame){
+  if (frame->frag_idx == 1) {
+    if (!start_section(cs, m, frame)) {
+      config_stream_reset(cs);
+      return CONFIG_STREAM_SKIPPED;
+    }
+  } else if (!cs->active || frame->req_type != cs->req_type || frame->seq != cs->seq ||
+             frame->frag_idx != cs->next_frag) {
+    // A resend or another transfer: the whole section is parsed at the end
+    config_stream_reset(cs);
+    return CONFIG_STREAM_SKIPPED;
+  }
+  if (cs->lz) {
+    int status = lz_decode_feed(&cs->dec, frame->payload, frame->payload_len);
+    if (status == LZ_ERROR || (status == LZ_DONE) != (frame->frag_idx == cs->frag_cnt)) {
+      config_stream_reset(cs);
+      return CONFIG_STREAM_SKIPPED;
+    }
+    config_parse_feed(&cs->parser, (const char*)cs->raw + cs->raw_parsed, cs->dec.pos - cs->raw_parsed);
+    cs->raw_parsed = cs->dec.pos;
+  } else {
+    config_parse_feed(&cs->parser, (const char*)frame->payload, frame->payload_len);
+  }
+  cs->next_frag++;
+  return frame->frag_idx == cs->frag_cnt ? CONFIG_STREAM_DONE : CONFIG_STREAM_PARSED;
+}
+
+int config_stream_end(struct config_stream* cs, struct config_parse_result* result, uint8_t** text, size_t* len){
+  struct config_parse_result local;
+  if (result == NULL) {
+    result = &local;
+  }
+  int entries = config_parse_end(&cs->parser, result);
+  if (result->file_type.len > 0) {
+    cs->model->file_type = config_model_intern(cs->model, result->file_type.text, result->file_type.len);
+  }
+  if (text != NULL) {
+    *text = NULL;
+    if (cs->lz) {
+      cs->raw[cs->raw_len] = '\0';
+      *text = cs->raw;
+      *len = cs->raw_len;
+      cs->raw = NULL;
+    }
+  }
+  config_stream_reset(cs);
+  return entries;
+}
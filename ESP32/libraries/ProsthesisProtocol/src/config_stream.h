@@ -0,0 +1,65 @@
+#ifndef PROTOCOL_CONFIG_STREAM_H
+#define PROTOCOL_CONFIG_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "wire_frame.h"
+#include "lz_codec.h"
+#include "config_parse.h"
+#include "config_model.h"
+
+// Parses a YAML section of the config download into a config_model while its
+// fragments arrive, instead of once the whole section is in. The screen feeds
+// every fragment the reassembler accepts (from the BLE callback); the fragments
+// that come in order, 1..frag_cnt of one transfer, are parsed right away, so when
+// the last one arrives the section is already in the model. LZ sections are
+// decompressed as they come (lz_decode_feed) into a buffer of the section's
+// size, which is handed over at the end for the config cache; plain sections
+// are not kept. The parser state is fixed (config_parse_stream).
+//
+// One section is parsed at a time, as the prosthesis sends them. A fragment out
+// of order (a resend) or of another transfer ends the parse: config_stream_fragment()
+// returns CONFIG_STREAM_SKIPPED and the section is parsed as a whole once the
+// reassembler has it, after config_model_clear_section() of what was stored.
+//
+// The section replaces the one in the model (the general section also replaces
+// the communications): it is cleared when its first fragment arrives, so an
+// empty section leaves it empty, as when the section is parsed whole.
+
+enum config_stream_status {
+  CONFIG_STREAM_SKIPPED = 0,  // not parsed: parse the section when it is complete
+  CONFIG_STREAM_PARSED,       // parsed, more fragments to come
+  CONFIG_STREAM_DONE          // the last fragment: the section is in the model, call config_stream_end()
+};
+
+struct config_stream {
+  bool active;
+  bool lz;
+  uint8_t req_type;
+  uint8_t seq;
+  uint16_t frag_cnt;
+  uint16_t next_frag;                   // frag_idx expected next
+  struct config_model* model;
+  struct lz_decoder dec;
+  uint8_t* raw;                         // the decompressed LZ section, raw_len + 1 bytes
+  size_t raw_len;
+  size_t raw_parsed;                    // of raw, fed to the parser
+  struct config_parse_stream parser;
+};
+
+// Drops the section being parsed (what was stored stays in the model). A zeroed
+// struct is idle.
+void config_stream_reset(struct config_stream* cs);
+
+// Feeds a fragment of a YAML section that the reassembler accepted
+// (WIRE_REASM_IN_PROGRESS or WIRE_REASM_DONE). Returns a config_stream_status.
+int config_stream_fragment(struct config_stream* cs, struct config_model* m, const struct wire_frame* frame);
+
+// After CONFIG_STREAM_DONE: ends the parse and keeps the file_type, as
+// config_model_load() does. result may be NULL. If text is not NULL it gets the
+// decompressed text of an LZ section (0 terminated, the caller frees it) and len
+// its length; NULL for a plain section, which the reassembler still has.
+// Returns the number of entries.
+int config_stream_end(struct config_stream* cs, struct config_parse_result* result, uint8_t** text, size_t* len);
+
+#endif //PROTOCOL_CONFIG_STREAM_H
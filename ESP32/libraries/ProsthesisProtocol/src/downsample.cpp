@@ -0,0 +1,115 @@
+#include "downsample.h"
+
+#include <string.h>
+
+static inline void downsample_mark(struct downsample_series* s, uint16_t i){
+  s->changed[i / 32] |= 1u << (i % 32);
+}
+
+uint16_t downsample_bucket_count(uint32_t window_us, uint32_t sample_us, uint16_t max_buckets){
+  if (max_buckets > DOWNSAMPLE_MAX_BUCKETS) {
+    max_buckets = DOWNSAMPLE_MAX_BUCKETS;
+  }
+  uint32_t buckets = sample_us > 0 ? window_us / sample_us : max_buckets;
+  if (buckets > max_buckets) {
+    buckets = max_buckets;
+  }
+  return (uint16_t)(buckets > 0 ? buckets : 1);
+}
+
+void downsample_series_init(struct downsample_series* s, uint32_t window_us, uint16_t buckets, int16_t empty){
+  if (buckets > DOWNSAMPLE_MAX_BUCKETS) {
+    buckets = DOWNSAMPLE_MAX_BUCKETS;
+  }
+  if (buckets == 0) {
+    buckets = 1;
+  }
+  s->buckets = buckets;
+  s->bucket_us = window_us / buckets > 0 ? window_us / buckets : 1;
+  s->empty = empty;
+  downsample_series_clear(s);
+}
+
+void downsample_series_clear(struct downsample_series* s){
+  for (int i = 0; i < 2 * DOWNSAMPLE_MAX_BUCKETS; i++) {
+    s->points[i] = s->empty;
+  }
+  s->started = false;
+  s->newest = 0;
+  memset(s->changed, 0xFF, sizeof(s->changed));
+}
+
+static inline void downsample_empty_bucket(struct downsample_series* s, uint32_t bucket){
+  uint16_t i = (uint16_t)(bucket % s->buckets);
+  if (s->points[2 * i] != s->empty || s->points[2 * i + 1] != s->empty) {
+    s->points[2 * i] = s->empty;
+    s->points[2 * i + 1] = s->empty;
+    downsample_mark(s, i);
+  }
+}
+
+bool downsample_series_add(struct downsample_series* s, uint32_t t_us, int16_t value){
+  uint32_t bucket = t_us / s->bucket_us;
+  if (!s->started) {
+    s->newest = bucket;
+    s->started = true;
+  }
+  int32_t ahead = (int32_t)(bucket - s->newest);
+  if (ahead <= -(int32_t)s->buckets) {
+    return false;
+  }
+  if (ahead > 0) {
+    uint32_t skipped = (uint32_t)ahead < s->buckets ? (uint32_t)ahead : s->buckets;
+    for (uint32_t k = 1; k <= skipped; k++) {
+      downsample_empty_bucket(s, s->newest + k);
+    }
+    s->newest = bucket;
+  }
+  uint16_t i = (uint16_t)(bucket % s->buckets);
+  int16_t* pair = &s->points[2 * i];
+  if (pair[0] == s->empty || value < pair[0]) {
+    pair[0] = value;
+    downsample_mark(s, i);
+  }
+  if (pair[1] == s->empty || value > pair[1]) {
+    pair[1] = value;
+    downsample_mark(s, i);
+  }
+  return true;
+}
+
+void downsample_series_gap(struct downsample_series* s, uint16_t count){
+  if (!s->started) {
+    return;
+  }
+  if (count >= s->buckets) {
+    count = s->buckets - 1;
+  }
+  for (uint16_t k = 1; k <= count; k++) {
+    downsample_empty_bucket(s, s->newest + k);
+  }
+}
+
+uint16_t downsample_series_head(const struct downsample_series* s){
+  return (uint16_t)(s->newest % s->buckets);
+}
+
+size_t downsample_minmax(const int16_t* in, size_t n, int16_t* out, size_t buckets){
+  if (buckets > n) {
+    buckets = n;
+  }
+  size_t start = 0;
+  for (size_t b = 0; b < buckets; b++) {
+    size_t end = (size_t)((uint64_t)n * (b + 1) / buckets);
+    int16_t lo = in[start];
+    int16_t hi = in[start];
+    for (size_t i = start + 1; i < end; i++) {
+      lo = in[i] < lo ? in[i] : lo;
+      hi = in[i] > hi ? in[i] : hi;
+    }
+    out[2 * b] = lo;
+    out[2 * b + 1] = hi;
+    start = end;
+  }
+  return buckets;
+}
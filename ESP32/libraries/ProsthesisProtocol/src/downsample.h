@@ -0,0 +1,58 @@
+#ifndef PROTOCOL_DOWNSAMPLE_H
+#define PROTOCOL_DOWNSAMPLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Min/max downsampling for the Debug chart. The time window on screen is split
+// into a fixed number of buckets, about one per pixel column, and each bucket
+// keeps the lowest and the highest sample that fell into it. The chart draws
+// the pair as two points, so a bucket becomes a vertical stroke from min to max
+// and a one-sample spike stays visible however many samples share its column.
+// Point count, memory and redraw cost depend on the bucket count only, not on
+// the window length or the sample rate.
+//
+// A series is a ring of buckets on the time axis: bucket t_us / bucket_us goes
+// to index (t_us / bucket_us) % buckets, so series fed with the same times line
+// up. points[2 * i] and points[2 * i + 1] are min and max of bucket i, or both
+// `empty` (LV_CHART_POINT_NONE on the screen) while it holds no sample.
+
+#define DOWNSAMPLE_MAX_BUCKETS 160     // a bit more than the 140 column pairs of the 280 px chart
+
+struct downsample_series {
+  uint32_t bucket_us;
+  uint16_t buckets;
+  int16_t empty;
+  bool started;
+  uint32_t newest;                     // bucket number of the newest sample
+  int16_t points[2 * DOWNSAMPLE_MAX_BUCKETS];
+  uint32_t changed[(DOWNSAMPLE_MAX_BUCKETS + 31) / 32];   // buckets written since the last plot_damage_add_series()
+};
+
+// Buckets for window_us when samples come every sample_us: at most max_buckets,
+// and never shorter than a sample so the trace has no holes between samples.
+uint16_t downsample_bucket_count(uint32_t window_us, uint32_t sample_us, uint16_t max_buckets);
+
+// buckets is capped to DOWNSAMPLE_MAX_BUCKETS. All buckets start empty.
+void downsample_series_init(struct downsample_series* s, uint32_t window_us, uint16_t buckets, int16_t empty);
+
+// Empties every bucket (all marked changed), keeps the window.
+void downsample_series_clear(struct downsample_series* s);
+
+// Adds one sample at t_us. A sample in a newer bucket empties the buckets it
+// skipped; one older than the window is dropped (returns false).
+bool downsample_series_add(struct downsample_series* s, uint32_t t_us, int16_t value);
+
+// Empties the count buckets after the newest one, the moving gap that shows
+// where the circular chart is being written.
+void downsample_series_gap(struct downsample_series* s, uint16_t count);
+
+// Index of the bucket of the newest sample in points / 2.
+uint16_t downsample_series_head(const struct downsample_series* s);
+
+// Whole trace at once: splits in[0..n) into buckets of equal sample count and
+// writes min, max of each to out (2 x buckets values). Returns the buckets
+// written, fewer than asked if n is smaller.
+size_t downsample_minmax(const int16_t* in, size_t n, int16_t* out, size_t buckets);
+
+#endif //PROTOCOL_DOWNSAMPLE_H
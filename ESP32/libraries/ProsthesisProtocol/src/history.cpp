@@ -0,0 +1,175 @@
+#include "history.h"
+
+#include <string.h>
+
+static const uint32_t tier_bucket_ms[HISTORY_TIERS] = {HISTORY_TIER0_BUCKET_MS, HISTORY_TIER1_BUCKET_MS, HISTORY_TIER2_BUCKET_MS};
+static const uint16_t tier_buckets[HISTORY_TIERS] = {HISTORY_TIER0_BUCKETS, HISTORY_TIER1_BUCKETS, HISTORY_TIER2_BUCKETS};
+static const uint16_t tier_offset[HISTORY_TIERS] = {0, HISTORY_TIER0_BUCKETS, HISTORY_TIER0_BUCKETS + HISTORY_TIER1_BUCKETS};
+
+void history_init(struct history_store* h){
+  memset(h, 0, sizeof(*h));
+}
+
+uint32_t history_bucket_ms(int tier){
+  return tier >= 0 && tier < HISTORY_TIERS ? tier_bucket_ms[tier] : 0;
+}
+
+uint16_t history_bucket_count(int tier){
+  return tier >= 0 && tier < HISTORY_TIERS ? tier_buckets[tier] : 0;
+}
+
+static int find_channel(const struct history_store* h, const struct telemetry_channel* ch){
+  for (int i = 0; i < HISTORY_MAX_CHANNELS; i++) {
+    if (h->channels[i].used && h->channels[i].channel.is_motor == ch->is_motor && h->channels[i].channel.id == ch->id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// A free slot, or the one fed least recently (emptied)
+static struct history_channel* take_channel(struct history_store* h, const struct telemetry_channel* ch){
+  struct history_channel* slot = NULL;
+  for (int i = 0; i < HISTORY_MAX_CHANNELS && (slot == NULL || slot->used); i++) {
+    struct history_channel* c = &h->channels[i];
+    if (slot == NULL || !c->used || (int32_t)(c->last_ms - slot->last_ms) < 0) {
+      slot = c;
+    }
+  }
+  if (slot->used) {
+    h->evicted++;
+  }
+  memset(slot, 0, sizeof(*slot));
+  slot->used = true;
+  slot->channel = *ch;
+  return slot;
+}
+
+// Whether bucket number of tier is still (or already) in the ring
+static inline bool bucket_held(const struct history_channel* c, int tier, uint32_t number){
+  return c->started[tier] && (uint32_t)(c->newest[tier] - number) < tier_buckets[tier];
+}
+
+static inline const struct history_bucket* bucket_of(const struct history_channel* c, int tier, uint32_t number){
+  return &c->buckets[tier_offset[tier] + number % tier_buckets[tier]];
+}
+
+void history_add(struct history_store* h, const struct telemetry_channel* ch, uint32_t t_ms, int16_t value){
+  int index = find_channel(h, ch);
+  struct history_channel* c = index >= 0 ? &h->channels[index] : take_channel(h, ch);
+  if (!c->started[0] || (int32_t)(t_ms - c->last_ms) > 0) {
+    c->last_ms = t_ms;
+  }
+  for (int tier = 0; tier < HISTORY_TIERS; tier++) {
+    uint32_t number = t_ms / tier_bucket_ms[tier];
+    uint16_t n = tier_buckets[tier];
+    if (!c->started[tier]) {
+      c->newest[tier] = number;
+      c->started[tier] = true;
+    }
+    int32_t ahead = (int32_t)(number - c->newest[tier]);
+    if (ahead <= -(int32_t)n) {
+      continue;
+    }
+    if (ahead > 0) {
+      // Empty the buckets skipped over, they still hold samples from a lap ago
+      uint32_t skipped = (uint32_t)ahead < n ? (uint32_t)ahead : n;
+      for (uint32_t k = 1; k <= skipped; k++) {
+        c->buckets[tier_offset[tier] + (c->newest[tier] + k) % n].count = 0;
+      }
+      c->newest[tier] = number;
+    }
+    struct history_bucket* b = &c->buckets[tier_offset[tier] + number % n];
+    if (b->count == 0) {
+      b->min = value;
+      b->max = value;
+      b->sum = 0;
+    } else if (b->count == UINT16_MAX) {
+      continue;
+    }
+    b->count++;
+    b->min = value < b->min ? value : b->min;
+    b->max = value > b->max ? value : b->max;
+    b->sum += value;
+  }
+}
+
+// Adds a bucket to a column being merged
+static void merge_bucket(struct history_value* out, int64_t* sum, const struct history_bucket* b){
+  if (b->count == 0) {
+    return;
+  }
+  if (out->count == 0 || b->min < out->min) {
+    out->min = b->min;
+  }
+  if (out->count == 0 || b->max > out->max) {
+    out->max = b->max;
+  }
+  out->count += b->count;
+  *sum += b->sum;
+}
+
+static void finish_value(struct history_value* out, int64_t sum){
+  if (out->count == 0) {
+    return;
+  }
+  int64_t half = out->count / 2;
+  out->mean = (int16_t)((sum >= 0 ? sum + half : sum - half) / (int64_t)out->count);
+}
+
+bool history_get(const struct history_store* h, const struct telemetry_channel* ch, int tier, uint32_t t_ms,
+                 struct history_value* out){
+  memset(out, 0, sizeof(*out));
+  int index = find_channel(h, ch);
+  if (index < 0 || tier < 0 || tier >= HISTORY_TIERS) {
+    return false;
+  }
+  const struct history_channel* c = &h->channels[index];
+  uint32_t number = t_ms / tier_bucket_ms[tier];
+  if (!bucket_held(c, tier, number)) {
+    return false;
+  }
+  int64_t sum = 0;
+  merge_bucket(out, &sum, bucket_of(c, tier, number));
+  finish_value(out, sum);
+  return true;
+}
+
+static inline uint32_t buckets_per_column(int tier, uint16_t max_columns){
+  return (tier_buckets[tier] + max_columns - 1) / max_columns;
+}
+
+uint16_t history_columns(int tier, uint16_t max_columns){
+  if (tier < 0 || tier >= HISTORY_TIERS || max_columns == 0) {
+    return 0;
+  }
+  uint32_t per_column = buckets_per_column(tier, max_columns);
+  return (uint16_t)((tier_buckets[tier] + per_column - 1) / per_column);
+}
+
+uint16_t history_query(const struct history_store* h, const struct telemetry_channel* ch, int tier, uint32_t now_ms,
+                       uint16_t max_columns, struct history_value* out){
+  int index = find_channel(h, ch);
+  if (index < 0 || tier < 0 || tier >= HISTORY_TIERS || max_columns == 0) {
+    return 0;
+  }
+  const struct history_channel* c = &h->channels[index];
+  uint32_t per_column = buckets_per_column(tier, max_columns);
+  uint16_t columns = history_columns(tier, max_columns);
+  uint32_t now_number = now_ms / tier_bucket_ms[tier];
+  uint32_t first = (now_number / per_column - (columns - 1)) * per_column;
+  for (uint16_t k = 0; k < columns; k++) {
+    int64_t sum = 0;
+    memset(&out[k], 0, sizeof(out[k]));
+    for (uint32_t i = 0; i < per_column; i++) {
+      uint32_t number = first + k * per_column + i;
+      // Numbers before the first bucket ever (right after boot) wrap past now_number
+      if (number > now_number || !bucket_held(c, tier, number)) {
+        continue;
+      }
+      merge_bucket(&out[k], &sum, bucket_of(c, tier, number));
+    }
+    finish_value(&out[k], sum);
+  }
+  return columns;
+}
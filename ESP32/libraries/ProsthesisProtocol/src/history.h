@@ -0,0 +1,83 @@
+#ifndef PROTOCOL_HISTORY_H
+#define PROTOCOL_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "telemetry.h"
+
+// Long term history of the telemetry channels on the screen, for trends over an
+// hour of wear that the live chart (downsample.h) cannot keep. Every sample goes
+// into three tiers of time buckets at once: 1 s buckets for the last 5 minutes,
+// 10 s buckets for the last hour and 1 min buckets for the last 4 hours. A bucket
+// keeps count, min, max and sum of its samples. Each tier is a ring of buckets
+// (bucket t_ms / bucket_ms at index (t_ms / bucket_ms) % buckets), so memory is
+// fixed however long the session runs: the oldest buckets are overwritten.
+//
+// Up to HISTORY_MAX_CHANNELS channels are kept; a new channel takes a free slot
+// or the one fed least recently. Times are screen millis(), which wraps after
+// 49 days.
+
+#define HISTORY_TIERS 3
+#define HISTORY_MAX_CHANNELS TELEMETRY_MAX_CHANNELS
+#define HISTORY_TIER0_BUCKET_MS 1000
+#define HISTORY_TIER0_BUCKETS 300      // 5 min
+#define HISTORY_TIER1_BUCKET_MS 10000
+#define HISTORY_TIER1_BUCKETS 360      // 1 h
+#define HISTORY_TIER2_BUCKET_MS 60000
+#define HISTORY_TIER2_BUCKETS 240      // 4 h
+#define HISTORY_TOTAL_BUCKETS (HISTORY_TIER0_BUCKETS + HISTORY_TIER1_BUCKETS + HISTORY_TIER2_BUCKETS)
+
+struct history_bucket {
+  int16_t min;
+  int16_t max;
+  uint16_t count;                      // saturates, a bucket takes at most 65535 samples
+  int32_t sum;
+};
+
+struct history_channel {
+  bool used;
+  struct telemetry_channel channel;
+  uint32_t last_ms;                    // time of the newest sample
+  bool started[HISTORY_TIERS];
+  uint32_t newest[HISTORY_TIERS];      // bucket number of the newest sample, per tier
+  struct history_bucket buckets[HISTORY_TOTAL_BUCKETS];   // tier 0, then 1, then 2
+};
+
+struct history_store {
+  struct history_channel channels[HISTORY_MAX_CHANNELS];
+  uint32_t evicted;                    // channels dropped to make room for another
+};
+
+// One bucket, or several merged into a column
+struct history_value {
+  uint32_t count;                      // 0: no sample, the rest is 0 too
+  int16_t min;
+  int16_t max;
+  int16_t mean;                        // rounded
+};
+
+void history_init(struct history_store* h);
+
+uint32_t history_bucket_ms(int tier);
+uint16_t history_bucket_count(int tier);
+
+// Adds one sample of ch taken at t_ms. A sample older than what a tier still
+// holds is left out of that tier.
+void history_add(struct history_store* h, const struct telemetry_channel* ch, uint32_t t_ms, int16_t value);
+
+// Bucket of tier holding t_ms. Returns false if ch is not kept or the bucket is
+// no longer (or not yet) in the ring.
+bool history_get(const struct history_store* h, const struct telemetry_channel* ch, int tier, uint32_t t_ms,
+                 struct history_value* out);
+
+// Columns history_query() returns for tier with at most max_columns.
+uint16_t history_columns(int tier, uint16_t max_columns);
+
+// The whole tier up to now_ms in at most max_columns columns, oldest first: each
+// column merges the same number of buckets and starts on a multiple of it, so a
+// later query only changes the newest column(s). Returns the number of columns,
+// 0 if ch is not kept or tier is invalid.
+uint16_t history_query(const struct history_store* h, const struct telemetry_channel* ch, int tier, uint32_t now_ms,
+                       uint16_t max_columns, struct history_value* out);
+
+#endif //PROTOCOL_HISTORY_H
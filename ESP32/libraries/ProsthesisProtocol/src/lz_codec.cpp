@@ -0,0 +1,187 @@
+#include "lz_codec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+size_t lz_compress_bound(size_t raw_len){
+  return LZ_HDR_LEN + raw_len + (raw_len + 7) / 8;
+}
+
+static inline uint32_t lz_hash(const uint8_t* p){
+  uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+  return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static inline void lz_insert(struct lz_compressor* st, const uint8_t* in, size_t pos){
+  uint32_t h = lz_hash(&in[pos]);
+  st->prev[pos & (LZ_WINDOW - 1)] = st->head[h];
+  st->head[h] = (uint16_t)pos;
+}
+
+size_t lz_compress(struct lz_compressor* st, const uint8_t* in, size_t in_len, uint8_t* out, size_t out_cap){
+  if (out_cap < LZ_HDR_LEN) {
+    return 0;
+  }
+  memset(st, 0, sizeof(*st));
+  out[0] = LZ_MAGIC;
+  out[1] = (uint8_t)(in_len);
+  out[2] = (uint8_t)(in_len >> 8);
+  out[3] = (uint8_t)(in_len >> 16);
+  out[4] = (uint8_t)(in_len >> 24);
+  size_t o = LZ_HDR_LEN;
+  size_t flag_pos = 0;
+  int flag_bit = 8;
+  size_t pos = 0;
+  while (pos < in_len) {
+    if (flag_bit == 8) {
+      if (o >= out_cap) {
+        return 0;
+      }
+      flag_pos = o;
+      out[o++] = 0;
+      flag_bit = 0;
+    }
+    size_t best_len = 0;
+    size_t best_dist = 0;
+    if (pos + LZ_MIN_MATCH <= in_len) {
+      size_t max_len = in_len - pos < LZ_MAX_MATCH ? in_len - pos : LZ_MAX_MATCH;
+      uint16_t cand = st->head[lz_hash(&in[pos])];
+      size_t dist = (uint16_t)(pos - cand);
+      for (int chain = 0; chain < LZ_MAX_CHAIN && dist > 0 && dist <= LZ_WINDOW && dist <= pos; chain++) {
+        const uint8_t* a = &in[pos];
+        const uint8_t* b = &in[pos - dist];
+        size_t len = 0;
+        while (len < max_len && a[len] == b[len]) {
+          len++;
+        }
+        if (len > best_len) {
+          best_len = len;
+          best_dist = dist;
+          if (len == max_len) {
+            break;
+          }
+        }
+        cand = st->prev[(pos - dist) & (LZ_WINDOW - 1)];
+        size_t next = (uint16_t)(pos - cand);
+        if (next <= dist) {
+          break;
+        }
+        dist = next;
+      }
+    }
+    if (best_len >= LZ_MIN_MATCH) {
+      size_t need = best_len >= 18 ? 3 : 2;
+      if (o + need > out_cap) {
+        return 0;
+      }
+      size_t d = best_dist - 1;
+      size_t code = best_len >= 18 ? 15 : best_len - LZ_MIN_MATCH;
+      out[o++] = (uint8_t)(code << 4 | d >> 8);
+      out[o++] = (uint8_t)(d & 0xFF);
+      if (best_len >= 18) {
+        out[o++] = (uint8_t)(best_len - 18);
+      }
+      out[flag_pos] |= (uint8_t)(1 << flag_bit);
+      for (size_t i = 0; i < best_len; i++, pos++) {
+        if (pos + LZ_MIN_MATCH <= in_len) {
+          lz_insert(st, in, pos);
+        }
+      }
+    } else {
+      if (o >= out_cap) {
+        return 0;
+      }
+      out[o++] = in[pos];
+      if (pos + LZ_MIN_MATCH <= in_len) {
+        lz_insert(st, in, pos);
+      }
+      pos++;
+    }
+    flag_bit++;
+  }
+  return o;
+}
+
+bool lz_is_compressed(const uint8_t* buf, size_t len){
+  return buf != NULL && len >= LZ_HDR_LEN && buf[0] == LZ_MAGIC;
+}
+
+uint32_t lz_raw_len(const uint8_t* buf){
+  return (uint32_t)buf[1] | ((uint32_t)buf[2] << 8) | ((uint32_t)buf[3] << 16) | ((uint32_t)buf[4] << 24);
+}
+
+void lz_decoder_init(struct lz_decoder* dec, uint8_t* out, size_t out_cap){
+  memset(dec, 0, sizeof(*dec));
+  dec->out = out;
+  dec->out_len = out_cap;
+}
+
+int lz_decode_feed(struct lz_decoder* dec, const uint8_t* data, size_t len){
+  for (size_t i = 0; i < len; i++) {
+    uint8_t b = data[i];
+    if (dec->hdr_got < LZ_HDR_LEN) {
+      dec->hdr[dec->hdr_got++] = b;
+      if (dec->hdr_got == LZ_HDR_LEN) {
+        if (dec->hdr[0] != LZ_MAGIC || lz_raw_len(dec->hdr) > dec->out_len) {
+          return LZ_ERROR;
+        }
+        dec->out_len = lz_raw_len(dec->hdr);
+      }
+      continue;
+    }
+    if (dec->pos == dec->out_len) {
+      return LZ_DONE;
+    }
+    if (dec->flag_bits == 0) {
+      dec->flags = b;
+      dec->flag_bits = 8;
+      continue;
+    }
+    dec->tok[dec->tok_len++] = b;
+    if (dec->flags & 1) {
+      if (dec->tok_len < 2 || (dec->tok_len == 2 && (dec->tok[0] >> 4) == 15)) {
+        continue;
+      }
+      size_t dist = (((size_t)(dec->tok[0] & 0x0F) << 8) | dec->tok[1]) + 1;
+      size_t mlen = (dec->tok[0] >> 4) == 15 ? 18 + (size_t)dec->tok[2] : (size_t)(dec->tok[0] >> 4) + LZ_MIN_MATCH;
+      if (dist > dec->pos || dec->pos + mlen > dec->out_len) {
+        return LZ_ERROR;
+      }
+      uint8_t* dst = &dec->out[dec->pos];
+      const uint8_t* src = dst - dist;
+      for (size_t k = 0; k < mlen; k++) {
+        dst[k] = src[k];   // byte by byte, the copy may overlap itself
+      }
+      dec->pos += mlen;
+    } else {
+      dec->out[dec->pos++] = b;
+    }
+    dec->tok_len = 0;
+    dec->flags >>= 1;
+    dec->flag_bits--;
+  }
+  return (dec->hdr_got == LZ_HDR_LEN && dec->pos == dec->out_len) ? LZ_DONE : LZ_NEED_MORE;
+}
+
+uint8_t* lz_decompress(const uint8_t* in, size_t in_len, size_t* raw_len){
+  if (!lz_is_compressed(in, in_len)) {
+    return NULL;
+  }
+  size_t len = lz_raw_len(in);
+  uint8_t* out = (uint8_t*)malloc(len + 1);
+  if (out == NULL) {
+    return NULL;
+  }
+  struct lz_decoder dec;
+  lz_decoder_init(&dec, out, len);
+  if (lz_decode_feed(&dec, in, in_len) != LZ_DONE) {
+    free(out);
+    return NULL;
+  }
+  out[len] = '\0';
+  if (raw_len) {
+    *raw_len = len;
+  }
+  return out;
+}
+
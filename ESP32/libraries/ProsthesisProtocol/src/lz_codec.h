@@ -0,0 +1,81 @@
+#ifndef PROTOCOL_LZ_CODEC_H
+#define PROTOCOL_LZ_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Small-window LZ (LZSS) compression for the YAML sections of the config download.
+// Field names, parameter arrays and pin blocks repeat for every entry, so most of a
+// section is copies of text seen a few hundred bytes earlier.
+//
+// Container:
+//   byte 0     LZ_MAGIC    never the first byte of a YAML section or a config snapshot (those are sent as is)
+//   byte 1-4   raw_len     length of the decompressed data (little endian)
+//   byte 5..   tokens      groups of one flag byte + 8 items, flag bit i (LSB first):
+//                0: literal, 1 byte
+//                1: match,   2 bytes: (len_code << 4 | (dist - 1) >> 8), (dist - 1) & 0xFF
+//                            len_code 0..14 -> length 3..17, 15 -> 18 + one more byte
+//
+// Compression keeps a hash head table and a chain over the last LZ_WINDOW positions
+// (struct lz_compressor, 10 KB). Decompression needs no memory besides the output,
+// which doubles as the window, and can be fed the container in pieces (lz_decode_feed).
+
+#define LZ_MAGIC 0xC5
+#define LZ_HDR_LEN 5
+#define LZ_WINDOW_BITS 12
+#define LZ_WINDOW (1 << LZ_WINDOW_BITS)    // 4 KB
+#define LZ_HASH_BITS 10
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (18 + 255)
+#define LZ_MAX_CHAIN 16                     // candidates tried per position
+
+struct lz_compressor {
+  uint16_t head[1 << LZ_HASH_BITS];         // last position with this hash (low 16 bits)
+  uint16_t prev[LZ_WINDOW];                 // previous position with the same hash
+};
+
+// Worst case output size: every byte a literal.
+size_t lz_compress_bound(size_t raw_len);
+
+// Compresses in into out (see lz_compress_bound). Returns the container length,
+// 0 if out is too small. Positions are kept as 16 bit values: a stale candidate
+// only costs a failed compare, every match is checked byte by byte.
+size_t lz_compress(struct lz_compressor* st, const uint8_t* in, size_t in_len, uint8_t* out, size_t out_cap);
+
+// True if buf holds an LZ container (as opposed to plain text).
+bool lz_is_compressed(const uint8_t* buf, size_t len);
+
+// Decompressed length announced by the container header.
+uint32_t lz_raw_len(const uint8_t* buf);
+
+enum lz_status {
+  LZ_NEED_MORE = 0,   // consumed everything, feed the next piece
+  LZ_DONE,            // all raw_len bytes written
+  LZ_ERROR            // bad header, bad distance or output overflow
+};
+
+// Incremental decoder: tokens may be split anywhere between lz_decode_feed calls.
+struct lz_decoder {
+  uint8_t* out;
+  size_t out_len;     // raw_len, known once the header has been read
+  size_t pos;
+  size_t hdr_got;
+  uint8_t hdr[LZ_HDR_LEN];
+  uint8_t flags;
+  uint8_t flag_bits;  // items left in the current group
+  uint8_t tok[3];
+  uint8_t tok_len;
+};
+
+// out must hold raw_len bytes (lz_raw_len of the first LZ_HDR_LEN bytes).
+void lz_decoder_init(struct lz_decoder* dec, uint8_t* out, size_t out_cap);
+
+// Feeds the next piece of the container. Returns an lz_status.
+int lz_decode_feed(struct lz_decoder* dec, const uint8_t* data, size_t len);
+
+// One-shot helper: returns the decompressed data (NULL terminated, the caller frees it)
+// and its length in *raw_len, NULL if the container is malformed or truncated.
+uint8_t* lz_decompress(const uint8_t* in, size_t in_len, size_t* raw_len);
+
+#endif //PROTOCOL_LZ_CODEC_H
+
@@ -0,0 +1,107 @@
+#include "plot_damage.h"
+
+#include <string.h>
+
+static inline bool plot_is_dirty(const struct plot_damage* d, uint16_t i){
+  return (d->dirty[i / 32] >> (i % 32)) & 1u;
+}
+
+static inline void plot_set_dirty(struct plot_damage* d, uint16_t i, bool dirty){
+  if (dirty) {
+    d->dirty[i / 32] |= 1u << (i % 32);
+  } else {
+    d->dirty[i / 32] &= ~(1u << (i % 32));
+  }
+}
+
+void plot_damage_init(struct plot_damage* d, uint16_t width, uint16_t height, uint16_t point_count,
+                      uint32_t budget_px, uint16_t margin_px){
+  memset(d, 0, sizeof(*d));
+  d->width = width > 0 ? width : 1;
+  d->height = height;
+  d->point_count = point_count > PLOT_MAX_POINTS ? PLOT_MAX_POINTS : point_count;
+  d->budget_px = budget_px;
+  d->margin_px = margin_px;
+}
+
+void plot_damage_mark(struct plot_damage* d, uint16_t first, uint16_t count){
+  if (d->point_count == 0) {
+    return;
+  }
+  if (count > d->point_count) {
+    count = d->point_count;
+  }
+  for (uint16_t k = 0; k < count; k++) {
+    plot_set_dirty(d, (uint16_t)((first + k) % d->point_count), true);
+  }
+}
+
+void plot_damage_mark_all(struct plot_damage* d){
+  plot_damage_mark(d, 0, d->point_count);
+}
+
+void plot_damage_add_series(struct plot_damage* d, struct downsample_series* s){
+  for (uint16_t b = 0; b < s->buckets; b++) {
+    if ((s->changed[b / 32] >> (b % 32)) & 1u) {
+      plot_damage_mark(d, (uint16_t)(2 * b), 2);
+    }
+  }
+  memset(s->changed, 0, sizeof(s->changed));
+}
+
+int16_t plot_point_x(const struct plot_damage* d, uint16_t point){
+  if (d->point_count < 2) {
+    return 0;
+  }
+  return (int16_t)((int32_t)d->width * point / (d->point_count - 1));
+}
+
+int plot_damage_take(struct plot_damage* d, struct plot_span* spans, int max_spans){
+  int count = 0;
+  uint32_t used_px = 0;
+  if (d->point_count == 0 || max_spans <= 0) {
+    return 0;
+  }
+  for (uint16_t k = 0; k < d->point_count; k++) {
+    uint16_t i = (uint16_t)((d->cursor + k) % d->point_count);
+    if (!plot_is_dirty(d, i)) {
+      continue;
+    }
+    // The segments to both neighbours move with the point
+    int32_t x1 = plot_point_x(d, i > 0 ? i - 1 : 0) - d->margin_px;
+    int32_t x2 = plot_point_x(d, i + 1 < d->point_count ? i + 1 : i) + d->margin_px;
+    x1 = x1 < 0 ? 0 : x1;
+    x2 = x2 > d->width ? d->width : x2;      // the last point sits on x = width, like in lv_chart
+    bool merge = count > 0 && x1 <= spans[count - 1].x2 + 1 && x2 >= spans[count - 1].x1;
+    int32_t new_cols = merge ? (x2 > spans[count - 1].x2 ? x2 - spans[count - 1].x2 : 0) : x2 - x1 + 1;
+    if ((!merge && count == max_spans) ||
+        (d->budget_px > 0 && count > 0 && used_px + (uint32_t)new_cols * d->height > d->budget_px)) {
+      d->cursor = i;
+      d->deferred++;
+      break;
+    }
+    if (merge) {
+      spans[count - 1].x2 = (int16_t)(x2 > spans[count - 1].x2 ? x2 : spans[count - 1].x2);
+    } else {
+      spans[count].x1 = (int16_t)x1;
+      spans[count].x2 = (int16_t)x2;
+      count++;
+    }
+    used_px += (uint32_t)new_cols * d->height;
+    plot_set_dirty(d, i, false);
+  }
+  if (count > 0) {
+    d->frames++;
+    d->pixels += used_px;
+  }
+  return count;
+}
+
+bool plot_damage_pending(const struct plot_damage* d){
+  for (size_t w = 0; w < sizeof(d->dirty) / sizeof(d->dirty[0]); w++) {
+    if (d->dirty[w]) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,61 @@
+#ifndef PROTOCOL_PLOT_DAMAGE_H
+#define PROTOCOL_PLOT_DAMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "downsample.h"
+
+// Which pixel columns of a streaming line plot need drawing again. Writing a
+// few points and refreshing the whole chart makes LVGL redraw (and send to the
+// display) every pixel of it, however little changed. Instead the points that
+// changed are marked here, and each frame plot_damage_take() turns them into
+// the column spans to invalidate: a point moves the line segments to both of its
+// neighbours, so the span runs from the previous point to the next one (plus a
+// margin for the line width). A frame redraws at most budget_px pixels; what
+// does not fit stays marked and goes first next frame, so a burst (a late batch,
+// a cleared chart) is spread over a few frames instead of stalling one.
+//
+// Point i is drawn at x = width * i / (point_count - 1), like lv_chart.
+
+#define PLOT_MAX_POINTS (2 * DOWNSAMPLE_MAX_BUCKETS)
+#define PLOT_MAX_SPANS 8
+
+struct plot_span {
+  int16_t x1;                          // columns of the plot area, inclusive
+  int16_t x2;
+};
+
+struct plot_damage {
+  uint16_t width;
+  uint16_t height;
+  uint16_t point_count;
+  uint16_t margin_px;
+  uint32_t budget_px;                  // 0: no cap
+  uint16_t cursor;                     // point the next frame starts from
+  uint32_t dirty[(PLOT_MAX_POINTS + 31) / 32];
+  uint32_t frames;                     // frames that redrew something
+  uint32_t pixels;                     // redrawn in all
+  uint32_t deferred;                   // frames that left damage for the next one
+};
+
+// point_count is capped to PLOT_MAX_POINTS. Nothing is marked.
+void plot_damage_init(struct plot_damage* d, uint16_t width, uint16_t height, uint16_t point_count,
+                      uint32_t budget_px, uint16_t margin_px);
+
+// Marks count points from first on, wrapping around the end.
+void plot_damage_mark(struct plot_damage* d, uint16_t first, uint16_t count);
+
+void plot_damage_mark_all(struct plot_damage* d);
+
+// Marks the points of the buckets the series changed and clears its record.
+void plot_damage_add_series(struct plot_damage* d, struct downsample_series* s);
+
+int16_t plot_point_x(const struct plot_damage* d, uint16_t point);
+
+// Spans to redraw this frame, at most max_spans and budget_px pixels; the
+// points they cover are no longer marked. Returns the number of spans.
+int plot_damage_take(struct plot_damage* d, struct plot_span* spans, int max_spans);
+
+bool plot_damage_pending(const struct plot_damage* d);
+
+#endif //PROTOCOL_PLOT_DAMAGE_H
@@ -0,0 +1,39 @@
+#include "protocol_port.h"
+
+#ifdef ARDUINO
+
+static SemaphoreHandle_t protocol_mutex = xSemaphoreCreateMutex();
+
+uint32_t protocol_millis(){
+  return millis();
+}
+
+void protocol_lock(){
+  xSemaphoreTake(protocol_mutex, portMAX_DELAY);
+}
+
+void protocol_unlock(){
+  xSemaphoreGive(protocol_mutex);
+}
+
+#else
+
+#include <chrono>
+#include <mutex>
+
+static std::mutex protocol_mutex;
+
+uint32_t protocol_millis(){
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void protocol_lock(){
+  protocol_mutex.lock();
+}
+
+void protocol_unlock(){
+  protocol_mutex.unlock();
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef PROTOCOL_PORT_H
+#define PROTOCOL_PORT_H
+
+#include <stdint.h>
+
+// The few things the protocol needs from the platform. On the ESP32 (ARDUINO
+// defined by the core) they map to millis(), a FreeRTOS mutex and Serial; on
+// the host to a steady clock, std::mutex and stderr.
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#ifndef PROTOCOL_LOG
+#define PROTOCOL_LOG(...) Serial.printf(__VA_ARGS__)
+#endif
+#else
+#include <stdio.h>
+#ifndef PROTOCOL_LOG
+#define PROTOCOL_LOG(...) fprintf(stderr, __VA_ARGS__)
+#endif
+#endif
+
+// Milliseconds since start, wraps like millis().
+uint32_t protocol_millis();
+
+// Guards the reassemblers and tx_history: they are used from the BLE callbacks
+// and from the task that polls for stalled transfers. The screen also takes it
+// for its config model while a section is parsed from the BLE callback. Not recursive.
+void protocol_lock();
+void protocol_unlock();
+
+#endif //PROTOCOL_PORT_H
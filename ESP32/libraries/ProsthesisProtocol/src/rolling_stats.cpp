@@ -0,0 +1,152 @@
+#include "rolling_stats.h"
+
+#include <string.h>
+
+static inline void put_u16(uint8_t* dst, uint16_t val){
+  dst[0] = (uint8_t)(val & 0xFF);
+  dst[1] = (uint8_t)(val >> 8);
+}
+
+static inline uint16_t get_u16(const uint8_t* src){
+  return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+// sqrt(v) rounded to the nearest integer, without floating point
+static uint32_t rounded_sqrt(uint64_t v){
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+  while (bit > v) {
+    bit >>= 2;
+  }
+  uint64_t rest = v;
+  while (bit != 0) {
+    if (rest >= root + bit) {
+      rest -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  // v - root^2 > root means v is past (root + 0.5)^2
+  return (uint32_t)(rest > root ? root + 1 : root);
+}
+
+void rolling_stats_init(struct rolling_stats* rs, const struct telemetry_channel* channels, uint8_t count, uint32_t window_ms){
+  memset(rs, 0, sizeof(*rs));
+  if (count > ROLLING_STATS_MAX_CHANNELS) {
+    count = ROLLING_STATS_MAX_CHANNELS;
+  }
+  if (window_ms < ROLLING_STATS_SLOTS) {
+    window_ms = ROLLING_STATS_SLOTS;
+  }
+  rs->window_ms = window_ms;
+  rs->slot_us = window_ms * 1000 / ROLLING_STATS_SLOTS;
+  rs->channel_count = count;
+  memcpy(rs->channels, channels, count * sizeof(struct telemetry_channel));
+}
+
+void rolling_stats_add(struct rolling_stats* rs, uint8_t channel, uint32_t t_us, int16_t value){
+  if (channel >= rs->channel_count) {
+    return;
+  }
+  uint32_t number = t_us / rs->slot_us;
+  struct rolling_stats_slot* slot = &rs->slots[channel][number % ROLLING_STATS_SLOTS];
+  if (slot->count == 0 || slot->number != number) {
+    if (slot->count > 0 && (int32_t)(slot->number - number) > 0) {
+      return;
+    }
+    slot->number = number;
+    slot->count = 0;
+    slot->min = value;
+    slot->max = value;
+    slot->sum = 0;
+    slot->sum_sq = 0;
+  }
+  if (slot->count == UINT16_MAX) {
+    return;
+  }
+  slot->count++;
+  slot->min = value < slot->min ? value : slot->min;
+  slot->max = value > slot->max ? value : slot->max;
+  slot->sum += value;
+  slot->sum_sq += (uint64_t)((int32_t)value * value);
+}
+
+void rolling_stats_get(const struct rolling_stats* rs, uint8_t channel, uint32_t now_us, struct rolling_stats_value* out){
+  memset(out, 0, sizeof(*out));
+  if (channel >= rs->channel_count) {
+    return;
+  }
+  out->channel = rs->channels[channel];
+  uint32_t now_number = now_us / rs->slot_us;
+  int64_t sum = 0;
+  uint64_t sum_sq = 0;
+  for (int i = 0; i < ROLLING_STATS_SLOTS; i++) {
+    const struct rolling_stats_slot* slot = &rs->slots[channel][i];
+    // Slots from before the window (or from after now_us) wrap to a large age
+    if (slot->count == 0 || now_number - slot->number >= ROLLING_STATS_SLOTS) {
+      continue;
+    }
+    if (out->count == 0 || slot->min < out->min) {
+      out->min = slot->min;
+    }
+    if (out->count == 0 || slot->max > out->max) {
+      out->max = slot->max;
+    }
+    out->count += slot->count;
+    sum += slot->sum;
+    sum_sq += slot->sum_sq;
+  }
+  if (out->count == 0) {
+    return;
+  }
+  int64_t half = out->count / 2;
+  out->mean = (int16_t)((sum >= 0 ? sum + half : sum - half) / (int64_t)out->count);
+  out->rms = (uint16_t)rounded_sqrt(sum_sq / out->count);
+}
+
+size_t rolling_stats_encode(uint8_t* out, size_t cap, const struct rolling_stats* rs, uint32_t now_us){
+  size_t len = ROLLING_STATS_HDR_LEN + (size_t)rs->channel_count * ROLLING_STATS_CHANNEL_LEN;
+  if (out == NULL || cap < len) {
+    return 0;
+  }
+  put_u16(out, (uint16_t)(rs->window_ms > UINT16_MAX ? UINT16_MAX : rs->window_ms));
+  out[2] = rs->channel_count;
+  uint8_t* p = &out[ROLLING_STATS_HDR_LEN];
+  for (uint8_t c = 0; c < rs->channel_count; c++) {
+    struct rolling_stats_value v;
+    rolling_stats_get(rs, c, now_us, &v);
+    p[0] = (uint8_t)((v.channel.is_motor ? 0x80 : 0) | (v.channel.id & 0x7F));
+    put_u16(&p[1], (uint16_t)(v.count > UINT16_MAX ? UINT16_MAX : v.count));
+    put_u16(&p[3], (uint16_t)v.min);
+    put_u16(&p[5], (uint16_t)v.max);
+    put_u16(&p[7], (uint16_t)v.mean);
+    put_u16(&p[9], v.rms);
+    p += ROLLING_STATS_CHANNEL_LEN;
+  }
+  return len;
+}
+
+int rolling_stats_decode(const uint8_t* buf, size_t len, uint16_t* window_ms, struct rolling_stats_value* values, int max_values){
+  if (buf == NULL || len < ROLLING_STATS_HDR_LEN) {
+    return -1;
+  }
+  int count = buf[2];
+  if (len != ROLLING_STATS_HDR_LEN + (size_t)count * ROLLING_STATS_CHANNEL_LEN) {
+    return -1;
+  }
+  *window_ms = get_u16(buf);
+  const uint8_t* p = &buf[ROLLING_STATS_HDR_LEN];
+  for (int c = 0; c < count && c < max_values; c++) {
+    values[c].channel.is_motor = p[0] >> 7;
+    values[c].channel.id = p[0] & 0x7F;
+    values[c].count = get_u16(&p[1]);
+    values[c].min = (int16_t)get_u16(&p[3]);
+    values[c].max = (int16_t)get_u16(&p[5]);
+    values[c].mean = (int16_t)get_u16(&p[7]);
+    values[c].rms = get_u16(&p[9]);
+    p += ROLLING_STATS_CHANNEL_LEN;
+  }
+  return count;
+}
@@ -0,0 +1,82 @@
+#ifndef PROTOCOL_ROLLING_STATS_H
+#define PROTOCOL_ROLLING_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "telemetry.h"
+
+// Rolling statistics of every sampled channel, kept on the prosthesis so the
+// Status tab gets all of them in one round trip instead of one READ_REQ per
+// sensor. The window is split into ROLLING_STATS_SLOTS slots of window / slots;
+// each slot keeps count, min, max, sum and sum of squares of the samples that
+// fell into it. Adding a sample updates one slot, a snapshot merges the slots of
+// the last window, so neither depends on the sample rate. The window slides a
+// slot at a time: a snapshot covers between window - slot and window.
+//
+// A slot is t_us / slot_us modulo the slot count, so after micros() wraps (every
+// 71 minutes) the statistics restart with an empty window.
+//
+// STATS_REQ has no payload.
+//
+// STATS_ANS payload:
+//   byte 0-1   window_ms   (little endian)
+//   byte 2     channel_count
+//   byte 3..   channels    channel_count x 11 bytes:
+//                is_motor << 7 | id, count (u16), min, max, mean (int16), rms (u16)
+// all little endian. count saturates at 65535. A channel without samples in the
+// window has count 0 and zeros for the rest. With more than a few channels the
+// payload is longer than MAX_MSG_LEN, so the screen reassembles it like a YAML
+// section instead of collecting it as a short message.
+
+#define ROLLING_STATS_SLOTS 10
+#define ROLLING_STATS_HDR_LEN 3
+#define ROLLING_STATS_CHANNEL_LEN 11
+#define ROLLING_STATS_MAX_CHANNELS 16   // SAMPLE_FRAME_MAX_VALUES, every sampled channel
+#define ROLLING_STATS_MAX_LEN (ROLLING_STATS_HDR_LEN + ROLLING_STATS_MAX_CHANNELS * ROLLING_STATS_CHANNEL_LEN)
+#define ROLLING_STATS_DEFAULT_WINDOW_MS 1000
+
+struct rolling_stats_slot {
+  uint32_t number;                     // t_us / slot_us of the samples in it
+  uint16_t count;                      // a slot takes at most 65535 samples, so sum fits
+  int16_t min;
+  int16_t max;
+  int32_t sum;
+  uint64_t sum_sq;
+};
+
+struct rolling_stats {
+  uint32_t window_ms;
+  uint32_t slot_us;
+  uint8_t channel_count;
+  struct telemetry_channel channels[ROLLING_STATS_MAX_CHANNELS];
+  struct rolling_stats_slot slots[ROLLING_STATS_MAX_CHANNELS][ROLLING_STATS_SLOTS];
+};
+
+// One channel over the window
+struct rolling_stats_value {
+  struct telemetry_channel channel;
+  uint32_t count;
+  int16_t min;
+  int16_t max;
+  int16_t mean;                        // rounded
+  uint16_t rms;                        // rounded
+};
+
+// count is capped to ROLLING_STATS_MAX_CHANNELS; every window starts empty.
+void rolling_stats_init(struct rolling_stats* rs, const struct telemetry_channel* channels, uint8_t count, uint32_t window_ms);
+
+// Adds one sample of channel (its position in channels) taken at t_us. Samples
+// older than the slot now holding their place are dropped.
+void rolling_stats_add(struct rolling_stats* rs, uint8_t channel, uint32_t t_us, int16_t value);
+
+// Statistics of channel over the window ending at now_us.
+void rolling_stats_get(const struct rolling_stats* rs, uint8_t channel, uint32_t now_us, struct rolling_stats_value* out);
+
+// STATS_ANS with every channel. Returns the payload length, 0 if out is too small.
+size_t rolling_stats_encode(uint8_t* out, size_t cap, const struct rolling_stats* rs, uint32_t now_us);
+
+// Returns the number of channels (at most max_values are stored), -1 if the
+// payload is malformed.
+int rolling_stats_decode(const uint8_t* buf, size_t len, uint16_t* window_ms, struct rolling_stats_value* values, int max_values);
+
+#endif //PROTOCOL_ROLLING_STATS_H
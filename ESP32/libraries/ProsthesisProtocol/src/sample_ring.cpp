@@ -0,0 +1,38 @@
+#include "sample_ring.h"
+
+#define SAMPLE_RING_MASK (SAMPLE_RING_SIZE - 1)
+
+void sample_ring_reset(struct sample_ring* ring){
+  ring->head.store(0, std::memory_order_relaxed);
+  ring->tail.store(0, std::memory_order_relaxed);
+  ring->dropped.store(0, std::memory_order_relaxed);
+}
+
+bool sample_ring_push(struct sample_ring* ring, const struct sample_frame* frame){
+  uint32_t head = ring->head.load(std::memory_order_relaxed);
+  // acquire: the consumer is done reading the slot it released
+  uint32_t tail = ring->tail.load(std::memory_order_acquire);
+  if (head - tail >= SAMPLE_RING_SIZE) {
+    ring->dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  ring->frames[head & SAMPLE_RING_MASK] = *frame;
+  // release: the frame is written before the consumer can see it
+  ring->head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+bool sample_ring_pop(struct sample_ring* ring, struct sample_frame* frame){
+  uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+  uint32_t head = ring->head.load(std::memory_order_acquire);
+  if (head == tail) {
+    return false;
+  }
+  *frame = ring->frames[tail & SAMPLE_RING_MASK];
+  ring->tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+uint32_t sample_ring_count(const struct sample_ring* ring){
+  return ring->head.load(std::memory_order_acquire) - ring->tail.load(std::memory_order_acquire);
+}
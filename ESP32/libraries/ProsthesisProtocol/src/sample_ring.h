@@ -0,0 +1,43 @@
+#ifndef PROTOCOL_SAMPLE_RING_H
+#define PROTOCOL_SAMPLE_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free single producer / single consumer ring of sample frames. The
+// prosthesis samples every configured sensor and motor from its own task at a
+// fixed rate (the producer) and the telemetry sender drains the ring from loop()
+// (the consumer), so neither side ever waits for the other. A frame that finds
+// the ring full is dropped and counted; the sampler never blocks.
+
+#define SAMPLE_FRAME_MAX_VALUES 16     // sensors first, then motors
+#define SAMPLE_RING_SIZE 128           // frames, power of two
+
+struct sample_frame {
+  uint32_t tick;                       // sampler tick, counts every frame taken (also the dropped ones)
+  uint32_t t_us;                       // when the tick started
+  uint8_t count;
+  int16_t values[SAMPLE_FRAME_MAX_VALUES];
+};
+
+struct sample_ring {
+  std::atomic<uint32_t> head;          // written by the producer only
+  std::atomic<uint32_t> tail;          // written by the consumer only
+  std::atomic<uint32_t> dropped;
+  struct sample_frame frames[SAMPLE_RING_SIZE];
+};
+
+// Empties the ring. Only while neither side is running.
+void sample_ring_reset(struct sample_ring* ring);
+
+// Producer side. Returns false (and counts the frame as dropped) if the ring is full.
+bool sample_ring_push(struct sample_ring* ring, const struct sample_frame* frame);
+
+// Consumer side. Returns false if the ring is empty.
+bool sample_ring_pop(struct sample_ring* ring, struct sample_frame* frame);
+
+// Frames waiting; exact from either side, a snapshot from anywhere else.
+uint32_t sample_ring_count(const struct sample_ring* ring);
+
+#endif //PROTOCOL_SAMPLE_RING_H
@@ -0,0 +1,175 @@
+#include "serial_export.h"
+#include "wire_frame.h"
+
+#include <string.h>
+
+static inline void put_u16(uint8_t* dst, uint16_t val){
+  dst[0] = (uint8_t)(val & 0xFF);
+  dst[1] = (uint8_t)(val >> 8);
+}
+
+static inline uint16_t get_u16(const uint8_t* src){
+  return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static inline void put_u32(uint8_t* dst, uint32_t val){
+  for (int i = 0; i < 4; i++) {
+    dst[i] = (uint8_t)(val >> (8 * i));
+  }
+}
+
+static inline uint32_t get_u32(const uint8_t* src){
+  return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static size_t payload_len(uint8_t count){
+  return (size_t)count * 2;            // int16 values or (is_motor, id) pairs
+}
+
+static size_t encode(uint8_t* out, size_t cap, uint8_t type, uint8_t count, uint32_t seq, uint32_t t_us){
+  size_t len = EXPORT_HDR_LEN + payload_len(count) + EXPORT_CRC_LEN;
+  if (out == NULL || count > EXPORT_MAX_VALUES || cap < len) {
+    return 0;
+  }
+  out[0] = EXPORT_SYNC0;
+  out[1] = EXPORT_SYNC1;
+  out[2] = type;
+  out[3] = count;
+  put_u32(&out[4], seq);
+  put_u32(&out[8], t_us);
+  return len;
+}
+
+static void seal(uint8_t* out, size_t len){
+  put_u16(&out[len - EXPORT_CRC_LEN], wire_crc16(&out[2], len - 2 - EXPORT_CRC_LEN));
+}
+
+size_t export_samples_encode(uint8_t* out, size_t cap, uint32_t seq, uint32_t t_us, const int16_t* values, uint8_t count){
+  size_t len = encode(out, cap, EXPORT_SAMPLES, count, seq, t_us);
+  if (len == 0) {
+    return 0;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    put_u16(&out[EXPORT_HDR_LEN + 2 * i], (uint16_t)values[i]);
+  }
+  seal(out, len);
+  return len;
+}
+
+size_t export_channels_encode(uint8_t* out, size_t cap, uint32_t seq, uint16_t rate_hz,
+                              const struct telemetry_channel* channels, uint8_t count){
+  size_t len = encode(out, cap, EXPORT_CHANNELS, count, seq, rate_hz);
+  if (len == 0) {
+    return 0;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    out[EXPORT_HDR_LEN + 2 * i] = channels[i].is_motor;
+    out[EXPORT_HDR_LEN + 2 * i + 1] = channels[i].id;
+  }
+  seal(out, len);
+  return len;
+}
+
+void export_decoder_reset(struct export_decoder* d){
+  memset(d, 0, sizeof(*d));
+}
+
+// Drops the first n bytes of the buffer
+static void discard(struct export_decoder* d, size_t n){
+  memmove(d->buf, &d->buf[n], d->len - n);
+  d->len -= n;
+}
+
+// Skips to the next possible start of a frame: a sync byte at any position but 0
+static void resync(struct export_decoder* d){
+  size_t i = 1;
+  while (i < d->len && d->buf[i] != EXPORT_SYNC0) {
+    i++;
+  }
+  d->skipped_bytes += i;
+  discard(d, i);
+}
+
+static void take(struct export_decoder* d, size_t len, export_frame_fn on_frame, void* ctx){
+  struct export_frame frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.type = d->buf[2];
+  frame.count = d->buf[3];
+  frame.seq = get_u32(&d->buf[4]);
+  frame.t_us = get_u32(&d->buf[8]);
+  const uint8_t* p = &d->buf[EXPORT_HDR_LEN];
+  for (uint8_t i = 0; i < frame.count; i++) {
+    if (frame.type == EXPORT_SAMPLES) {
+      frame.values[i] = (int16_t)get_u16(&p[2 * i]);
+    } else {
+      frame.channels[i].is_motor = p[2 * i];
+      frame.channels[i].id = p[2 * i + 1];
+    }
+  }
+  if (frame.type == EXPORT_SAMPLES) {
+    if (d->synced && frame.seq != d->expected_seq) {
+      // An older seq means the prosthesis restarted; only count a gap forward
+      uint32_t gap = frame.seq - d->expected_seq;
+      if ((int32_t)gap > 0) {
+        d->dropped += gap;
+      }
+    }
+    d->synced = true;
+    d->expected_seq = frame.seq + 1;
+    d->frames++;
+  }
+  discard(d, len);
+  if (on_frame != NULL) {
+    on_frame(&frame, ctx);
+  }
+}
+
+int export_decoder_feed(struct export_decoder* d, const uint8_t* data, size_t len, export_frame_fn on_frame, void* ctx){
+  int found = 0;
+  size_t pos = 0;
+  while (pos < len || d->len > 0) {
+    // Fill up to a whole header, then up to the whole frame (a count too large
+    // for buf is refused below before anything more is read)
+    size_t want = EXPORT_HDR_LEN;
+    if (d->len >= EXPORT_HDR_LEN && d->buf[3] <= EXPORT_MAX_VALUES) {
+      want = EXPORT_HDR_LEN + payload_len(d->buf[3]) + EXPORT_CRC_LEN;
+    }
+    if (d->len < want) {
+      if (pos == len) {
+        break;
+      }
+      size_t n = want - d->len;
+      if (n > len - pos) {
+        n = len - pos;
+      }
+      memcpy(&d->buf[d->len], &data[pos], n);
+      d->len += n;
+      pos += n;
+    }
+    if (d->buf[0] != EXPORT_SYNC0 || (d->len > 1 && d->buf[1] != EXPORT_SYNC1)) {
+      resync(d);
+      continue;
+    }
+    if (d->len < EXPORT_HDR_LEN) {
+      continue;
+    }
+    uint8_t type = d->buf[2];
+    if ((type != EXPORT_SAMPLES && type != EXPORT_CHANNELS) || d->buf[3] > EXPORT_MAX_VALUES) {
+      resync(d);
+      continue;
+    }
+    size_t frame_len = EXPORT_HDR_LEN + payload_len(d->buf[3]) + EXPORT_CRC_LEN;
+    if (d->len < frame_len) {
+      continue;
+    }
+    uint16_t crc = get_u16(&d->buf[frame_len - EXPORT_CRC_LEN]);
+    if (crc != wire_crc16(&d->buf[2], frame_len - 2 - EXPORT_CRC_LEN)) {
+      d->crc_errors++;
+      resync(d);
+      continue;
+    }
+    take(d, frame_len, on_frame, ctx);
+    found++;
+  }
+  return found;
+}
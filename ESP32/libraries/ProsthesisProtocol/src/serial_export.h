@@ -0,0 +1,73 @@
+#ifndef PROTOCOL_SERIAL_EXPORT_H
+#define PROTOCOL_SERIAL_EXPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "telemetry.h"
+
+// Binary telemetry export over the USB serial port, for captures on the bench.
+// The prosthesis writes every sampled frame (all sensors and motors of one
+// sampler tick) as one binary frame instead of text; a host decoder
+// (Unit Tests/host/export_decode) turns the stream into CSV or column files.
+//
+// Frame:
+//   byte 0-1   sync        0xA5 0x5A
+//   byte 2     type        EXPORT_SAMPLES or EXPORT_CHANNELS
+//   byte 3     count       values (EXPORT_SAMPLES) or channels (EXPORT_CHANNELS)
+//   byte 4-7   seq         sampler tick of the frame (sample_frame.tick); not checked for EXPORT_CHANNELS
+//   byte 8-11  t_us        prosthesis time (micros()) of the tick, or the sample rate in Hz for EXPORT_CHANNELS
+//   byte 12..  payload     count x int16 (EXPORT_SAMPLES) or count x (is_motor, id) (EXPORT_CHANNELS)
+//   last 2     crc         CRC-16/CCITT of bytes 2.. (wire_crc16)
+// all little endian. The tick counts every frame the sampler took, so a frame
+// lost anywhere (sample ring full, serial buffer full, bytes lost on the way)
+// leaves a gap the decoder counts as dropped. Text that gets into the stream
+// (logs) is skipped: the decoder looks for the sync bytes and only takes frames
+// whose CRC matches. EXPORT_CHANNELS is repeated every second so a capture
+// started late still names its columns.
+
+#define EXPORT_SYNC0 0xA5
+#define EXPORT_SYNC1 0x5A
+#define EXPORT_HDR_LEN 12
+#define EXPORT_CRC_LEN 2
+#define EXPORT_MAX_VALUES 16           // SAMPLE_FRAME_MAX_VALUES
+#define EXPORT_MAX_FRAME_LEN (EXPORT_HDR_LEN + 2 * EXPORT_MAX_VALUES + EXPORT_CRC_LEN)
+
+enum export_frame_type {
+  EXPORT_SAMPLES = 1,
+  EXPORT_CHANNELS = 2
+};
+
+struct export_frame {
+  uint8_t type;
+  uint8_t count;
+  uint32_t seq;
+  uint32_t t_us;                       // rate_hz for EXPORT_CHANNELS
+  int16_t values[EXPORT_MAX_VALUES];
+  struct telemetry_channel channels[EXPORT_MAX_VALUES];
+};
+
+// Returns the frame length, 0 if out is too small or count is above EXPORT_MAX_VALUES.
+size_t export_samples_encode(uint8_t* out, size_t cap, uint32_t seq, uint32_t t_us, const int16_t* values, uint8_t count);
+size_t export_channels_encode(uint8_t* out, size_t cap, uint32_t seq, uint16_t rate_hz,
+                              const struct telemetry_channel* channels, uint8_t count);
+
+typedef void (*export_frame_fn)(const struct export_frame* frame, void* ctx);
+
+// Host side: finds the frames in a byte stream fed in pieces of any size.
+struct export_decoder {
+  uint8_t buf[EXPORT_MAX_FRAME_LEN];
+  size_t len;
+  bool synced;                         // expected_seq is known
+  uint32_t expected_seq;
+  uint32_t frames;                     // good sample frames
+  uint32_t dropped;                    // sample frames missing from the sequence
+  uint32_t crc_errors;
+  uint32_t skipped_bytes;              // not part of a good frame (text, damaged frames)
+};
+
+void export_decoder_reset(struct export_decoder* d);
+
+// Hands every good frame to on_frame. Returns the number of frames found.
+int export_decoder_feed(struct export_decoder* d, const uint8_t* data, size_t len, export_frame_fn on_frame, void* ctx);
+
+#endif //PROTOCOL_SERIAL_EXPORT_H
@@ -0,0 +1,240 @@
+#include "telemetry.h"
+
+#include <string.h>
+
+static inline void put_u16(uint8_t* dst, uint16_t val){
+  dst[0] = (uint8_t)(val & 0xFF);
+  dst[1] = (uint8_t)(val >> 8);
+}
+
+static inline uint16_t get_u16(const uint8_t* src){
+  return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static inline void put_u32(uint8_t* dst, uint32_t val){
+  put_u16(&dst[0], (uint16_t)(val & 0xFFFF));
+  put_u16(&dst[2], (uint16_t)(val >> 16));
+}
+
+static inline uint32_t get_u32(const uint8_t* src){
+  return (uint32_t)get_u16(&src[0]) | ((uint32_t)get_u16(&src[2]) << 16);
+}
+
+size_t telemetry_sub_encode(uint8_t* out, size_t cap, const struct telemetry_sub* sub){
+  size_t len = TELEMETRY_SUB_HDR_LEN + (size_t)sub->channel_count * TELEMETRY_CHANNEL_LEN;
+  if (out == NULL || cap < len || sub->channel_count > TELEMETRY_MAX_CHANNELS) {
+    return 0;
+  }
+  put_u16(&out[0], sub->rate_hz);
+  out[2] = sub->batch;
+  out[3] = sub->channel_count;
+  for (uint8_t i = 0; i < sub->channel_count; i++) {
+    out[TELEMETRY_SUB_HDR_LEN + i * TELEMETRY_CHANNEL_LEN] = sub->channels[i].is_motor;
+    out[TELEMETRY_SUB_HDR_LEN + i * TELEMETRY_CHANNEL_LEN + 1] = sub->channels[i].id;
+  }
+  return len;
+}
+
+bool telemetry_sub_decode(const uint8_t* buf, size_t len, struct telemetry_sub* sub){
+  if (buf == NULL || len < TELEMETRY_SUB_HDR_LEN || buf[3] == 0 || buf[3] > TELEMETRY_MAX_CHANNELS ||
+      len != TELEMETRY_SUB_HDR_LEN + (size_t)buf[3] * TELEMETRY_CHANNEL_LEN) {
+    return false;
+  }
+  sub->rate_hz = get_u16(&buf[0]);
+  sub->batch = buf[2];
+  sub->channel_count = buf[3];
+  for (uint8_t i = 0; i < sub->channel_count; i++) {
+    sub->channels[i].is_motor = buf[TELEMETRY_SUB_HDR_LEN + i * TELEMETRY_CHANNEL_LEN] ? 1 : 0;
+    sub->channels[i].id = buf[TELEMETRY_SUB_HDR_LEN + i * TELEMETRY_CHANNEL_LEN + 1];
+  }
+  if (sub->rate_hz == 0) {
+    sub->rate_hz = 1;
+  }
+  if (sub->rate_hz > TELEMETRY_MAX_RATE_HZ) {
+    sub->rate_hz = TELEMETRY_MAX_RATE_HZ;
+  }
+  if (sub->batch == 0) {
+    sub->batch = 1;
+  }
+  if (sub->batch > TELEMETRY_MAX_BATCH) {
+    sub->batch = TELEMETRY_MAX_BATCH;
+  }
+  return true;
+}
+
+uint8_t telemetry_max_batch(size_t stride){
+  size_t fit = stride > TELEMETRY_HDR_LEN ? (stride - TELEMETRY_HDR_LEN) / TELEMETRY_SAMPLE_LEN : 0;
+  if (fit < 1) {
+    return 1;
+  }
+  return fit > TELEMETRY_MAX_BATCH ? TELEMETRY_MAX_BATCH : (uint8_t)fit;
+}
+
+size_t telemetry_batch_encode(uint8_t* out, size_t cap, const struct telemetry_batch* batch){
+  size_t len = TELEMETRY_HDR_LEN + (size_t)batch->count * TELEMETRY_SAMPLE_LEN;
+  if (out == NULL || cap < len || batch->count > TELEMETRY_MAX_BATCH) {
+    return 0;
+  }
+  put_u32(&out[0], batch->first_seq);
+  out[4] = batch->count;
+  put_u32(&out[5], batch->t_first_us);
+  put_u32(&out[9], batch->t_span_us);
+  for (uint8_t i = 0; i < batch->count; i++) {
+    uint8_t* rec = &out[TELEMETRY_HDR_LEN + i * TELEMETRY_SAMPLE_LEN];
+    rec[0] = batch->channels[i];
+    put_u16(&rec[1], (uint16_t)batch->samples[i]);
+  }
+  return len;
+}
+
+int telemetry_batch_decode(const uint8_t* buf, size_t len, uint8_t channel_count, struct telemetry_batch* batch){
+  if (buf == NULL || len < TELEMETRY_HDR_LEN || buf[4] > TELEMETRY_MAX_BATCH ||
+      len != TELEMETRY_HDR_LEN + (size_t)buf[4] * TELEMETRY_SAMPLE_LEN) {
+    return -1;
+  }
+  batch->first_seq = get_u32(&buf[0]);
+  batch->count = buf[4];
+  batch->t_first_us = get_u32(&buf[5]);
+  batch->t_span_us = get_u32(&buf[9]);
+  for (uint8_t i = 0; i < batch->count; i++) {
+    const uint8_t* rec = &buf[TELEMETRY_HDR_LEN + i * TELEMETRY_SAMPLE_LEN];
+    if (rec[0] >= channel_count) {
+      return -1;
+    }
+    batch->channels[i] = rec[0];
+    batch->samples[i] = (int16_t)get_u16(&rec[1]);
+  }
+  return batch->count;
+}
+
+static void telemetry_sender_flush(struct telemetry_sender* s, telemetry_emit_fn emit, void* ctx){
+  uint8_t payload[TELEMETRY_HDR_LEN + TELEMETRY_MAX_BATCH * TELEMETRY_SAMPLE_LEN];
+  s->batch.t_span_us = s->last_tick_us - s->batch.t_first_us;
+  size_t len = telemetry_batch_encode(payload, sizeof(payload), &s->batch);
+  if (len > 0) {
+    emit(payload, len, ctx);
+    s->batches++;
+  }
+  s->batch.count = 0;
+}
+
+void telemetry_sender_start(struct telemetry_sender* s, const struct telemetry_sub* sub, uint8_t batch_cap, uint32_t now_us){
+  memset(s, 0, sizeof(*s));
+  s->sub = *sub;
+  if (s->sub.batch > batch_cap) {
+    s->sub.batch = batch_cap;
+  }
+  if (s->sub.batch == 0) {
+    s->sub.batch = 1;
+  }
+  if (s->sub.channel_count == 0 || s->sub.channel_count > TELEMETRY_MAX_CHANNELS) {
+    return;
+  }
+  s->period_us = 1000000u / (sub->rate_hz ? sub->rate_hz : 1);
+  s->next_sample_us = now_us;
+  s->active = true;
+}
+
+void telemetry_sender_stop(struct telemetry_sender* s, telemetry_emit_fn emit, void* ctx){
+  if (s->active && s->batch.count > 0) {
+    telemetry_sender_flush(s, emit, ctx);
+  }
+  s->active = false;
+}
+
+// Samples every channel once, stamped t_us. Returns the number of batches emitted.
+static int telemetry_sender_take_tick(struct telemetry_sender* s, uint32_t t_us, telemetry_sample_fn sample, telemetry_emit_fn emit, void* ctx){
+  int emitted = 0;
+  s->last_tick_us = t_us;
+  for (uint8_t c = 0; c < s->sub.channel_count; c++) {
+    if (s->batch.count == 0) {
+      s->batch.first_seq = s->next_seq;
+      s->batch.t_first_us = t_us;
+    }
+    int value = sample(s->sub.channels[c].is_motor, s->sub.channels[c].id, ctx);
+    s->batch.channels[s->batch.count] = c;
+    s->batch.samples[s->batch.count++] = (int16_t)(value > 32767 ? 32767 : (value < -32768 ? -32768 : value));
+    s->next_seq++;
+    s->sampled++;
+    if (s->batch.count >= s->sub.batch) {
+      telemetry_sender_flush(s, emit, ctx);
+      emitted++;
+    }
+  }
+  s->next_sample_us += s->period_us;
+  return emitted;
+}
+
+// Skips `ticks` ticks, counting their samples as dropped. The samples of a batch
+// must be consecutive, so the partial batch goes out first.
+static int telemetry_sender_skip(struct telemetry_sender* s, uint32_t ticks, telemetry_emit_fn emit, void* ctx){
+  int emitted = 0;
+  if (s->batch.count > 0) {
+    telemetry_sender_flush(s, emit, ctx);
+    emitted++;
+  }
+  s->dropped += ticks * s->sub.channel_count;
+  s->next_seq += ticks * s->sub.channel_count;
+  s->next_sample_us += ticks * s->period_us;
+  return emitted;
+}
+
+int telemetry_sender_poll(struct telemetry_sender* s, uint32_t now_us, telemetry_sample_fn sample, telemetry_emit_fn emit, void* ctx){
+  if (!s->active || (int32_t)(now_us - s->next_sample_us) < 0) {
+    return 0;
+  }
+  int emitted = 0;
+  uint32_t behind = now_us - s->next_sample_us;
+  if (behind > TELEMETRY_MAX_BACKLOG_MS * 1000u) {
+    // Stalled (e.g. a long BLE write): send what we have and resume from now
+    emitted += telemetry_sender_skip(s, behind / s->period_us, emit, ctx);
+  }
+  while ((int32_t)(now_us - s->next_sample_us) >= 0) {
+    emitted += telemetry_sender_take_tick(s, s->next_sample_us, sample, emit, ctx);
+  }
+  return emitted;
+}
+
+int telemetry_sender_feed(struct telemetry_sender* s, uint32_t tick_us, uint32_t t_us, telemetry_sample_fn sample, telemetry_emit_fn emit, void* ctx){
+  if (!s->active || (int32_t)(tick_us - s->next_sample_us) < 0) {
+    return 0;
+  }
+  int emitted = 0;
+  // Ticks that were due before this frame had no frame of their own (ring overflow)
+  uint32_t missed = (tick_us - s->next_sample_us) / s->period_us;
+  if (missed > 0) {
+    emitted += telemetry_sender_skip(s, missed, emit, ctx);
+  }
+  emitted += telemetry_sender_take_tick(s, t_us, sample, emit, ctx);
+  return emitted;
+}
+
+void telemetry_receiver_reset(struct telemetry_receiver* r){
+  memset(r, 0, sizeof(*r));
+}
+
+uint32_t telemetry_receiver_push(struct telemetry_receiver* r, const struct telemetry_batch* batch){
+  uint32_t missing = 0;
+  if (r->synced) {
+    uint32_t gap = batch->first_seq - r->expected_seq;
+    if (gap < 0x80000000u) {
+      missing = gap;
+    }
+  }
+  r->synced = true;
+  r->expected_seq = batch->first_seq + batch->count;
+  r->received += batch->count;
+  r->lost += missing;
+  return missing;
+}
+
+uint32_t telemetry_sample_time(const struct telemetry_batch* batch, uint8_t channel_count, int i){
+  uint32_t n = channel_count ? channel_count : 1;
+  uint32_t tick0 = batch->first_seq / n;
+  uint32_t ticks = (batch->count > 0 ? (batch->first_seq + batch->count - 1) / n : tick0) - tick0;
+  if (ticks == 0) {
+    return batch->t_first_us;
+  }
+  uint32_t tick = (batch->first_seq + (uint32_t)i) / n - tick0;
+  return batch->t_first_us + (uint32_t)((uint64_t)batch->t_span_us * tick / ticks);
+}
@@ -0,0 +1,137 @@
+#ifndef PROTOCOL_TELEMETRY_H
+#define PROTOCOL_TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Push telemetry for the Debug chart. Instead of one READ_REQ / READ_ANS round
+// trip per sample, the screen subscribes once and the prosthesis samples at the
+// requested rate and pushes the samples in batches. One subscription covers up to
+// TELEMETRY_MAX_CHANNELS sensors / motors, sampled on the same ticks and sent in
+// one stream, so they share a time axis and the frame overhead.
+//
+// TELEMETRY_SUB_REQ payload (TELEMETRY_UNSUB_REQ has none):
+//   byte 0-1   rate_hz     ticks per second, every channel is sampled once per tick (little endian)
+//   byte 2     batch       samples per TELEMETRY_DATA, capped to what fits one fragment
+//   byte 3     channel_count
+//   byte 4..   channels    channel_count x (is_motor, id); the position is the channel number
+//
+// TELEMETRY_DATA payload:
+//   byte 0-3   first_seq   sequence number of the first sample, counts every sample
+//                          taken since the subscription (little endian)
+//   byte 4     count
+//   byte 5-8   t_first_us  prosthesis time (micros()) of the tick of the first sample
+//   byte 9-12  t_span_us   time from that tick to the tick of the last sample
+//   byte 13..  samples     count x (channel, int16 little endian)
+//
+// Each tick adds one sample per channel in channel order, so sample seq belongs
+// to channel seq % channel_count and tick seq / channel_count; the receiver uses
+// that to place lost samples and to time every sample (telemetry_sample_time()).
+// The screen maps prosthesis time to its own clock with clock_sync.h.
+
+#define TELEMETRY_SUB_HDR_LEN 4
+#define TELEMETRY_CHANNEL_LEN 2
+#define TELEMETRY_HDR_LEN 13
+#define TELEMETRY_SAMPLE_LEN 3
+#define TELEMETRY_MAX_CHANNELS 4
+#define TELEMETRY_SUB_MAX_LEN (TELEMETRY_SUB_HDR_LEN + TELEMETRY_MAX_CHANNELS * TELEMETRY_CHANNEL_LEN)
+#define TELEMETRY_DEFAULT_RATE_HZ 100
+#define TELEMETRY_DEFAULT_BATCH 10
+#define TELEMETRY_MAX_RATE_HZ 1000
+#define TELEMETRY_MAX_BATCH 38         // keeps TELEMETRY_DATA below MAX_MSG_LEN
+#define TELEMETRY_MAX_BACKLOG_MS 200   // a sender further behind than this skips ahead (counted as dropped)
+
+struct telemetry_channel {
+  uint8_t is_motor;
+  uint8_t id;                          // sensor / motor index
+};
+
+struct telemetry_sub {
+  uint16_t rate_hz;
+  uint8_t batch;
+  uint8_t channel_count;
+  struct telemetry_channel channels[TELEMETRY_MAX_CHANNELS];
+};
+
+struct telemetry_batch {
+  uint32_t first_seq;
+  uint8_t count;
+  uint32_t t_first_us;
+  uint32_t t_span_us;
+  uint8_t channels[TELEMETRY_MAX_BATCH];
+  int16_t samples[TELEMETRY_MAX_BATCH];
+};
+
+// Returns the payload length, 0 if out is too small.
+size_t telemetry_sub_encode(uint8_t* out, size_t cap, const struct telemetry_sub* sub);
+
+// Returns false if the payload is malformed or names no channel. rate_hz and batch
+// are clamped to 1..TELEMETRY_MAX_RATE_HZ and 1..TELEMETRY_MAX_BATCH.
+bool telemetry_sub_decode(const uint8_t* buf, size_t len, struct telemetry_sub* sub);
+
+// Samples that fit in one fragment with the given payload stride.
+uint8_t telemetry_max_batch(size_t stride);
+
+size_t telemetry_batch_encode(uint8_t* out, size_t cap, const struct telemetry_batch* batch);
+
+// Returns the number of samples, -1 if the payload is malformed or a channel
+// number is not below channel_count.
+int telemetry_batch_decode(const uint8_t* buf, size_t len, uint8_t channel_count, struct telemetry_batch* batch);
+
+// Reads one sample of (is_motor, id).
+typedef int (*telemetry_sample_fn)(uint8_t is_motor, uint8_t id, void* ctx);
+
+// Hands a TELEMETRY_DATA payload to the link.
+typedef void (*telemetry_emit_fn)(const uint8_t* payload, size_t len, void* ctx);
+
+// Prosthesis side: samples every channel on a fixed schedule (in microseconds, so
+// rates above 1 kHz / loop tick are kept exact on average) and emits every full batch.
+struct telemetry_sender {
+  bool active;
+  struct telemetry_sub sub;
+  uint32_t period_us;
+  uint32_t next_sample_us;
+  uint32_t next_seq;
+  uint32_t last_tick_us;     // time of the newest tick in batch
+  struct telemetry_batch batch;
+  uint32_t sampled;
+  uint32_t dropped;      // samples skipped because the sender fell too far behind (all channels)
+  uint32_t batches;
+};
+
+// batch_cap is telemetry_max_batch() for the current MTU. A sub without channels
+// leaves the sender inactive.
+void telemetry_sender_start(struct telemetry_sender* s, const struct telemetry_sub* sub, uint8_t batch_cap, uint32_t now_us);
+
+// Emits what was sampled so far (if anything) and stops.
+void telemetry_sender_stop(struct telemetry_sender* s, telemetry_emit_fn emit, void* ctx);
+
+// Samples inline: takes every tick that is due by now_us. Returns the number of batches emitted.
+int telemetry_sender_poll(struct telemetry_sender* s, uint32_t now_us, telemetry_sample_fn sample, telemetry_emit_fn emit, void* ctx);
+
+// For samples taken elsewhere (e.g. a sampler task at a fixed rate, see
+// sample_ring.h): tick_us is the scheduled time of one frame and t_us the time its
+// values were actually taken (sent as the sample time). Takes one tick from the
+// frame if one is due, so a subscription slower than the frames is decimated.
+// Ticks due before tick_us are counted as dropped. Returns the number of batches emitted.
+int telemetry_sender_feed(struct telemetry_sender* s, uint32_t tick_us, uint32_t t_us, telemetry_sample_fn sample, telemetry_emit_fn emit, void* ctx);
+
+// Screen side: counts samples lost on the way from the sequence numbers.
+struct telemetry_receiver {
+  bool synced;
+  uint32_t expected_seq;
+  uint32_t received;
+  uint32_t lost;
+};
+
+void telemetry_receiver_reset(struct telemetry_receiver* r);
+
+// Accounts one received batch. Returns the samples missing right before it; they
+// are first_seq - missing .. first_seq - 1.
+uint32_t telemetry_receiver_push(struct telemetry_receiver* r, const struct telemetry_batch* batch);
+
+// Prosthesis time of sample i of batch. The ticks between the first and the last
+// one are spread evenly over t_span_us.
+uint32_t telemetry_sample_time(const struct telemetry_batch* batch, uint8_t channel_count, int i);
+
+#endif //PROTOCOL_TELEMETRY_H
@@ -0,0 +1,232 @@
+#include "telemetry_log.h"
+#include "wire_frame.h"
+
+#include <string.h>
+
+static const uint8_t log_magic[4] = {'P', 'T', 'L', 'G'};
+
+static inline void put_u16(uint8_t* dst, uint16_t val){
+  dst[0] = (uint8_t)(val & 0xFF);
+  dst[1] = (uint8_t)(val >> 8);
+}
+
+static inline uint16_t get_u16(const uint8_t* src){
+  return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static inline void put_u32(uint8_t* dst, uint32_t val){
+  put_u16(&dst[0], (uint16_t)(val & 0xFFFF));
+  put_u16(&dst[2], (uint16_t)(val >> 16));
+}
+
+static inline uint32_t get_u32(const uint8_t* src){
+  return (uint32_t)get_u16(&src[0]) | ((uint32_t)get_u16(&src[2]) << 16);
+}
+
+uint8_t telemetry_log_block_ticks(uint8_t channel_count){
+  if (channel_count == 0) {
+    return 0;
+  }
+  size_t fit = (TELEMETRY_LOG_BLOCK_SIZE - TELEMETRY_LOG_BLOCK_HDR_LEN - TELEMETRY_LOG_BLOCK_CRC_LEN) / (2u * channel_count);
+  return fit > 255 ? 255 : (uint8_t)fit;
+}
+
+void telemetry_log_arm(struct telemetry_log* log, const struct telemetry_log_config* cfg, uint32_t now_us){
+  memset(log, 0, sizeof(*log));
+  log->cfg = *cfg;
+  if (cfg->channel_count == 0 || cfg->channel_count > TELEMETRY_MAX_CHANNELS) {
+    return;
+  }
+  if (log->cfg.rate_hz == 0) {
+    log->cfg.rate_hz = 1;
+  }
+  log->period_us = 1000000u / log->cfg.rate_hz;
+  uint32_t pre_ticks = (uint32_t)((uint64_t)cfg->pre_ms * log->cfg.rate_hz / 1000u);
+  log->pre_cap = (uint16_t)(pre_ticks < TELEMETRY_LOG_PRE_TICKS ? pre_ticks : TELEMETRY_LOG_PRE_TICKS);
+  log->next_tick_us = now_us;
+  log->state = TELEMETRY_LOG_ARMED;
+}
+
+// Hands the block being filled to write. Returns 1 if it was taken.
+static int telemetry_log_flush(struct telemetry_log* log, telemetry_log_write_fn write, void* ctx){
+  if (log->block_ticks == 0) {
+    return 0;
+  }
+  uint8_t* b = log->block;
+  size_t data_len = (size_t)log->block_ticks * log->cfg.channel_count * 2;
+  b[0] = TELEMETRY_LOG_BLOCK_SYNC;
+  b[1] = log->block_ticks;
+  put_u32(&b[2], log->block_first_tick - log->tick_base);
+  put_u32(&b[6], log->block_first_us);
+  put_u32(&b[10], log->block_last_us - log->block_first_us);
+  put_u16(&b[TELEMETRY_LOG_BLOCK_HDR_LEN + data_len], wire_crc16(b, TELEMETRY_LOG_BLOCK_HDR_LEN + data_len));
+  size_t len = TELEMETRY_LOG_BLOCK_HDR_LEN + data_len + TELEMETRY_LOG_BLOCK_CRC_LEN;
+  log->block_ticks = 0;
+  if (!write(b, len, ctx)) {
+    log->dropped_blocks++;
+    return 0;
+  }
+  log->bytes += len;
+  log->blocks++;
+  return 1;
+}
+
+// Appends one tick to the block, starting a new one when it is full or the tick does not follow.
+static int telemetry_log_put_tick(struct telemetry_log* log, uint32_t tick, uint32_t t_us, const int16_t* values,
+                                  telemetry_log_write_fn write, void* ctx){
+  int written = 0;
+  if (log->block_ticks > 0 && (tick != log->block_first_tick + log->block_ticks ||
+                               log->block_ticks >= telemetry_log_block_ticks(log->cfg.channel_count))) {
+    written += telemetry_log_flush(log, write, ctx);
+  }
+  if (log->block_ticks == 0) {
+    log->block_first_tick = tick;
+    log->block_first_us = t_us;
+  }
+  uint8_t* dst = &log->block[TELEMETRY_LOG_BLOCK_HDR_LEN + (size_t)log->block_ticks * log->cfg.channel_count * 2];
+  for (uint8_t c = 0; c < log->cfg.channel_count; c++) {
+    put_u16(&dst[c * 2], (uint16_t)values[c]);
+  }
+  log->block_ticks++;
+  log->block_last_us = t_us;
+  return written;
+}
+
+int telemetry_log_feed(struct telemetry_log* log, uint32_t tick_us, uint32_t t_us, telemetry_sample_fn sample,
+                       telemetry_log_write_fn write, void* ctx){
+  if ((log->state != TELEMETRY_LOG_ARMED && log->state != TELEMETRY_LOG_RECORDING) ||
+      (int32_t)(tick_us - log->next_tick_us) < 0) {
+    return 0;
+  }
+  uint32_t missed = (tick_us - log->next_tick_us) / log->period_us;
+  log->tick += missed;
+  log->skipped_ticks += missed;
+  log->next_tick_us += (missed + 1) * log->period_us;
+  if (log->state == TELEMETRY_LOG_RECORDING && missed >= log->post_left) {
+    // The post-trigger window ended while no frames came
+    int written = telemetry_log_flush(log, write, ctx);
+    log->state = TELEMETRY_LOG_DONE;
+    return written;
+  }
+  if (log->state == TELEMETRY_LOG_RECORDING) {
+    log->post_left -= missed;
+  }
+  int16_t values[TELEMETRY_MAX_CHANNELS];
+  for (uint8_t c = 0; c < log->cfg.channel_count; c++) {
+    int value = sample(log->cfg.channels[c].is_motor, log->cfg.channels[c].id, ctx);
+    values[c] = (int16_t)(value > 32767 ? 32767 : (value < -32768 ? -32768 : value));
+  }
+  uint32_t tick = log->tick++;
+  if (log->state == TELEMETRY_LOG_ARMED) {
+    if (log->pre_cap == 0) {
+      return 0;
+    }
+    uint16_t slot;
+    if (log->pre_count < log->pre_cap) {
+      slot = (uint16_t)((log->pre_head + log->pre_count++) % log->pre_cap);
+    } else {
+      slot = log->pre_head;
+      log->pre_head = (uint16_t)((log->pre_head + 1) % log->pre_cap);
+    }
+    log->pre_tick[slot] = tick;
+    log->pre_t_us[slot] = t_us;
+    memcpy(log->pre_values[slot], values, sizeof(values));
+    return 0;
+  }
+  int written = telemetry_log_put_tick(log, tick, t_us, values, write, ctx);
+  if (--log->post_left == 0) {
+    written += telemetry_log_flush(log, write, ctx);
+    log->state = TELEMETRY_LOG_DONE;
+  }
+  return written;
+}
+
+bool telemetry_log_trigger(struct telemetry_log* log, uint8_t trigger, uint32_t t_us, telemetry_log_write_fn write, void* ctx){
+  if (log->state != TELEMETRY_LOG_ARMED) {
+    return false;
+  }
+  log->tick_base = log->pre_count > 0 ? log->pre_tick[log->pre_head] : log->tick;
+  uint8_t hdr[TELEMETRY_LOG_MAX_LEN];
+  memcpy(hdr, log_magic, sizeof(log_magic));
+  hdr[4] = TELEMETRY_LOG_VERSION;
+  hdr[5] = log->cfg.channel_count;
+  put_u16(&hdr[6], log->cfg.rate_hz);
+  hdr[8] = trigger;
+  hdr[9] = 0;
+  put_u16(&hdr[10], (uint16_t)(log->tick - log->tick_base));
+  put_u32(&hdr[12], t_us);
+  for (uint8_t c = 0; c < log->cfg.channel_count; c++) {
+    hdr[TELEMETRY_LOG_HDR_LEN + c * TELEMETRY_CHANNEL_LEN] = log->cfg.channels[c].is_motor;
+    hdr[TELEMETRY_LOG_HDR_LEN + c * TELEMETRY_CHANNEL_LEN + 1] = log->cfg.channels[c].id;
+  }
+  size_t hdr_len = TELEMETRY_LOG_HDR_LEN + (size_t)log->cfg.channel_count * TELEMETRY_CHANNEL_LEN;
+  if (write(hdr, hdr_len, ctx)) {
+    log->bytes += hdr_len;
+  } else {
+    log->dropped_blocks++;
+  }
+  for (uint16_t i = 0; i < log->pre_count; i++) {
+    uint16_t slot = (uint16_t)((log->pre_head + i) % log->pre_cap);
+    telemetry_log_put_tick(log, log->pre_tick[slot], log->pre_t_us[slot], log->pre_values[slot], write, ctx);
+  }
+  log->pre_count = 0;
+  log->post_left = (uint32_t)((uint64_t)log->cfg.post_ms * log->cfg.rate_hz / 1000u);
+  log->state = TELEMETRY_LOG_RECORDING;
+  if (log->post_left == 0) {
+    telemetry_log_finish(log, write, ctx);
+  }
+  return true;
+}
+
+void telemetry_log_finish(struct telemetry_log* log, telemetry_log_write_fn write, void* ctx){
+  if (log->state == TELEMETRY_LOG_RECORDING) {
+    telemetry_log_flush(log, write, ctx);
+    log->state = TELEMETRY_LOG_DONE;
+  }
+}
+
+size_t telemetry_log_header_decode(const uint8_t* buf, size_t len, struct telemetry_log_header* hdr){
+  if (buf == NULL || len < TELEMETRY_LOG_HDR_LEN || memcmp(buf, log_magic, sizeof(log_magic)) != 0 ||
+      buf[4] != TELEMETRY_LOG_VERSION || buf[5] == 0 || buf[5] > TELEMETRY_MAX_CHANNELS ||
+      len < TELEMETRY_LOG_HDR_LEN + (size_t)buf[5] * TELEMETRY_CHANNEL_LEN) {
+    return 0;
+  }
+  hdr->version = buf[4];
+  hdr->channel_count = buf[5];
+  hdr->rate_hz = get_u16(&buf[6]);
+  hdr->trigger = buf[8];
+  hdr->pre_ticks = get_u16(&buf[10]);
+  hdr->trigger_us = get_u32(&buf[12]);
+  for (uint8_t c = 0; c < hdr->channel_count; c++) {
+    hdr->channels[c].is_motor = buf[TELEMETRY_LOG_HDR_LEN + c * TELEMETRY_CHANNEL_LEN];
+    hdr->channels[c].id = buf[TELEMETRY_LOG_HDR_LEN + c * TELEMETRY_CHANNEL_LEN + 1];
+  }
+  return TELEMETRY_LOG_HDR_LEN + (size_t)hdr->channel_count * TELEMETRY_CHANNEL_LEN;
+}
+
+int telemetry_log_block_decode(const uint8_t* buf, size_t len, uint8_t channel_count, struct telemetry_log_block* block){
+  if (len < 2) {
+    return 0;
+  }
+  if (buf[0] != TELEMETRY_LOG_BLOCK_SYNC || buf[1] == 0 || buf[1] > telemetry_log_block_ticks(channel_count)) {
+    return -1;
+  }
+  size_t data_len = (size_t)buf[1] * channel_count * 2;
+  size_t block_len = TELEMETRY_LOG_BLOCK_HDR_LEN + data_len + TELEMETRY_LOG_BLOCK_CRC_LEN;
+  if (len < block_len) {
+    return 0;
+  }
+  if (get_u16(&buf[TELEMETRY_LOG_BLOCK_HDR_LEN + data_len]) != wire_crc16(buf, TELEMETRY_LOG_BLOCK_HDR_LEN + data_len)) {
+    return -1;
+  }
+  block->ticks = buf[1];
+  block->first_tick = get_u32(&buf[2]);
+  block->t_first_us = get_u32(&buf[6]);
+  block->t_span_us = get_u32(&buf[10]);
+  block->data = &buf[TELEMETRY_LOG_BLOCK_HDR_LEN];
+  return (int)block_len;
+}
+
+int16_t telemetry_log_value(const struct telemetry_log_block* block, uint8_t channel_count, int tick, int channel){
+  return (int16_t)get_u16(&block->data[((size_t)tick * channel_count + channel) * 2]);
+}
@@ -0,0 +1,136 @@
+#ifndef PROTOCOL_TELEMETRY_LOG_H
+#define PROTOCOL_TELEMETRY_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "telemetry.h"
+
+// Black box recording of telemetry channels on the prosthesis. While armed the
+// newest ticks are kept in RAM; a trigger (e.g. EMERGENCY_STOP) writes them out
+// followed by the ticks of the next post_ms, so a recording shows what led up to
+// the event and what came after. The output is an append-only binary log handed
+// to the caller in pieces of at most TELEMETRY_LOG_BLOCK_SIZE bytes (one flash page);
+// the caller decides where it goes (the mock queues it for a SPIFFS writer task).
+//
+// Log layout (little endian):
+//   header  16 bytes + channel_count x (is_motor, id)
+//     byte 0-3   magic "PTLG"
+//     byte 4     version
+//     byte 5     channel_count
+//     byte 6-7   rate_hz
+//     byte 8     trigger (enum telemetry_log_trigger)
+//     byte 9     reserved
+//     byte 10-11 pre_ticks   ticks recorded before the trigger
+//     byte 12-15 trigger_us  prosthesis time (micros()) of the trigger
+//   blocks, each
+//     byte 0     TELEMETRY_LOG_BLOCK_SYNC
+//     byte 1     ticks
+//     byte 2-5   first_tick  tick number in the recording (0 = oldest pre-trigger tick)
+//     byte 6-9   t_first_us  prosthesis time of the first tick
+//     byte 10-13 t_span_us   time from the first to the last tick
+//     byte 14..  ticks x channel_count x int16, tick major
+//     last 2     CRC-16/CCITT of the block up to here
+// The ticks of a block are consecutive; a tick that could not be recorded starts a
+// new block, so gaps show up as jumps of first_tick. A block cut short by a reset
+// fails its CRC and ends the log.
+
+#define TELEMETRY_LOG_HDR_LEN 16
+#define TELEMETRY_LOG_VERSION 1
+#define TELEMETRY_LOG_BLOCK_SYNC 0xB5
+#define TELEMETRY_LOG_BLOCK_HDR_LEN 14
+#define TELEMETRY_LOG_BLOCK_CRC_LEN 2
+#define TELEMETRY_LOG_BLOCK_SIZE 256        // one SPIFFS page
+#define TELEMETRY_LOG_PRE_TICKS 512         // longest pre-trigger history kept in RAM
+#define TELEMETRY_LOG_MAX_LEN (TELEMETRY_LOG_HDR_LEN + TELEMETRY_MAX_CHANNELS * TELEMETRY_CHANNEL_LEN)
+
+enum telemetry_log_trigger {
+  TELEMETRY_LOG_TRIGGER_NONE, TELEMETRY_LOG_TRIGGER_EMERGENCY_STOP, TELEMETRY_LOG_TRIGGER_MANUAL
+};
+
+enum telemetry_log_state {
+  TELEMETRY_LOG_IDLE, TELEMETRY_LOG_ARMED, TELEMETRY_LOG_RECORDING, TELEMETRY_LOG_DONE
+};
+
+struct telemetry_log_config {
+  uint16_t rate_hz;
+  uint8_t channel_count;
+  struct telemetry_channel channels[TELEMETRY_MAX_CHANNELS];
+  uint32_t pre_ms;                          // capped to TELEMETRY_LOG_PRE_TICKS ticks
+  uint32_t post_ms;
+};
+
+struct telemetry_log_header {
+  uint8_t version;
+  uint8_t channel_count;
+  uint16_t rate_hz;
+  uint8_t trigger;
+  uint16_t pre_ticks;
+  uint32_t trigger_us;
+  struct telemetry_channel channels[TELEMETRY_MAX_CHANNELS];
+};
+
+struct telemetry_log_block {
+  uint8_t ticks;
+  uint32_t first_tick;
+  uint32_t t_first_us;
+  uint32_t t_span_us;
+  const uint8_t* data;                      // points into the decoded buffer
+};
+
+// Takes a piece of the log. Returns false if it could not be taken (counted as dropped).
+typedef bool (*telemetry_log_write_fn)(const uint8_t* data, size_t len, void* ctx);
+
+struct telemetry_log {
+  struct telemetry_log_config cfg;
+  uint8_t state;
+  uint32_t period_us;
+  uint32_t next_tick_us;
+  uint32_t tick;                            // next tick number since arming
+  uint32_t tick_base;                       // tick 0 of the recording
+  uint16_t pre_cap;
+  // Pre-trigger history, a ring of the newest pre_cap ticks
+  uint16_t pre_head;
+  uint16_t pre_count;
+  uint32_t pre_tick[TELEMETRY_LOG_PRE_TICKS];
+  uint32_t pre_t_us[TELEMETRY_LOG_PRE_TICKS];
+  int16_t pre_values[TELEMETRY_LOG_PRE_TICKS][TELEMETRY_MAX_CHANNELS];
+  uint32_t post_left;                       // ticks still to record after the trigger
+  // Block being filled
+  uint8_t block[TELEMETRY_LOG_BLOCK_SIZE];
+  uint8_t block_ticks;
+  uint32_t block_first_tick;
+  uint32_t block_first_us;
+  uint32_t block_last_us;
+  uint32_t bytes;                           // handed to write
+  uint32_t blocks;
+  uint32_t dropped_blocks;                  // write refused them
+  uint32_t skipped_ticks;                   // due while no frame came (sample ring overflow)
+};
+
+// Ticks of channel_count channels that fit one block.
+uint8_t telemetry_log_block_ticks(uint8_t channel_count);
+
+// Starts keeping the pre-trigger history. A config without channels leaves the log idle.
+void telemetry_log_arm(struct telemetry_log* log, const struct telemetry_log_config* cfg, uint32_t now_us);
+
+// Records one frame of the sampler like telemetry_sender_feed(): tick_us is its
+// scheduled time, t_us the time it was taken. Returns the number of blocks written.
+int telemetry_log_feed(struct telemetry_log* log, uint32_t tick_us, uint32_t t_us, telemetry_sample_fn sample,
+                       telemetry_log_write_fn write, void* ctx);
+
+// Writes the header and the pre-trigger history and records post_ms more. Ignored
+// (returns false) unless armed.
+bool telemetry_log_trigger(struct telemetry_log* log, uint8_t trigger, uint32_t t_us, telemetry_log_write_fn write, void* ctx);
+
+// Writes the partial block of a running recording and ends it.
+void telemetry_log_finish(struct telemetry_log* log, telemetry_log_write_fn write, void* ctx);
+
+// Returns the header length, 0 if buf does not start with a valid header.
+size_t telemetry_log_header_decode(const uint8_t* buf, size_t len, struct telemetry_log_header* hdr);
+
+// Returns the length of the block at buf, 0 if buf ends before it does, -1 if it is corrupted.
+int telemetry_log_block_decode(const uint8_t* buf, size_t len, uint8_t channel_count, struct telemetry_log_block* block);
+
+int16_t telemetry_log_value(const struct telemetry_log_block* block, uint8_t channel_count, int tick, int channel);
+
+#endif //PROTOCOL_TELEMETRY_LOG_H
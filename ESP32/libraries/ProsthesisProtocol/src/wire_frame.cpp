@@ -0,0 +1,380 @@
+#include "wire_frame.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct wire_crc16_tables {
+  uint16_t table[4][256];
+};
+
+static struct wire_crc16_tables wire_crc16_build_tables(){
+  struct wire_crc16_tables t;
+  for (int b = 0; b < 256; b++) {
+    uint16_t crc = (uint16_t)(b << 8);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ WIRE_CRC16_POLY) : (uint16_t)(crc << 1);
+    }
+    t.table[0][b] = crc;
+  }
+  for (int k = 1; k < 4; k++) {
+    for (int b = 0; b < 256; b++) {
+      uint16_t prev = t.table[k - 1][b];
+      t.table[k][b] = (uint16_t)((prev << 8) ^ t.table[0][prev >> 8]);
+    }
+  }
+  return t;
+}
+
+// Tables are built on first use (2 KB, thread safe function-local static).
+static const struct wire_crc16_tables* wire_crc16_get_tables(){
+  static const struct wire_crc16_tables tables = wire_crc16_build_tables();
+  return &tables;
+}
+
+uint16_t wire_crc16(const uint8_t* data, size_t length){
+  const struct wire_crc16_tables* t = wire_crc16_get_tables();
+  uint16_t crc = WIRE_CRC16_INIT;
+  while (length >= 4) {
+    crc ^= (uint16_t)((data[0] << 8) | data[1]);
+    crc = t->table[3][crc >> 8] ^ t->table[2][crc & 0xFF] ^ t->table[1][data[2]] ^ t->table[0][data[3]];
+    data += 4;
+    length -= 4;
+  }
+  while (length > 0) {
+    crc = (uint16_t)((crc << 8) ^ t->table[0][(crc >> 8) ^ *data]);
+    data++;
+    length--;
+  }
+  return crc;
+}
+
+static inline void wire_put_u16(uint8_t* dst, uint16_t val){
+  dst[0] = (uint8_t)(val & 0xFF);
+  dst[1] = (uint8_t)(val >> 8);
+}
+
+static inline uint16_t wire_get_u16(const uint8_t* src){
+  return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+size_t wire_frame_encode(uint8_t* out, size_t out_cap, uint8_t req_type, uint8_t seq,
+                         uint16_t frag_idx, uint16_t frag_cnt, const uint8_t* payload, uint16_t payload_len){
+  size_t frame_len = WIRE_FRAME_HDR_LEN + payload_len;
+  if (out == NULL || frame_len > out_cap) {
+    return 0;
+  }
+  out[0] = req_type;
+  out[1] = seq;
+  wire_put_u16(&out[2], frag_idx);
+  wire_put_u16(&out[4], frag_cnt);
+  wire_put_u16(&out[6], payload_len);
+  wire_put_u16(&out[8], wire_crc16(payload, payload_len));
+  if (payload_len > 0) {
+    memcpy(&out[WIRE_FRAME_HDR_LEN], payload, payload_len);
+  }
+  return frame_len;
+}
+
+int wire_frame_decode(const uint8_t* data, size_t length, struct wire_frame* frame){
+  if (data == NULL || length < WIRE_FRAME_HDR_LEN) {
+    return WIRE_ERR_SHORT;
+  }
+  frame->req_type = data[0];
+  frame->seq = data[1];
+  frame->frag_idx = wire_get_u16(&data[2]);
+  frame->frag_cnt = wire_get_u16(&data[4]);
+  frame->payload_len = wire_get_u16(&data[6]);
+  frame->crc = wire_get_u16(&data[8]);
+  frame->payload = &data[WIRE_FRAME_HDR_LEN];
+  if ((size_t)frame->payload_len != length - WIRE_FRAME_HDR_LEN) {
+    return WIRE_ERR_LENGTH;
+  }
+  if (wire_crc16(frame->payload, frame->payload_len) != frame->crc) {
+    return WIRE_ERR_CHECKSUM;
+  }
+  return WIRE_OK;
+}
+
+uint16_t wire_frag_payload_size(uint16_t mtu){
+  if (mtu < WIRE_DEFAULT_MTU) {
+    mtu = WIRE_DEFAULT_MTU;
+  }
+  if (mtu > WIRE_MAX_MTU) {
+    mtu = WIRE_MAX_MTU;
+  }
+  return mtu - WIRE_ATT_OVERHEAD - WIRE_FRAME_HDR_LEN;
+}
+
+uint16_t wire_frag_count(size_t msg_len, size_t stride){
+  if (msg_len == 0) {
+    return 1;
+  }
+  return (uint16_t)((msg_len + stride - 1) / stride);
+}
+
+size_t wire_frag_encode(uint8_t* out, size_t out_cap, uint8_t req_type, uint8_t seq,
+                        const uint8_t* msg, size_t msg_len, size_t stride, uint16_t frag_idx){
+  uint16_t frag_cnt = wire_frag_count(msg_len, stride);
+  size_t start = (size_t)(frag_idx - 1) * stride;
+  if (frag_idx < 1 || frag_idx > frag_cnt) {
+    return 0;
+  }
+  size_t chunk = (msg_len - start) < stride ? (msg_len - start) : stride;
+  return wire_frame_encode(out, out_cap, req_type, seq, frag_idx, frag_cnt, msg + start, (uint16_t)chunk);
+}
+
+static void wire_transfer_clear(struct wire_transfer* t){
+  free(t->bitmap);
+  free(t->buf);
+  free(t->tail);
+  memset(t, 0, sizeof(*t));
+}
+
+void wire_reasm_reset(struct wire_reassembler* reasm){
+  for (int i = 0; i < WIRE_REASM_SLOTS; i++) {
+    wire_transfer_clear(&reasm->slots[i]);
+  }
+  free(reasm->ready_buf);
+  memset(reasm, 0, sizeof(*reasm));
+}
+
+static inline uint16_t wire_transfer_key(uint8_t req_type, uint8_t seq){
+  return (uint16_t)(((req_type << 8) | seq) + 1);
+}
+
+static inline bool wire_bitmap_get(const uint8_t* bitmap, uint16_t idx){
+  return (bitmap[(idx - 1) / 8] >> ((idx - 1) % 8)) & 1;
+}
+
+// Finds the slot of a running transfer, or claims one (evicting the quietest) for a new one.
+static struct wire_transfer* wire_reasm_slot(struct wire_reassembler* reasm, const struct wire_frame* frame){
+  struct wire_transfer* victim = &reasm->slots[0];
+  for (int i = 0; i < WIRE_REASM_SLOTS; i++) {
+    struct wire_transfer* t = &reasm->slots[i];
+    if (t->active && t->seq == frame->seq && t->req_type == frame->req_type) {
+      return t;
+    }
+    if (!t->active || (victim->active && t->last_rx_ms < victim->last_rx_ms)) {
+      victim = t;
+    }
+  }
+  if (victim->active) {
+    reasm->expired++;
+  }
+  wire_transfer_clear(victim);
+  victim->bitmap = (uint8_t*)calloc((frame->frag_cnt + 7) / 8, 1);
+  if (victim->bitmap == NULL) {
+    return NULL;
+  }
+  victim->active = true;
+  victim->req_type = frame->req_type;
+  victim->seq = frame->seq;
+  victim->frag_cnt = frame->frag_cnt;
+  return victim;
+}
+
+// Copies the parked last fragment into place once the stride is known.
+static bool wire_transfer_place_tail(struct wire_transfer* t){
+  if (t->tail_len > t->stride) {
+    return false;
+  }
+  memcpy(t->buf + (size_t)(t->frag_cnt - 1) * t->stride, t->tail, t->tail_len);
+  t->total_len = (size_t)(t->frag_cnt - 1) * t->stride + t->tail_len;
+  free(t->tail);
+  t->tail = NULL;
+  return true;
+}
+
+int wire_reasm_push(struct wire_reassembler* reasm, const struct wire_frame* frame, uint32_t now_ms){
+  if (frame->frag_idx == 0 || frame->frag_idx > frame->frag_cnt) {
+    return WIRE_REASM_ERROR;
+  }
+  if (frame->frag_idx < frame->frag_cnt && frame->payload_len == 0) {
+    return WIRE_REASM_ERROR;   // only the last fragment may be empty, the others carry the stride
+  }
+  uint16_t key = wire_transfer_key(frame->req_type, frame->seq);
+  for (int i = 0; i < WIRE_REASM_RECENT; i++) {
+    if (reasm->recent[i] == key && now_ms - reasm->recent_ms[i] < WIRE_REASM_RECENT_MS) {
+      reasm->duplicates++;
+      return WIRE_REASM_DUPLICATE;
+    }
+  }
+  struct wire_transfer* t = wire_reasm_slot(reasm, frame);
+  if (t == NULL) {
+    return WIRE_REASM_ERROR;
+  }
+  if (frame->frag_cnt != t->frag_cnt) {
+    wire_transfer_clear(t);
+    return WIRE_REASM_ERROR;
+  }
+  if (wire_bitmap_get(t->bitmap, frame->frag_idx)) {
+    reasm->duplicates++;
+    t->last_rx_ms = now_ms;
+    return WIRE_REASM_DUPLICATE;
+  }
+  bool is_last = frame->frag_idx == frame->frag_cnt;
+  if (t->stride == 0 && (!is_last || frame->frag_cnt == 1)) {
+    // First fragment that tells us the stride: allocate the whole message
+    t->stride = frame->payload_len;
+    t->buf = (uint8_t*)malloc((size_t)frame->frag_cnt * t->stride + 1);
+    if (t->buf == NULL || (t->tail && !wire_transfer_place_tail(t))) {
+      wire_transfer_clear(t);
+      return WIRE_REASM_ERROR;
+    }
+  }
+  if (t->stride == 0) {
+    t->tail = (uint8_t*)malloc(frame->payload_len ? frame->payload_len : 1);
+    if (t->tail == NULL) {
+      wire_transfer_clear(t);
+      return WIRE_REASM_ERROR;
+    }
+    memcpy(t->tail, frame->payload, frame->payload_len);
+    t->tail_len = frame->payload_len;
+  } else {
+    if (frame->payload_len > t->stride || (!is_last && frame->payload_len != t->stride)) {
+      wire_transfer_clear(t);
+      return WIRE_REASM_ERROR;
+    }
+    memcpy(t->buf + (size_t)(frame->frag_idx - 1) * t->stride, frame->payload, frame->payload_len);
+    if (is_last) {
+      t->total_len = (size_t)(frame->frag_cnt - 1) * t->stride + frame->payload_len;
+    }
+  }
+  t->bitmap[(frame->frag_idx - 1) / 8] |= (uint8_t)(1 << ((frame->frag_idx - 1) % 8));
+  t->received++;
+  t->resends = 0;
+  t->last_rx_ms = now_ms;
+  if (t->received < t->frag_cnt) {
+    return WIRE_REASM_IN_PROGRESS;
+  }
+  t->buf[t->total_len] = '\0';
+  free(reasm->ready_buf);
+  reasm->ready_buf = t->buf;
+  reasm->ready_len = t->total_len;
+  t->buf = NULL;
+  reasm->recent[reasm->recent_next] = key;
+  reasm->recent_ms[reasm->recent_next] = now_ms;
+  reasm->recent_next = (reasm->recent_next + 1) % WIRE_REASM_RECENT;
+  wire_transfer_clear(t);
+  return WIRE_REASM_DONE;
+}
+
+uint8_t* wire_reasm_take(struct wire_reassembler* reasm, size_t* len){
+  uint8_t* buf = reasm->ready_buf;
+  if (len) {
+    *len = reasm->ready_len;
+  }
+  reasm->ready_buf = NULL;
+  reasm->ready_len = 0;
+  return buf;
+}
+
+size_t wire_reasm_missing(const struct wire_transfer* t, char* out, size_t cap){
+  int pos = snprintf(out, cap, "%u|%u", t->seq, t->req_type);
+  int ranges = 0;
+  uint16_t idx = 1;
+  while (idx <= t->frag_cnt && ranges < WIRE_RESEND_MAX_RANGES && pos > 0 && (size_t)pos < cap) {
+    if (wire_bitmap_get(t->bitmap, idx)) {
+      idx++;
+      continue;
+    }
+    uint16_t first = idx;
+    while (idx < t->frag_cnt && !wire_bitmap_get(t->bitmap, idx + 1)) {
+      idx++;
+    }
+    int written = (first == idx) ? snprintf(out + pos, cap - pos, "|%u", first)
+                                 : snprintf(out + pos, cap - pos, "|%u-%u", first, idx);
+    if (written < 0 || (size_t)(pos + written) >= cap) {
+      out[pos] = '\0';
+      break;
+    }
+    pos += written;
+    ranges++;
+    idx++;
+  }
+  return pos > 0 ? (size_t)pos : 0;
+}
+
+bool wire_reasm_poll(struct wire_reassembler* reasm, uint32_t now_ms, char* out, size_t cap){
+  for (int i = 0; i < WIRE_REASM_SLOTS; i++) {
+    struct wire_transfer* t = &reasm->slots[i];
+    if (!t->active || now_ms - t->last_rx_ms < WIRE_REASM_RESEND_MS) {
+      continue;
+    }
+    if (t->resends >= WIRE_REASM_MAX_RESENDS) {
+      reasm->expired++;
+      wire_transfer_clear(t);
+      continue;
+    }
+    t->resends++;
+    t->last_rx_ms = now_ms;
+    return wire_reasm_missing(t, out, cap) > 0;
+  }
+  return false;
+}
+
+int wire_resend_parse(const char* text, uint8_t* seq, uint8_t* req_type,
+                      struct wire_frag_range* ranges, int max_ranges){
+  char* end;
+  unsigned long val = strtoul(text, &end, 10);
+  if (end == text || *end != '|' || val > 0xFF) {
+    return -1;
+  }
+  *seq = (uint8_t)val;
+  text = end + 1;
+  val = strtoul(text, &end, 10);
+  if (end == text || val > 0xFF) {
+    return -1;
+  }
+  *req_type = (uint8_t)val;
+  int count = 0;
+  while (*end == '|' && count < max_ranges) {
+    text = end + 1;
+    unsigned long first = strtoul(text, &end, 10);
+    unsigned long last = first;
+    if (end == text) {
+      return -1;
+    }
+    if (*end == '-') {
+      text = end + 1;
+      last = strtoul(text, &end, 10);
+      if (end == text) {
+        return -1;
+      }
+    }
+    if (first == 0 || last < first || last > 0xFFFF) {
+      return -1;
+    }
+    ranges[count].first = (uint16_t)first;
+    ranges[count].last = (uint16_t)last;
+    count++;
+  }
+  return count;
+}
+
+void wire_tx_history_add(struct wire_tx_history* history, uint8_t req_type, uint8_t seq,
+                         const uint8_t* msg, size_t msg_len, uint16_t stride){
+  struct wire_tx_record* rec = &history->records[history->next];
+  free(rec->msg);
+  rec->msg = (uint8_t*)malloc(msg_len ? msg_len : 1);
+  if (rec->msg == NULL) {
+    return;
+  }
+  memcpy(rec->msg, msg, msg_len);
+  rec->msg_len = msg_len;
+  rec->req_type = req_type;
+  rec->seq = seq;
+  rec->stride = stride;
+  history->next = (history->next + 1) % WIRE_TX_HISTORY_SIZE;
+}
+
+const struct wire_tx_record* wire_tx_history_find(const struct wire_tx_history* history, uint8_t req_type, uint8_t seq){
+  for (int i = 0; i < WIRE_TX_HISTORY_SIZE; i++) {
+    const struct wire_tx_record* rec = &history->records[i];
+    if (rec->msg && rec->req_type == req_type && rec->seq == seq) {
+      return rec;
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,179 @@
+#ifndef PROTOCOL_WIRE_FRAME_H
+#define PROTOCOL_WIRE_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compact on-air framing.
+// Every BLE write/notify carries a small packed header followed only by the
+// payload bytes that are actually used (instead of the whole msg_interp struct).
+//
+//   byte 0     req_type    (enum msg_type)
+//   byte 1     seq         transfer id, same for every fragment of one message
+//   byte 2-3   frag_idx    1-based fragment index   (little endian)
+//   byte 4-5   frag_cnt    total fragments          (little endian)
+//   byte 6-7   payload_len payload bytes that follow (little endian)
+//   byte 8-9   crc         CRC-16/CCITT of the payload (little endian)
+//   byte 10..  payload
+//
+// Fragments are sized to the ATT MTU negotiated for the connection: every
+// fragment except the last carries exactly wire_frag_payload_size(mtu) bytes.
+
+#define WIRE_FRAME_HDR_LEN 10
+#define WIRE_ATT_OVERHEAD 3          // ATT opcode + attribute handle
+#define WIRE_DEFAULT_MTU 23          // BLE minimum, used until the MTU exchange completes
+#define WIRE_MAX_MTU 517             // largest ATT MTU we ask for
+#define WIRE_FRAME_MAX_PAYLOAD (WIRE_MAX_MTU - WIRE_ATT_OVERHEAD - WIRE_FRAME_HDR_LEN)
+#define WIRE_FRAME_MAX_LEN (WIRE_FRAME_HDR_LEN + WIRE_FRAME_MAX_PAYLOAD)
+
+enum wire_status {
+  WIRE_OK = 0,
+  WIRE_ERR_SHORT,      // buffer smaller than the header
+  WIRE_ERR_LENGTH,     // payload_len does not match the received length
+  WIRE_ERR_CHECKSUM,   // payload does not match the CRC field
+  WIRE_ERR_NO_SPACE    // output buffer too small
+};
+
+// Decoded view of a frame. payload points into the received buffer (no copy).
+struct wire_frame {
+  uint8_t req_type;
+  uint8_t seq;
+  uint16_t frag_idx;
+  uint16_t frag_cnt;
+  uint16_t payload_len;
+  uint16_t crc;
+  const uint8_t* payload;
+};
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF, no reflection, check("123456789") = 0x29B1).
+// Slice-by-4: table[k][b] is the CRC contribution of byte b followed by k zero bytes,
+// which lets the main loop fold four payload bytes per iteration.
+#define WIRE_CRC16_POLY 0x1021
+#define WIRE_CRC16_INIT 0xFFFF
+
+// The tables are built on first use (2 KB).
+uint16_t wire_crc16(const uint8_t* data, size_t length);
+
+// Writes one frame into out. Returns the number of bytes to put on air, 0 on error.
+size_t wire_frame_encode(uint8_t* out, size_t out_cap, uint8_t req_type, uint8_t seq,
+                         uint16_t frag_idx, uint16_t frag_cnt, const uint8_t* payload, uint16_t payload_len);
+
+// Parses and validates a received frame without copying the payload.
+int wire_frame_decode(const uint8_t* data, size_t length, struct wire_frame* frame);
+
+// Payload bytes that fit in one fragment for the given ATT MTU.
+uint16_t wire_frag_payload_size(uint16_t mtu);
+
+// Number of fragments needed to send msg_len bytes with the given payload stride.
+uint16_t wire_frag_count(size_t msg_len, size_t stride);
+
+// Encodes fragment frag_idx (1-based) of msg. Returns the frame length, 0 on error.
+size_t wire_frag_encode(uint8_t* out, size_t out_cap, uint8_t req_type, uint8_t seq,
+                        const uint8_t* msg, size_t msg_len, size_t stride, uint16_t frag_idx);
+
+// Reassembly engine.
+// Fragments may arrive lost, duplicated or out of order. Each transfer is keyed by
+// (seq, req_type) and tracks the fragments it already has in a bitmap; the stride
+// is learned from any non-last fragment (a last fragment that arrives first is
+// parked until then). Transfers that stop making progress are reported by
+// wire_reasm_poll() so the receiver can ask for just the missing fragments
+// (FRAG_RESEND_REQ), and are dropped after WIRE_REASM_MAX_RESENDS requests in a row
+// that brought nothing new.
+// Time is passed in by the caller (millis() on the ESP32) so this runs on the host too.
+#define WIRE_REASM_SLOTS 4            // transfers collected at the same time (one per YAML section)
+#define WIRE_REASM_RECENT 4           // completed transfers remembered to drop late duplicates
+#define WIRE_REASM_RESEND_MS 300      // silence before missing fragments are requested
+#define WIRE_REASM_MAX_RESENDS 3      // unanswered resend requests before the transfer is dropped
+// How long a completed transfer is remembered: the last answer to a resend request
+// arrives within this. After it the key is free again, since seq restarts at 0 on
+// every boot and wraps after 256 messages.
+#define WIRE_REASM_RECENT_MS (WIRE_REASM_RESEND_MS * (WIRE_REASM_MAX_RESENDS + 1))
+#define WIRE_RESEND_MAX_RANGES 16     // fragment ranges carried by one FRAG_RESEND_REQ
+
+struct wire_transfer {
+  bool active;
+  uint8_t req_type;
+  uint8_t seq;
+  uint8_t resends;       // resend requests sent since the last new fragment
+  uint16_t frag_cnt;
+  uint16_t received;     // distinct fragments stored so far
+  uint16_t stride;       // 0 until a non-last fragment arrived
+  uint16_t tail_len;
+  uint8_t* bitmap;       // bit i set once fragment i+1 is stored
+  uint8_t* buf;
+  uint8_t* tail;         // last fragment, parked while the stride is unknown
+  size_t total_len;
+  uint32_t last_rx_ms;
+};
+
+struct wire_reassembler {
+  struct wire_transfer slots[WIRE_REASM_SLOTS];
+  uint16_t recent[WIRE_REASM_RECENT];   // (req_type << 8 | seq) + 1 of completed transfers, 0 = empty
+  uint32_t recent_ms[WIRE_REASM_RECENT];   // when they completed
+  uint8_t recent_next;
+  uint8_t* ready_buf;                   // completed message waiting for wire_reasm_take()
+  size_t ready_len;
+  uint32_t duplicates;
+  uint32_t expired;
+};
+
+enum wire_reasm_status {
+  WIRE_REASM_IN_PROGRESS = 0,
+  WIRE_REASM_DONE,
+  WIRE_REASM_DUPLICATE,
+  WIRE_REASM_ERROR
+};
+
+// Frees everything the reassembler holds and clears it.
+void wire_reasm_reset(struct wire_reassembler* reasm);
+
+// Feeds one decoded fragment. On WIRE_REASM_DONE the message (NULL terminated)
+// is waiting in the reassembler; take it with wire_reasm_take().
+int wire_reasm_push(struct wire_reassembler* reasm, const struct wire_frame* frame, uint32_t now_ms);
+
+// Hands the completed message over to the caller, who becomes responsible for freeing it.
+uint8_t* wire_reasm_take(struct wire_reassembler* reasm, size_t* len);
+
+// Writes the FRAG_RESEND_REQ payload for a transfer: "seq|req_type|first-last|idx|..."
+// listing up to WIRE_RESEND_MAX_RANGES runs of missing fragments. Returns its length.
+size_t wire_reasm_missing(const struct wire_transfer* t, char* out, size_t cap);
+
+// Checks running transfers for silence. For the first stalled one, writes its
+// FRAG_RESEND_REQ payload to out and returns true; transfers that used up their
+// resend attempts are dropped. Call it periodically.
+bool wire_reasm_poll(struct wire_reassembler* reasm, uint32_t now_ms, char* out, size_t cap);
+
+struct wire_frag_range {
+  uint16_t first;
+  uint16_t last;
+};
+
+// Parses a FRAG_RESEND_REQ payload. Returns the number of ranges, -1 if malformed.
+int wire_resend_parse(const char* text, uint8_t* seq, uint8_t* req_type,
+                      struct wire_frag_range* ranges, int max_ranges);
+
+// Sender side: copies of the last multi-fragment messages, so fragments named in a
+// FRAG_RESEND_REQ can be encoded again with the stride they were first sent with.
+#define WIRE_TX_HISTORY_SIZE 4
+
+struct wire_tx_record {
+  uint8_t req_type;
+  uint8_t seq;
+  uint16_t stride;
+  uint8_t* msg;       // NULL when the record is empty
+  size_t msg_len;
+};
+
+struct wire_tx_history {
+  struct wire_tx_record records[WIRE_TX_HISTORY_SIZE];
+  uint8_t next;
+};
+
+// Stores a copy of msg, replacing the oldest record.
+void wire_tx_history_add(struct wire_tx_history* history, uint8_t req_type, uint8_t seq,
+                         const uint8_t* msg, size_t msg_len, uint16_t stride);
+
+// Returns the record of transfer (req_type, seq), NULL if it is no longer kept.
+const struct wire_tx_record* wire_tx_history_find(const struct wire_tx_history* history, uint8_t req_type, uint8_t seq);
+
+#endif //PROTOCOL_WIRE_FRAME_H
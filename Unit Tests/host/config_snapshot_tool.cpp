@@ -0,0 +1,129 @@
+// Host converter of the hand config to the binary snapshot the prosthesis sends
+// (config_snapshot.h), and a dump of a snapshot.
+//
+// Build from this folder:
+//   make config_snapshot_tool
+// Convert a config (what the mock does at boot with its config.yaml):
+//   ./config_snapshot_tool ../../Assests/example_hand_configuration.yaml config.bin
+// Show what a snapshot holds (e.g. one read back from the prosthesis' SPIFFS):
+//   ./config_snapshot_tool -d config.bin
+//
+// The converter reports what did not fit the model's limits (config_model.h);
+// those entries are not in the snapshot, as they would not be in the model.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "ProsthesisProtocol.h"
+
+static struct config_model model;   // static: the model is a few KB
+
+static bool read_all(const char* path, std::vector<uint8_t>* out){
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    out->insert(out->end(), chunk, chunk + n);
+  }
+  fclose(f);
+  return true;
+}
+
+static int convert(const char* yaml_path, const char* out_path){
+  std::vector<uint8_t> yaml;
+  if (!read_all(yaml_path, &yaml)) {
+    return 1;
+  }
+  struct config_parse_result result;
+  config_model_reset(&model);
+  int entries = config_model_load(&model, (const char*)yaml.data(), yaml.size(), &result);
+  if (result.skipped_lines > 0) {
+    fprintf(stderr, "%s: skipped %u malformed lines, the first is line %u\n", yaml_path, result.skipped_lines, result.first_skipped_line);
+  }
+  if (model.dropped > 0) {
+    fprintf(stderr, "%s: %u entries, parameters, pins or strings did not fit the model and are left out\n", yaml_path, model.dropped);
+  }
+  std::vector<uint8_t> snapshot(config_snapshot_size(&model));
+  uint32_t digest = config_digest(yaml.data(), yaml.size());
+  size_t len = config_snapshot_encode(&model, digest, snapshot.data(), snapshot.size());
+  FILE* f = fopen(out_path, "wb");
+  if (!f || fwrite(snapshot.data(), 1, len, f) != len) {
+    fprintf(stderr, "cannot write %s\n", out_path);
+    if (f) {
+      fclose(f);
+    }
+    return 1;
+  }
+  fclose(f);
+  printf("%s: %d entries, %zu bytes of YAML -> %s: %zu bytes (source digest %08x)\n",
+         yaml_path, entries, yaml.size(), out_path, len, digest);
+  return 0;
+}
+
+static int dump(const char* path){
+  std::vector<uint8_t> raw;
+  if (!read_all(path, &raw)) {
+    return 1;
+  }
+  std::vector<uint32_t> aligned((raw.size() + 3) / 4);   // config_snapshot_open() wants 4 byte alignment
+  memcpy(aligned.data(), raw.data(), raw.size());
+  struct config_snapshot v;
+  if (!config_snapshot_open((const uint8_t*)aligned.data(), raw.size(), &v)) {
+    fprintf(stderr, "%s: not a valid version %d snapshot\n", path, CONFIG_SNAPSHOT_VERSION);
+    return 1;
+  }
+  printf("%s: %u bytes, version %d, source digest %08x, %s\n", path, v.total_len, CONFIG_SNAPSHOT_VERSION,
+         v.source_digest, config_snapshot_str(&v, v.file_type));
+  printf("  %u strings in %u bytes\n", v.name_count, v.pool_len);
+  for (uint8_t i = 0; i < v.general_count; i++) {
+    printf("  general %-20s %d\n", config_snapshot_str(&v, v.general[i].name), v.general[i].code);
+  }
+  for (uint8_t i = 0; i < v.communication_count; i++) {
+    printf("  comm    %-20s %s\n", config_snapshot_str(&v, v.communications[i].name),
+           v.communications[i].status == CONFIG_STATUS_ON ? "on" : "off");
+  }
+  for (uint8_t i = 0; i < v.sensor_count; i++) {
+    const struct config_model_sensor* s = &v.sensors[i];
+    printf("  sensor  %-20s %-3s %s, %s:", config_snapshot_str(&v, s->name), s->status == CONFIG_STATUS_ON ? "on" : "off",
+           config_snapshot_str(&v, s->type), config_snapshot_str(&v, s->function_name));
+    for (uint8_t p = 0; p < s->param_count; p++) {
+      const struct config_model_param* param = &v.params[s->first_param + p];
+      printf(" %s=%d [%d,%d]%s", config_snapshot_str(&v, param->name), param->current_val, param->min, param->max,
+             param->modify_permission ? "" : " ro");
+    }
+    printf("\n");
+  }
+  for (uint8_t i = 0; i < v.motor_count; i++) {
+    const struct config_model_motor* motor = &v.motors[i];
+    printf("  motor   %-20s %s, threshold %d:", config_snapshot_str(&v, motor->name), config_snapshot_str(&v, motor->type),
+           motor->safety_threshold.current_val);
+    for (uint8_t p = 0; p < motor->pin_count; p++) {
+      const struct config_model_pin* pin = &v.pins[motor->first_pin + p];
+      printf(" %s=%d", config_snapshot_str(&v, pin->type), pin->pin_number);
+    }
+    printf("\n");
+  }
+  for (uint8_t i = 0; i < v.function_count; i++) {
+    printf("  func    %-20s %s\n", config_snapshot_str(&v, v.functions[i].name), config_snapshot_str(&v, v.functions[i].protocol_type));
+  }
+  return 0;
+}
+
+int main(int argc, char** argv){
+  if (argc == 3 && strcmp(argv[1], "-d") == 0) {
+    return dump(argv[2]);
+  }
+  if (argc == 3) {
+    return convert(argv[1], argv[2]);
+  }
+  fprintf(stderr, "usage: %s config.yaml config.bin\n       %s -d config.bin\n", argv[0], argv[0]);
+  return 2;
+}
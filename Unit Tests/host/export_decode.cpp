@@ -0,0 +1,357 @@
+// Host decoder of the binary telemetry export (serial_export.h): reads the stream
+// the prosthesis writes on its USB serial port after 'B' and turns it into a CSV
+// file, or into one raw file per column for numpy / pandas, and reports what was
+// lost on the way.
+//
+// Build from this folder:
+//   make export_decode
+// Capture straight from the prosthesis (switches it to the export and back):
+//   ./export_decode -d /dev/ttyUSB0 -s 60 -o capture.csv
+// Decode a capture saved with any serial tool (at SERIAL_EXPORT_BAUD):
+//   ./export_decode -o capture.csv capture.bin
+//   ./export_decode -c capture_columns capture.bin
+// Without -o or -c the CSV goes to stdout. Without a file (or with -) the
+// stream is read from stdin.
+//
+// The column files (-c dir) hold the rows back to back, little endian:
+//   dir/tick.u32, dir/t_us.u32, dir/sensor<id>.i16, dir/motor<id>.i16
+// and dir/columns.txt lists them with their type and the number of rows, e.g.
+//   numpy.fromfile("dir/sensor0.i16", dtype="<i2")
+//
+// Every sample frame is one row: the sampler tick, the prosthesis micros() of the
+// tick and one value per channel (sensors first, then motors). The channel names
+// come from the channel map the prosthesis repeats every second; rows before the
+// first map are named v0, v1... Rows whose channel count differs from the first
+// row (the prosthesis was restarted with another configuration) are counted and
+// left out.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "ProsthesisProtocol.h"
+
+#define LOG_BAUD B115200            // SERIAL_LOG_BAUD of the mock
+#define EXPORT_BAUD B921600         // SERIAL_EXPORT_BAUD of the mock
+#define READ_CHUNK 4096
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int){
+  stop_requested = 1;
+}
+
+struct decode_state {
+  FILE* csv;                        // NULL when writing columns
+  std::string column_dir;
+  std::vector<FILE*> columns;       // tick, t_us, then one per channel
+  std::vector<std::string> names;   // of the channels
+  bool have_map;
+  struct telemetry_channel map[EXPORT_MAX_VALUES];
+  uint8_t map_count;
+  uint16_t rate_hz;
+  int row_count;                    // values per row, -1 before the first row
+  uint64_t rows;
+  uint64_t other_count;             // rows left out, other channel count
+  uint32_t maps;
+  bool first;
+  uint32_t first_tick;
+  uint32_t last_tick;
+};
+
+static std::string channel_name(const struct telemetry_channel& ch){
+  char name[16];
+  snprintf(name, sizeof(name), "%s%d", ch.is_motor ? "motor" : "sensor", ch.id);
+  return name;
+}
+
+static FILE* open_column(struct decode_state* st, const std::string& name){
+  std::string path = st->column_dir + "/" + name;
+  FILE* f = fopen(path.c_str(), "wb");
+  if (!f) {
+    fprintf(stderr, "cannot write %s: %s\n", path.c_str(), strerror(errno));
+    exit(1);
+  }
+  return f;
+}
+
+// Names the columns after the first row; from the channel map if it matches.
+static void start_rows(struct decode_state* st, int count){
+  st->row_count = count;
+  for (int i = 0; i < count; i++) {
+    if (st->have_map && st->map_count == count) {
+      st->names.push_back(channel_name(st->map[i]));
+    } else {
+      char name[8];
+      snprintf(name, sizeof(name), "v%d", i);
+      st->names.push_back(name);
+    }
+  }
+  if (st->csv) {
+    fprintf(st->csv, "tick,t_us");
+    for (size_t i = 0; i < st->names.size(); i++) {
+      fprintf(st->csv, ",%s", st->names[i].c_str());
+    }
+    fprintf(st->csv, "\n");
+    return;
+  }
+  st->columns.push_back(open_column(st, "tick.u32"));
+  st->columns.push_back(open_column(st, "t_us.u32"));
+  for (size_t i = 0; i < st->names.size(); i++) {
+    st->columns.push_back(open_column(st, st->names[i] + ".i16"));
+  }
+}
+
+static void put_le(FILE* f, uint32_t v, int bytes){
+  uint8_t b[4];
+  for (int i = 0; i < bytes; i++) {
+    b[i] = (uint8_t)(v >> (8 * i));
+  }
+  fwrite(b, 1, bytes, f);
+}
+
+static void on_frame(const struct export_frame* frame, void* ctx){
+  struct decode_state* st = (struct decode_state*)ctx;
+  if (frame->type == EXPORT_CHANNELS) {
+    st->have_map = true;
+    st->map_count = frame->count;
+    st->rate_hz = (uint16_t)frame->t_us;
+    memcpy(st->map, frame->channels, sizeof(st->map));
+    st->maps++;
+    return;
+  }
+  if (st->row_count < 0) {
+    start_rows(st, frame->count);
+  }
+  if (frame->count != st->row_count) {
+    st->other_count++;
+    return;
+  }
+  if (!st->first) {
+    st->first = true;
+    st->first_tick = frame->seq;
+  }
+  st->last_tick = frame->seq;
+  st->rows++;
+  if (st->csv) {
+    fprintf(st->csv, "%u,%u", frame->seq, frame->t_us);
+    for (int i = 0; i < frame->count; i++) {
+      fprintf(st->csv, ",%d", frame->values[i]);
+    }
+    fprintf(st->csv, "\n");
+    return;
+  }
+  put_le(st->columns[0], frame->seq, 4);
+  put_le(st->columns[1], frame->t_us, 4);
+  for (int i = 0; i < frame->count; i++) {
+    put_le(st->columns[2 + i], (uint16_t)frame->values[i], 2);
+  }
+}
+
+static void write_column_index(const struct decode_state* st){
+  std::string path = st->column_dir + "/columns.txt";
+  FILE* f = fopen(path.c_str(), "w");
+  if (!f) {
+    fprintf(stderr, "cannot write %s: %s\n", path.c_str(), strerror(errno));
+    return;
+  }
+  fprintf(f, "# column file type rows (little endian, rows back to back)\n");
+  fprintf(f, "tick tick.u32 uint32 %llu\n", (unsigned long long)st->rows);
+  fprintf(f, "t_us t_us.u32 uint32 %llu\n", (unsigned long long)st->rows);
+  for (size_t i = 0; i < st->names.size(); i++) {
+    fprintf(f, "%s %s.i16 int16 %llu\n", st->names[i].c_str(), st->names[i].c_str(), (unsigned long long)st->rows);
+  }
+  if (st->rate_hz) {
+    fprintf(f, "# sampled at %u Hz\n", st->rate_hz);
+  }
+  fclose(f);
+}
+
+static bool set_baud(int fd, speed_t baud){
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0) {
+    return false;
+  }
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 2;              // read() returns after 200 ms without data
+  cfsetispeed(&tio, baud);
+  cfsetospeed(&tio, baud);
+  return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+// Asks the prosthesis for the export at the log baud rate, then follows it to the export baud rate.
+static int open_device(const char* path){
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+  if (!set_baud(fd, LOG_BAUD)) {
+    fprintf(stderr, "%s is not a serial port\n", path);
+    exit(1);
+  }
+  const char start = 'B';
+  if (write(fd, &start, 1) != 1) {
+    fprintf(stderr, "cannot write to %s\n", path);
+    exit(1);
+  }
+  tcdrain(fd);
+  usleep(50000);                    // the announcement goes out at the old rate
+  set_baud(fd, EXPORT_BAUD);
+  tcflush(fd, TCIFLUSH);
+  return fd;
+}
+
+static void close_device(int fd){
+  const char stop = 'T';
+  if (write(fd, &stop, 1) == 1) {
+    tcdrain(fd);
+  }
+  close(fd);
+}
+
+static double now_s(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(){
+  fprintf(stderr,
+          "usage: export_decode [-o out.csv | -c column_dir] [file | -]\n"
+          "       export_decode -d /dev/ttyUSB0 [-s seconds] [-o out.csv | -c column_dir]\n");
+  exit(2);
+}
+
+int main(int argc, char** argv){
+  const char* csv_path = NULL;
+  const char* column_dir = NULL;
+  const char* device = NULL;
+  double seconds = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:c:d:s:")) != -1) {
+    switch (opt) {
+      case 'o': csv_path = optarg; break;
+      case 'c': column_dir = optarg; break;
+      case 'd': device = optarg; break;
+      case 's': seconds = atof(optarg); break;
+      default: usage();
+    }
+  }
+  if ((csv_path && column_dir) || (device && optind < argc) || optind + 1 < argc) {
+    usage();
+  }
+
+  struct decode_state st;
+  st.csv = stdout;
+  st.have_map = false;
+  st.map_count = 0;
+  st.rate_hz = 0;
+  st.row_count = -1;
+  st.rows = 0;
+  st.other_count = 0;
+  st.maps = 0;
+  st.first = false;
+  st.first_tick = 0;
+  st.last_tick = 0;
+  if (csv_path) {
+    st.csv = fopen(csv_path, "w");
+    if (!st.csv) {
+      fprintf(stderr, "cannot write %s: %s\n", csv_path, strerror(errno));
+      return 1;
+    }
+  } else if (column_dir) {
+    st.csv = NULL;
+    st.column_dir = column_dir;
+    if (mkdir(column_dir, 0755) != 0 && errno != EEXIST) {
+      fprintf(stderr, "cannot create %s: %s\n", column_dir, strerror(errno));
+      return 1;
+    }
+  }
+
+  int fd = 0;
+  if (device) {
+    fd = open_device(device);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    fprintf(stderr, "capturing from %s%s\n", device, seconds > 0 ? "" : ", Ctrl-C to stop");
+  } else if (optind < argc && strcmp(argv[optind], "-") != 0) {
+    fd = open(argv[optind], O_RDONLY);
+    if (fd < 0) {
+      fprintf(stderr, "cannot open %s: %s\n", argv[optind], strerror(errno));
+      return 1;
+    }
+  }
+
+  struct export_decoder decoder;
+  export_decoder_reset(&decoder);
+  uint8_t chunk[READ_CHUNK];
+  uint64_t bytes = 0;
+  double start = now_s();
+  while (!stop_requested) {
+    if (device && seconds > 0 && now_s() - start >= seconds) {
+      break;
+    }
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      fprintf(stderr, "read failed: %s\n", strerror(errno));
+      break;
+    }
+    if (n == 0 && !device) {
+      break;
+    }
+    bytes += n;
+    export_decoder_feed(&decoder, chunk, n, on_frame, &st);
+  }
+  double elapsed = now_s() - start;
+  if (device) {
+    close_device(fd);
+  } else if (fd != 0) {
+    close(fd);
+  }
+
+  if (st.csv && st.csv != stdout) {
+    fclose(st.csv);
+  }
+  for (size_t i = 0; i < st.columns.size(); i++) {
+    fclose(st.columns[i]);
+  }
+  if (column_dir) {
+    write_column_index(&st);
+  }
+
+  uint64_t expected = (uint64_t)decoder.frames + decoder.dropped;
+  fprintf(stderr, "%llu bytes, %u channel maps", (unsigned long long)bytes, st.maps);
+  if (st.rate_hz) {
+    fprintf(stderr, " (%u Hz)", st.rate_hz);
+  }
+  fprintf(stderr, "\n%llu rows of %d channels", (unsigned long long)st.rows, st.row_count < 0 ? 0 : st.row_count);
+  if (st.first) {
+    fprintf(stderr, ", ticks %u..%u", st.first_tick, st.last_tick);
+  }
+  fprintf(stderr, "\ndropped %u frames (%.3f%%), %u CRC errors, %u bytes skipped",
+          decoder.dropped, expected ? 100.0 * decoder.dropped / expected : 0.0, decoder.crc_errors, decoder.skipped_bytes);
+  if (st.other_count) {
+    fprintf(stderr, ", %llu rows with another channel count left out", (unsigned long long)st.other_count);
+  }
+  fprintf(stderr, "\n");
+  if (device && elapsed > 0) {
+    fprintf(stderr, "%.1f s, %.0f frames/s, %.1f KB/s\n", elapsed, decoder.frames / elapsed, bytes / elapsed / 1000);
+  }
+  return 0;
+}
@@ -0,0 +1,2539 @@
+// Host benchmark for the BLE message protocol shared by the management screen
+// and the mock prosthesis. Runs on Linux, no Arduino headers needed.
+//
+// Build and run from this folder (see Makefile):
+//   make bench
+//   (Linux/glibc only: the heap allocation counter wraps glibc malloc)
+//   ./protocol_bench [path/to/hand_configuration.yaml]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <malloc.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ProsthesisProtocol.h"
+
+// Heap allocation counter: glibc's malloc is wrapped so every allocation made
+// while count_allocs is set (by the protocol code or by the bench) is counted.
+// heap_live follows malloc and free (usable sizes) while counting, heap_peak is
+// its highest value; realloc and calloc are not followed.
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void __libc_free(void* ptr);
+static bool count_allocs = false;
+static size_t heap_allocs = 0;
+static long heap_live = 0;
+static long heap_peak = 0;
+extern "C" void* malloc(size_t size){
+  void* ptr = __libc_malloc(size);
+  if (count_allocs) {
+    heap_allocs++;
+    heap_live += (long)malloc_usable_size(ptr);
+    heap_peak = std::max(heap_peak, heap_live);
+  }
+  return ptr;
+}
+extern "C" void free(void* ptr){
+  if (count_allocs && ptr != NULL) {
+    heap_live -= (long)malloc_usable_size(ptr);
+  }
+  __libc_free(ptr);
+}
+
+static void start_heap_count(){
+  heap_allocs = 0;
+  heap_live = 0;
+  heap_peak = 0;
+  count_allocs = true;
+}
+
+#define DEFAULT_YAML_PATH "../../Assests/example_hand_configuration.yaml"
+#define YAML_PARSER_PATH "../../ESP32/Mock_Prosthesis/shared_yaml_parser.h"
+
+// struct msg_interp (com_vars.h) as it was sent before, as one fixed size frame.
+struct legacy_msg_interp {
+  int req_type;
+  int cur_msg_count;
+  int tot_msg_count;
+  int msg_length;
+  char msg[128];
+  int checksum;
+};
+#define LEGACY_FRAME_LEN sizeof(struct legacy_msg_interp)
+#define LEGACY_STRIDE 127
+
+// BLE 4.x link layer model, 1M PHY, no data length extension:
+// every ATT value goes out in 27 byte LL PDUs, each acknowledged by an empty PDU.
+#define ATT_L2CAP_OVERHEAD 7   // 3 bytes ATT opcode/handle + 4 bytes L2CAP header
+#define LL_MAX_PAYLOAD 27
+#define LL_DLE_MAX_PAYLOAD 251 // with the BLE 4.2 data length extension
+#define LL_PDU_OVERHEAD 10     // preamble + access address + header + crc
+#define LL_T_IFS_US 150
+
+static double now_us(){
+  using namespace std::chrono;
+  return duration_cast<duration<double, std::micro>>(steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string read_file(const char* path){
+  std::string content;
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    exit(1);
+  }
+  char chunk[1024];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    content.append(chunk, n);
+  }
+  fclose(f);
+  return content;
+}
+
+// Airtime of one notification/write carrying att_value_len bytes.
+static double ble_airtime_us(size_t att_value_len, size_t ll_max_payload = LL_MAX_PAYLOAD){
+  size_t l2cap_len = att_value_len + ATT_L2CAP_OVERHEAD;
+  double airtime = 0;
+  while (l2cap_len > 0) {
+    size_t pdu = l2cap_len > ll_max_payload ? ll_max_payload : l2cap_len;
+    airtime += (LL_PDU_OVERHEAD + pdu) * 8 + LL_T_IFS_US + LL_PDU_OVERHEAD * 8 + LL_T_IFS_US;
+    l2cap_len -= pdu;
+  }
+  return airtime;
+}
+
+// Same section boundaries as splitYaml() in shared_yaml_parser.h.
+static std::vector<std::string> split_sections(const std::string& yaml){
+  const char* keys[] = {"general:", "sensors:", "motors:", "functions:"};
+  std::vector<std::string> sections;
+  for (int i = 0; i < 4; i++) {
+    size_t start = yaml.find(keys[i]);
+    if (start == std::string::npos) {
+      continue;
+    }
+    size_t end = (i < 3) ? yaml.find(keys[i + 1], start) : std::string::npos;
+    sections.push_back(yaml.substr(start, end == std::string::npos ? std::string::npos : end - start));
+  }
+  return sections;
+}
+
+struct link_totals {
+  size_t frames;
+  size_t bytes;
+  double airtime_us;
+};
+
+static void add_legacy_msg(struct link_totals* t, size_t msg_len){
+  uint16_t frags = wire_frag_count(msg_len, LEGACY_STRIDE);
+  t->frames += frags;
+  t->bytes += frags * LEGACY_FRAME_LEN;
+  t->airtime_us += frags * ble_airtime_us(LEGACY_FRAME_LEN);
+}
+
+static void add_compact_msg(struct link_totals* t, size_t msg_len, size_t stride, size_t ll_max_payload = LL_MAX_PAYLOAD){
+  uint16_t frags = wire_frag_count(msg_len, stride);
+  for (uint16_t i = 0; i < frags; i++) {
+    size_t chunk = (msg_len - i * stride) < stride ? (msg_len - i * stride) : stride;
+    t->frames++;
+    t->bytes += WIRE_FRAME_HDR_LEN + chunk;
+    t->airtime_us += ble_airtime_us(WIRE_FRAME_HDR_LEN + chunk, ll_max_payload);
+  }
+}
+
+static void print_totals(const char* name, const struct link_totals* t){
+  printf("  %-10s frames: %6zu  bytes on air: %8zu  airtime: %9.1f ms\n",
+         name, t->frames, t->bytes, t->airtime_us / 1000.0);
+}
+
+static void bench_framing(const std::string& yaml){
+  printf("== Compact framing ==\n");
+  std::vector<std::string> sections = split_sections(yaml);
+
+  // Full YAML transfer: one request + one fragmented answer per section.
+  struct link_totals legacy = {0, 0, 0};
+  struct link_totals compact = {0, 0, 0};
+  const char* request_text = "Please send Motors data";
+  for (size_t i = 0; i < sections.size(); i++) {
+    add_legacy_msg(&legacy, strlen(request_text));
+    add_compact_msg(&compact, strlen(request_text), WIRE_FRAME_MAX_PAYLOAD);
+    add_legacy_msg(&legacy, sections[i].size());
+    add_compact_msg(&compact, sections[i].size(), WIRE_FRAME_MAX_PAYLOAD);
+  }
+  printf("Full YAML transfer (%zu bytes, %zu sections):\n", yaml.size(), sections.size());
+  print_totals("legacy", &legacy);
+  print_totals("compact", &compact);
+
+  // 5 Hz debug chart: READ_REQ "is_motor|id" and READ_ANS "is_motor|id|value" for one minute.
+  struct link_totals legacy_read = {0, 0, 0};
+  struct link_totals compact_read = {0, 0, 0};
+  for (int tick = 0; tick < 5 * 60; tick++) {
+    add_legacy_msg(&legacy_read, strlen("0|3"));
+    add_compact_msg(&compact_read, strlen("0|3"), WIRE_FRAME_MAX_PAYLOAD);
+    add_legacy_msg(&legacy_read, strlen("0|3|42"));
+    add_compact_msg(&compact_read, strlen("0|3|42"), WIRE_FRAME_MAX_PAYLOAD);
+  }
+  printf("5 Hz READ_REQ/READ_ANS session, 60 s:\n");
+  print_totals("legacy", &legacy_read);
+  print_totals("compact", &compact_read);
+  printf("  airtime per READ round trip: legacy %.0f us, compact %.0f us\n",
+         (ble_airtime_us(LEGACY_FRAME_LEN) * 2), ble_airtime_us(WIRE_FRAME_HDR_LEN + 3) + ble_airtime_us(WIRE_FRAME_HDR_LEN + 6));
+
+  // Codec cost: encode + decode every fragment of the YAML many times.
+  uint8_t frame[WIRE_FRAME_MAX_LEN];
+  struct wire_frame decoded;
+  const int rounds = 20000;
+  size_t frames = 0;
+  uint32_t sink = 0;
+  double start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    uint16_t frags = wire_frag_count(yaml.size(), WIRE_FRAME_MAX_PAYLOAD);
+    for (uint16_t i = 0; i < frags; i++) {
+      size_t offset = i * WIRE_FRAME_MAX_PAYLOAD;
+      size_t chunk = (yaml.size() - offset) < WIRE_FRAME_MAX_PAYLOAD ? (yaml.size() - offset) : WIRE_FRAME_MAX_PAYLOAD;
+      size_t len = wire_frame_encode(frame, sizeof(frame), 14, (uint8_t)r, i + 1, frags,
+                                     (const uint8_t*)yaml.data() + offset, (uint16_t)chunk);
+      if (wire_frame_decode(frame, len, &decoded) != WIRE_OK) {
+        fprintf(stderr, "decode failed\n");
+        exit(1);
+      }
+      sink += decoded.payload_len;
+      frames++;
+    }
+  }
+  double elapsed = now_us() - start;
+  printf("Codec: %zu frames encoded+decoded in %.1f ms -> %.0f frames/s (%u)\n\n",
+         frames, elapsed / 1000.0, frames / (elapsed / 1e6), (unsigned)(sink & 1));
+}
+
+// Sends msg through wire_frag_encode + wire_reasm_push and checks it comes out unchanged.
+static bool reassembly_round_trip(const std::string& msg, size_t stride){
+  struct wire_reassembler reasm;
+  memset(&reasm, 0, sizeof(reasm));
+  uint8_t frame[WIRE_FRAME_MAX_LEN];
+  struct wire_frame decoded;
+  uint16_t frags = wire_frag_count(msg.size(), stride);
+  int status = WIRE_REASM_ERROR;
+  for (uint16_t i = 1; i <= frags; i++) {
+    size_t len = wire_frag_encode(frame, sizeof(frame), 14, 7, (const uint8_t*)msg.data(), msg.size(), stride, i);
+    if (len == 0 || wire_frame_decode(frame, len, &decoded) != WIRE_OK) {
+      return false;
+    }
+    status = wire_reasm_push(&reasm, &decoded, 0);
+    if (status == WIRE_REASM_ERROR) {
+      return false;
+    }
+  }
+  size_t out_len = 0;
+  uint8_t* out = wire_reasm_take(&reasm, &out_len);
+  bool ok = status == WIRE_REASM_DONE && out != NULL && out_len == msg.size() &&
+            memcmp(out, msg.data(), out_len) == 0 && out[out_len] == '\0';
+  free(out);
+  wire_reasm_reset(&reasm);
+  return ok;
+}
+
+// Fragment count and modelled transfer time of the YAML download for every ATT MTU.
+static void bench_mtu_sweep(const std::string& yaml){
+  printf("== MTU sweep (YAML download, 4 requests + 4 sections) ==\n");
+  std::vector<std::string> sections = split_sections(yaml);
+  const char* request_text = "Please send Motors data";
+  const uint16_t mtus[] = {23, 27, 32, 48, 64, 100, 128, 158, 185, 247, 251, 300, 400, 512, 517};
+  printf("  %5s %7s %10s %10s %14s %14s %s\n", "MTU", "stride", "fragments", "bytes", "airtime LL27", "airtime DLE", "round trip");
+  for (size_t m = 0; m < sizeof(mtus) / sizeof(mtus[0]); m++) {
+    size_t stride = wire_frag_payload_size(mtus[m]);
+    struct link_totals plain = {0, 0, 0};
+    struct link_totals dle = {0, 0, 0};
+    bool ok = true;
+    for (size_t i = 0; i < sections.size(); i++) {
+      add_compact_msg(&plain, strlen(request_text), stride);
+      add_compact_msg(&dle, strlen(request_text), stride, LL_DLE_MAX_PAYLOAD);
+      add_compact_msg(&plain, sections[i].size(), stride);
+      add_compact_msg(&dle, sections[i].size(), stride, LL_DLE_MAX_PAYLOAD);
+      ok = ok && reassembly_round_trip(sections[i], stride);
+    }
+    printf("  %5u %7zu %10zu %10zu %11.1f ms %11.1f ms %s\n", mtus[m], stride, plain.frames, plain.bytes,
+           plain.airtime_us / 1000.0, dle.airtime_us / 1000.0, ok ? "ok" : "FAILED");
+    if (!ok) {
+      exit(1);
+    }
+  }
+  printf("\n");
+}
+
+// The one byte XOR checksum the frames used before the CRC.
+static uint8_t xor_checksum(const uint8_t* data, size_t length){
+  uint8_t checksum = 0;
+  for (size_t i = 0; i < length; ++i) {
+    checksum ^= data[i];
+  }
+  return checksum;
+}
+
+// Bit at a time reference for wire_crc16.
+static uint16_t crc16_bitwise(const uint8_t* data, size_t length){
+  uint16_t crc = WIRE_CRC16_INIT;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)(data[i] << 8);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ WIRE_CRC16_POLY) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// Small deterministic PRNG so every run corrupts the same bits.
+static uint32_t rng_state = 0x12345678;
+static uint32_t rng_next(){
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+enum corruption_kind { SINGLE_BIT, TWO_BITS, BURST_16, BYTE_SWAP, RANDOM_BYTES, CORRUPTION_KINDS };
+static const char* corruption_names[] = {"1 bit flip", "2 bit flips", "burst <= 16 bit", "adjacent byte swap", "2-4 random bytes"};
+
+// Applies one error of the given kind to buf. Returns false if the buffer did not change.
+static bool corrupt(std::vector<uint8_t>& buf, int kind){
+  std::vector<uint8_t> before = buf;
+  size_t n = buf.size();
+  switch (kind) {
+    case SINGLE_BIT:
+      buf[rng_next() % n] ^= (uint8_t)(1 << (rng_next() % 8));
+      break;
+    case TWO_BITS: {
+      size_t a = rng_next() % (n * 8);
+      size_t b = rng_next() % (n * 8);
+      buf[a / 8] ^= (uint8_t)(1 << (a % 8));
+      buf[b / 8] ^= (uint8_t)(1 << (b % 8));
+      break;
+    }
+    case BURST_16: {
+      size_t len = 2 + rng_next() % 15;   // first and last bit of the burst are flipped
+      size_t start = rng_next() % (n * 8 - len + 1);
+      for (size_t i = 0; i < len; i++) {
+        if (i == 0 || i == len - 1 || (rng_next() & 1)) {
+          buf[(start + i) / 8] ^= (uint8_t)(0x80 >> ((start + i) % 8));
+        }
+      }
+      break;
+    }
+    case BYTE_SWAP: {
+      size_t i = rng_next() % (n - 1);
+      uint8_t tmp = buf[i];
+      buf[i] = buf[i + 1];
+      buf[i + 1] = tmp;
+      break;
+    }
+    case RANDOM_BYTES: {
+      int count = 2 + rng_next() % 3;
+      for (int i = 0; i < count; i++) {
+        buf[rng_next() % n] = (uint8_t)rng_next();
+      }
+      break;
+    }
+  }
+  return buf != before;
+}
+
+static void bench_crc(const std::string& yaml){
+  printf("== Integrity check: XOR checksum vs CRC-16/CCITT ==\n");
+  const uint8_t* check = (const uint8_t*)"123456789";
+  if (wire_crc16(check, 9) != 0x29B1) {
+    fprintf(stderr, "wire_crc16 check value mismatch: 0x%04X\n", wire_crc16(check, 9));
+    exit(1);
+  }
+  for (size_t len = 0; len < 600; len++) {
+    size_t offset = len % 7;
+    if (wire_crc16((const uint8_t*)yaml.data() + offset, len) != crc16_bitwise((const uint8_t*)yaml.data() + offset, len)) {
+      fprintf(stderr, "wire_crc16 differs from the bitwise reference at length %zu\n", len);
+      exit(1);
+    }
+  }
+  printf("  check(\"123456789\") = 0x29B1, slice-by-4 matches the bitwise reference\n");
+
+  // Throughput over the whole YAML, repeated.
+  const int rounds = 20000;
+  const uint8_t* data = (const uint8_t*)yaml.data();
+  uint32_t sink = 0;
+  double start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    sink += xor_checksum(data, yaml.size() - (r & 1));
+  }
+  double xor_us = now_us() - start;
+  start = now_us();
+  for (int r = 0; r < rounds / 10; r++) {
+    sink += crc16_bitwise(data, yaml.size() - (r & 1));
+  }
+  double bitwise_us = (now_us() - start) * 10;
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    sink += wire_crc16(data, yaml.size() - (r & 1));
+  }
+  double slice_us = now_us() - start;
+  double total_mb = (double)yaml.size() * rounds / 1e6;
+  printf("  throughput: XOR %.0f MB/s, CRC bitwise %.0f MB/s, CRC slice-by-4 %.0f MB/s (%u)\n",
+         total_mb / (xor_us / 1e6), total_mb / (bitwise_us / 1e6), total_mb / (slice_us / 1e6), sink & 1);
+
+  // Corruption detection on real fragments of the YAML at the default and the max MTU.
+  const size_t strides[] = {wire_frag_payload_size(WIRE_DEFAULT_MTU), wire_frag_payload_size(WIRE_MAX_MTU)};
+  const int trials = 100000;
+  for (size_t s = 0; s < 2; s++) {
+    size_t stride = strides[s];
+    printf("  undetected errors out of %d corrupted %zu byte payloads:\n", trials, stride);
+    for (int kind = 0; kind < CORRUPTION_KINDS; kind++) {
+      size_t xor_miss = 0;
+      size_t crc_miss = 0;
+      int done = 0;
+      while (done < trials) {
+        size_t offset = (rng_next() % (yaml.size() - stride));
+        std::vector<uint8_t> payload(data + offset, data + offset + stride);
+        uint8_t xor_sent = xor_checksum(payload.data(), payload.size());
+        uint16_t crc_sent = wire_crc16(payload.data(), payload.size());
+        if (!corrupt(payload, kind)) {
+          continue;
+        }
+        done++;
+        xor_miss += xor_checksum(payload.data(), payload.size()) == xor_sent;
+        crc_miss += wire_crc16(payload.data(), payload.size()) == crc_sent;
+      }
+      printf("    %-20s XOR %6zu (%6.2f%%)   CRC-16 %6zu (%5.3f%%)\n", corruption_names[kind],
+             xor_miss, 100.0 * xor_miss / trials, crc_miss, 100.0 * crc_miss / trials);
+    }
+  }
+  printf("\n");
+}
+
+// Send loop as it was before the TX pool: scratch string and every fragment on the heap.
+static size_t send_heap(int req_type, const char* text, size_t stride){
+  char* scratch = (char*)malloc(MAX_MSG_LEN);
+  snprintf(scratch, MAX_MSG_LEN, "%s", text);
+  size_t msg_len = strlen(scratch);
+  uint16_t frags = wire_frag_count(msg_len, stride);
+  size_t sent = 0;
+  for (uint16_t i = 1; i <= frags; i++) {
+    size_t chunk = (msg_len - (i - 1) * stride) < stride ? (msg_len - (i - 1) * stride) : stride;
+    uint8_t* frame = (uint8_t*)malloc(WIRE_FRAME_HDR_LEN + chunk);
+    sent += wire_frag_encode(frame, WIRE_FRAME_HDR_LEN + chunk, req_type, 1, (const uint8_t*)scratch, msg_len, stride, i);
+    free(frame);
+  }
+  free(scratch);
+  return sent;
+}
+
+// Current send loop: scratch string and one frame buffer on the stack.
+static size_t send_stacked(int req_type, const char* text, size_t stride){
+  char scratch[MAX_MSG_LEN];
+  snprintf(scratch, MAX_MSG_LEN, "%s", text);
+  size_t msg_len = strlen(scratch);
+  uint16_t frags = wire_frag_count(msg_len, stride);
+  size_t sent = 0;
+  uint8_t frame[WIRE_FRAME_MAX_LEN];
+  for (uint16_t i = 1; i <= frags; i++) {
+    sent += wire_frag_encode(frame, WIRE_FRAME_MAX_LEN, req_type, 1, (const uint8_t*)scratch, msg_len, stride, i);
+  }
+  return sent;
+}
+
+static void measure_tx(const char* name, const char* text, size_t stride){
+  const int rounds = 200000;
+  size_t sink = 0;
+  size_t (*senders[2])(int, const char*, size_t) = {send_heap, send_stacked};
+  size_t allocs[2];
+  double ns[2];
+  for (int k = 0; k < 2; k++) {
+    heap_allocs = 0;
+    count_allocs = true;
+    double start = now_us();
+    for (int r = 0; r < rounds; r++) {
+      sink += senders[k](0, text, stride);
+    }
+    ns[k] = (now_us() - start) * 1000.0 / rounds;
+    count_allocs = false;
+    allocs[k] = heap_allocs;
+  }
+  printf("  %-28s heap allocs/op: %5.2f -> %4.2f   time/op: %6.1f ns -> %6.1f ns (%zu)\n", name,
+         (double)allocs[0] / rounds, (double)allocs[1] / rounds, ns[0], ns[1], sink & 1);
+}
+
+static void bench_tx_allocations(){
+  printf("== Transmit path heap allocations (before: malloc per fragment, after: stack buffer) ==\n");
+  measure_tx("READ_REQ chart tick", "0|3", wire_frag_payload_size(WIRE_MAX_MTU));
+  measure_tx("READ_ANS chart tick", "0|3|42", wire_frag_payload_size(WIRE_MAX_MTU));
+  measure_tx("SENSOR_PARAM_REQ, MTU 517", "2|0|10|2|1|250|2|2|75|2|3|1", wire_frag_payload_size(WIRE_MAX_MTU));
+  measure_tx("SENSOR_PARAM_REQ, MTU 23", "2|0|10|2|1|250|2|2|75|2|3|1", wire_frag_payload_size(WIRE_DEFAULT_MTU));
+  const size_t chart_ticks = 5 * 60 * 60;
+  printf("  1 h debug chart at 5 Hz (READ_REQ + READ_ANS): %zu malloc/free pairs before, 0 after\n\n", chart_ticks * 2 * 2);
+}
+
+// Parameter / state changes: text "id|param|value" requests (one per entity, each
+// answered before the next is sent) vs one BATCH_CMD_REQ carrying all of them.
+struct change_cmd {
+  uint8_t kind;
+  uint8_t id;
+  uint8_t param;
+  int32_t value;
+};
+
+// Text encoder as the screen had it (append_msg_field with snprintf), one entity per message.
+static size_t encode_text(char* msg, const struct change_cmd* cmds, size_t count){
+  int pos = 0;
+  msg[0] = '\0';
+  for (size_t i = 0; i < count; i++) {
+    const struct change_cmd* c = &cmds[i];
+    int written;
+    if (c->kind == BATCH_SENSOR_PARAM) {
+      written = snprintf(&msg[pos], MAX_MSG_LEN - pos, "%s%d|%d|%d", pos > 0 ? "|" : "", c->id, c->param, c->value);
+    } else {
+      written = snprintf(&msg[pos], MAX_MSG_LEN - pos, "%s%d|%d", pos > 0 ? "|" : "", c->id, c->value);
+    }
+    if (written < 0 || pos + written >= MAX_MSG_LEN) {
+      return 0;
+    }
+    pos += written;
+  }
+  return pos;
+}
+
+// Text decoder as the mock had it: copy, strtok, atoi. Returns the sum of the values.
+static long decode_text(const char* msg, int fields_per_cmd){
+  char copy[MAX_MSG_LEN];
+  strcpy(copy, msg);
+  long sum = 0;
+  int i = 0;
+  for (char* tok = strtok(copy, "|"); tok != NULL; tok = strtok(NULL, "|")) {
+    int v = atoi(tok);
+    if (i % fields_per_cmd == fields_per_cmd - 1) {
+      sum += v;
+    }
+    i++;
+  }
+  return sum;
+}
+
+static size_t encode_batch(uint8_t* buf, size_t cap, const struct change_cmd* cmds, size_t count){
+  struct batch_cmd_writer w;
+  batch_cmd_begin(&w, buf, cap);
+  for (size_t i = 0; i < count; i++) {
+    if (!batch_cmd_add(&w, cmds[i].kind, cmds[i].id, cmds[i].param, cmds[i].value)) {
+      return 0;
+    }
+  }
+  return batch_cmd_len(&w);
+}
+
+static long decode_batch(const uint8_t* buf, size_t len){
+  struct batch_cmd_reader r;
+  struct batch_cmd cmd;
+  long sum = 0;
+  if (!batch_cmd_open(&r, buf, len)) {
+    return -1;
+  }
+  while (batch_cmd_next(&r, &cmd)) {
+    sum += cmd.value;
+  }
+  return sum;
+}
+
+// Groups cmds into the per-entity text messages the Tech / Daily tabs used to send.
+static std::vector<std::vector<struct change_cmd> > text_messages(const std::vector<struct change_cmd>& cmds){
+  std::vector<std::vector<struct change_cmd> > msgs;
+  for (size_t i = 0; i < cmds.size(); i++) {
+    bool same = !msgs.empty() && msgs.back()[0].kind == cmds[i].kind &&
+                (cmds[i].kind == BATCH_SENSOR_STATE || msgs.back()[0].id == cmds[i].id);
+    if (!same) {
+      msgs.push_back(std::vector<struct change_cmd>());
+    }
+    msgs.back().push_back(cmds[i]);
+  }
+  return msgs;
+}
+
+static void compare_batch(const char* name, const std::vector<struct change_cmd>& cmds){
+  const int rounds = 200000;
+  std::vector<std::vector<struct change_cmd> > msgs = text_messages(cmds);
+  char text[MAX_MSG_LEN];
+  uint8_t bin[MAX_MSG_LEN - 1];
+  size_t text_bytes = 0;
+  size_t frames_text[2] = {0, 0};
+  size_t frames_bin[2] = {0, 0};
+  const uint16_t mtus[2] = {WIRE_DEFAULT_MTU, WIRE_MAX_MTU};
+  for (size_t m = 0; m < msgs.size(); m++) {
+    size_t len = encode_text(text, &msgs[m][0], msgs[m].size());
+    text_bytes += len;
+    for (int k = 0; k < 2; k++) {
+      frames_text[k] += wire_frag_count(len, wire_frag_payload_size(mtus[k]));
+    }
+  }
+  size_t bin_len = encode_batch(bin, sizeof(bin), &cmds[0], cmds.size());
+  struct batch_cmd_reader reader;
+  struct batch_cmd decoded;
+  bool round_trip = batch_cmd_open(&reader, bin, bin_len);
+  while (round_trip && batch_cmd_next(&reader, &decoded)) {
+    const struct change_cmd* c = &cmds[reader.read - 1];
+    round_trip = decoded.kind == c->kind && decoded.id == c->id && decoded.param == c->param && decoded.value == c->value;
+  }
+  if (!round_trip || reader.read != cmds.size()) {
+    printf("  %s: BATCH ROUND TRIP FAILED\n", name);
+    return;
+  }
+  for (int k = 0; k < 2; k++) {
+    frames_bin[k] = wire_frag_count(bin_len, wire_frag_payload_size(mtus[k]));
+  }
+
+  long sink = 0;
+  double start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    for (size_t m = 0; m < msgs.size(); m++) {
+      encode_text(text, &msgs[m][0], msgs[m].size());
+      sink += text[0];
+    }
+  }
+  double text_enc = (now_us() - start) * 1000.0 / rounds;
+  std::vector<std::string> encoded;
+  for (size_t m = 0; m < msgs.size(); m++) {
+    encode_text(text, &msgs[m][0], msgs[m].size());
+    encoded.push_back(text);
+  }
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    for (size_t m = 0; m < msgs.size(); m++) {
+      sink += decode_text(encoded[m].c_str(), msgs[m][0].kind == BATCH_SENSOR_PARAM ? 3 : 2);
+    }
+  }
+  double text_dec = (now_us() - start) * 1000.0 / rounds;
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    sink += encode_batch(bin, sizeof(bin), &cmds[0], cmds.size());
+  }
+  double bin_enc = (now_us() - start) * 1000.0 / rounds;
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    sink += decode_batch(bin, bin_len);
+  }
+  double bin_dec = (now_us() - start) * 1000.0 / rounds;
+
+  printf("  %s: %zu commands\n", name, cmds.size());
+  printf("    text  %2zu requests %4zu B  frames MTU 23/517: %3zu/%2zu  encode %6.1f ns  decode %6.1f ns\n",
+         msgs.size(), text_bytes, frames_text[0], frames_text[1], text_enc, text_dec);
+  printf("    batch %2d request  %4zu B  frames MTU 23/517: %3zu/%2zu  encode %6.1f ns  decode %6.1f ns  (%ld)\n",
+         1, bin_len, frames_bin[0], frames_bin[1], bin_enc, bin_dec, sink & 1);
+}
+
+static void bench_batch_cmd(){
+  printf("== Change requests: text per entity vs one binary BATCH_CMD_REQ ==\n");
+  printf("  every request waits for its answer, so round trips = requests\n");
+  std::vector<struct change_cmd> one_sensor;
+  for (uint8_t p = 0; p < 3; p++) {
+    struct change_cmd c = {BATCH_SENSOR_PARAM, 2, p, (int32_t)(60 + 15 * p)};
+    one_sensor.push_back(c);
+  }
+  compare_batch("one sensor, 3 parameters", one_sensor);
+
+  std::vector<struct change_cmd> session;
+  for (uint8_t id = 0; id < 6; id++) {
+    struct change_cmd c = {BATCH_SENSOR_STATE, id, 0, id & 1};
+    session.push_back(c);
+  }
+  for (uint8_t id = 0; id < 4; id++) {
+    for (uint8_t p = 0; p < 3; p++) {
+      struct change_cmd c = {BATCH_SENSOR_PARAM, id, p, (int32_t)(20 + 10 * p + id)};
+      session.push_back(c);
+    }
+  }
+  for (uint8_t id = 0; id < 5; id++) {
+    struct change_cmd c = {BATCH_MOTOR_PARAM, id, 0, (int32_t)(25 - 20 * id)};
+    session.push_back(c);
+  }
+  compare_batch("session: 6 switches, 4 sensors x 3 params, 5 motors", session);
+  printf("\n");
+}
+
+// Config download model: time from the first request to the last YAML fragment.
+// Requests and acks wait for the next connection event; fragments are limited by airtime.
+#define CONN_INTERVAL_MS 15.0   // setConnectionParams(12, 12, ...) on the mock, 1.25 ms units
+#define YAML_READ_SPLIT_MS 12.0 // mock: readYAML() from SPIFFS + splitYaml(), per call (assumed)
+#define ESP32_SLOWDOWN 20.0     // CPU time on a 240 MHz ESP32 vs this host (assumed)
+
+// yaml_stream_window() with the window size as a parameter, for the sweep below.
+static int stream_window(size_t stride, size_t window_bytes){
+  int window = (int)(window_bytes / stride);
+  return window < 4 ? 4 : window;
+}
+
+static double next_conn_event(double t_ms){
+  return ((long)(t_ms / CONN_INTERVAL_MS) + 1) * CONN_INTERVAL_MS;
+}
+
+// Delivers the fragments of one message starting at start_ms. Returns when the last one arrives.
+static double send_fragments_ms(double start_ms, size_t msg_len, size_t stride){
+  uint16_t frags = wire_frag_count(msg_len, stride);
+  double t = start_ms;
+  for (uint16_t i = 0; i < frags; i++) {
+    size_t chunk = (msg_len - i * stride) < stride ? (msg_len - i * stride) : stride;
+    t += ble_airtime_us(WIRE_FRAME_HDR_LEN + chunk) / 1000.0;
+  }
+  return t;
+}
+
+// Today's scheme: one request per section, the mock reads and splits the file every time.
+static double lockstep_download_ms(const std::vector<std::string>& sections, size_t stride){
+  double t = 0;
+  for (size_t i = 0; i < sections.size(); i++) {
+    double request_arrives = next_conn_event(t) + ble_airtime_us(WIRE_FRAME_HDR_LEN + 24) / 1000.0;
+    t = send_fragments_ms(request_arrives + YAML_READ_SPLIT_MS, sections[i].size(), stride);
+  }
+  return t;
+}
+
+// One YAML_REQ, all sections back to back, at most `window` fragments ahead of the acks.
+// arrivals, if given, gets the time every fragment is in at the screen.
+static double streamed_download_ms(const std::vector<std::string>& sections, size_t stride, int window,
+                                   std::vector<double>* arrivals = NULL){
+  double request_arrives = next_conn_event(0) + ble_airtime_us(WIRE_FRAME_HDR_LEN + 21) / 1000.0;
+  double cursor = request_arrives + YAML_READ_SPLIT_MS;
+  std::vector<std::pair<double, uint32_t> > acks;   // (arrival at the mock, fragments confirmed)
+  uint32_t sent = 0;
+  uint32_t received = 0;
+  uint32_t last_ack = 0;
+  for (size_t s = 0; s < sections.size(); s++) {
+    size_t msg_len = sections[s].size();
+    uint16_t frags = wire_frag_count(msg_len, stride);
+    for (uint16_t i = 0; i < frags; i++) {
+      // Wait for enough acks to open the window
+      uint32_t acked = 0;
+      for (size_t a = 0; a < acks.size(); a++) {
+        if (acks[a].first <= cursor && acks[a].second > acked) {
+          acked = acks[a].second;
+        }
+      }
+      if (sent - acked >= (uint32_t)window) {
+        for (size_t a = 0; a < acks.size(); a++) {
+          if (sent - acks[a].second < (uint32_t)window && acks[a].first > cursor) {
+            cursor = acks[a].first;
+            break;
+          }
+        }
+      }
+      size_t chunk = (msg_len - i * stride) < stride ? (msg_len - i * stride) : stride;
+      cursor += ble_airtime_us(WIRE_FRAME_HDR_LEN + chunk) / 1000.0;
+      if (arrivals != NULL) {
+        arrivals->push_back(cursor);
+      }
+      sent++;
+      received++;
+      if (received - last_ack >= (uint32_t)window / 2) {
+        last_ack = received;
+        acks.push_back(std::make_pair(next_conn_event(cursor) + ble_airtime_us(WIRE_FRAME_HDR_LEN + 3) / 1000.0, received));
+      }
+    }
+  }
+  return cursor;
+}
+
+static void bench_yaml_download(const std::string& yaml){
+  printf("== Config download: lock-step (4 requests) vs streamed (1 request, windowed acks) ==\n");
+  printf("  window in bytes (at least 4 fragments), ack every half window\n");
+  printf("  model: %.1f ms connection interval, %.0f ms per readYAML+splitYaml on the mock, 1M PHY no DLE\n",
+         CONN_INTERVAL_MS, YAML_READ_SPLIT_MS);
+  std::vector<std::string> sections = split_sections(yaml);
+  const uint16_t mtus[] = {23, 185, 247, 517};
+  printf("  %5s %12s %14s %14s %14s\n", "MTU", "lock-step", "stream 512 B", "stream 1 KB", "stream 2 KB");
+  for (size_t m = 0; m < sizeof(mtus) / sizeof(mtus[0]); m++) {
+    size_t stride = wire_frag_payload_size(mtus[m]);
+    printf("  %5u %9.1f ms %11.1f ms %11.1f ms %11.1f ms\n", mtus[m], lockstep_download_ms(sections, stride),
+           streamed_download_ms(sections, stride, stream_window(stride, 512)),
+           streamed_download_ms(sections, stride, stream_window(stride, 1024)),
+           streamed_download_ms(sections, stride, stream_window(stride, 2048)));
+  }
+  double digest_ms = next_conn_event(0) + ble_airtime_us(WIRE_FRAME_HDR_LEN + 8) / 1000.0;
+  printf("  reconnect with an unchanged config: CONFIG_DIGEST_ANS only, %.1f ms + SPIFFS read on the screen\n", digest_ms);
+  printf("  (on the device the screen prints \"Config download (...): N ms from connect to setupInitialUserScreen\")\n\n");
+}
+
+// The config create_default_yaml_string() writes to SPIFFS on a fresh mock.
+static std::string default_yaml(){
+  std::string src = read_file(YAML_PARSER_PATH);
+  size_t fn = src.find("create_default_yaml_string()");
+  size_t start = src.find("R\"(", fn);
+  size_t end = src.find(")\"", start);
+  if (fn == std::string::npos || start == std::string::npos || end == std::string::npos) {
+    return "";
+  }
+  std::string yaml = src.substr(start + 3, end - start - 3);
+  std::string plain;
+  for (size_t i = 0; i < yaml.size(); i++) {
+    if (yaml[i] != '\r') {
+      plain += yaml[i];
+    }
+  }
+  return plain;
+}
+
+// A config in the layout of example_hand_configuration.yaml with many entries.
+static std::string synthetic_yaml(int sensor_cnt, int motor_cnt, int gesture_cnt){
+  char line[160];
+  std::string yaml = "file_type: hand_system_configuration\n\ngeneral:\n"
+                     "  - name: 'Technician_code'\n    code: 2025\n  - name: 'Debug_code'\n    code: 2024\n\n";
+  yaml += "# inputs type options: {'BLE_input', 'Wifi_input'}\nsensors:\n";
+  for (int i = 0; i < sensor_cnt; i++) {
+    snprintf(line, sizeof(line), "  - name: 'sensor_%03d' # string (required)\n    status: '%s'\n", i, (i % 3) ? "on" : "off");
+    yaml += line;
+    yaml += "    type: 'BLE_input' # string (required)\n    function:\n";
+    snprintf(line, sizeof(line), "      name: 'function_%03d' # string (required)\n      parameters:\n", i);
+    yaml += line;
+    snprintf(line, sizeof(line), "        param_1: [%d,20,100,true] \n        high_thld: [%d,20,100,true]\n"
+             "        low_thld: [%d,20,100,%s]\n\n", 20 + (i * 7) % 80, 50 + (i * 13) % 50, 20 + (i * 5) % 40, (i % 4) ? "true" : "false");
+    yaml += line;
+  }
+  yaml += "motors:\n";
+  for (int i = 0; i < motor_cnt; i++) {
+    snprintf(line, sizeof(line), "  - name: 'motor_%03d_dc'  # string (required)\n    type: 'DC_motor'      # string (required)\n    pins:\n", i);
+    yaml += line;
+    const char* pins[] = {"in1_pin", "in2_pin", "sense_pin"};
+    for (int p = 0; p < 3; p++) {
+      snprintf(line, sizeof(line), "      - type: '%s'   # string (required)\n        pin_number: %d    # int (required)\n",
+               pins[p], (i * 3 + p) % 40);
+      yaml += line;
+    }
+    snprintf(line, sizeof(line), "    safety_threshold: [%d,10,50,true]\n\n", 10 + (i * 3) % 40);
+    yaml += line;
+  }
+  yaml += "functions:\n";
+  for (int i = 0; i < gesture_cnt; i++) {
+    snprintf(line, sizeof(line), "  - name: 'gest_%03d' # string (required)\n    protocol_type: 'gesture' # string (required)\n\n", i);
+    yaml += line;
+  }
+  return yaml;
+}
+
+static size_t bench_lz_section(const std::string& text, double* compress_us, double* decompress_us){
+  static struct lz_compressor lz;
+  const int rounds = 200;
+  std::vector<uint8_t> packed(lz_compress_bound(text.size()));
+  size_t packed_len = 0;
+  double start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    packed_len = lz_compress(&lz, (const uint8_t*)text.data(), text.size(), &packed[0], packed.size());
+  }
+  *compress_us += (now_us() - start) / rounds;
+  bool ok = true;
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    size_t raw_len = 0;
+    uint8_t* raw = lz_decompress(&packed[0], packed_len, &raw_len);
+    ok = ok && raw != NULL && raw_len == text.size() && memcmp(raw, text.data(), raw_len) == 0;
+    free(raw);
+  }
+  *decompress_us += (now_us() - start) / rounds;
+  if (!ok) {
+    printf("  LZ ROUND TRIP FAILED\n");
+  }
+  // The mock falls back to the text when compression does not help
+  return packed_len < text.size() ? packed_len : text.size();
+}
+
+static void bench_compression_config(const char* name, const std::string& yaml){
+  std::vector<std::string> sections = split_sections(yaml);
+  std::vector<std::string> on_air;
+  size_t raw = 0;
+  size_t packed = 0;
+  double compress_us = 0;
+  double decompress_us = 0;
+  for (size_t i = 0; i < sections.size(); i++) {
+    size_t len = bench_lz_section(sections[i], &compress_us, &decompress_us);
+    raw += sections[i].size();
+    packed += len;
+    on_air.push_back(std::string(len, 'x'));
+  }
+  printf("  %-24s %7zu B -> %6zu B (%4.1fx)  compress %7.1f us  decompress %6.1f us\n", name, raw, packed,
+         (double)raw / packed, compress_us, decompress_us);
+  const uint16_t mtus[] = {23, 247, 517};
+  for (size_t m = 0; m < sizeof(mtus) / sizeof(mtus[0]); m++) {
+    size_t stride = wire_frag_payload_size(mtus[m]);
+    int window = stream_window(stride, YAML_STREAM_WINDOW_BYTES);
+    double plain_ms = streamed_download_ms(sections, stride, window);
+    double lz_ms = streamed_download_ms(on_air, stride, window) + (compress_us + decompress_us) / 1000.0 * ESP32_SLOWDOWN;
+    unsigned plain_frags = 0;
+    unsigned lz_frags = 0;
+    for (size_t i = 0; i < sections.size(); i++) {
+      plain_frags += wire_frag_count(sections[i].size(), stride);
+      lz_frags += wire_frag_count(on_air[i].size(), stride);
+    }
+    printf("      MTU %3u: %4u -> %4u fragments, streamed download %8.1f ms -> %8.1f ms\n", mtus[m],
+           plain_frags, lz_frags, plain_ms, lz_ms);
+  }
+}
+
+static void bench_compression(const std::string& yaml){
+  printf("== LZ compressed config sections (window %d B, compressor state %zu B) ==\n",
+         LZ_WINDOW, sizeof(struct lz_compressor));
+  printf("  download time adds compress + decompress time x%.0f (host -> ESP32 estimate)\n", ESP32_SLOWDOWN);
+  bench_compression_config("example config", yaml);
+  std::string def = default_yaml();
+  if (!def.empty()) {
+    bench_compression_config("default config (mock)", def);
+  }
+  bench_compression_config("100 sensors, 20 motors", synthetic_yaml(100, 20, 10));
+  bench_compression_config("250 sensors, 50 motors", synthetic_yaml(250, 50, 20));
+  printf("\n");
+}
+
+// Debug chart telemetry: READ_REQ polling vs TELEMETRY_SUB_REQ push.
+#define TELEMETRY_POLL_TIMER_MS 200.0  // update_chart timer on the screen
+#define NOTIFY_PER_CONN_EVENT 4        // notifications the ESP32 gets out per connection event (assumed)
+#define SINGLE_CHANNEL_HDR_LEN 15      // one stream per channel: is_motor, id, first_seq, count, t_first_us, t_span_us
+#define SINGLE_CHANNEL_SAMPLE_LEN 2    // int16 without a channel number
+
+struct telemetry_link {
+  struct wire_reassembler reasm;
+  struct msg_interp msg;
+  struct telemetry_receiver rx;
+  uint16_t mtu;
+  uint8_t channel_count;
+  size_t frames;
+  size_t frame_bytes;
+  int sample_value;
+};
+
+static int bench_sample(uint8_t is_motor, uint8_t id, void* ctx){
+  struct telemetry_link* link = (struct telemetry_link*)ctx;
+  return link->sample_value++ & 0x3FF;
+}
+
+// Screen side of the link: same path as onWrite() + QueueTelemetry().
+static void telemetry_receive_frame(const uint8_t* bytes, size_t len, void* ctx){
+  struct telemetry_link* link = (struct telemetry_link*)ctx;
+  link->frames++;
+  link->frame_bytes += len;
+  struct wire_frame frame;
+  if (!decode_frame(bytes, len, &frame) || !collect_msg(&link->reasm, &frame, &link->msg)) {
+    return;
+  }
+  struct telemetry_batch batch;
+  if (telemetry_batch_decode((const uint8_t*)link->msg.msg, link->msg.msg_length, link->channel_count, &batch) > 0) {
+    telemetry_receiver_push(&link->rx, &batch);
+  }
+}
+
+static void telemetry_emit(const uint8_t* payload, size_t len, void* ctx){
+  struct telemetry_link* link = (struct telemetry_link*)ctx;
+  send_msg(TELEMETRY_DATA, payload, len, link->mtu, telemetry_receive_frame, ctx);
+}
+
+static void bench_telemetry_loopback(uint16_t mtu, uint16_t rate_hz, uint8_t channel_count){
+  struct telemetry_link link;
+  memset(&link.reasm, 0, sizeof(link.reasm));
+  telemetry_receiver_reset(&link.rx);
+  link.mtu = mtu;
+  link.channel_count = channel_count;
+  link.frames = 0;
+  link.frame_bytes = 0;
+  link.sample_value = 0;
+  uint8_t batch_cap = telemetry_max_batch(wire_frag_payload_size(mtu));
+  struct telemetry_sub sub;
+  sub.rate_hz = rate_hz;
+  sub.batch = TELEMETRY_MAX_BATCH;
+  sub.channel_count = channel_count;
+  for (uint8_t c = 0; c < channel_count; c++) {
+    sub.channels[c].is_motor = c & 1;
+    sub.channels[c].id = c;
+  }
+  struct telemetry_sender sender;
+  telemetry_sender_start(&sender, &sub, batch_cap, 0);
+
+  // 60 s of samples, polled every 1 ms like the mock's loop()
+  const uint32_t seconds = 60;
+  double start = now_us();
+  for (uint32_t t_us = 0; t_us < seconds * 1000000u; t_us += 1000) {
+    telemetry_sender_poll(&sender, t_us, bench_sample, telemetry_emit, &link);
+  }
+  telemetry_sender_stop(&sender, telemetry_emit, &link);
+  double elapsed_us = now_us() - start;
+  double host_sps = sender.sampled / (elapsed_us / 1e6);
+  printf("    MTU %3u  %4u Hz x %u ch  batch %2u: %7u samples, lost %u, dropped %u, %6zu frames, %7zu B  "
+         "host %9.0f sps  ESP32 ~%8.0f sps\n",
+         mtu, rate_hz, channel_count, sender.sub.batch, link.rx.received, link.rx.lost, sender.dropped, link.frames,
+         link.frame_bytes, host_sps, host_sps / ESP32_SLOWDOWN);
+}
+
+static void bench_telemetry(){
+  printf("== Debug chart telemetry (conn interval %.1f ms, %d notifications per event) ==\n",
+         CONN_INTERVAL_MS, NOTIFY_PER_CONN_EVENT);
+  // Polling: one READ_REQ write and one READ_ANS notification per sample; the answer
+  // goes out at the earliest in the connection event after the request.
+  const char* read_req = "0|3";
+  const char* read_ans = "0|3|1023";
+  double poll_airtime = ble_airtime_us(WIRE_FRAME_HDR_LEN + strlen(read_req)) +
+                        ble_airtime_us(WIRE_FRAME_HDR_LEN + strlen(read_ans));
+  double poll_timer_sps = 1000.0 / TELEMETRY_POLL_TIMER_MS;
+  double poll_max_sps = 1000.0 / (2 * CONN_INTERVAL_MS);
+  printf("  READ_REQ polling: %.1f sps with the %.0f ms timer, at most %.1f sps (2 conn events per round trip), "
+         "%.0f us airtime per sample\n", poll_timer_sps, TELEMETRY_POLL_TIMER_MS, poll_max_sps, poll_airtime);
+
+  // Same rate and batching latency (TELEMETRY_DEFAULT_BATCH ticks per notification) for every scheme.
+  // Polling cannot reach the rate; its airtime is what the samples would cost if it could.
+  const int rate = TELEMETRY_DEFAULT_RATE_HZ;
+  const int ticks = TELEMETRY_DEFAULT_BATCH;
+  const uint16_t mtu = 247;
+  printf("  %d Hz per channel, %d ticks per notification, MTU %u, airtime per second of samples:\n", rate, ticks, mtu);
+  printf("    %-9s %18s %26s %26s\n", "channels", "poll per channel", "push stream per channel", "multiplexed stream");
+  double events_per_s = 1000.0 / CONN_INTERVAL_MS;
+  for (int channels = 1; channels <= TELEMETRY_MAX_CHANNELS; channels++) {
+    double poll_air = channels * rate * poll_airtime;
+    double single_payload = SINGLE_CHANNEL_HDR_LEN + ticks * SINGLE_CHANNEL_SAMPLE_LEN;
+    double single_notif = (double)channels * rate / ticks;
+    double single_air = single_notif * ble_airtime_us(WIRE_FRAME_HDR_LEN + (size_t)single_payload);
+    // The multiplexed batch is capped by TELEMETRY_MAX_BATCH / the fragment size
+    int samples = ticks * channels;
+    int cap = telemetry_max_batch(wire_frag_payload_size(mtu));
+    int per_notif = samples < cap ? samples : cap;
+    double mux_notif = (double)channels * rate / per_notif;
+    double mux_air = mux_notif * ble_airtime_us(WIRE_FRAME_HDR_LEN + TELEMETRY_HDR_LEN + per_notif * TELEMETRY_SAMPLE_LEN);
+    printf("    %-9d %10.1f ms %5s %12.1f ms %5.0f notif/s %12.1f ms %5.0f notif/s\n", channels, poll_air / 1000.0,
+           poll_air > 1e6 || channels * rate > poll_max_sps ? "(n/a)" : "", single_air / 1000.0, single_notif,
+           mux_air / 1000.0, mux_notif);
+    if (channels == TELEMETRY_MAX_CHANNELS) {
+      double max_by_air = 1e6 / ble_airtime_us(WIRE_FRAME_HDR_LEN + TELEMETRY_HDR_LEN + per_notif * TELEMETRY_SAMPLE_LEN) * per_notif;
+      double max_by_events = events_per_s * NOTIFY_PER_CONN_EVENT * per_notif;
+      printf("    multiplexed, %d channels: at most %.0f samples/s on the link\n", channels,
+             max_by_air < max_by_events ? max_by_air : max_by_events);
+    }
+  }
+
+  printf("  loopback through send_msg / decode_frame / collect_msg (60 s of samples, 1 ms loop):\n");
+  bench_telemetry_loopback(23, 100, 1);
+  bench_telemetry_loopback(247, 100, 1);
+  bench_telemetry_loopback(247, 100, TELEMETRY_MAX_CHANNELS);
+  bench_telemetry_loopback(247, TELEMETRY_MAX_RATE_HZ, TELEMETRY_MAX_CHANNELS);
+  printf("\n");
+}
+
+// Sample ring: sampler thread at a fixed rate, telemetry thread draining it every
+// drain_ms (loop() on the mock drains every 10 ms).
+struct ring_run {
+  uint32_t produced;
+  uint32_t consumed;
+  uint32_t dropped;
+  uint32_t max_fill;
+};
+
+static struct sample_ring bench_ring;
+
+static struct ring_run run_sample_ring(double rate_hz, double drain_ms, double seconds){
+  sample_ring_reset(&bench_ring);
+  std::atomic<bool> done(false);
+  struct ring_run run = {0, 0, 0, 0};
+  std::thread producer([&run, &done, rate_hz, seconds]() {
+    struct sample_frame frame;
+    frame.count = SAMPLE_FRAME_MAX_VALUES;
+    memset(frame.values, 0, sizeof(frame.values));
+    double start = now_us();
+    double period_us = rate_hz > 0 ? 1e6 / rate_hz : 0;
+    uint32_t tick = 0;
+    while (true) {
+      double due = start + tick * period_us;
+      double t = now_us();
+      if (t - start >= seconds * 1e6) {
+        break;
+      }
+      if (t < due) {
+        continue;
+      }
+      frame.tick = tick++;
+      frame.t_us = (uint32_t)(t - start);
+      sample_ring_push(&bench_ring, &frame);
+    }
+    run.produced = tick;
+    done.store(true);
+  });
+  struct sample_frame frame;
+  while (true) {
+    bool finished = done.load();
+    uint32_t fill = sample_ring_count(&bench_ring);
+    run.max_fill = fill > run.max_fill ? fill : run.max_fill;
+    while (sample_ring_pop(&bench_ring, &frame)) {
+      run.consumed++;
+    }
+    if (finished) {
+      break;
+    }
+    if (drain_ms > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds((long)(drain_ms * 1000)));
+    }
+  }
+  producer.join();
+  run.dropped = bench_ring.dropped.load();
+  return run;
+}
+
+static void bench_sample_ring(){
+  printf("== Sample ring (%d frames of %zu B, %zu B in all; %u hardware threads) ==\n", SAMPLE_RING_SIZE,
+         sizeof(struct sample_frame), sizeof(struct sample_ring), std::thread::hardware_concurrency());
+  const double drains[] = {1, 10};
+  const double rates[] = {1000, 5000, 10000, 20000, 50000, 100000};
+  for (size_t d = 0; d < sizeof(drains) / sizeof(drains[0]); d++) {
+    double max_ok = 0;
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+      struct ring_run run = run_sample_ring(rates[r], drains[d], 0.5);
+      printf("  drain every %4.1f ms, %6.0f Hz: %7u frames, %7u drained, %6u dropped (%5.2f %%), max fill %3u\n",
+             drains[d], rates[r], run.produced, run.consumed, run.dropped, 100.0 * run.dropped / run.produced, run.max_fill);
+      if (run.dropped == 0 && rates[r] > max_ok) {
+        max_ok = rates[r];
+      }
+    }
+    printf("    highest rate without drops: %.0f Hz (ring / drain period = %.0f Hz)\n", max_ok,
+           SAMPLE_RING_SIZE * 1000.0 / drains[d]);
+  }
+  // Cost of the ring itself, one thread: push 64 frames, pop 64 frames
+  struct sample_frame frame;
+  memset(&frame, 0, sizeof(frame));
+  sample_ring_reset(&bench_ring);
+  const uint32_t rounds = 100000;
+  double start = now_us();
+  for (uint32_t r = 0; r < rounds; r++) {
+    for (int i = 0; i < 64; i++) {
+      frame.tick++;
+      sample_ring_push(&bench_ring, &frame);
+    }
+    for (int i = 0; i < 64; i++) {
+      sample_ring_pop(&bench_ring, &frame);
+    }
+  }
+  double ns = (now_us() - start) * 1000.0 / (rounds * 64.0);
+  printf("  push + pop: %.1f ns per frame on the host, ESP32 ~%.1f us (%.2f %% of a 1 kHz tick)\n", ns,
+         ns * ESP32_SLOWDOWN / 1000.0, ns * ESP32_SLOWDOWN / 1e4);
+  printf("\n");
+}
+
+// Debug chart downsampling on a 1 M sample trace (a noisy sine with one-sample
+// spikes): min/max buckets against largest-triangle-three-buckets and plain
+// decimation, each down to the 280 points of the chart. Counts the spikes that
+// are still visible and the CPU time per sample.
+#define DOWNSAMPLE_TRACE_LEN 1000000
+#define DOWNSAMPLE_SPIKES 50
+#define DOWNSAMPLE_POINTS 280
+
+// Largest-triangle-three-buckets: keeps one sample per bucket, the one that
+// spans the largest triangle with its neighbours. Writes points values.
+static void lttb(const int16_t* in, size_t n, int16_t* out, size_t points){
+  out[0] = in[0];
+  size_t a = 0;
+  double every = (double)(n - 2) / (points - 2);
+  for (size_t i = 0; i < points - 2; i++) {
+    size_t avg_start = (size_t)((i + 1) * every) + 1;
+    size_t avg_end = (size_t)((i + 2) * every) + 1;
+    avg_end = avg_end < n ? avg_end : n;
+    double avg_x = 0, avg_y = 0;
+    for (size_t j = avg_start; j < avg_end; j++) {
+      avg_x += j;
+      avg_y += in[j];
+    }
+    size_t avg_len = avg_end > avg_start ? avg_end - avg_start : 1;
+    avg_x /= avg_len;
+    avg_y /= avg_len;
+    size_t start = (size_t)(i * every) + 1;
+    size_t end = (size_t)((i + 1) * every) + 1;
+    double best = -1;
+    size_t next_a = start;
+    for (size_t j = start; j < end; j++) {
+      double area = (a - avg_x) * (in[j] - in[a]) - (a - (double)j) * (avg_y - in[a]);
+      area = area < 0 ? -area : area;
+      if (area > best) {
+        best = area;
+        next_a = j;
+      }
+    }
+    out[i + 1] = in[next_a];
+    a = next_a;
+  }
+  out[points - 1] = in[n - 1];
+}
+
+static int visible_spikes(const int16_t* points, size_t count, int16_t threshold){
+  int visible = 0;
+  for (size_t i = 0; i < count; i++) {
+    visible += points[i] >= threshold;
+  }
+  return visible;
+}
+
+// Mean distance, in value units, between the true min/max of each chart column
+// (two points) and what the points of that column show.
+static double envelope_error(const int16_t* truth, const int16_t* points, size_t columns){
+  double sum = 0;
+  for (size_t c = 0; c < columns; c++) {
+    int16_t lo = points[2 * c] < points[2 * c + 1] ? points[2 * c] : points[2 * c + 1];
+    int16_t hi = points[2 * c] < points[2 * c + 1] ? points[2 * c + 1] : points[2 * c];
+    sum += (lo - truth[2 * c]) + (truth[2 * c + 1] - hi);
+  }
+  return sum / (2.0 * columns);
+}
+
+static void bench_downsample(){
+  printf("== Debug chart downsampling, %d samples to %d points (%d one-sample spikes) ==\n",
+         DOWNSAMPLE_TRACE_LEN, DOWNSAMPLE_POINTS, DOWNSAMPLE_SPIKES);
+  std::vector<int16_t> trace(DOWNSAMPLE_TRACE_LEN);
+  for (size_t i = 0; i < trace.size(); i++) {
+    trace[i] = (int16_t)(500 + 300 * sin(i * 2 * 3.14159265 / 20000) + (int)(rng_next() % 40));
+  }
+  // Spikes far enough apart that no two share a bucket
+  for (int k = 0; k < DOWNSAMPLE_SPIKES; k++) {
+    trace[(size_t)k * (DOWNSAMPLE_TRACE_LEN / DOWNSAMPLE_SPIKES) + 7919] = 4000;
+  }
+  const int16_t spike_threshold = 2000;
+  int16_t out[DOWNSAMPLE_POINTS];
+  int16_t truth[DOWNSAMPLE_POINTS];
+  downsample_minmax(trace.data(), trace.size(), truth, DOWNSAMPLE_POINTS / 2);
+  const int rounds = 10;
+
+  double start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    downsample_minmax(trace.data(), trace.size(), out, DOWNSAMPLE_POINTS / 2);
+  }
+  double minmax_ns = (now_us() - start) * 1000.0 / rounds / trace.size();
+  int minmax_visible = visible_spikes(out, DOWNSAMPLE_POINTS, spike_threshold);
+  double minmax_error = envelope_error(truth, out, DOWNSAMPLE_POINTS / 2);
+
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    lttb(trace.data(), trace.size(), out, DOWNSAMPLE_POINTS);
+  }
+  double lttb_ns = (now_us() - start) * 1000.0 / rounds / trace.size();
+  int lttb_visible = visible_spikes(out, DOWNSAMPLE_POINTS, spike_threshold);
+  double lttb_error = envelope_error(truth, out, DOWNSAMPLE_POINTS / 2);
+
+  size_t step = trace.size() / DOWNSAMPLE_POINTS;
+  for (size_t i = 0; i < DOWNSAMPLE_POINTS; i++) {
+    out[i] = trace[i * step];
+  }
+  int decimated_visible = visible_spikes(out, DOWNSAMPLE_POINTS, spike_threshold);
+  double decimated_error = envelope_error(truth, out, DOWNSAMPLE_POINTS / 2);
+
+  // Streaming, as the chart does it: one sample at a time into the bucket ring
+  static struct downsample_series series;
+  downsample_series_init(&series, DOWNSAMPLE_TRACE_LEN, DOWNSAMPLE_POINTS / 2, 8191);
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    downsample_series_clear(&series);
+    for (size_t i = 0; i < trace.size(); i++) {
+      downsample_series_add(&series, (uint32_t)i, trace[i]);
+    }
+  }
+  double stream_ns = (now_us() - start) * 1000.0 / rounds / trace.size();
+  int stream_visible = visible_spikes(series.points, DOWNSAMPLE_POINTS, spike_threshold);
+
+  printf("  %-22s %12s %14s %15s %15s\n", "", "host ns/smp", "ESP32 us/smp", "spikes visible", "envelope error");
+  printf("  %-22s %12s %14s %8d / %-4d %15.1f\n", "decimation", "-", "-", decimated_visible, DOWNSAMPLE_SPIKES, decimated_error);
+  printf("  %-22s %12.2f %14.3f %8d / %-4d %15.1f\n", "LTTB", lttb_ns, lttb_ns * ESP32_SLOWDOWN / 1000.0,
+         lttb_visible, DOWNSAMPLE_SPIKES, lttb_error);
+  printf("  %-22s %12.2f %14.3f %8d / %-4d %15.1f\n", "min/max, whole trace", minmax_ns, minmax_ns * ESP32_SLOWDOWN / 1000.0,
+         minmax_visible, DOWNSAMPLE_SPIKES, minmax_error);
+  printf("  %-22s %12.2f %14.3f %8d / %-4d %15s\n", "min/max, streamed", stream_ns, stream_ns * ESP32_SLOWDOWN / 1000.0,
+         stream_visible, DOWNSAMPLE_SPIKES, "same buckets");
+  // What the chart keeps per window at the default subscription rate
+  printf("  chart at %d Hz, %zu B per series whatever the window:\n", TELEMETRY_DEFAULT_RATE_HZ, sizeof(struct downsample_series));
+  const uint32_t windows_ms[] = {1000, 2000, 5000, 30000, 60000, 300000};
+  for (size_t w = 0; w < sizeof(windows_ms) / sizeof(windows_ms[0]); w++) {
+    uint16_t buckets = downsample_bucket_count(windows_ms[w] * 1000, 1000000 / TELEMETRY_DEFAULT_RATE_HZ, 140);
+    printf("    %6u ms window: %3u buckets of %6u ms, %5.1f samples each, %3u points\n", windows_ms[w], buckets,
+           windows_ms[w] / buckets, (double)windows_ms[w] * TELEMETRY_DEFAULT_RATE_HZ / 1000.0 / buckets, 2 * buckets);
+  }
+  printf("\n");
+}
+
+// Debug chart rendering, headless: a software line renderer stands in for LVGL
+// (background, division lines and the series polylines, every segment clipped to
+// the invalidated area the way lv_draw_line does) on a 280 x 125 RGB565 buffer.
+// Compared at 10, 100 and 500 samples per second per series, 2 series, a 2 s
+// window and a 20 ms chart timer: lv_chart_refresh() every frame against the
+// columns plot_damage.h reports, with and without the per-frame pixel budget.
+// At 5 s the window is changed, which redraws the whole chart. Flush time is what
+// the pixels take over the display's SPI bus (40 MHz, 16 bit per pixel).
+#define PLOT_W 280
+#define PLOT_H 125
+#define PLOT_FRAME_MS 20
+#define PLOT_SERIES 2
+#define PLOT_BUDGET_PX 5000
+#define PLOT_EMPTY 8191
+#define SPI_US_PER_PX (16.0 / 40.0)
+
+static uint16_t plot_fb[PLOT_H][PLOT_W + 1];
+
+static inline int plot_y(int16_t value){
+  int y = PLOT_H - 1 - value * (PLOT_H - 1) / 1000;
+  return y < 0 ? 0 : (y >= PLOT_H ? PLOT_H - 1 : y);
+}
+
+static void plot_line(int x0, int y0, int x1, int y1, int clip_x1, int clip_x2, uint16_t color){
+  int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+  int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+  int err = dx + dy;
+  while (true) {
+    if (x0 >= clip_x1 && x0 <= clip_x2) {
+      plot_fb[y0][x0] = color;
+    }
+    if (x0 == x1 && y0 == y1) {
+      break;
+    }
+    int e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      x0 += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y0 += sy;
+    }
+  }
+}
+
+// Draws columns clip_x1..clip_x2 of the chart. Returns the pixels written to the display.
+static uint32_t plot_render(const struct downsample_series* series, int count, uint16_t points, int clip_x1, int clip_x2){
+  for (int y = 0; y < PLOT_H; y++) {
+    uint16_t color = (y % (PLOT_H / 4) == 0) ? 0xC618 : 0xFFFF;     // division lines
+    for (int x = clip_x1; x <= clip_x2; x++) {
+      plot_fb[y][x] = color;
+    }
+  }
+  for (int c = 0; c < count; c++) {
+    for (uint16_t i = 0; i + 1 < points; i++) {
+      int xa = PLOT_W * i / (points - 1);
+      int xb = PLOT_W * (i + 1) / (points - 1);
+      if (xb < clip_x1 || xa > clip_x2) {
+        continue;
+      }
+      int16_t a = series[c].points[i];
+      int16_t b = series[c].points[i + 1];
+      if (a == PLOT_EMPTY || b == PLOT_EMPTY) {
+        continue;
+      }
+      plot_line(xa, plot_y(a), xb, plot_y(b), clip_x1, clip_x2, (uint16_t)(0x001F << (c * 5)));
+    }
+  }
+  return (uint32_t)(clip_x2 - clip_x1 + 1) * PLOT_H;
+}
+
+enum plot_mode { PLOT_FULL_REFRESH, PLOT_DAMAGE, PLOT_DAMAGE_BUDGET };
+
+static void bench_plot_run(double sps, int mode){
+  static struct downsample_series series[PLOT_SERIES];
+  static uint16_t reference[PLOT_H][PLOT_W + 1];
+  struct plot_damage damage;
+  uint32_t window_us = 2000000;
+  uint16_t buckets = downsample_bucket_count(window_us, (uint32_t)(1e6 / sps), 140);
+  uint16_t points = 2 * buckets;
+  for (int c = 0; c < PLOT_SERIES; c++) {
+    downsample_series_init(&series[c], window_us, buckets, PLOT_EMPTY);
+  }
+  plot_damage_init(&damage, PLOT_W, PLOT_H, points, mode == PLOT_DAMAGE_BUDGET ? PLOT_BUDGET_PX : 0, 2);
+  plot_damage_mark_all(&damage);
+  std::vector<double> frame_us;
+  std::vector<uint32_t> frame_px;
+  uint64_t sample = 0;
+  const uint32_t frames = 10000 / PLOT_FRAME_MS;
+  for (uint32_t f = 0; f < frames; f++) {
+    uint32_t frame_t_us = f * PLOT_FRAME_MS * 1000;
+    if (f == 5000 / PLOT_FRAME_MS) {
+      // New window: every point changes
+      window_us = 5000000;
+      buckets = downsample_bucket_count(window_us, (uint32_t)(1e6 / sps), 140);
+      points = 2 * buckets;
+      for (int c = 0; c < PLOT_SERIES; c++) {
+        downsample_series_init(&series[c], window_us, buckets, PLOT_EMPTY);
+      }
+      plot_damage_init(&damage, PLOT_W, PLOT_H, points, mode == PLOT_DAMAGE_BUDGET ? PLOT_BUDGET_PX : 0, 2);
+      plot_damage_mark_all(&damage);
+    }
+    double start = now_us();
+    bool fed = false;
+    for (; sample / sps * 1e6 <= frame_t_us; sample++) {
+      uint32_t t = (uint32_t)(sample / sps * 1e6);
+      for (int c = 0; c < PLOT_SERIES; c++) {
+        int16_t value = (int16_t)(500 + 350 * sin(t / 1e6 * 2 * 3.14159265 * (c + 1)) + (int)(rng_next() % 60) - 30);
+        downsample_series_add(&series[c], t, value);
+      }
+      fed = true;
+    }
+    uint32_t px = 0;
+    if (mode == PLOT_FULL_REFRESH) {
+      for (int c = 0; c < PLOT_SERIES; c++) {
+        downsample_series_gap(&series[c], 4);
+      }
+      if (fed || f == 0) {
+        px = plot_render(series, PLOT_SERIES, points, 0, PLOT_W);
+      }
+    } else {
+      for (int c = 0; c < PLOT_SERIES; c++) {
+        downsample_series_gap(&series[c], 4);
+        plot_damage_add_series(&damage, &series[c]);
+      }
+      struct plot_span spans[PLOT_MAX_SPANS];
+      int count = plot_damage_take(&damage, spans, PLOT_MAX_SPANS);
+      for (int i = 0; i < count; i++) {
+        px += plot_render(series, PLOT_SERIES, points, spans[i].x1, spans[i].x2);
+      }
+    }
+    frame_us.push_back(now_us() - start);
+    frame_px.push_back(px);
+  }
+  // What the columns left on screen must equal a full redraw of the final data
+  bool same = true;
+  if (mode != PLOT_FULL_REFRESH) {
+    while (plot_damage_pending(&damage)) {
+      struct plot_span spans[PLOT_MAX_SPANS];
+      int count = plot_damage_take(&damage, spans, PLOT_MAX_SPANS);
+      for (int i = 0; i < count; i++) {
+        plot_render(series, PLOT_SERIES, points, spans[i].x1, spans[i].x2);
+      }
+    }
+    memcpy(reference, plot_fb, sizeof(plot_fb));
+    plot_render(series, PLOT_SERIES, points, 0, PLOT_W);
+    same = memcmp(reference, plot_fb, sizeof(plot_fb)) == 0;
+  }
+  std::vector<double> total_us(frame_us.size());
+  double render_sum = 0;
+  uint64_t px_sum = 0;
+  for (size_t i = 0; i < frame_us.size(); i++) {
+    total_us[i] = frame_us[i] * ESP32_SLOWDOWN + frame_px[i] * SPI_US_PER_PX;
+    render_sum += frame_us[i];
+    px_sum += frame_px[i];
+  }
+  std::vector<double> sorted(total_us);
+  std::sort(sorted.begin(), sorted.end());
+  const char* names[] = {"lv_chart_refresh", "damaged columns", "damage + budget"};
+  printf("  %3.0f sps, %-17s: %5.1f us render (host), %6.0f px per frame; ESP32 frame %6.2f ms mean, %6.2f ms p99, %6.2f ms max%s\n",
+         sps, names[mode], render_sum / frame_us.size(), (double)px_sum / frame_px.size(),
+         (render_sum * ESP32_SLOWDOWN + px_sum * SPI_US_PER_PX) / frame_us.size() / 1000.0,
+         sorted[sorted.size() * 99 / 100] / 1000.0, sorted.back() / 1000.0, same ? "" : "  SCREEN DIFFERS");
+}
+
+static void bench_plot(){
+  printf("== Debug chart frame time, headless (%dx%d, %d series, %d ms timer, SPI flush %.1f us/px, budget %d px) ==\n",
+         PLOT_W, PLOT_H, PLOT_SERIES, PLOT_FRAME_MS, SPI_US_PER_PX, PLOT_BUDGET_PX);
+  const double rates[] = {10, 100, 500};
+  for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+    for (int mode = PLOT_FULL_REFRESH; mode <= PLOT_DAMAGE_BUDGET; mode++) {
+      bench_plot_run(rates[r], mode);
+    }
+  }
+  printf("  (ESP32 frame = render x%.0f + flush; the chart timer fires every %d ms)\n", ESP32_SLOWDOWN, PLOT_FRAME_MS);
+  printf("\n");
+}
+
+// History tiers on the screen: a day of telemetry through history_add, then the
+// Debug tab's queries, checked against the buckets recomputed from the samples.
+#define HISTORY_BENCH_RATE_HZ TELEMETRY_DEFAULT_RATE_HZ
+#define HISTORY_BENCH_HOURS 24
+
+// Deterministic synthetic signal: a slow swing per channel, noise and rare spikes
+static int16_t history_signal(uint32_t t_ms, int channel){
+  uint32_t x = t_ms * 2654435761u ^ (uint32_t)channel * 40503u;
+  x ^= x >> 15;
+  x *= 2246822519u;
+  x ^= x >> 13;
+  double swing = 300.0 * sin(2 * M_PI * t_ms / (600000.0 * (channel + 1)));
+  int spike = (x % 5000) == 0 ? 2000 : 0;
+  return (int16_t)(500 + swing + (int)(x % 41) - 20 + spike);
+}
+
+static void bench_history(){
+  static struct history_store h;
+  history_init(&h);
+  struct telemetry_channel channels[HISTORY_MAX_CHANNELS];
+  for (int c = 0; c < HISTORY_MAX_CHANNELS; c++) {
+    channels[c].is_motor = c & 1;
+    channels[c].id = (uint8_t)c;
+  }
+  const uint32_t period_ms = 1000 / HISTORY_BENCH_RATE_HZ;
+  const uint32_t end_ms = HISTORY_BENCH_HOURS * 3600u * 1000u;
+  printf("== Screen history tiers (%d h at %d Hz x %d channels) ==\n", HISTORY_BENCH_HOURS, HISTORY_BENCH_RATE_HZ,
+         HISTORY_MAX_CHANNELS);
+  printf("  memory: %zu B for %d channels (%zu B per channel, %d buckets of %zu B), fixed\n", sizeof(h),
+         HISTORY_MAX_CHANNELS, sizeof(h.channels[0]), HISTORY_TOTAL_BUCKETS, sizeof(struct history_bucket));
+  // Insert latency per hour, so a slowdown as the session grows would show
+  double worst_hour_ns = 0, total_us = 0;
+  uint64_t inserts = 0;
+  std::vector<int16_t> hour_samples(3600000u / period_ms * HISTORY_MAX_CHANNELS);
+  for (uint32_t hour = 0; hour < HISTORY_BENCH_HOURS; hour++) {
+    size_t i = 0;
+    for (uint32_t t = hour * 3600000u; t < (hour + 1) * 3600000u; t += period_ms) {
+      for (int c = 0; c < HISTORY_MAX_CHANNELS; c++) {
+        hour_samples[i++] = history_signal(t, c);
+      }
+    }
+    i = 0;
+    double start = now_us();
+    for (uint32_t t = hour * 3600000u; t < (hour + 1) * 3600000u; t += period_ms) {
+      for (int c = 0; c < HISTORY_MAX_CHANNELS; c++) {
+        history_add(&h, &channels[c], t, hour_samples[i++]);
+      }
+    }
+    double took_us = now_us() - start;
+    double per_ns = took_us * 1000.0 / (3600000.0 / period_ms * HISTORY_MAX_CHANNELS);
+    worst_hour_ns = per_ns > worst_hour_ns ? per_ns : worst_hour_ns;
+    total_us += took_us;
+    inserts += 3600000u / period_ms * HISTORY_MAX_CHANNELS;
+  }
+  double insert_ns = total_us * 1000.0 / inserts;
+  printf("  history_add: %llu samples, %.1f ns each on the host (worst hour %.1f ns), ESP32 ~%.2f us; "
+         "%.2f %% of a core at %d Hz x %d\n", (unsigned long long)inserts, insert_ns, worst_hour_ns,
+         insert_ns * ESP32_SLOWDOWN / 1000.0, insert_ns * ESP32_SLOWDOWN * HISTORY_BENCH_RATE_HZ * HISTORY_MAX_CHANNELS / 1e7,
+         HISTORY_BENCH_RATE_HZ, HISTORY_MAX_CHANNELS);
+
+  // What the Debug tab asks when a tier is picked: every channel, 140 columns
+  struct history_value cols[DOWNSAMPLE_MAX_BUCKETS];
+  const int queries = 2000;
+  for (int tier = 0; tier < HISTORY_TIERS; tier++) {
+    uint16_t n = 0;
+    double start = now_us();
+    for (int q = 0; q < queries; q++) {
+      n = history_query(&h, &channels[q % HISTORY_MAX_CHANNELS], tier, end_ms - 1, 140, cols);
+    }
+    double query_us = (now_us() - start) / queries;
+    // Check every column against the samples it covers
+    uint32_t bucket_ms = history_bucket_ms(tier);
+    uint32_t per_column = (history_bucket_count(tier) + 139) / 140;
+    uint32_t column_ms = bucket_ms * per_column;
+    uint32_t first_ms = ((end_ms - 1) / column_ms - (n - 1)) * column_ms;
+    uint32_t oldest_ms = ((end_ms - 1) / bucket_ms - history_bucket_count(tier) + 1) * bucket_ms;
+    int mismatches = 0;
+    for (int c = 0; c < HISTORY_MAX_CHANNELS; c++) {
+      history_query(&h, &channels[c], tier, end_ms - 1, 140, cols);
+      for (uint16_t k = 0; k < n; k++) {
+        int64_t sum = 0;
+        uint32_t count = 0;
+        int16_t lo = INT16_MAX, hi = INT16_MIN;
+        for (uint32_t t = first_ms + k * column_ms; t < first_ms + (k + 1) * column_ms; t += period_ms) {
+          if (t < oldest_ms) {
+            continue;
+          }
+          int16_t v = history_signal(t, c);
+          lo = v < lo ? v : lo;
+          hi = v > hi ? v : hi;
+          sum += v;
+          count++;
+        }
+        int16_t mean = count ? (int16_t)((sum + count / 2) / count) : 0;
+        if (cols[k].count != count || (count && (cols[k].min != lo || cols[k].max != hi || cols[k].mean != mean))) {
+          mismatches++;
+        }
+      }
+    }
+    printf("  tier %d (%2u s buckets, %3u kept = %5.1f min): query of %3u columns %.2f us on the host, ESP32 ~%.0f us, "
+           "%d columns differ from the samples\n", tier, bucket_ms / 1000, history_bucket_count(tier),
+           history_bucket_count(tier) * bucket_ms / 60000.0, n, query_us, query_us * ESP32_SLOWDOWN, mismatches);
+  }
+  printf("\n");
+}
+
+// Black box recorder (telemetry_log.h) against an emulated SPIFFS, in simulated
+// time with 1 ms steps: the sampler task pushes a frame into the sample ring every
+// step, loop() drains it every 10 ms and feeds the log. A page write takes
+// FLASH_PAGE_US, every 16th page also erases a 4 KB sector, and once per run the
+// file system stalls for a garbage collection. Compared: blocks queued to a writer
+// task (the mock) and blocks written from loop() itself.
+#define FLASH_PAGE_US 2500
+#define FLASH_ERASE_US 45000
+#define FLASH_PAGES_PER_SECTOR 16
+#define FLASH_GC_US 250000
+#define RECORDER_QUEUE_BLOCKS 32
+#define RECORDER_LOOP_MS 10
+
+struct flash_model {
+  uint32_t pages;
+  bool gc_done;
+  double busy_ms;
+};
+
+// Time the next page write takes.
+static uint32_t flash_write_us(struct flash_model* flash, uint32_t now_ms){
+  uint32_t us = FLASH_PAGE_US;
+  if (++flash->pages % FLASH_PAGES_PER_SECTOR == 0) {
+    us += FLASH_ERASE_US;
+  }
+  if (!flash->gc_done && now_ms >= 7000) {
+    flash->gc_done = true;
+    us += FLASH_GC_US;
+  }
+  flash->busy_ms += us / 1000.0;
+  return us;
+}
+
+struct recorder_sim {
+  bool inline_writes;
+  uint32_t now_ms;
+  struct flash_model flash;
+  uint32_t queued;                 // blocks waiting for the writer task
+  uint32_t max_queued;
+  double writer_free_ms;           // writer task (or loop() when inline) busy until
+  uint32_t bytes;
+  uint32_t longest_loop_stall_ms;
+};
+
+static bool recorder_sim_write(const uint8_t* data, size_t len, void* ctx){
+  struct recorder_sim* sim = (struct recorder_sim*)ctx;
+  sim->bytes += len;
+  if (sim->inline_writes) {
+    double start = sim->writer_free_ms > sim->now_ms ? sim->writer_free_ms : sim->now_ms;
+    sim->writer_free_ms = start + flash_write_us(&sim->flash, sim->now_ms) / 1000.0;
+    return true;
+  }
+  if (sim->queued >= RECORDER_QUEUE_BLOCKS) {
+    sim->bytes -= len;
+    return false;
+  }
+  sim->queued++;
+  sim->max_queued = sim->queued > sim->max_queued ? sim->queued : sim->max_queued;
+  return true;
+}
+
+static int recorder_sim_sample(uint8_t is_motor, uint8_t id, void* ctx){
+  return is_motor * 100 + id;
+}
+
+static void bench_recorder_run(uint16_t rate_hz, uint8_t channel_count, bool inline_writes){
+  static struct telemetry_log log;
+  struct telemetry_log_config cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.rate_hz = rate_hz;
+  cfg.channel_count = channel_count;
+  for (uint8_t c = 0; c < channel_count; c++) {
+    cfg.channels[c].id = c;
+  }
+  cfg.pre_ms = 5000;
+  cfg.post_ms = 5000;
+  struct recorder_sim sim;
+  memset(&sim, 0, sizeof(sim));
+  sim.inline_writes = inline_writes;
+  sample_ring_reset(&bench_ring);
+  telemetry_log_arm(&log, &cfg, 0);
+  double next_loop_ms = 0;
+  uint32_t last_loop_ms = 0;
+  const uint32_t trigger_ms = 6000, end_ms = 12000;
+  for (sim.now_ms = 0; sim.now_ms < end_ms; sim.now_ms++) {
+    struct sample_frame frame;
+    frame.tick = sim.now_ms;
+    frame.t_us = sim.now_ms * 1000;
+    frame.count = channel_count;
+    sample_ring_push(&bench_ring, &frame);
+    // Writer task: takes the next block whenever the flash is free
+    while (!inline_writes && sim.queued > 0 && sim.writer_free_ms <= sim.now_ms) {
+      sim.queued--;
+      double begin = sim.writer_free_ms > sim.now_ms ? sim.writer_free_ms : sim.now_ms;
+      sim.writer_free_ms = begin + flash_write_us(&sim.flash, sim.now_ms) / 1000.0;
+    }
+    if (sim.now_ms < next_loop_ms) {
+      continue;
+    }
+    uint32_t period_ms = sim.now_ms - last_loop_ms;
+    sim.longest_loop_stall_ms = period_ms > sim.longest_loop_stall_ms ? period_ms : sim.longest_loop_stall_ms;
+    last_loop_ms = sim.now_ms;
+    while (sample_ring_pop(&bench_ring, &frame)) {
+      telemetry_log_feed(&log, frame.tick * 1000, frame.t_us, recorder_sim_sample, recorder_sim_write, &sim);
+    }
+    if (sim.now_ms >= trigger_ms && log.state == TELEMETRY_LOG_ARMED) {
+      telemetry_log_trigger(&log, TELEMETRY_LOG_TRIGGER_EMERGENCY_STOP, frame.t_us, recorder_sim_write, &sim);
+    }
+    next_loop_ms = sim.now_ms + RECORDER_LOOP_MS;
+    if (inline_writes && sim.writer_free_ms > next_loop_ms) {
+      next_loop_ms = sim.writer_free_ms;   // loop() was writing
+    }
+  }
+  printf("  %4d Hz x %d, %-13s: %6u B in %3u blocks, flash busy %5.1f %%, %2u blocks dropped, %3u ticks skipped, "
+         "%3u frames lost in the ring, peak queue %2u, longest loop() period %3u ms\n",
+         rate_hz, channel_count, inline_writes ? "inline writes" : "writer task", log.bytes, log.blocks,
+         100.0 * sim.flash.busy_ms / (end_ms - trigger_ms), log.dropped_blocks, log.skipped_ticks,
+         bench_ring.dropped.load(), sim.max_queued, sim.longest_loop_stall_ms);
+}
+
+static void bench_recorder(){
+  printf("== Black box recorder on emulated SPIFFS (page %d us, sector erase %d us every %d pages, one %d ms GC stall; "
+         "5 s before and after the trigger) ==\n", FLASH_PAGE_US, FLASH_ERASE_US, FLASH_PAGES_PER_SECTOR, FLASH_GC_US / 1000);
+  bench_recorder_run(100, TELEMETRY_MAX_CHANNELS, false);
+  bench_recorder_run(100, TELEMETRY_MAX_CHANNELS, true);
+  bench_recorder_run(1000, TELEMETRY_MAX_CHANNELS, false);
+  bench_recorder_run(1000, TELEMETRY_MAX_CHANNELS, true);
+  // Cost per frame in loop() while armed and while recording (blocks go nowhere)
+  static struct telemetry_log log;
+  struct telemetry_log_config cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.rate_hz = 1000;
+  cfg.channel_count = TELEMETRY_MAX_CHANNELS;
+  cfg.pre_ms = 500;
+  cfg.post_ms = 1000000;
+  struct recorder_sim sim;
+  memset(&sim, 0, sizeof(sim));
+  sim.inline_writes = true;
+  telemetry_log_arm(&log, &cfg, 0);
+  const uint32_t frames = 200000;
+  double start = now_us();
+  for (uint32_t i = 0; i < frames; i++) {
+    telemetry_log_feed(&log, i * 1000, i * 1000, recorder_sim_sample, recorder_sim_write, &sim);
+  }
+  double armed_ns = (now_us() - start) * 1000.0 / frames;
+  telemetry_log_trigger(&log, TELEMETRY_LOG_TRIGGER_MANUAL, 0, recorder_sim_write, &sim);
+  start = now_us();
+  for (uint32_t i = frames; i < 2 * frames; i++) {
+    telemetry_log_feed(&log, i * 1000, i * 1000, recorder_sim_sample, recorder_sim_write, &sim);
+  }
+  double recording_ns = (now_us() - start) * 1000.0 / frames;
+  printf("  telemetry_log_feed, %d channels: %.0f ns armed, %.0f ns recording per tick on the host, "
+         "ESP32 ~%.1f / %.1f us\n", TELEMETRY_MAX_CHANNELS, armed_ns, recording_ns,
+         armed_ns * ESP32_SLOWDOWN / 1000.0, recording_ns * ESP32_SLOWDOWN / 1000.0);
+  printf("\n");
+}
+
+// Status tab: one STATS_REQ / STATS_ANS with every channel vs a READ_REQ round trip
+// per sensor, and the cost of keeping the statistics on the prosthesis.
+#define STATS_REFRESH_MS 500.0          // stat_timer on the screen
+#define STATS_SAMPLER_HZ 1000           // SAMPLER_RATE_HZ on the mock
+
+static void bench_stats(){
+  printf("== Status tab statistics (conn interval %.1f ms, refresh every %.0f ms, %d ms window) ==\n",
+         CONN_INTERVAL_MS, STATS_REFRESH_MS, ROLLING_STATS_DEFAULT_WINDOW_MS);
+  const char* read_req = "0|3";
+  const char* read_ans = "0|3|1023";
+  printf("  %-9s %28s %40s %32s\n", "channels", "READ_REQ per channel", "STATS_REQ / STATS_ANS (MTU 23 | 247)",
+         "raw samples, multiplexed");
+  const int counts[] = {1, 4, 8, ROLLING_STATS_MAX_CHANNELS};
+  for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    int channels = counts[i];
+    struct link_totals poll = {0, 0, 0};
+    for (int c = 0; c < channels; c++) {
+      add_compact_msg(&poll, strlen(read_req), wire_frag_payload_size(WIRE_DEFAULT_MTU));
+      add_compact_msg(&poll, strlen(read_ans), wire_frag_payload_size(WIRE_DEFAULT_MTU));
+    }
+    // The polls go one after the other: a request and its answer take two connection events
+    double poll_latency_ms = channels * 2 * CONN_INTERVAL_MS;
+    size_t ans_len = ROLLING_STATS_HDR_LEN + channels * ROLLING_STATS_CHANNEL_LEN;
+    struct link_totals stats23 = {0, 0, 0};
+    struct link_totals stats247 = {0, 0, 0};
+    add_compact_msg(&stats23, 0, wire_frag_payload_size(WIRE_DEFAULT_MTU));
+    add_compact_msg(&stats23, ans_len, wire_frag_payload_size(WIRE_DEFAULT_MTU));
+    add_compact_msg(&stats247, 0, wire_frag_payload_size(247));
+    add_compact_msg(&stats247, ans_len, wire_frag_payload_size(247));
+    // An answer split over n notifications needs ceil(n / NOTIFY_PER_CONN_EVENT) events after the request
+    size_t frags23 = stats23.frames - 1;
+    double stats23_ms = (1 + (frags23 + NOTIFY_PER_CONN_EVENT - 1) / NOTIFY_PER_CONN_EVENT) * CONN_INTERVAL_MS;
+    double stats247_ms = 2 * CONN_INTERVAL_MS;
+    // Shipping every sample instead, to compute the statistics on the screen
+    int cap = telemetry_max_batch(wire_frag_payload_size(247));
+    double raw_notif = (double)channels * STATS_SAMPLER_HZ / cap;
+    double raw_air_ms = raw_notif * ble_airtime_us(WIRE_FRAME_HDR_LEN + TELEMETRY_HDR_LEN + cap * TELEMETRY_SAMPLE_LEN) / 1000.0;
+    double refreshes = 1000.0 / STATS_REFRESH_MS;
+    printf("  %-9d %6.1f ms air/s, %5.0f ms  %6.1f | %4.1f ms air/s, %3.0f | %3.0f ms  %8.1f ms air/s %6.0f notif/s\n",
+           channels, poll.airtime_us * refreshes / 1000.0, poll_latency_ms,
+           stats23.airtime_us * refreshes / 1000.0, stats247.airtime_us * refreshes / 1000.0, stats23_ms, stats247_ms,
+           raw_air_ms, raw_notif);
+  }
+  printf("  (air/s: airtime per second of refreshes; ms: time until every value is on screen)\n");
+
+  // Prosthesis side: one update per sample, one merge of the slots per request
+  static struct rolling_stats rs;
+  struct telemetry_channel channels[ROLLING_STATS_MAX_CHANNELS];
+  for (int c = 0; c < ROLLING_STATS_MAX_CHANNELS; c++) {
+    channels[c].is_motor = c & 1;
+    channels[c].id = (uint8_t)c;
+  }
+  rolling_stats_init(&rs, channels, ROLLING_STATS_MAX_CHANNELS, ROLLING_STATS_DEFAULT_WINDOW_MS);
+  const uint32_t frames = 1000000;
+  double start = now_us();
+  for (uint32_t t = 0; t < frames; t++) {
+    for (uint8_t c = 0; c < ROLLING_STATS_MAX_CHANNELS; c++) {
+      rolling_stats_add(&rs, c, t * 1000, (int16_t)(rng_next() & 0x3FF));
+    }
+  }
+  double add_ns = (now_us() - start) * 1000.0 / ((double)frames * ROLLING_STATS_MAX_CHANNELS);
+  uint8_t ans[ROLLING_STATS_MAX_LEN];
+  size_t ans_len = 0;
+  const int snapshots = 100000;
+  start = now_us();
+  for (int i = 0; i < snapshots; i++) {
+    ans_len += rolling_stats_encode(ans, sizeof(ans), &rs, (frames - 1) * 1000 + i % 1000);
+  }
+  double encode_us = (now_us() - start) / snapshots;
+  printf("  rolling_stats_add: %.1f ns per sample on the host, ESP32 ~%.2f us (%d channels at %d Hz: ~%.1f %% of a core)\n",
+         add_ns, add_ns * ESP32_SLOWDOWN / 1000.0, ROLLING_STATS_MAX_CHANNELS, STATS_SAMPLER_HZ,
+         add_ns * ESP32_SLOWDOWN * ROLLING_STATS_MAX_CHANNELS * STATS_SAMPLER_HZ / 1e7);
+  printf("  rolling_stats_encode, %d channels: %.2f us on the host, ESP32 ~%.0f us; %zu B of state, STATS_ANS %zu B\n",
+         ROLLING_STATS_MAX_CHANNELS, encode_us, encode_us * ESP32_SLOWDOWN, sizeof(rs), ans_len / snapshots);
+  printf("\n");
+}
+
+#define EXPORT_SAMPLER_HZ 1000      // SAMPLER_RATE_HZ of the mock
+
+static void count_export_frame(const struct export_frame* frame, void* ctx){
+  (*(uint64_t*)ctx) += frame->count;
+}
+
+static void bench_export(){
+  printf("== USB serial export (8N1: 10 bits per byte), frames per second that fit the link ==\n");
+  const int channel_counts[] = {2, 4, 8, EXPORT_MAX_VALUES};
+  const int bauds[] = {115200, 460800, 921600, 2000000};
+  printf("  %-9s %7s %7s", "channels", "binary", "text");
+  for (size_t b = 0; b < sizeof(bauds) / sizeof(bauds[0]); b++) {
+    printf(" %15d", bauds[b]);
+  }
+  printf("\n");
+  for (size_t i = 0; i < sizeof(channel_counts) / sizeof(channel_counts[0]); i++) {
+    int channels = channel_counts[i];
+    size_t binary_len = EXPORT_HDR_LEN + 2 * channels + EXPORT_CRC_LEN;
+    // The same row as text (tick, micros and the values, as a log line would print them)
+    char line[256];
+    size_t text_len = 0;
+    const int rows = 1000;
+    for (int r = 0; r < rows; r++) {
+      int n = snprintf(line, sizeof(line), "%u,%u", 123456 + r, 123456789 + r * 1000);
+      for (int c = 0; c < channels; c++) {
+        n += snprintf(line + n, sizeof(line) - n, ",%d", (int)(rng_next() % 4096) - 2048);
+      }
+      text_len += n + 1;
+    }
+    double text_avg = (double)text_len / rows;
+    printf("  %-9d %5zu B %5.1f B", channels, binary_len, text_avg);
+    for (size_t b = 0; b < sizeof(bauds) / sizeof(bauds[0]); b++) {
+      double bytes_per_s = bauds[b] / 10.0;
+      double binary_hz = bytes_per_s / binary_len;
+      double text_hz = bytes_per_s / text_avg;
+      printf(" %6.0f%s|%6.0f%s", binary_hz, binary_hz >= EXPORT_SAMPLER_HZ ? "*" : " ",
+             text_hz, text_hz >= EXPORT_SAMPLER_HZ ? "*" : " ");
+    }
+    printf("\n");
+  }
+  printf("  (binary | text frames/s; * keeps up with the %d Hz sampler)\n", EXPORT_SAMPLER_HZ);
+
+  // CPU: encoding on the prosthesis, decoding on the host
+  const int frames = 1000000;
+  int16_t values[EXPORT_MAX_VALUES];
+  for (int c = 0; c < EXPORT_MAX_VALUES; c++) {
+    values[c] = (int16_t)(rng_next() & 0x3FF);
+  }
+  std::vector<uint8_t> stream;
+  stream.reserve((size_t)frames * EXPORT_MAX_FRAME_LEN);
+  uint8_t buf[EXPORT_MAX_FRAME_LEN];
+  double start = now_us();
+  for (int f = 0; f < frames; f++) {
+    values[f % EXPORT_MAX_VALUES]++;
+    size_t len = export_samples_encode(buf, sizeof(buf), f, f * 1000, values, EXPORT_MAX_VALUES);
+    stream.insert(stream.end(), buf, buf + len);
+  }
+  double encode_ns = (now_us() - start) * 1000.0 / frames;
+  // Lose one frame in a thousand, like a full TX buffer would
+  std::vector<uint8_t> lossy;
+  lossy.reserve(stream.size());
+  for (int f = 0; f < frames; f++) {
+    if (f % 1000 != 500) {
+      lossy.insert(lossy.end(), &stream[(size_t)f * EXPORT_MAX_FRAME_LEN], &stream[(size_t)(f + 1) * EXPORT_MAX_FRAME_LEN]);
+    }
+  }
+  struct export_decoder d;
+  export_decoder_reset(&d);
+  uint64_t decoded_values = 0;
+  start = now_us();
+  for (size_t pos = 0; pos < lossy.size(); pos += 4096) {
+    export_decoder_feed(&d, &lossy[pos], std::min((size_t)4096, lossy.size() - pos), count_export_frame, &decoded_values);
+  }
+  double decode_us = now_us() - start;
+  printf("  export_samples_encode, %d values: %.0f ns on the host, ESP32 ~%.1f us (%.1f %% of a core at %d Hz)\n",
+         EXPORT_MAX_VALUES, encode_ns, encode_ns * ESP32_SLOWDOWN / 1000.0, encode_ns * ESP32_SLOWDOWN * EXPORT_SAMPLER_HZ / 1e7,
+         EXPORT_SAMPLER_HZ);
+  printf("  export_decoder_feed: %.0f MB/s on the host (%.0fx a 2 Mbaud link); %u frames, %u dropped found of %d lost, %u CRC errors\n",
+         lossy.size() / decode_us, lossy.size() / decode_us * 1e6 / 200000.0, d.frames, d.dropped, frames / 1000, d.crc_errors);
+  printf("\n");
+}
+
+// Config loading: the single pass parser (config_parse.h) against what the
+// sketches did before: splitYaml() copied every section, then every entry was
+// copied again with a section header and parsed into a JsonDocument of its own.
+// The JsonDocument / libyaml part needs the Arduino libraries, so only the
+// copies are measured here: the old numbers are a lower bound.
+struct bench_param {
+  int current_val, min, max;
+  bool modify_permission;
+};
+struct bench_pin {
+  std::string type;
+  int pin_number;
+};
+struct bench_config {                  // the sketches' vectors, std::string for String
+  std::vector<std::pair<std::string, int> > general;
+  struct sensor {
+    std::string name, status, type, function_name;
+    std::map<std::string, bench_param> parameters;
+  };
+  struct motor {
+    std::string name, type;
+    std::vector<bench_pin> pins;
+    bench_param safety_threshold;
+  };
+  std::vector<sensor> sensors;
+  std::vector<motor> motors;
+  std::vector<std::pair<std::string, std::string> > functions;
+};
+
+static std::string bench_text(const struct config_text& t){
+  return std::string(t.text, t.len);
+}
+
+static bench_param bench_param_of(const struct config_param& p){
+  bench_param out = {p.current_val, p.min, p.max, p.modify_permission};
+  return out;
+}
+
+// Like StoreConfigEntry() in shared_yaml_parser.h
+static void store_bench_entry(const struct config_entry* e, void* ctx){
+  struct bench_config* cfg = (struct bench_config*)ctx;
+  if (e->section == CONFIG_GENERAL) {
+    cfg->general.push_back(std::make_pair(bench_text(e->name), e->code));
+  } else if (e->section == CONFIG_SENSORS) {
+    bench_config::sensor sensor;
+    sensor.name = bench_text(e->name);
+    sensor.status = bench_text(e->status);
+    sensor.type = bench_text(e->type);
+    sensor.function_name = bench_text(e->function_name);
+    for (int i = 0; i < e->param_count; i++) {
+      sensor.parameters[bench_text(e->params[i].name)] = bench_param_of(e->params[i]);
+    }
+    cfg->sensors.push_back(sensor);
+  } else if (e->section == CONFIG_MOTORS) {
+    bench_config::motor motor;
+    motor.name = bench_text(e->name);
+    motor.type = bench_text(e->type);
+    for (int i = 0; i < e->pin_count; i++) {
+      bench_pin pin = {bench_text(e->pins[i].type), e->pins[i].pin_number};
+      motor.pins.push_back(pin);
+    }
+    motor.safety_threshold = bench_param_of(e->safety_threshold);
+    cfg->motors.push_back(motor);
+  } else if (e->section == CONFIG_FUNCTIONS) {
+    cfg->functions.push_back(std::make_pair(bench_text(e->name), bench_text(e->protocol_type)));
+  }
+}
+
+static void count_bench_entry(const struct config_entry* e, void* ctx){
+  (*(int*)ctx) += e->param_count + e->pin_count + 1;
+}
+
+// splitYaml() and the split*Field() copies, each entry freed after its (not modelled) parse
+static size_t legacy_split_copies(const char* yaml){
+  const char* keys[] = {"general:", "sensors:", "motors:", "functions:"};
+  const char* titles[] = {"general:\n  ", "sensors:\n  ", "motors:\n  ", "functions:\n  "};
+  char* sections[4];
+  for (int i = 0; i < 4; i++) {
+    const char* start = strstr(yaml, keys[i]);
+    const char* end = (start && i < 3) ? strstr(start, keys[i + 1]) : NULL;
+    sections[i] = NULL;
+    if (start) {
+      size_t len = (end ? end : yaml + strlen(yaml)) - start;
+      sections[i] = (char*)malloc(len + 1);
+      strncpy(sections[i], start, len);
+      sections[i][len] = '\0';
+    }
+  }
+  size_t entries = 0;
+  for (int i = 0; i < 4; i++) {
+    if (!sections[i]) {
+      continue;
+    }
+    const char* entry = strstr(sections[i], "- name:");
+    while (entry && strstr(entry, "- name:")) {
+      const char* entry_end = strstr(entry + 1, "- name:");
+      if (!entry_end) {
+        entry_end = sections[i] + strlen(sections[i]);
+      }
+      size_t title_len = strlen(titles[i]);
+      char* single = (char*)malloc(entry_end - entry + title_len + 1);
+      strncpy(single, titles[i], title_len);
+      strncpy(&single[title_len], entry, entry_end - entry);
+      single[entry_end - entry + title_len] = '\0';
+      entries += single[title_len] == '-';
+      free(single);
+      entry = entry_end;
+    }
+    free(sections[i]);
+  }
+  return entries;
+}
+
+static void bench_config_parse_one(const char* name, const std::string& yaml){
+  const int rounds = 2000;
+  size_t sink = 0;
+  start_heap_count();
+  double start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    sink += legacy_split_copies(yaml.c_str());
+  }
+  double split_us = (now_us() - start) / rounds;
+  count_allocs = false;
+  size_t split_allocs = heap_allocs / rounds;
+  long split_peak = heap_peak;
+
+  int items = 0;
+  struct config_parse_result result;
+  start_heap_count();
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    config_parse(yaml.data(), yaml.size(), count_bench_entry, &items, &result);
+  }
+  double parse_us = (now_us() - start) / rounds;
+  count_allocs = false;
+  size_t parse_allocs = heap_allocs;
+
+  struct bench_config* kept = NULL;
+  start_heap_count();
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    delete kept;
+    kept = new bench_config;
+    config_parse(yaml.data(), yaml.size(), store_bench_entry, kept, NULL);
+  }
+  double store_us = (now_us() - start) / rounds;
+  count_allocs = false;
+  size_t store_allocs = heap_allocs / rounds;
+  long store_peak = heap_peak;
+  size_t model_entries = kept->general.size() + kept->sensors.size() + kept->motors.size() + kept->functions.size();
+  delete kept;
+
+  printf("  %-22s %6zu B %4u entries | %7.1f us %5zu allocs %6ld B | %6.1f us %2zu allocs %4zu B | %7.1f us %5zu allocs %6ld B\n",
+         name, yaml.size(), result.entries, split_us, split_allocs, split_peak, parse_us, parse_allocs,
+         sizeof(struct config_entry), store_us, store_allocs, store_peak);
+  if (model_entries + result.skipped_lines == 0 || (int)sink < 0 || items < 0) {
+    printf("  (nothing parsed)\n");
+  }
+}
+
+static void bench_config_parse(const std::string& yaml){
+  printf("== Config loading: single pass config_parse against splitYaml + a copy and a JsonDocument per entry ==\n");
+  printf("  %-44s | %-32s | %-26s | %s\n", "config", "split + entry copies (no JSON)", "config_parse, no model",
+         "config_parse into the structs");
+  printf("  %-44s | %10s %12s %8s | %9s %9s %6s | %10s %12s %8s\n", "", "time", "allocs", "peak",
+         "time", "allocs", "stack", "time", "allocs", "peak");
+  bench_config_parse_one("example config", yaml);
+  std::string def = default_yaml();
+  if (!def.empty()) {
+    bench_config_parse_one("default config (mock)", def);
+  }
+  // 2 general entries + 200: 80 sensors, 60 motors, 60 functions
+  bench_config_parse_one("200 entities", synthetic_yaml(80, 60, 60));
+  printf("  (per parse on the host, ESP32 ~x%.0f; peak: highest heap in use above the yaml text)\n", ESP32_SLOWDOWN);
+  printf("  the old path also built a JsonDocument through libyaml for every entry, not counted here\n");
+  printf("\n");
+}
+
+// Config model: the same config kept as the sketches' structs (String fields, a
+// std::map of parameters per sensor, vectors of entries; std::string stands in
+// for String) against config_model.h, interned names and flat arrays in one
+// static struct. Heap after loading, and what a load costs.
+static struct config_model bench_model;
+
+static size_t model_used_bytes(const struct config_model* m){
+  return sizeof(struct config_model_sensor) * m->sensor_count + sizeof(struct config_model_motor) * m->motor_count +
+         sizeof(struct config_model_function) * m->function_count + sizeof(struct config_model_general) * m->general_count +
+         sizeof(struct config_model_communication) * m->communication_count +
+         sizeof(struct config_model_param) * m->param_count + sizeof(struct config_model_pin) * m->pin_count + m->pool_len;
+}
+
+static void bench_config_model_one(const char* name, const std::string& yaml){
+  const int rounds = 2000;
+  start_heap_count();
+  struct bench_config* cfg = new bench_config;
+  config_parse(yaml.data(), yaml.size(), store_bench_entry, cfg, NULL);
+  count_allocs = false;
+  size_t structs_allocs = heap_allocs;
+  long structs_bytes = heap_live;
+  delete cfg;
+  double start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    cfg = new bench_config;
+    config_parse(yaml.data(), yaml.size(), store_bench_entry, cfg, NULL);
+    delete cfg;
+  }
+  double structs_us = (now_us() - start) / rounds;
+
+  start_heap_count();
+  config_model_reset(&bench_model);
+  config_model_load(&bench_model, yaml.data(), yaml.size(), NULL);
+  count_allocs = false;
+  size_t model_allocs = heap_allocs;
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    config_model_reset(&bench_model);
+    config_model_load(&bench_model, yaml.data(), yaml.size(), NULL);
+  }
+  double model_us = (now_us() - start) / rounds;
+  printf("  %-22s | %5zu allocs %6ld B %6.1f us | %2zu allocs %5zu B used of %zu B, %3u strings in %4u B, %u dropped %6.1f us\n",
+         name, structs_allocs, structs_bytes, structs_us, model_allocs, model_used_bytes(&bench_model),
+         sizeof(struct config_model), bench_model.name_count, bench_model.pool_len, bench_model.dropped, model_us);
+}
+
+static void bench_config_model(const std::string& yaml){
+  printf("== Config model: String / std::map structs against interned names and flat arrays ==\n");
+  printf("  %-22s | %-35s | %s\n", "config", "structs (heap after the load)", "config_model (static, no heap)");
+  bench_config_model_one("example config", yaml);
+  std::string def = default_yaml();
+  if (!def.empty()) {
+    bench_config_model_one("default config (mock)", def);
+  }
+  printf("  (host: 8 byte pointers and 15 char std::string SSO, so String on the ESP32 allocates more often;\n");
+  printf("   each heap block also carries the allocator's header. The model has no pointers, same size on both.)\n");
+  printf("\n");
+}
+
+// Config snapshot (config_snapshot.h): the YAML sections, LZ compressed when the
+// screen allows it, against the binary snapshot of the model; parsed into the
+// model on the screen against copied into it.
+static uint32_t bench_snapshot_buf[CONFIG_SNAPSHOT_MAX_LEN / 4 + 1];   // 4 byte aligned
+
+static size_t lz_on_air(const uint8_t* data, size_t len){
+  static struct lz_compressor lz;
+  std::vector<uint8_t> packed(lz_compress_bound(len));
+  size_t packed_len = lz_compress(&lz, data, len, &packed[0], packed.size());
+  return packed_len > 0 && packed_len < len ? packed_len : len;
+}
+
+static void bench_config_snapshot_one(const char* name, const std::string& yaml){
+  const int rounds = 2000;
+  std::vector<std::string> sections = split_sections(yaml);
+  std::vector<std::string> sections_on_air;
+  size_t text_len = 0;
+  size_t text_lz_len = 0;
+  for (size_t i = 0; i < sections.size(); i++) {
+    size_t len = lz_on_air((const uint8_t*)sections[i].data(), sections[i].size());
+    text_len += sections[i].size();
+    text_lz_len += len;
+    sections_on_air.push_back(std::string(len, 'x'));
+  }
+  double start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    config_model_reset(&bench_model);
+    for (size_t i = 0; i < sections.size(); i++) {
+      config_model_load(&bench_model, sections[i].data(), sections[i].size(), NULL);
+    }
+  }
+  double parse_us = (now_us() - start) / rounds;
+
+  // The mock makes the snapshot from the whole file, file_type included
+  config_model_reset(&bench_model);
+  config_model_load(&bench_model, yaml.data(), yaml.size(), NULL);
+  uint8_t* snapshot = (uint8_t*)bench_snapshot_buf;
+  size_t snapshot_len = config_snapshot_encode(&bench_model, config_digest((const uint8_t*)yaml.data(), yaml.size()),
+                                               snapshot, sizeof(bench_snapshot_buf));
+  size_t snapshot_lz_len = lz_on_air(snapshot, snapshot_len);
+  struct config_snapshot view;
+  bool ok = true;
+  start = now_us();
+  for (int r = 0; r < rounds * 10; r++) {
+    ok = config_snapshot_open(snapshot, snapshot_len, &view) && ok;
+  }
+  double open_us = (now_us() - start) / (rounds * 10);
+  start = now_us();
+  for (int r = 0; r < rounds * 10; r++) {
+    ok = config_snapshot_load(&bench_model, snapshot, snapshot_len) && ok;
+  }
+  double load_us = (now_us() - start) / (rounds * 10);
+  if (!ok) {
+    printf("  SNAPSHOT REJECTED\n");
+  }
+  printf("  %-22s | %5zu B text, %5zu B LZ | %4zu B, %4zu B LZ | parse %6.1f us | open %5.2f us, load %5.2f us (%.0fx)%s\n",
+         name, text_len, text_lz_len, snapshot_len, snapshot_lz_len, parse_us, open_us, load_us, parse_us / load_us,
+         bench_model.dropped ? " (entries dropped)" : "");
+  std::vector<std::string> snapshot_on_air(1, std::string(snapshot_lz_len, 'x'));
+  const uint16_t mtus[] = {23, 247};
+  for (size_t m = 0; m < sizeof(mtus) / sizeof(mtus[0]); m++) {
+    size_t stride = wire_frag_payload_size(mtus[m]);
+    int window = stream_window(stride, YAML_STREAM_WINDOW_BYTES);
+    unsigned text_frags = 0;
+    for (size_t i = 0; i < sections_on_air.size(); i++) {
+      text_frags += wire_frag_count(sections_on_air[i].size(), stride);
+    }
+    double text_ms = streamed_download_ms(sections_on_air, stride, window) + parse_us / 1000.0 * ESP32_SLOWDOWN;
+    double snapshot_ms = streamed_download_ms(snapshot_on_air, stride, window) + load_us / 1000.0 * ESP32_SLOWDOWN;
+    printf("      MTU %3u: %3u -> %3u fragments, download + load %7.1f ms -> %7.1f ms\n", mtus[m], text_frags,
+           wire_frag_count(snapshot_lz_len, stride), text_ms, snapshot_ms);
+  }
+}
+
+static void bench_config_snapshot(const std::string& yaml){
+  printf("== Config snapshot: YAML sections parsed on the screen vs the binary snapshot copied into the model ==\n");
+  printf("  %-22s | %-24s | %-17s | %-15s | %s\n", "config", "YAML sections on air", "snapshot on air", "YAML -> model",
+         "snapshot -> model");
+  bench_config_snapshot_one("example config", yaml);
+  std::string def = default_yaml();
+  if (!def.empty()) {
+    bench_config_snapshot_one("default config (mock)", def);
+  }
+  bench_config_snapshot_one("16 sensors, 16 motors", synthetic_yaml(16, 16, 8));
+  printf("  (download: streamed with the LZ cap, window %d B; load time x%.0f for the ESP32. open only checks the\n",
+         YAML_STREAM_WINDOW_BYTES, ESP32_SLOWDOWN);
+  printf("   header and the CRC, load adds the copy into the model. Without LZ the snapshot goes as it is.)\n");
+  printf("\n");
+}
+
+// Config sections parsed as their fragments arrive (config_stream.h) against parsed
+// once all four are in, in a loopback: the sections are fragmented as the mock
+// sends them (LZ when shorter), decoded, reassembled and parsed as on the screen,
+// and every step is timed on this host (x ESP32_SLOWDOWN). The fragments arrive
+// as the streamed download model has them, and the BLE callback handles them one
+// after the other. Today load_yaml_step then parses the sections in one go on the
+// UI thread; streamed, they are in handConfig when the last fragment is handled.
+static struct config_stream bench_stream;
+
+// When the screen is done with the last fragment, each one waiting for the previous
+static double handle_fragments_ms(const std::vector<double>& arrivals, const std::vector<double>& cost_us, int rounds,
+                                  double* longest_us){
+  double t = 0;
+  *longest_us = 0;
+  for (size_t i = 0; i < arrivals.size(); i++) {
+    double us = cost_us[i] / rounds * ESP32_SLOWDOWN;
+    t = std::max(t, arrivals[i]) + us / 1000.0;
+    *longest_us = std::max(*longest_us, us);
+  }
+  return t;
+}
+
+static void bench_config_stream_one(const char* name, const std::string& yaml, bool lz, uint16_t mtu){
+  const int rounds = 200;
+  std::vector<std::string> sections = split_sections(yaml);
+  size_t stride = wire_frag_payload_size(mtu);
+  std::vector<std::string> on_air;
+  std::vector<std::vector<uint8_t> > frags;
+  for (size_t s = 0; s < sections.size(); s++) {
+    std::string data = sections[s];
+    if (lz) {
+      static struct lz_compressor lzc;
+      std::vector<uint8_t> packed(lz_compress_bound(data.size()));
+      size_t packed_len = lz_compress(&lzc, (const uint8_t*)data.data(), data.size(), &packed[0], packed.size());
+      if (packed_len > 0 && packed_len < data.size()) {
+        data.assign((const char*)&packed[0], packed_len);
+      }
+    }
+    on_air.push_back(data);
+    uint16_t cnt = wire_frag_count(data.size(), stride);
+    for (uint16_t i = 1; i <= cnt; i++) {
+      uint8_t buf[WIRE_FRAME_MAX_LEN];
+      size_t len = wire_frag_encode(buf, sizeof(buf), YML_SENSOR_ANS + (int)s, (uint8_t)s, (const uint8_t*)data.data(),
+                                    data.size(), stride, i);
+      frags.push_back(std::vector<uint8_t>(buf, buf + len));
+    }
+  }
+  std::vector<double> arrivals;
+  streamed_download_ms(on_air, stride, stream_window(stride, YAML_STREAM_WINDOW_BYTES), &arrivals);
+
+  std::vector<double> today_us(frags.size(), 0.0);
+  std::vector<double> streamed_us(frags.size(), 0.0);
+  double burst_us = 0;
+  int today_entries = 0;
+  int streamed_entries = 0;
+  bool all_streamed = true;
+  struct wire_reassembler reasm;
+  memset(&reasm, 0, sizeof(reasm));
+  for (int r = 0; r < rounds; r++) {
+    // Today: reassembly and decompression in the callback, the parse in load_yaml_step
+    wire_reasm_reset(&reasm);
+    std::vector<uint8_t*> texts;
+    for (size_t f = 0; f < frags.size(); f++) {
+      double start = now_us();
+      struct wire_frame frame;
+      wire_frame_decode(&frags[f][0], frags[f].size(), &frame);
+      if (wire_reasm_push(&reasm, &frame, 0) == WIRE_REASM_DONE) {
+        size_t len = 0;
+        uint8_t* msg = wire_reasm_take(&reasm, &len);
+        if (lz_is_compressed(msg, len)) {
+          uint8_t* raw = lz_decompress(msg, len, &len);
+          free(msg);
+          msg = raw;
+        }
+        texts.push_back(msg);
+      }
+      today_us[f] += now_us() - start;
+    }
+    double start = now_us();
+    config_model_reset(&bench_model);
+    today_entries = 0;
+    for (size_t i = 0; i < texts.size(); i++) {
+      today_entries += config_model_load(&bench_model, (const char*)texts[i], strlen((const char*)texts[i]), NULL);
+    }
+    burst_us += now_us() - start;
+    for (size_t i = 0; i < texts.size(); i++) {
+      free(texts[i]);
+    }
+
+    // Streamed: the parse in the callback as well
+    wire_reasm_reset(&reasm);
+    config_model_reset(&bench_model);
+    streamed_entries = 0;
+    for (size_t f = 0; f < frags.size(); f++) {
+      start = now_us();
+      struct wire_frame frame;
+      wire_frame_decode(&frags[f][0], frags[f].size(), &frame);
+      int status = wire_reasm_push(&reasm, &frame, 0);
+      int parsed = config_stream_fragment(&bench_stream, &bench_model, &frame);
+      if (status == WIRE_REASM_DONE) {
+        size_t len = 0;
+        uint8_t* msg = wire_reasm_take(&reasm, &len);
+        uint8_t* raw = NULL;
+        all_streamed = all_streamed && parsed == CONFIG_STREAM_DONE;
+        if (parsed == CONFIG_STREAM_DONE) {
+          streamed_entries += config_stream_end(&bench_stream, NULL, &raw, &len);
+        }
+        free(msg);
+        free(raw);
+      }
+      streamed_us[f] += now_us() - start;
+    }
+  }
+  wire_reasm_reset(&reasm);
+  double today_longest_us, streamed_longest_us;
+  double last_ms = arrivals.back();
+  double burst_ms = burst_us / rounds * ESP32_SLOWDOWN / 1000.0;
+  double today_ms = handle_fragments_ms(arrivals, today_us, rounds, &today_longest_us) + burst_ms;
+  double streamed_ms = handle_fragments_ms(arrivals, streamed_us, rounds, &streamed_longest_us);
+  printf("  %-22s %-3s %4u %5zu | %7.1f ms | %7.1f ms, UI thread %5.2f ms | %7.1f ms, callback <= %4.0f us | %5.2f ms%s\n",
+         name, lz ? "LZ" : "-", mtu, frags.size(), last_ms, today_ms, burst_ms, streamed_ms, streamed_longest_us,
+         today_ms - streamed_ms, all_streamed && today_entries == streamed_entries ? "" : " (NOT ALL STREAMED)");
+}
+
+static void bench_config_stream(const std::string& yaml){
+  printf("== Config parse: sections parsed in load_yaml_step once all are in vs parsed as the fragments arrive ==\n");
+  printf("  loopback: real fragments, reassembly, LZ and parse, timed here x%.0f; arrivals from the streamed download model\n",
+         ESP32_SLOWDOWN);
+  printf("  %-22s %-3s %4s %5s | %-10s | %-30s | %-32s | %s\n", "config", "LZ", "MTU", "frags", "last frag",
+         "parsed once all are in", "parsed as they arrive", "saved");
+  std::string big = synthetic_yaml(16, 16, 8);
+  const uint16_t mtus[] = {23, 247};
+  for (int lz = 0; lz < 2; lz++) {
+    for (size_t m = 0; m < sizeof(mtus) / sizeof(mtus[0]); m++) {
+      bench_config_stream_one("example config", yaml, lz != 0, mtus[m]);
+      bench_config_stream_one("16 sensors, 16 motors", big, lz != 0, mtus[m]);
+    }
+  }
+  printf("  (times from the YAML_REQ to the config being in handConfig, before the poll of load_yaml_step (every\n");
+  printf("   100 ms) that puts up the user screen, the same for both. callback: longest time the BLE callback takes\n");
+  printf("   on one fragment when it parses as well.)\n");
+  printf("\n");
+}
+
+// Config index (config_index.h): the lookups the screen makes by name, type and
+// for its dropdowns, done by scanning the entries on every use against an index
+// built once per config. The model holds 16 sensors and motors and 32 functions,
+// so the scaling rows use arrays of N entries laid out as the model's (interned
+// ids) with a table probed as config_index does; the config_model_find() of a
+// selected text is the same for both and left out. The Hand class of the
+// modified sketch (classes.h) scans std::string names, against its std::map.
+struct bench_index_table {
+  std::vector<uint16_t> names;   // slot -> name, 0xFFFF free
+  std::vector<uint16_t> ids;
+  uint32_t mask;
+};
+
+static uint32_t bench_slot_of(uint16_t name, uint32_t mask){
+  return (((uint32_t)name * 2654435761u) >> 16) & mask;
+}
+
+static void bench_index_build(struct bench_index_table* t, const std::vector<uint16_t>& names){
+  uint32_t slots = 1;
+  while (slots < names.size() * 2) {
+    slots <<= 1;
+  }
+  t->mask = slots - 1;
+  t->names.assign(slots, 0xFFFF);
+  t->ids.assign(slots, 0);
+  for (size_t i = 0; i < names.size(); i++) {
+    uint32_t slot = bench_slot_of(names[i], t->mask);
+    while (t->names[slot] != 0xFFFF && t->names[slot] != names[i]) {
+      slot = (slot + 1) & t->mask;
+    }
+    if (t->names[slot] == 0xFFFF) {
+      t->names[slot] = names[i];
+      t->ids[slot] = (uint16_t)i;
+    }
+  }
+}
+
+static int bench_index_id(const struct bench_index_table* t, uint16_t name){
+  uint32_t slot = bench_slot_of(name, t->mask);
+  while (t->names[slot] != 0xFFFF) {
+    if (t->names[slot] == name) {
+      return t->ids[slot];
+    }
+    slot = (slot + 1) & t->mask;
+  }
+  return -1;
+}
+
+// get_options_string() of the screen: one malloc and the names copied per dropdown
+static char* bench_options_string(const std::vector<std::string>& names){
+  size_t total = 0;
+  for (size_t i = 0; i < names.size(); i++) {
+    total += names[i].size() + 1;
+  }
+  char* result = (char*)malloc(total + 1);
+  char* pos = result;
+  for (size_t i = 0; i < names.size(); i++) {
+    memcpy(pos, names[i].c_str(), names[i].size());
+    pos += names[i].size();
+    *pos++ = '\n';
+  }
+  *(pos - 1) = '\0';
+  return result;
+}
+
+static void bench_config_index_one(size_t n){
+  const int lookups = 200000;
+  std::vector<std::string> names(n);
+  std::vector<uint16_t> interned(n);
+  std::vector<uint16_t> types(n);
+  std::map<std::string, size_t> hand_map;
+  for (size_t i = 0; i < n; i++) {
+    names[i] = "sensor_" + std::to_string(i);
+    interned[i] = (uint16_t)(1 + i * 12);   // pool offsets, as config_model_intern() gives them
+    types[i] = i % 4 == 0 ? 1 : 2;          // every 4th is a gesture
+    hand_map[names[i]] = i;
+  }
+  long sink = 0;
+
+  // Lookup of an entry by name: the dropdown and the Hand getters
+  double start = now_us();
+  for (int r = 0; r < lookups; r++) {
+    const std::string& name = names[(r * 7919u) % n];
+    size_t id = 0;
+    while (id < n && names[id] != name) {
+      id++;
+    }
+    sink += id;
+  }
+  double text_ns = (now_us() - start) * 1000.0 / lookups;
+  start = now_us();
+  for (int r = 0; r < lookups; r++) {
+    sink += hand_map.find(names[(r * 7919u) % n])->second;
+  }
+  double map_ns = (now_us() - start) * 1000.0 / lookups;
+  start = now_us();
+  for (int r = 0; r < lookups; r++) {
+    uint16_t name = interned[(r * 7919u) % n];
+    size_t id = 0;
+    while (id < n && interned[id] != name) {
+      id++;
+    }
+    sink += id;
+  }
+  double scan_ns = (now_us() - start) * 1000.0 / lookups;
+  struct bench_index_table table;
+  const int builds = 2000;
+  start = now_us();
+  for (int r = 0; r < builds; r++) {
+    bench_index_build(&table, interned);
+  }
+  double build_us = (now_us() - start) / builds;
+  start = now_us();
+  for (int r = 0; r < lookups; r++) {
+    sink += bench_index_id(&table, interned[(r * 7919u) % n]);
+  }
+  double index_ns = (now_us() - start) * 1000.0 / lookups;
+
+  // Dropdown options: rebuilt for every dropdown against the cached string
+  const int rounds = 20000;
+  start_heap_count();
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    char* options = bench_options_string(names);
+    sink += options[0];
+    free(options);
+  }
+  double options_us = (now_us() - start) / rounds;
+  count_allocs = false;
+  double options_allocs = (double)heap_allocs / rounds;
+
+  // Gesture functions: counted on every use against the list of the index
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    int count = 0;
+    for (size_t i = 0; i < n; i++) {
+      count += types[i] == 1;
+    }
+    sink += count;
+  }
+  double gestures_us = (now_us() - start) / rounds;
+
+  printf("  %4zu | %7.1f ns %6.1f ns | %6.1f ns %5.1f ns | %5.1f us | %6.2f us, %.0f alloc | %6.3f us | (%ld)\n", n, text_ns,
+         map_ns, scan_ns, index_ns, build_us, options_us, options_allocs, gestures_us, sink & 1);
+}
+
+static struct config_index bench_index;
+
+static void bench_config_index(const std::string& yaml){
+  printf("== Config index: lookups by name, type and dropdown options scanned per use vs indexed once per config ==\n");
+  printf("  %4s | %-20s | %-18s | %-8s | %-18s | %s\n", "N", "by text: scan, map", "by id: scan, index",
+         "build", "options rebuilt", "gestures counted");
+  const size_t sizes[] = {10, 100, 1000};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    bench_config_index_one(sizes[i]);
+  }
+  printf("  (indexed: the options and the gestures are a pointer and a count, read in a few ns.)\n");
+
+  // The real index over the example config
+  const int rounds = 20000;
+  config_model_reset(&bench_model);
+  config_model_load(&bench_model, yaml.data(), yaml.size(), NULL);
+  const struct config_model* m = &bench_model;
+  long sink = 0;
+  double start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    config_index_build(&bench_index, m);
+  }
+  double build_us = (now_us() - start) / rounds;
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    sink += config_index_refresh(&bench_index, m);
+  }
+  double refresh_ns = (now_us() - start) * 1000.0 / rounds;
+  int found = 0;
+  start = now_us();
+  for (int r = 0; r < rounds; r++) {
+    for (uint8_t i = 0; i < m->sensor_count; i++) {
+      found += config_index_id(&bench_index, CONFIG_INDEX_SENSORS, m->sensors[i].name) == i;
+    }
+  }
+  double lookup_ns = (now_us() - start) * 1000.0 / rounds / std::max(1, (int)m->sensor_count);
+  printf("  example config (%u sensors, %u motors, %u functions): config_index_build %.2f us (x%.0f on the ESP32),\n",
+         m->sensor_count, m->motor_count, m->function_count, build_us, ESP32_SLOWDOWN);
+  printf("   refresh of an unchanged model %.1f ns, lookup %.1f ns, %d of %d found (%ld), %zu B static\n", refresh_ns,
+         lookup_ns, found, rounds * m->sensor_count, sink & 1, sizeof(struct config_index));
+  printf("\n");
+}
+
+int main(int argc, char** argv){
+  const char* yaml_path = argc > 1 ? argv[1] : DEFAULT_YAML_PATH;
+  std::string yaml = read_file(yaml_path);
+  bench_framing(yaml);
+  bench_mtu_sweep(yaml);
+  bench_tx_allocations();
+  bench_batch_cmd();
+  bench_crc(yaml);
+  bench_yaml_download(yaml);
+  bench_compression(yaml);
+  bench_telemetry();
+  bench_sample_ring();
+  bench_downsample();
+  bench_plot();
+  bench_history();
+  bench_recorder();
+  bench_stats();
+  bench_export();
+  bench_config_parse(yaml);
+  bench_config_model(yaml);
+  bench_config_snapshot(yaml);
+  bench_config_stream(yaml);
+  bench_config_index(yaml);
+  return 0;
+}
@@ -0,0 +1,2232 @@
+// Unit tests for the ProsthesisProtocol library (framing, fragmentation, CRC,
+// reassembly, selective resend, command batches, LZ codec, telemetry, sample ring, clock sync,
+// downsampling, plot damage, history tiers, black box log, rolling statistics,
+// serial export, config parsing, model, snapshot, streamed parse and index), built natively.
+// Exits with 1 if any check fails.
+//
+// Build and run from this folder:
+//   make test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ProsthesisProtocol.h"
+
+static int checks = 0;
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    checks++; \
+    if (!(cond)) { \
+      failures++; \
+      printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+  } while (0)
+
+#define CHECK_EQ(a, b) do { \
+    checks++; \
+    long long va_ = (long long)(a), vb_ = (long long)(b); \
+    if (va_ != vb_) { \
+      failures++; \
+      printf("  FAILED %s:%d: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, va_, vb_); \
+    } \
+  } while (0)
+
+static uint32_t rng_state = 12345;
+static uint32_t rng_next(){
+  rng_state = rng_state * 1103515245u + 12345u;
+  return rng_state >> 8;
+}
+
+static std::string sample_text(size_t len){
+  static const char* words[] = {"sensor", "motor", "threshold: ", "pins: [", "gesture", "\n  - ", "enabled", "12", "0.5"};
+  std::string text;
+  while (text.size() < len) {
+    text += words[rng_next() % 9];
+  }
+  text.resize(len);
+  return text;
+}
+
+// Reference CRC-16/CCITT-FALSE, one bit at a time.
+static uint16_t crc16_bitwise(const uint8_t* data, size_t length){
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)(data[i] << 8);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static void test_crc16(){
+  CHECK_EQ(wire_crc16((const uint8_t*)"123456789", 9), 0x29B1);
+  CHECK_EQ(wire_crc16(NULL, 0), 0xFFFF);
+  std::string text = sample_text(600);
+  for (size_t len = 0; len <= text.size(); len += 7) {
+    CHECK_EQ(wire_crc16((const uint8_t*)text.data(), len), crc16_bitwise((const uint8_t*)text.data(), len));
+  }
+}
+
+static void test_frame_round_trip(){
+  const char* payload = "0|3|42";
+  uint8_t frame[WIRE_FRAME_MAX_LEN];
+  size_t len = wire_frame_encode(frame, sizeof(frame), READ_ANS, 7, 1, 1, (const uint8_t*)payload, 6);
+  CHECK_EQ(len, WIRE_FRAME_HDR_LEN + 6);
+  struct wire_frame decoded;
+  CHECK_EQ(wire_frame_decode(frame, len, &decoded), WIRE_OK);
+  CHECK_EQ(decoded.req_type, READ_ANS);
+  CHECK_EQ(decoded.seq, 7);
+  CHECK_EQ(decoded.frag_idx, 1);
+  CHECK_EQ(decoded.frag_cnt, 1);
+  CHECK_EQ(decoded.payload_len, 6);
+  CHECK(memcmp(decoded.payload, payload, 6) == 0);
+
+  CHECK_EQ(wire_frame_decode(frame, WIRE_FRAME_HDR_LEN - 1, &decoded), WIRE_ERR_SHORT);
+  CHECK_EQ(wire_frame_decode(frame, len - 1, &decoded), WIRE_ERR_LENGTH);
+  frame[WIRE_FRAME_HDR_LEN + 2] ^= 0x01;
+  CHECK_EQ(wire_frame_decode(frame, len, &decoded), WIRE_ERR_CHECKSUM);
+  CHECK_EQ(wire_frame_encode(frame, WIRE_FRAME_HDR_LEN + 5, READ_ANS, 7, 1, 1, (const uint8_t*)payload, 6), 0);
+}
+
+static void test_fragment_sizes(){
+  CHECK_EQ(wire_frag_payload_size(0), WIRE_DEFAULT_MTU - WIRE_ATT_OVERHEAD - WIRE_FRAME_HDR_LEN);
+  CHECK_EQ(wire_frag_payload_size(WIRE_DEFAULT_MTU), 10);
+  CHECK_EQ(wire_frag_payload_size(185), 172);
+  CHECK_EQ(wire_frag_payload_size(2000), WIRE_FRAME_MAX_PAYLOAD);
+  CHECK_EQ(wire_frag_count(0, 10), 1);
+  CHECK_EQ(wire_frag_count(10, 10), 1);
+  CHECK_EQ(wire_frag_count(11, 10), 2);
+
+  uint8_t frame[WIRE_FRAME_MAX_LEN];
+  const char* msg = "abcdefghijklmnopqrstuvw";
+  CHECK_EQ(wire_frag_encode(frame, sizeof(frame), 0, 0, (const uint8_t*)msg, 23, 10, 0), 0);
+  CHECK_EQ(wire_frag_encode(frame, sizeof(frame), 0, 0, (const uint8_t*)msg, 23, 10, 4), 0);
+  CHECK_EQ(wire_frag_encode(frame, sizeof(frame), 0, 0, (const uint8_t*)msg, 23, 10, 3), WIRE_FRAME_HDR_LEN + 3);
+}
+
+// Encodes msg as fragments and returns them in order.
+static std::vector<std::vector<uint8_t> > fragment(const std::string& msg, uint8_t req_type, uint8_t seq, size_t stride){
+  std::vector<std::vector<uint8_t> > frames;
+  uint16_t cnt = wire_frag_count(msg.size(), stride);
+  for (uint16_t i = 1; i <= cnt; i++) {
+    uint8_t buf[WIRE_FRAME_MAX_LEN];
+    size_t len = wire_frag_encode(buf, sizeof(buf), req_type, seq, (const uint8_t*)msg.data(), msg.size(), stride, i);
+    frames.push_back(std::vector<uint8_t>(buf, buf + len));
+  }
+  return frames;
+}
+
+static int push(struct wire_reassembler* reasm, const std::vector<uint8_t>& bytes, uint32_t now_ms){
+  struct wire_frame frame;
+  if (wire_frame_decode(bytes.data(), bytes.size(), &frame) != WIRE_OK) {
+    return -1;
+  }
+  return wire_reasm_push(reasm, &frame, now_ms);
+}
+
+static bool take_equals(struct wire_reassembler* reasm, const std::string& expected){
+  size_t len = 0;
+  uint8_t* msg = wire_reasm_take(reasm, &len);
+  bool same = msg != NULL && len == expected.size() && memcmp(msg, expected.data(), len) == 0 && msg[len] == '\0';
+  free(msg);
+  return same;
+}
+
+static void test_reassembly_orders(){
+  std::string msg = sample_text(95);
+  std::vector<std::vector<uint8_t> > frames = fragment(msg, YML_SENSOR_ANS, 3, 10);
+  struct wire_reassembler reasm;
+  memset(&reasm, 0, sizeof(reasm));
+
+  for (size_t i = 0; i < frames.size(); i++) {
+    CHECK_EQ(push(&reasm, frames[i], 0), i + 1 == frames.size() ? WIRE_REASM_DONE : WIRE_REASM_IN_PROGRESS);
+  }
+  CHECK(take_equals(&reasm, msg));
+  // Late duplicate of a completed transfer
+  CHECK_EQ(push(&reasm, frames[2], 0), WIRE_REASM_DUPLICATE);
+  CHECK_EQ(push(&reasm, frames[2], WIRE_REASM_RECENT_MS - 1), WIRE_REASM_DUPLICATE);
+  // The same key once the resend window is over is a new transfer (seq restarted
+  // after a reboot, or wrapped)
+  for (size_t i = 0; i < frames.size(); i++) {
+    CHECK_EQ(push(&reasm, frames[i], WIRE_REASM_RECENT_MS), i + 1 == frames.size() ? WIRE_REASM_DONE : WIRE_REASM_IN_PROGRESS);
+  }
+  CHECK(take_equals(&reasm, msg));
+
+  // Last fragment first: parked until the stride is known
+  frames = fragment(msg, YML_SENSOR_ANS, 4, 10);
+  for (size_t i = frames.size(); i-- > 0;) {
+    CHECK_EQ(push(&reasm, frames[i], 0), i == 0 ? WIRE_REASM_DONE : WIRE_REASM_IN_PROGRESS);
+  }
+  CHECK(take_equals(&reasm, msg));
+
+  // Shuffled with duplicates
+  frames = fragment(msg, YML_MOTORS_ANS, 5, 10);
+  std::vector<size_t> order;
+  for (size_t i = 0; i < frames.size(); i++) {
+    order.push_back(i);
+    order.push_back(i);
+  }
+  for (size_t i = order.size(); i > 1; i--) {
+    std::swap(order[i - 1], order[rng_next() % i]);
+  }
+  int done = 0;
+  for (size_t i = 0; i < order.size(); i++) {
+    int status = push(&reasm, frames[order[i]], 0);
+    if (status == WIRE_REASM_DONE) {
+      done++;
+      CHECK(take_equals(&reasm, msg));
+    }
+  }
+  CHECK_EQ(done, 1);
+  CHECK(reasm.duplicates >= frames.size());
+
+  // Fragment count that disagrees with the running transfer
+  frames = fragment(msg, YML_FUNC_ANS, 6, 10);
+  CHECK_EQ(push(&reasm, frames[0], 0), WIRE_REASM_IN_PROGRESS);
+  std::vector<std::vector<uint8_t> > other = fragment(msg.substr(0, 40), YML_FUNC_ANS, 6, 10);
+  CHECK_EQ(push(&reasm, other[1], 0), WIRE_REASM_ERROR);
+
+  // An empty fragment that is not the last would give a stride of 0: refused,
+  // and the transfer still completes with the real fragments
+  frames = fragment(msg.substr(0, 30), YML_GENERAL_ANS, 7, 10);
+  uint8_t empty[WIRE_FRAME_MAX_LEN];
+  size_t empty_len = wire_frame_encode(empty, sizeof(empty), YML_GENERAL_ANS, 7, 1, (uint16_t)frames.size(), NULL, 0);
+  CHECK_EQ(push(&reasm, std::vector<uint8_t>(empty, empty + empty_len), 0), WIRE_REASM_ERROR);
+  empty_len = wire_frame_encode(empty, sizeof(empty), YML_GENERAL_ANS, 7, 2, (uint16_t)frames.size(), NULL, 0);
+  CHECK_EQ(push(&reasm, std::vector<uint8_t>(empty, empty + empty_len), 0), WIRE_REASM_ERROR);
+  for (size_t i = 0; i < frames.size(); i++) {
+    CHECK_EQ(push(&reasm, frames[i], 0), i + 1 == frames.size() ? WIRE_REASM_DONE : WIRE_REASM_IN_PROGRESS);
+  }
+  CHECK(take_equals(&reasm, msg.substr(0, 30)));
+  wire_reasm_reset(&reasm);
+}
+
+static void test_selective_resend(){
+  std::string msg = sample_text(200);
+  std::vector<std::vector<uint8_t> > frames = fragment(msg, YML_GENERAL_ANS, 9, 10);
+  struct wire_reassembler reasm;
+  memset(&reasm, 0, sizeof(reasm));
+  for (size_t i = 0; i < frames.size(); i++) {
+    // Lose fragments 2, 3 and 5
+    if (i != 1 && i != 2 && i != 4) {
+      push(&reasm, frames[i], 100);
+    }
+  }
+  char req[MAX_MSG_LEN];
+  CHECK(!wire_reasm_poll(&reasm, 100 + WIRE_REASM_RESEND_MS - 1, req, sizeof(req)));
+  CHECK(wire_reasm_poll(&reasm, 100 + WIRE_REASM_RESEND_MS, req, sizeof(req)));
+  char expected[32];
+  snprintf(expected, sizeof(expected), "9|%d|2-3|5", YML_GENERAL_ANS);
+  CHECK(strcmp(req, expected) == 0);
+
+  uint8_t seq = 0;
+  uint8_t req_type = 0;
+  struct wire_frag_range ranges[WIRE_RESEND_MAX_RANGES];
+  CHECK_EQ(wire_resend_parse(req, &seq, &req_type, ranges, WIRE_RESEND_MAX_RANGES), 2);
+  CHECK_EQ(seq, 9);
+  CHECK_EQ(req_type, YML_GENERAL_ANS);
+  CHECK_EQ(ranges[0].first, 2);
+  CHECK_EQ(ranges[0].last, 3);
+  CHECK_EQ(ranges[1].first, 5);
+  CHECK_EQ(ranges[1].last, 5);
+  for (int r = 0; r < 2; r++) {
+    for (uint16_t idx = ranges[r].first; idx <= ranges[r].last; idx++) {
+      push(&reasm, frames[idx - 1], 500);
+    }
+  }
+  CHECK(take_equals(&reasm, msg));
+
+  // A transfer nobody answers for is dropped after WIRE_REASM_MAX_RESENDS requests
+  push(&reasm, fragment(msg, YML_GENERAL_ANS, 10, 10)[0], 0);
+  uint32_t now = 0;
+  int requests = 0;
+  for (int i = 0; i < WIRE_REASM_MAX_RESENDS + 2; i++) {
+    now += WIRE_REASM_RESEND_MS;
+    requests += wire_reasm_poll(&reasm, now, req, sizeof(req)) ? 1 : 0;
+  }
+  CHECK_EQ(requests, WIRE_REASM_MAX_RESENDS);
+  CHECK_EQ(reasm.expired, 1);
+
+  CHECK_EQ(wire_resend_parse("", &seq, &req_type, ranges, 4), -1);
+  CHECK_EQ(wire_resend_parse("1|2|0", &seq, &req_type, ranges, 4), -1);
+  CHECK_EQ(wire_resend_parse("1|2|5-3", &seq, &req_type, ranges, 4), -1);
+  CHECK_EQ(wire_resend_parse("300|2|1", &seq, &req_type, ranges, 4), -1);
+  wire_reasm_reset(&reasm);
+}
+
+// wire_send_fn that keeps every frame in a std::vector
+static void capture_frame(const uint8_t* frame, size_t len, void* ctx){
+  std::vector<std::vector<uint8_t> >* frames = (std::vector<std::vector<uint8_t> >*)ctx;
+  frames->push_back(std::vector<uint8_t>(frame, frame + len));
+}
+
+// capture_frame() of a sender that takes the protocol lock meanwhile, as the
+// screen's reassembler does while a resend goes out
+static void capture_frame_locked(const uint8_t* frame, size_t len, void* ctx){
+  protocol_lock();
+  protocol_unlock();
+  capture_frame(frame, len, ctx);
+}
+
+static void test_send_and_resend(){
+  std::string msg = sample_text(300);
+  std::vector<std::vector<uint8_t> > sent;
+  send_msg(YML_SENSOR_ANS, (const uint8_t*)msg.data(), msg.size(), WIRE_DEFAULT_MTU, capture_frame, &sent);
+  CHECK_EQ(sent.size(), wire_frag_count(msg.size(), wire_frag_payload_size(WIRE_DEFAULT_MTU)));
+
+  struct wire_reassembler reasm;
+  memset(&reasm, 0, sizeof(reasm));
+  struct wire_frame frame;
+  uint8_t* joined = NULL;
+  size_t joined_len = 0;
+  for (size_t i = 0; i + 1 < sent.size(); i++) {
+    CHECK(decode_frame(sent[i].data(), sent[i].size(), &frame));
+    joined = reassemble_fragment(&reasm, &frame, &joined_len);
+    CHECK(joined == NULL);
+  }
+  // The last fragment is lost: ask for it again from the sender's history
+  char req[MAX_MSG_LEN];
+  snprintf(req, sizeof(req), "%d|%d|%u", frame.seq, YML_SENSOR_ANS, (unsigned)sent.size());
+  std::vector<std::vector<uint8_t> > resent;
+  CHECK_EQ(resend_fragments(req, capture_frame_locked, &resent), 1);
+  CHECK(resent.size() == 1 && resent[0] == sent.back());
+  CHECK(decode_frame(resent[0].data(), resent[0].size(), &frame));
+  joined = reassemble_fragment(&reasm, &frame, &joined_len);
+  CHECK(joined != NULL && joined_len == msg.size() && memcmp(joined, msg.data(), joined_len) == 0);
+  free(joined);
+
+  snprintf(req, sizeof(req), "%d|%d|1", (frame.seq + 100) & 0xFF, YML_SENSOR_ANS);
+  CHECK_EQ(resend_fragments(req, capture_frame, &resent), -1);
+  CHECK_EQ(resend_fragments("garbage", capture_frame, &resent), -1);
+
+  // Short messages end up in msg_interp
+  sent.clear();
+  send_msg(READ_ANS, (const uint8_t*)"0|3|42", 6, WIRE_DEFAULT_MTU, capture_frame, &sent);
+  struct msg_interp msg_struct;
+  struct wire_frame first;
+  CHECK(decode_frame(sent[0].data(), sent[0].size(), &first));
+  CHECK(collect_msg(&reasm, &first, &msg_struct));
+  CHECK(strcmp(msg_struct.msg, "0|3|42") == 0);
+  CHECK_EQ(msg_struct.req_type, READ_ANS);
+
+  std::string big = sample_text(MAX_MSG_LEN + 10);
+  sent.clear();
+  send_msg(READ_ANS, (const uint8_t*)big.data(), big.size(), WIRE_MAX_MTU, capture_frame, &sent);
+  CHECK(decode_frame(sent[0].data(), sent[0].size(), &first));
+  CHECK(!collect_msg(&reasm, &first, &msg_struct));
+  wire_reasm_reset(&reasm);
+}
+
+static void test_tx_history(){
+  struct wire_tx_history history;
+  memset(&history, 0, sizeof(history));
+  for (int seq = 0; seq < WIRE_TX_HISTORY_SIZE + 1; seq++) {
+    wire_tx_history_add(&history, YML_MOTORS_ANS, seq, (const uint8_t*)"abc", 3, 10);
+  }
+  CHECK(wire_tx_history_find(&history, YML_MOTORS_ANS, 0) == NULL);
+  const struct wire_tx_record* rec = wire_tx_history_find(&history, YML_MOTORS_ANS, WIRE_TX_HISTORY_SIZE);
+  CHECK(rec != NULL && rec->msg_len == 3 && rec->stride == 10);
+  CHECK(wire_tx_history_find(&history, YML_SENSOR_ANS, 1) == NULL);
+  for (int i = 0; i < WIRE_TX_HISTORY_SIZE; i++) {
+    free(history.records[i].msg);
+  }
+}
+
+static void test_batch_cmd(){
+  uint8_t buf[MAX_MSG_LEN - 1];
+  struct batch_cmd_writer w;
+  batch_cmd_begin(&w, buf, sizeof(buf));
+  const int32_t values[] = {0, 1, -1, 63, -64, 64, 8191, -8192, 1000000, -2147483647 - 1};
+  const int count = sizeof(values) / sizeof(values[0]);
+  for (int i = 0; i < count; i++) {
+    CHECK(batch_cmd_add(&w, i % BATCH_KIND_COUNT, (uint8_t)i, (uint8_t)(i * 6), values[i]));
+  }
+  CHECK(!batch_cmd_add(&w, BATCH_KIND_COUNT, 0, 0, 0));
+  CHECK(!batch_cmd_add(&w, BATCH_SENSOR_PARAM, 0, BATCH_CMD_MAX_PARAM + 1, 0));
+
+  struct batch_cmd_reader r;
+  CHECK(batch_cmd_open(&r, buf, batch_cmd_len(&w)));
+  CHECK_EQ(r.count, count);
+  struct batch_cmd cmd;
+  int read = 0;
+  while (batch_cmd_next(&r, &cmd)) {
+    CHECK_EQ(cmd.kind, read % BATCH_KIND_COUNT);
+    CHECK_EQ(cmd.id, read);
+    CHECK_EQ(cmd.param, read * 6);
+    CHECK_EQ(cmd.value, values[read]);
+    read++;
+  }
+  CHECK_EQ(read, count);
+
+  // Truncated payload stops early
+  CHECK(batch_cmd_open(&r, buf, batch_cmd_len(&w) - 1));
+  while (batch_cmd_next(&r, &cmd)) {
+  }
+  CHECK(r.read < r.count);
+
+  // Full buffer rejects the command and keeps the batch intact
+  uint8_t small[6];
+  batch_cmd_begin(&w, small, sizeof(small));
+  CHECK(batch_cmd_add(&w, BATCH_SENSOR_STATE, 1, 0, 1));
+  CHECK(!batch_cmd_add(&w, BATCH_MOTOR_PARAM, 2, 0, 8191));
+  CHECK_EQ(batch_cmd_len(&w), 4);
+  CHECK_EQ(small[0], 1);
+
+  uint8_t results[3] = {BATCH_APPLIED, BATCH_REJECTED, BATCH_UNKNOWN_TARGET};
+  uint8_t ans[8];
+  size_t ans_len = batch_cmd_encode_results(ans, sizeof(ans), results, 3);
+  CHECK_EQ(ans_len, 4);
+  const uint8_t* decoded = NULL;
+  CHECK_EQ(batch_cmd_decode_results(ans, ans_len, &decoded), 3);
+  CHECK(decoded != NULL && memcmp(decoded, results, 3) == 0);
+  CHECK_EQ(batch_cmd_decode_results(ans, ans_len - 1, &decoded), -1);
+  CHECK_EQ(batch_cmd_encode_results(ans, 3, results, 3), 0);
+}
+
+static bool lz_round_trip(const std::string& text, size_t* packed_out){
+  struct lz_compressor* st = (struct lz_compressor*)malloc(sizeof(struct lz_compressor));
+  std::vector<uint8_t> packed(lz_compress_bound(text.size()));
+  size_t packed_len = lz_compress(st, (const uint8_t*)text.data(), text.size(), packed.data(), packed.size());
+  free(st);
+  if (packed_len == 0 || !lz_is_compressed(packed.data(), packed_len) || lz_raw_len(packed.data()) != text.size()) {
+    return false;
+  }
+  size_t raw_len = 0;
+  uint8_t* raw = lz_decompress(packed.data(), packed_len, &raw_len);
+  bool same = raw != NULL && raw_len == text.size() && memcmp(raw, text.data(), raw_len) == 0;
+  free(raw);
+  // Streaming decode, one byte per call
+  std::vector<uint8_t> out(text.size() + 1);
+  struct lz_decoder dec;
+  lz_decoder_init(&dec, out.data(), text.size());
+  int status = LZ_NEED_MORE;
+  for (size_t i = 0; i < packed_len && status == LZ_NEED_MORE; i++) {
+    status = lz_decode_feed(&dec, &packed[i], 1);
+  }
+  same = same && status == LZ_DONE && memcmp(out.data(), text.data(), text.size()) == 0;
+  if (packed_out) {
+    *packed_out = packed_len;
+  }
+  return same;
+}
+
+static void test_lz(){
+  size_t packed_len = 0;
+  std::string text = sample_text(5000);
+  CHECK(lz_round_trip(text, &packed_len));
+  CHECK(packed_len < text.size() / 2);
+  CHECK(lz_round_trip("", NULL));
+  CHECK(lz_round_trip("ab", NULL));
+  CHECK(lz_round_trip(std::string(1000, 'x'), &packed_len));
+  CHECK(packed_len < 30);
+  std::string noise;
+  for (int i = 0; i < 3000; i++) {
+    noise += (char)(rng_next() & 0xFF);
+  }
+  CHECK(lz_round_trip(noise, &packed_len));
+  CHECK(packed_len <= lz_compress_bound(noise.size()));
+
+  // Truncated container and a match reaching before the start
+  struct lz_compressor* st = (struct lz_compressor*)malloc(sizeof(struct lz_compressor));
+  std::vector<uint8_t> packed(lz_compress_bound(text.size()));
+  packed_len = lz_compress(st, (const uint8_t*)text.data(), text.size(), packed.data(), packed.size());
+  free(st);
+  CHECK(lz_decompress(packed.data(), packed_len / 2, NULL) == NULL);
+  const uint8_t bad[] = {LZ_MAGIC, 4, 0, 0, 0, 0x01, 0x00, 0x05};
+  CHECK(lz_decompress(bad, sizeof(bad), NULL) == NULL);
+  CHECK(!lz_is_compressed((const uint8_t*)"general:", 8));
+}
+
+struct telemetry_loop {
+  int next_value;
+  uint8_t channel_count;
+  struct telemetry_receiver rx;
+  std::vector<int16_t> values;
+  std::vector<uint8_t> channels;
+  std::vector<uint32_t> times;
+};
+
+// Channel c of tick t reads t * 10 + c, so every sample shows where it came from.
+static int counting_sample(uint8_t is_motor, uint8_t id, void* ctx){
+  struct telemetry_loop* loop = (struct telemetry_loop*)ctx;
+  int tick = loop->next_value++ / loop->channel_count;
+  return tick * 10 + (is_motor ? 5 : 0) + id;
+}
+
+static void loopback_emit(const uint8_t* payload, size_t len, void* ctx){
+  struct telemetry_loop* loop = (struct telemetry_loop*)ctx;
+  struct telemetry_batch batch;
+  CHECK(telemetry_batch_decode(payload, len, loop->channel_count, &batch) > 0);
+  telemetry_receiver_push(&loop->rx, &batch);
+  loop->values.insert(loop->values.end(), batch.samples, batch.samples + batch.count);
+  loop->channels.insert(loop->channels.end(), batch.channels, batch.channels + batch.count);
+  for (int i = 0; i < batch.count; i++) {
+    loop->times.push_back(telemetry_sample_time(&batch, loop->channel_count, i));
+  }
+}
+
+static void test_telemetry(){
+  struct telemetry_sub sub;
+  sub.rate_hz = 250;
+  sub.batch = 12;
+  sub.channel_count = 3;
+  sub.channels[0].is_motor = 0;
+  sub.channels[0].id = 2;
+  sub.channels[1].is_motor = 1;
+  sub.channels[1].id = 0;
+  sub.channels[2].is_motor = 1;
+  sub.channels[2].id = 3;
+  uint8_t buf[TELEMETRY_HDR_LEN + TELEMETRY_MAX_BATCH * TELEMETRY_SAMPLE_LEN];
+  size_t sub_len = telemetry_sub_encode(buf, sizeof(buf), &sub);
+  CHECK_EQ(sub_len, TELEMETRY_SUB_HDR_LEN + 3 * TELEMETRY_CHANNEL_LEN);
+  struct telemetry_sub decoded_sub;
+  CHECK(telemetry_sub_decode(buf, sub_len, &decoded_sub));
+  CHECK(decoded_sub.rate_hz == 250 && decoded_sub.batch == 12 && decoded_sub.channel_count == 3);
+  CHECK(decoded_sub.channels[1].is_motor == 1 && decoded_sub.channels[2].id == 3);
+  CHECK(!telemetry_sub_decode(buf, sub_len - 1, &decoded_sub));
+  struct telemetry_sub extreme = sub;
+  extreme.rate_hz = 60000;
+  extreme.batch = 0;
+  telemetry_sub_encode(buf, sizeof(buf), &extreme);
+  CHECK(telemetry_sub_decode(buf, sub_len, &decoded_sub));
+  CHECK_EQ(decoded_sub.rate_hz, TELEMETRY_MAX_RATE_HZ);
+  CHECK_EQ(decoded_sub.batch, 1);
+  extreme.channel_count = 0;
+  CHECK(!telemetry_sub_decode(buf, telemetry_sub_encode(buf, sizeof(buf), &extreme), &decoded_sub));
+  extreme.channel_count = TELEMETRY_MAX_CHANNELS + 1;
+  CHECK_EQ(telemetry_sub_encode(buf, sizeof(buf), &extreme), 0);
+
+  // The timestamps leave room for one sample per fragment at the default MTU
+  CHECK_EQ(telemetry_max_batch(wire_frag_payload_size(WIRE_DEFAULT_MTU)), 1);
+  CHECK_EQ(telemetry_max_batch(wire_frag_payload_size(WIRE_MAX_MTU)), TELEMETRY_MAX_BATCH);
+  CHECK(TELEMETRY_HDR_LEN + TELEMETRY_MAX_BATCH * TELEMETRY_SAMPLE_LEN < MAX_MSG_LEN);
+
+  struct telemetry_batch batch;
+  batch.first_seq = 0xFFFFFFFEu;
+  batch.count = 3;
+  batch.t_first_us = 0xFFFFF000u;
+  batch.t_span_us = 20000;
+  batch.channels[0] = 0;
+  batch.channels[1] = 1;
+  batch.channels[2] = 2;
+  batch.samples[0] = -32768;
+  batch.samples[1] = 0;
+  batch.samples[2] = 32767;
+  size_t len = telemetry_batch_encode(buf, sizeof(buf), &batch);
+  CHECK_EQ(len, TELEMETRY_HDR_LEN + 3 * TELEMETRY_SAMPLE_LEN);
+  struct telemetry_batch decoded;
+  CHECK_EQ(telemetry_batch_decode(buf, len, 3, &decoded), 3);
+  CHECK(decoded.first_seq == 0xFFFFFFFEu && decoded.channels[2] == 2 && decoded.samples[0] == -32768 && decoded.samples[2] == 32767);
+  CHECK(decoded.t_first_us == 0xFFFFF000u && decoded.t_span_us == 20000);
+  // Two channels: seq 0xFFFFFFFE is channel 0 of a tick, 0xFFFFFFFF its channel 1 and
+  // 0 (wrapped) channel 0 of the next tick, at the end of the span
+  CHECK_EQ(telemetry_sample_time(&decoded, 2, 0), 0xFFFFF000u);
+  CHECK_EQ(telemetry_sample_time(&decoded, 2, 1), 0xFFFFF000u);
+  CHECK_EQ(telemetry_sample_time(&decoded, 2, 2), 0xFFFFF000u + 20000);
+  CHECK_EQ(telemetry_batch_decode(buf, len - 1, 3, &decoded), -1);
+  // A channel the subscription does not have
+  CHECK_EQ(telemetry_batch_decode(buf, len, 2, &decoded), -1);
+
+  // Three channels at 100 Hz for 1 s, polled every 10 ms: 300 samples in batches of 30,
+  // in tick order, every sample on its own channel
+  struct telemetry_loop loop;
+  loop.next_value = 0;
+  loop.channel_count = 3;
+  telemetry_receiver_reset(&loop.rx);
+  struct telemetry_sender sender;
+  sub.rate_hz = 100;
+  sub.batch = 30;
+  telemetry_sender_start(&sender, &sub, TELEMETRY_MAX_BATCH, 0);
+  for (uint32_t t = 0; t < 1000000; t += 10000) {
+    telemetry_sender_poll(&sender, t, counting_sample, loopback_emit, &loop);
+  }
+  CHECK_EQ(sender.sampled, 300);
+  CHECK_EQ(sender.batches, 10);
+  CHECK_EQ(loop.values.size(), 300);
+  const int expected_offset[3] = {2, 5, 8};
+  bool in_order = true;
+  bool timed = true;
+  for (size_t i = 0; i < loop.values.size(); i++) {
+    in_order = in_order && loop.channels[i] == i % 3 && loop.values[i] == (int16_t)((i / 3) * 10 + expected_offset[i % 3]);
+    timed = timed && loop.times[i] == (i / 3) * 10000;
+  }
+  CHECK(in_order);
+  CHECK(timed);
+
+  // A stall longer than TELEMETRY_MAX_BACKLOG_MS is skipped in whole ticks and
+  // shows up as lost samples; the next sample is still channel 0
+  telemetry_sender_poll(&sender, 1000000 + 500000, counting_sample, loopback_emit, &loop);
+  size_t before_gap = loop.values.size();
+  telemetry_sender_poll(&sender, 1000000 + 600000, counting_sample, loopback_emit, &loop);
+  CHECK(sender.dropped > 0);
+  CHECK_EQ(sender.dropped % 3, 0);
+  CHECK_EQ(loop.rx.lost, sender.dropped);
+  CHECK(loop.values.size() > before_gap && loop.channels[before_gap] == 0);
+  // The samples after the stall carry the time of their tick, so the gap stays visible
+  CHECK_EQ(loop.times[before_gap] - loop.times[before_gap - 1], 10000 * (sender.dropped / 3 + 1));
+  // Stopping sends the partial batch
+  telemetry_sender_poll(&sender, 1000000 + 625000, counting_sample, loopback_emit, &loop);
+  uint32_t before = loop.rx.received;
+  telemetry_sender_stop(&sender, loopback_emit, &loop);
+  CHECK(loop.rx.received > before);
+  CHECK_EQ(loop.rx.received, sender.sampled);
+  CHECK_EQ(telemetry_sender_poll(&sender, 2000000, counting_sample, loopback_emit, &loop), 0);
+
+  // The batch is capped to what fits one fragment
+  sub.rate_hz = 1000;
+  sub.batch = 40;
+  telemetry_sender_start(&sender, &sub, telemetry_max_batch(wire_frag_payload_size(WIRE_DEFAULT_MTU)), 0);
+  CHECK_EQ(sender.sub.batch, 1);
+  // A subscription without channels does not start
+  sub.channel_count = 0;
+  telemetry_sender_start(&sender, &sub, TELEMETRY_MAX_BATCH, 0);
+  CHECK(!sender.active);
+
+  // Losses across the wrap of the 32 bit sequence number
+  struct telemetry_receiver rx;
+  telemetry_receiver_reset(&rx);
+  batch.first_seq = 0xFFFFFFF0u;
+  batch.count = 6;
+  CHECK_EQ(telemetry_receiver_push(&rx, &batch), 0);
+  batch.first_seq = 3;
+  CHECK_EQ(telemetry_receiver_push(&rx, &batch), 13);
+  // An old (reordered) batch is not counted as a loss
+  batch.first_seq = 0;
+  CHECK_EQ(telemetry_receiver_push(&rx, &batch), 0);
+}
+
+static void fill_frame(struct sample_frame* frame, uint32_t tick){
+  frame->tick = tick;
+  frame->t_us = tick * 1000;
+  frame->count = SAMPLE_FRAME_MAX_VALUES;
+  for (int i = 0; i < SAMPLE_FRAME_MAX_VALUES; i++) {
+    frame->values[i] = (int16_t)(tick * 7 + i);
+  }
+}
+
+static bool frame_intact(const struct sample_frame* frame){
+  bool intact = frame->count == SAMPLE_FRAME_MAX_VALUES && frame->t_us == frame->tick * 1000;
+  for (int i = 0; i < SAMPLE_FRAME_MAX_VALUES; i++) {
+    intact = intact && frame->values[i] == (int16_t)(frame->tick * 7 + i);
+  }
+  return intact;
+}
+
+static void test_sample_ring(){
+  static struct sample_ring ring;
+  sample_ring_reset(&ring);
+  struct sample_frame frame;
+  CHECK(!sample_ring_pop(&ring, &frame));
+  for (uint32_t i = 0; i < SAMPLE_RING_SIZE; i++) {
+    fill_frame(&frame, i);
+    CHECK(sample_ring_push(&ring, &frame));
+  }
+  CHECK_EQ(sample_ring_count(&ring), SAMPLE_RING_SIZE);
+  fill_frame(&frame, SAMPLE_RING_SIZE);
+  CHECK(!sample_ring_push(&ring, &frame));
+  CHECK_EQ(ring.dropped.load(), 1);
+  CHECK(sample_ring_pop(&ring, &frame));
+  CHECK_EQ(frame.tick, 0);
+  fill_frame(&frame, SAMPLE_RING_SIZE);
+  CHECK(sample_ring_push(&ring, &frame));
+  bool in_order = true;
+  for (uint32_t i = 1; i <= SAMPLE_RING_SIZE; i++) {
+    in_order = in_order && sample_ring_pop(&ring, &frame) && frame.tick == i && frame_intact(&frame);
+  }
+  CHECK(in_order);
+  CHECK(!sample_ring_pop(&ring, &frame));
+
+  // Two threads: every frame the producer got in arrives once, in order and intact,
+  // and every other frame is counted as dropped
+  sample_ring_reset(&ring);
+  const uint32_t total = 200000;
+  std::atomic<uint32_t> pushed(0);
+  std::thread producer([&pushed, total]() {
+    struct sample_frame out;
+    for (uint32_t tick = 0; tick < total; tick++) {
+      fill_frame(&out, tick);
+      if (sample_ring_push(&ring, &out)) {
+        pushed++;
+      }
+    }
+  });
+  uint32_t popped = 0;
+  uint32_t last_tick = 0;
+  bool ordered = true;
+  bool intact = true;
+  while (true) {
+    bool producer_done = pushed + ring.dropped.load() == total;
+    if (sample_ring_pop(&ring, &frame)) {
+      ordered = ordered && (popped == 0 || frame.tick > last_tick);
+      intact = intact && frame_intact(&frame);
+      last_tick = frame.tick;
+      popped++;
+    } else if (producer_done) {
+      break;
+    }
+  }
+  producer.join();
+  CHECK(ordered);
+  CHECK(intact);
+  CHECK_EQ(popped, pushed);
+  CHECK_EQ(popped + ring.dropped.load(), total);
+}
+
+struct feed_ctx {
+  struct sample_frame frame;
+  int batches;
+};
+
+static int frame_sample(uint8_t is_motor, uint8_t id, void* ctx){
+  return ((struct feed_ctx*)ctx)->frame.values[id];
+}
+
+static void count_batch(const uint8_t* payload, size_t len, void* ctx){
+  ((struct feed_ctx*)ctx)->batches++;
+}
+
+static void test_telemetry_feed(){
+  // 1 kHz frames into a 100 Hz subscription: every 10th frame is taken
+  struct telemetry_sub sub;
+  sub.rate_hz = 100;
+  sub.batch = 10;
+  sub.channel_count = 2;
+  sub.channels[0].is_motor = 0;
+  sub.channels[0].id = 1;
+  sub.channels[1].is_motor = 0;
+  sub.channels[1].id = 3;
+  struct telemetry_sender sender;
+  telemetry_sender_start(&sender, &sub, TELEMETRY_MAX_BATCH, 0);
+  struct feed_ctx ctx;
+  ctx.batches = 0;
+  for (uint32_t tick = 0; tick < 1000; tick++) {
+    fill_frame(&ctx.frame, tick);
+    telemetry_sender_feed(&sender, tick * 1000, ctx.frame.t_us, frame_sample, count_batch, &ctx);
+  }
+  CHECK_EQ(sender.sampled, 200);
+  CHECK_EQ(sender.batches, 20);
+  CHECK_EQ(ctx.batches, 20);
+  CHECK_EQ(sender.batch.count, 0);
+  CHECK_EQ(sender.dropped, 0);
+
+  // Frames lost in the ring: the ticks due in between are dropped, not repeated
+  telemetry_sender_start(&sender, &sub, TELEMETRY_MAX_BATCH, 0);
+  for (uint32_t tick = 0; tick < 1000; tick++) {
+    if (tick >= 300 && tick < 350) {
+      continue;
+    }
+    fill_frame(&ctx.frame, tick);
+    telemetry_sender_feed(&sender, tick * 1000, ctx.frame.t_us, frame_sample, count_batch, &ctx);
+  }
+  CHECK_EQ(sender.dropped, 2 * 5);          // ticks 300, 310, 320, 330 and 340
+  CHECK_EQ(sender.sampled + sender.dropped, 200);
+
+  // The samples carry the time the frame was taken, not the schedule
+  telemetry_sender_start(&sender, &sub, TELEMETRY_MAX_BATCH, 0);
+  for (uint32_t tick = 0; tick < 35; tick++) {
+    fill_frame(&ctx.frame, tick);
+    ctx.frame.t_us += 150;                  // sampler woke up late
+    telemetry_sender_feed(&sender, tick * 1000, ctx.frame.t_us, frame_sample, count_batch, &ctx);
+  }
+  CHECK_EQ(sender.batch.count, 2 * 4);      // ticks 0, 10, 20 and 30, batch not sent yet
+  CHECK_EQ(sender.batch.t_first_us, 150);
+  CHECK_EQ(sender.last_tick_us, 30150);
+}
+
+static void test_clock_sync(){
+  uint8_t buf[CLOCK_SYNC_ANS_LEN];
+  uint32_t t1, t2, t3;
+  CHECK_EQ(clock_sync_req_encode(buf, sizeof(buf), 0x12345678u), CLOCK_SYNC_REQ_LEN);
+  CHECK(clock_sync_req_decode(buf, CLOCK_SYNC_REQ_LEN, &t1) && t1 == 0x12345678u);
+  CHECK(!clock_sync_req_decode(buf, CLOCK_SYNC_REQ_LEN - 1, &t1));
+  CHECK_EQ(clock_sync_ans_encode(buf, sizeof(buf), 1, 0xFFFFFFFFu, 3), CLOCK_SYNC_ANS_LEN);
+  CHECK(clock_sync_ans_decode(buf, CLOCK_SYNC_ANS_LEN, &t1, &t2, &t3) && t1 == 1 && t2 == 0xFFFFFFFFu && t3 == 3);
+  CHECK(!clock_sync_ans_decode(buf, CLOCK_SYNC_ANS_LEN + 1, &t1, &t2, &t3));
+  CHECK_EQ(clock_sync_ans_encode(buf, CLOCK_SYNC_ANS_LEN - 1, 1, 2, 3), 0);
+
+  // Prosthesis clock 5 s ahead, 8 ms each way, 1 ms to answer: exact
+  struct clock_sync cs;
+  clock_sync_reset(&cs);
+  CHECK(!cs.valid);
+  CHECK(clock_sync_add(&cs, 1000000, 6008000, 6009000, 1017000));
+  CHECK(cs.valid);
+  CHECK_EQ(cs.offset_us, 5000000);
+  CHECK_EQ(cs.rtt_us, 16000);
+  CHECK_EQ(clock_sync_to_local(&cs, 7000000), 2000000);
+  // A slower, lopsided exchange does not replace the better one
+  CHECK(clock_sync_add(&cs, 2000000, 7030000, 7030000, 2032000));
+  CHECK_EQ(cs.offset_us, 5000000);
+  // A faster one does, even if it is lopsided too
+  CHECK(clock_sync_add(&cs, 3000000, 8006000, 8006000, 3008000));
+  CHECK_EQ(cs.offset_us, 5002000);
+  CHECK_EQ(cs.rtt_us, 8000);
+  // Impossible or too slow round trips are ignored
+  CHECK(!clock_sync_add(&cs, 4000000, 9000000, 9010000, 4005000));
+  CHECK(!clock_sync_add(&cs, 4000000, 9000000, 9000000, 4000000 + CLOCK_SYNC_MAX_RTT_US + 1));
+  CHECK_EQ(cs.offset_us, 5002000);
+  // The best exchange ages out of the window
+  for (int i = 0; i < CLOCK_SYNC_WINDOW; i++) {
+    CHECK(clock_sync_add(&cs, 5000000, 10010000, 10010000, 5020000));
+  }
+  CHECK_EQ(cs.offset_us, 5000000);
+  CHECK_EQ(cs.rtt_us, 20000);
+
+  // Prosthesis clock behind and across the wrap of micros()
+  clock_sync_reset(&cs);
+  CHECK(clock_sync_add(&cs, 100, 0xFFFFFF00u + 5100, 0xFFFFFF00u + 5100, 10100));
+  CHECK_EQ(cs.offset_us, 0xFFFFFF00u);
+  CHECK_EQ(clock_sync_to_local(&cs, 0xFFFFFF00u + 20000), 20000);
+
+  // The seed is a fallback until an exchange completes, and does not replace one
+  clock_sync_reset(&cs);
+  clock_sync_seed(&cs, 900000, 100000);
+  CHECK(cs.seeded && !cs.valid);
+  CHECK_EQ(clock_sync_to_local(&cs, 950000), 150000);
+  clock_sync_seed(&cs, 0, 0);
+  CHECK_EQ(cs.offset_us, 800000);
+  CHECK(clock_sync_add(&cs, 1000, 801000 + 500, 801000 + 500, 2000));
+  clock_sync_seed(&cs, 0, 0);
+  CHECK_EQ(cs.offset_us, 800000);
+}
+
+static void test_downsample(){
+  const int16_t NONE = 8191;
+  CHECK_EQ(downsample_bucket_count(2000000, 10000, 140), 140);
+  CHECK_EQ(downsample_bucket_count(1000000, 10000, 140), 100);   // never shorter than a sample
+  CHECK_EQ(downsample_bucket_count(1000000, 10000, 1000), 100);
+  CHECK_EQ(downsample_bucket_count(300000000, 10000, 1000), DOWNSAMPLE_MAX_BUCKETS);
+  CHECK_EQ(downsample_bucket_count(1000, 10000, 140), 1);
+
+  // 1 s in 100 buckets of 10 ms; 10 samples per bucket keep their extremes
+  static struct downsample_series s;
+  downsample_series_init(&s, 1000000, 100, NONE);
+  CHECK_EQ(s.bucket_us, 10000);
+  for (int i = 0; i < 2 * DOWNSAMPLE_MAX_BUCKETS; i++) {
+    CHECK_EQ(s.points[i], NONE);
+  }
+  for (uint32_t t = 0; t < 500000; t += 1000) {
+    int16_t value = (int16_t)((t / 1000) % 10);
+    if (t == 123000) {
+      value = 900;                          // one sample spike
+    }
+    CHECK(downsample_series_add(&s, 5000000 + t, value));
+  }
+  CHECK_EQ(downsample_series_head(&s), (5000000 + 499000) / 10000 % 100);
+  int head = downsample_series_head(&s);
+  CHECK_EQ(s.points[2 * head], 0);
+  CHECK_EQ(s.points[2 * head + 1], 9);
+  int spike = (5000000 + 123000) / 10000 % 100;
+  CHECK_EQ(s.points[2 * spike + 1], 900);
+  CHECK_EQ(s.points[2 * spike], 0);
+  int untouched = (head + 1) % 100;         // the other half of the window
+  CHECK_EQ(s.points[2 * untouched], NONE);
+
+  // Late samples land in their bucket, older than the window they are dropped
+  CHECK(downsample_series_add(&s, 5000000 + 300000, -50));
+  CHECK_EQ(s.points[2 * ((5000000 + 300000) / 10000 % 100)], -50);
+  CHECK(!downsample_series_add(&s, 5000000 + 499000 - 1000000, 7));
+  CHECK_EQ(downsample_series_head(&s), head);
+
+  // A jump empties the skipped buckets, including what they held a window ago
+  CHECK(downsample_series_add(&s, 5000000 + 499000 + 50000, 3));
+  for (int k = 1; k < 5; k++) {
+    CHECK_EQ(s.points[2 * ((head + k) % 100)], NONE);
+  }
+  CHECK_EQ(s.points[2 * ((head + 5) % 100)], 3);
+  // A jump of more than the window empties everything
+  CHECK(downsample_series_add(&s, 5000000 + 5000000, 1));
+  int filled = 0;
+  for (int i = 0; i < 100; i++) {
+    filled += s.points[2 * i] != NONE;
+  }
+  CHECK_EQ(filled, 1);
+
+  // The gap empties the buckets after the newest one, never the newest
+  downsample_series_clear(&s);
+  downsample_series_gap(&s, 4);
+  for (uint32_t t = 0; t < 1000000; t += 10000) {
+    downsample_series_add(&s, t, 1);
+  }
+  downsample_series_gap(&s, 4);
+  head = downsample_series_head(&s);
+  CHECK_EQ(head, 99);
+  CHECK_EQ(s.points[2 * head], 1);
+  for (int k = 1; k <= 4; k++) {
+    CHECK_EQ(s.points[2 * ((head + k) % 100) + 1], NONE);
+  }
+  CHECK_EQ(s.points[2 * 5], 1);
+  downsample_series_gap(&s, 500);
+  CHECK_EQ(s.points[2 * head], 1);
+
+  // Whole trace: equal sample counts per bucket, extremes kept
+  int16_t in[1000];
+  for (int i = 0; i < 1000; i++) {
+    in[i] = (int16_t)(i % 7);
+  }
+  in[555] = -300;
+  int16_t out[2 * 10];
+  CHECK_EQ(downsample_minmax(in, 1000, out, 10), 10);
+  CHECK_EQ(out[2 * 5], -300);
+  CHECK_EQ(out[2 * 5 + 1], 6);
+  CHECK_EQ(out[2 * 4], 0);
+  CHECK_EQ(downsample_minmax(in, 3, out, 10), 3);
+  CHECK_EQ(out[4], 2);
+  CHECK_EQ(out[5], 2);
+}
+
+static void test_plot_damage(){
+  struct plot_damage d;
+  struct plot_span spans[PLOT_MAX_SPANS];
+  // 280 px, 141 points: a point every 2 px
+  plot_damage_init(&d, 280, 100, 141, 0, 0);
+  CHECK_EQ(plot_point_x(&d, 0), 0);
+  CHECK_EQ(plot_point_x(&d, 70), 140);
+  CHECK_EQ(plot_point_x(&d, 140), 280);
+  CHECK(!plot_damage_pending(&d));
+  CHECK_EQ(plot_damage_take(&d, spans, PLOT_MAX_SPANS), 0);
+
+  // A point moves the segments to both neighbours
+  plot_damage_mark(&d, 10, 1);
+  CHECK(plot_damage_pending(&d));
+  CHECK_EQ(plot_damage_take(&d, spans, PLOT_MAX_SPANS), 1);
+  CHECK_EQ(spans[0].x1, 18);
+  CHECK_EQ(spans[0].x2, 22);
+  CHECK(!plot_damage_pending(&d));
+  CHECK_EQ(d.pixels, 5 * 100);
+
+  // Neighbouring points merge, distant ones do not; the ends are clamped
+  plot_damage_mark(&d, 0, 3);
+  plot_damage_mark(&d, 50, 1);
+  plot_damage_mark(&d, 140, 1);
+  CHECK_EQ(plot_damage_take(&d, spans, PLOT_MAX_SPANS), 3);
+  CHECK_EQ(spans[0].x1, 0);
+  CHECK_EQ(spans[0].x2, 6);
+  CHECK_EQ(spans[1].x1, 98);
+  CHECK_EQ(spans[1].x2, 102);
+  CHECK_EQ(spans[2].x1, 278);
+  CHECK_EQ(spans[2].x2, 280);
+
+  // Marks wrap around the end
+  plot_damage_mark(&d, 139, 4);
+  CHECK_EQ(plot_damage_take(&d, spans, PLOT_MAX_SPANS), 2);
+  CHECK_EQ(spans[0].x1, 0);
+  CHECK_EQ(spans[0].x2, 4);
+  CHECK_EQ(spans[1].x1, 276);
+  CHECK_EQ(spans[1].x2, 280);
+
+  // Margin for the line width
+  plot_damage_init(&d, 280, 100, 141, 0, 2);
+  plot_damage_mark(&d, 10, 1);
+  plot_damage_take(&d, spans, PLOT_MAX_SPANS);
+  CHECK_EQ(spans[0].x1, 16);
+  CHECK_EQ(spans[0].x2, 24);
+
+  // Out of spans: the rest waits for the next frame
+  plot_damage_init(&d, 280, 100, 141, 0, 0);
+  for (int i = 0; i < 10; i++) {
+    plot_damage_mark(&d, (uint16_t)(i * 10), 1);
+  }
+  CHECK_EQ(plot_damage_take(&d, spans, 4), 4);
+  CHECK(plot_damage_pending(&d));
+  CHECK_EQ(d.deferred, 1);
+  CHECK_EQ(plot_damage_take(&d, spans, 4), 4);
+  CHECK_EQ(spans[0].x1, 78);
+  CHECK_EQ(plot_damage_take(&d, spans, 4), 2);
+  CHECK(!plot_damage_pending(&d));
+
+  // The pixel budget spreads a full redraw over frames, at least one point per frame
+  plot_damage_init(&d, 280, 100, 141, 50 * 100, 0);
+  plot_damage_mark_all(&d);
+  int frames = 0;
+  uint32_t most = 0;
+  while (plot_damage_pending(&d) && frames < 100) {
+    uint32_t before = d.pixels;
+    int count = plot_damage_take(&d, spans, PLOT_MAX_SPANS);
+    CHECK(count >= 1);
+    most = d.pixels - before > most ? d.pixels - before : most;
+    frames++;
+  }
+  CHECK(most <= 50 * 100);
+  CHECK(frames >= 6 && frames <= 7);        // 281 columns, up to 50 per frame
+  CHECK(d.pixels >= 281 * 100);
+  plot_damage_init(&d, 280, 100, 141, 1, 0);
+  plot_damage_mark(&d, 20, 2);
+  CHECK_EQ(plot_damage_take(&d, spans, PLOT_MAX_SPANS), 1);
+  CHECK(plot_damage_pending(&d));
+
+  // Buckets a series changed become their two points
+  static struct downsample_series s;
+  downsample_series_init(&s, 1000000, 100, 8191);
+  plot_damage_init(&d, 280, 100, 200, 0, 0);
+  plot_damage_add_series(&d, &s);           // a cleared series redraws everything
+  CHECK_EQ(plot_damage_take(&d, spans, PLOT_MAX_SPANS), 1);
+  CHECK(!plot_damage_pending(&d));
+  downsample_series_add(&s, 50000, 3);
+  downsample_series_add(&s, 52000, 2);
+  plot_damage_add_series(&d, &s);
+  CHECK_EQ(plot_damage_take(&d, spans, PLOT_MAX_SPANS), 1);
+  CHECK_EQ(spans[0].x1, plot_point_x(&d, 9));
+  CHECK_EQ(spans[0].x2, plot_point_x(&d, 12));
+  downsample_series_add(&s, 53000, 2);      // inside min/max already: nothing changes
+  downsample_series_gap(&s, 4);             // empty buckets stay clean
+  plot_damage_add_series(&d, &s);
+  CHECK(!plot_damage_pending(&d));
+}
+
+// Collects the log pieces like the SPIFFS file would; refuses them while full.
+struct log_sink {
+  std::vector<uint8_t> bytes;
+  int pieces;
+  bool full;
+  uint32_t tick;                            // of the frame being fed
+};
+
+static bool log_sink_write(const uint8_t* data, size_t len, void* ctx){
+  struct log_sink* sink = (struct log_sink*)ctx;
+  if (sink->full) {
+    return false;
+  }
+  CHECK(len <= TELEMETRY_LOG_BLOCK_SIZE);
+  sink->bytes.insert(sink->bytes.end(), data, data + len);
+  sink->pieces++;
+  return true;
+}
+
+// Sample value of (is_motor, id) at a tick: tells the channel and the tick apart.
+static int log_sample(uint8_t is_motor, uint8_t id, void* ctx){
+  return (int)(((struct log_sink*)ctx)->tick % 1000) * 10 + is_motor * 5 + id;
+}
+
+static void test_history(){
+  static struct history_store h;
+  history_init(&h);
+  struct telemetry_channel a = {0, 1};
+  struct telemetry_channel b = {1, 0};
+  struct history_value v;
+  CHECK(!history_get(&h, &a, 0, 0, &v));
+  CHECK_EQ(history_bucket_ms(1), 10000);
+  CHECK_EQ(history_bucket_count(2), HISTORY_TIER2_BUCKETS);
+  CHECK_EQ(history_bucket_ms(3), 0);
+  CHECK_EQ(history_columns(0, 140), 100);    // 3 buckets per column
+  CHECK_EQ(history_columns(1, 400), HISTORY_TIER1_BUCKETS);
+  CHECK_EQ(history_columns(1, 0), 0);
+
+  // 10 Hz for 2 h: a counts the seconds, b is constant
+  const uint32_t end_ms = 2 * 3600 * 1000;
+  for (uint32_t t = 0; t < end_ms; t += 100) {
+    history_add(&h, &a, t, (int16_t)(t / 1000 % 1000));
+    history_add(&h, &b, t, -5);
+  }
+  uint32_t now = end_ms - 1;
+  // Tier 0: one second, ten equal samples
+  CHECK(history_get(&h, &a, 0, now, &v));
+  CHECK_EQ(v.count, 10);
+  CHECK_EQ(v.min, 199);                      // second 7199
+  CHECK_EQ(v.mean, 199);
+  // 5 min ago is still there, 5 min + 1 s is not
+  CHECK(history_get(&h, &a, 0, now - 299000, &v));
+  CHECK(!history_get(&h, &a, 0, now - 300000, &v));
+  // Tier 1: 10 s buckets, the mean is the middle second
+  CHECK(history_get(&h, &a, 1, 7150000, &v));
+  CHECK_EQ(v.count, 100);
+  CHECK_EQ(v.min, 150);
+  CHECK_EQ(v.max, 159);
+  CHECK_EQ(v.mean, 155);                     // 154.5
+  CHECK(!history_get(&h, &a, 1, now - 3600000, &v));
+  // Tier 2: 1 min buckets back to the start (2 h < 4 h)
+  CHECK(history_get(&h, &a, 2, 0, &v));
+  CHECK_EQ(v.count, 600);
+  CHECK_EQ(v.min, 0);
+  CHECK_EQ(v.max, 59);
+  CHECK(history_get(&h, &b, 2, 3600000, &v));
+  CHECK_EQ(v.mean, -5);
+  CHECK(!history_get(&h, &b, 2, end_ms + 60000, &v));   // not yet
+
+  // Query: 1 h in 30 s columns, oldest first, the newest one ends with now
+  struct history_value cols[160];
+  uint16_t n = history_query(&h, &a, 1, now, 140, cols);
+  CHECK_EQ(n, 120);
+  CHECK_EQ(cols[n - 1].count, 300);
+  CHECK_EQ(cols[n - 1].min, 170);
+  CHECK_EQ(cols[n - 1].max, 199);
+  CHECK_EQ(cols[0].count, 300);              // 3600 .. 3629 s
+  CHECK_EQ(cols[0].min, 600);
+  CHECK_EQ(history_query(&h, &a, 0, now, 140, cols), 100);
+  CHECK_EQ(history_query(&h, &a, 2, now, 140, cols), 120);
+  CHECK_EQ(cols[0].count, 0);                // 4 h back: before the first sample
+  CHECK_EQ(cols[60].count, 1200);            // 0 .. 2 min
+  CHECK_EQ(history_query(&h, &a, 3, now, 140, cols), 0);
+  struct telemetry_channel unknown = {0, 9};
+  CHECK_EQ(history_query(&h, &unknown, 0, now, 140, cols), 0);
+  // Only the newest column changes while time goes on inside it
+  struct history_value before[160];
+  n = history_query(&h, &a, 0, 7200000, 140, before);
+  history_add(&h, &a, 7201000, 1000);
+  history_add(&h, &a, 7201000, -1000);
+  CHECK_EQ(history_query(&h, &a, 0, 7201000, 140, cols), n);
+  int changed = 0;
+  for (uint16_t k = 0; k < n; k++) {
+    changed += memcmp(&before[k], &cols[k], sizeof(cols[k])) != 0;
+  }
+  CHECK_EQ(changed, 1);
+  CHECK_EQ(cols[n - 1].min, -1000);
+  CHECK_EQ(cols[n - 1].max, 1000);
+
+  // A gap longer than a tier empties it; late samples land in their bucket
+  history_add(&h, &a, end_ms + 600000, 42);
+  CHECK(!history_get(&h, &a, 0, end_ms - 1000, &v));
+  CHECK(history_get(&h, &a, 1, end_ms - 1000, &v));      // the hour tier still has it
+  history_add(&h, &a, end_ms + 599000, 40);
+  CHECK(history_get(&h, &a, 0, end_ms + 599000, &v));
+  CHECK_EQ(v.mean, 40);
+  history_add(&h, &a, end_ms + 200000, 7);                // older than the 5 min ring
+  CHECK(!history_get(&h, &a, 0, end_ms + 200000, &v));
+  CHECK(history_get(&h, &a, 1, end_ms + 200000, &v));
+  CHECK_EQ(v.count, 1);
+
+  // More channels than slots: the one fed least recently makes room
+  struct telemetry_channel more[HISTORY_MAX_CHANNELS];
+  for (int i = 0; i < HISTORY_MAX_CHANNELS; i++) {
+    more[i].is_motor = 0;
+    more[i].id = (uint8_t)(10 + i);
+  }
+  history_add(&h, &a, end_ms + 700000, 1);
+  for (int i = 0; i < HISTORY_MAX_CHANNELS - 2; i++) {
+    history_add(&h, &more[i], end_ms + 700000, 1);
+  }
+  CHECK_EQ(h.evicted, 0);
+  history_add(&h, &more[HISTORY_MAX_CHANNELS - 2], end_ms + 700000, 1);
+  CHECK_EQ(h.evicted, 1);
+  CHECK(!history_get(&h, &b, 2, 3600000, &v));            // b was fed last at 2 h
+  CHECK(history_get(&h, &a, 2, 3600000, &v));
+}
+
+static void test_telemetry_log(){
+  struct telemetry_log_config cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.rate_hz = 100;
+  cfg.channel_count = 3;
+  cfg.channels[0].is_motor = 0;
+  cfg.channels[0].id = 0;
+  cfg.channels[1].is_motor = 1;
+  cfg.channels[1].id = 0;
+  cfg.channels[2].is_motor = 0;
+  cfg.channels[2].id = 2;
+  cfg.pre_ms = 2000;
+  cfg.post_ms = 1000;
+  CHECK_EQ(telemetry_log_block_ticks(3), 40);
+  CHECK_EQ(telemetry_log_block_ticks(0), 0);
+
+  // 1 kHz frames into a 100 Hz log, trigger after 5 s: 2 s before, 1 s after
+  static struct telemetry_log log;
+  struct log_sink sink;
+  sink.pieces = 0;
+  sink.full = false;
+  memset(&log, 0, sizeof(log));
+  CHECK(!telemetry_log_trigger(&log, TELEMETRY_LOG_TRIGGER_MANUAL, 0, log_sink_write, &sink));   // not armed
+  telemetry_log_arm(&log, &cfg, 1000 * 1000);
+  CHECK_EQ(log.state, TELEMETRY_LOG_ARMED);
+  CHECK_EQ(log.pre_cap, 200);
+  uint32_t frame = 1000;
+  for (; frame < 6000; frame++) {
+    sink.tick = (frame - 1000) / 10;
+    CHECK_EQ(telemetry_log_feed(&log, frame * 1000, frame * 1000 + 30, log_sample, log_sink_write, &sink), 0);
+  }
+  CHECK_EQ(sink.pieces, 0);                 // nothing is written while armed
+  CHECK(telemetry_log_trigger(&log, TELEMETRY_LOG_TRIGGER_EMERGENCY_STOP, 6000 * 1000, log_sink_write, &sink));
+  CHECK(!telemetry_log_trigger(&log, TELEMETRY_LOG_TRIGGER_MANUAL, 6000 * 1000, log_sink_write, &sink));
+  CHECK_EQ(log.state, TELEMETRY_LOG_RECORDING);
+  CHECK_EQ(sink.pieces, 1 + 200 / 40 - 1);  // header and the full blocks of the history
+  for (; log.state == TELEMETRY_LOG_RECORDING; frame++) {
+    sink.tick = (frame - 1000) / 10;
+    telemetry_log_feed(&log, frame * 1000, frame * 1000 + 30, log_sample, log_sink_write, &sink);
+  }
+  CHECK_EQ(log.state, TELEMETRY_LOG_DONE);
+  CHECK_EQ(frame, 6000 + 100 * 10 - 9);     // the 100th tick after the trigger ends it
+  CHECK_EQ(log.dropped_blocks, 0);
+  CHECK_EQ(log.skipped_ticks, 0);
+  CHECK_EQ(log.bytes, sink.bytes.size());
+  CHECK_EQ(sink.bytes.size(), TELEMETRY_LOG_HDR_LEN + 3 * TELEMETRY_CHANNEL_LEN + 300 * 3 * 2 +
+                              (300 / 40 + 1) * (TELEMETRY_LOG_BLOCK_HDR_LEN + TELEMETRY_LOG_BLOCK_CRC_LEN));
+  CHECK_EQ(telemetry_log_feed(&log, frame * 1000, frame * 1000, log_sample, log_sink_write, &sink), 0);
+
+  struct telemetry_log_header hdr;
+  CHECK_EQ(telemetry_log_header_decode(sink.bytes.data(), sink.bytes.size(), &hdr), TELEMETRY_LOG_HDR_LEN + 6);
+  CHECK_EQ(hdr.channel_count, 3);
+  CHECK_EQ(hdr.rate_hz, 100);
+  CHECK_EQ(hdr.trigger, TELEMETRY_LOG_TRIGGER_EMERGENCY_STOP);
+  CHECK_EQ(hdr.pre_ticks, 200);
+  CHECK_EQ(hdr.trigger_us, 6000 * 1000);
+  CHECK_EQ(hdr.channels[1].is_motor, 1);
+  CHECK_EQ(hdr.channels[2].id, 2);
+  CHECK_EQ(log.tick_base, 300);             // ticks 0..299 fell out of the history
+  size_t pos = TELEMETRY_LOG_HDR_LEN + 6;
+  struct telemetry_log_block block;
+  int len = telemetry_log_block_decode(&sink.bytes[pos], sink.bytes.size() - pos, 3, &block);
+  CHECK_EQ(len, TELEMETRY_LOG_BLOCK_HDR_LEN + 40 * 6 + TELEMETRY_LOG_BLOCK_CRC_LEN);
+  CHECK_EQ(block.ticks, 40);
+  CHECK_EQ(block.first_tick, 0);
+  CHECK_EQ(block.t_first_us, 4000 * 1000 + 30);
+  CHECK_EQ(block.t_span_us, 39 * 10000);
+  CHECK_EQ(telemetry_log_value(&block, 3, 0, 0), 3000);        // tick 300, sensor 0
+  CHECK_EQ(telemetry_log_value(&block, 3, 39, 1), 3395);       // tick 339, motor 0
+  CHECK_EQ(telemetry_log_value(&block, 3, 1, 2), 3012);        // tick 301, sensor 2
+  int ticks = 0;
+  uint32_t next_tick = 0;
+  for (; pos < sink.bytes.size(); pos += len) {
+    len = telemetry_log_block_decode(&sink.bytes[pos], sink.bytes.size() - pos, 3, &block);
+    CHECK(len > 0);
+    if (len <= 0) {
+      break;
+    }
+    CHECK_EQ(block.first_tick, next_tick);
+    next_tick += block.ticks;
+    ticks += block.ticks;
+  }
+  CHECK_EQ(ticks, 300);
+
+  // A truncated block asks for more, a flipped bit is caught
+  pos = TELEMETRY_LOG_HDR_LEN + 6;
+  CHECK_EQ(telemetry_log_block_decode(&sink.bytes[pos], 100, 3, &block), 0);
+  std::vector<uint8_t> corrupt(sink.bytes);
+  corrupt[pos + 50] ^= 0x04;
+  CHECK_EQ(telemetry_log_block_decode(&corrupt[pos], corrupt.size() - pos, 3, &block), -1);
+  corrupt[pos] = 0;
+  CHECK_EQ(telemetry_log_block_decode(&corrupt[pos], corrupt.size() - pos, 3, &block), -1);
+  corrupt[0] = 'X';
+  CHECK_EQ(telemetry_log_header_decode(corrupt.data(), corrupt.size(), &hdr), 0);
+  CHECK_EQ(telemetry_log_header_decode(sink.bytes.data(), TELEMETRY_LOG_HDR_LEN + 5, &hdr), 0);
+
+  // Frames missing from the ring: the ticks are skipped and start a new block
+  sink.bytes.clear();
+  sink.pieces = 0;
+  telemetry_log_arm(&log, &cfg, 0);
+  CHECK(telemetry_log_trigger(&log, TELEMETRY_LOG_TRIGGER_MANUAL, 0, log_sink_write, &sink));
+  CHECK_EQ(log.tick_base, 0);
+  for (frame = 0; log.state == TELEMETRY_LOG_RECORDING; frame++) {
+    if (frame >= 200 && frame < 255) {
+      continue;
+    }
+    sink.tick = frame / 10;
+    telemetry_log_feed(&log, frame * 1000, frame * 1000, log_sample, log_sink_write, &sink);
+  }
+  CHECK_EQ(log.skipped_ticks, 5);           // ticks 20..24
+  pos = telemetry_log_header_decode(sink.bytes.data(), sink.bytes.size(), &hdr);
+  CHECK_EQ(hdr.pre_ticks, 0);
+  ticks = 0;
+  int gap_blocks = 0;
+  next_tick = 0;
+  for (; pos < sink.bytes.size(); pos += len) {
+    len = telemetry_log_block_decode(&sink.bytes[pos], sink.bytes.size() - pos, 3, &block);
+    CHECK(len > 0);
+    if (len <= 0) {
+      break;
+    }
+    if (block.first_tick != next_tick) {
+      gap_blocks++;
+      CHECK_EQ(block.first_tick, 25);
+      CHECK_EQ(telemetry_log_value(&block, 3, 0, 0), 250);
+    }
+    next_tick = block.first_tick + block.ticks;
+    ticks += block.ticks;
+  }
+  CHECK_EQ(gap_blocks, 1);
+  CHECK_EQ(ticks, 95);                      // the 100 tick window includes the skipped ones
+  CHECK_EQ(next_tick, 100);
+
+  // A writer that cannot keep up loses whole blocks, the log goes on
+  sink.bytes.clear();
+  telemetry_log_arm(&log, &cfg, 0);
+  for (frame = 0; frame < 1000; frame++) {
+    sink.tick = frame / 10;
+    telemetry_log_feed(&log, frame * 1000, frame * 1000, log_sample, log_sink_write, &sink);
+  }
+  CHECK(telemetry_log_trigger(&log, TELEMETRY_LOG_TRIGGER_MANUAL, 0, log_sink_write, &sink));
+  sink.full = true;
+  for (; frame < 1400; frame++) {
+    sink.tick = frame / 10;
+    telemetry_log_feed(&log, frame * 1000, frame * 1000, log_sample, log_sink_write, &sink);
+  }
+  sink.full = false;
+  for (; log.state == TELEMETRY_LOG_RECORDING; frame++) {
+    sink.tick = frame / 10;
+    telemetry_log_feed(&log, frame * 1000, frame * 1000, log_sample, log_sink_write, &sink);
+  }
+  CHECK_EQ(log.dropped_blocks, 1);          // ticks 80..119, filled while the writer was full
+  CHECK_EQ(log.blocks, 4);                  // 0..39, 40..79, 120..159 and 160..199
+
+  // No channels: stays idle
+  cfg.channel_count = 0;
+  telemetry_log_arm(&log, &cfg, 0);
+  CHECK_EQ(log.state, TELEMETRY_LOG_IDLE);
+  CHECK(!telemetry_log_trigger(&log, TELEMETRY_LOG_TRIGGER_MANUAL, 0, log_sink_write, &sink));
+}
+
+static void test_rolling_stats(){
+  struct telemetry_channel channels[3] = {{0, 0}, {0, 1}, {1, 2}};
+  static struct rolling_stats rs;
+  rolling_stats_init(&rs, channels, 3, 1000);
+  CHECK_EQ(rs.slot_us, 100000);
+
+  // Empty window: zeros
+  struct rolling_stats_value v;
+  rolling_stats_get(&rs, 0, 0, &v);
+  CHECK_EQ(v.count, 0);
+  CHECK_EQ(v.min, 0);
+  CHECK_EQ(v.rms, 0);
+
+  // 1 kHz for 2 s: channel 0 counts up, 1 is constant, 2 alternates +-100
+  for (uint32_t t = 0; t < 2000; t++) {
+    rolling_stats_add(&rs, 0, t * 1000, (int16_t)t);
+    rolling_stats_add(&rs, 1, t * 1000, -7);
+    rolling_stats_add(&rs, 2, t * 1000, (int16_t)(t % 2 ? 100 : -100));
+  }
+  // At 1.999 s the window holds slots 10..19: the last second
+  rolling_stats_get(&rs, 0, 1999000, &v);
+  CHECK_EQ(v.count, 1000);
+  CHECK_EQ(v.min, 1000);
+  CHECK_EQ(v.max, 1999);
+  CHECK_EQ(v.mean, 1500);                   // 1499.5 rounds up
+  CHECK_EQ(v.rms, 1527);                    // sqrt(mean of t^2) = 1527.03
+  rolling_stats_get(&rs, 1, 1999000, &v);
+  CHECK_EQ(v.mean, -7);
+  CHECK_EQ(v.min, -7);
+  CHECK_EQ(v.rms, 7);
+  rolling_stats_get(&rs, 2, 1999000, &v);
+  CHECK_EQ(v.channel.is_motor, 1);
+  CHECK_EQ(v.channel.id, 2);
+  CHECK_EQ(v.mean, 0);
+  CHECK_EQ(v.rms, 100);
+  CHECK_EQ(v.min, -100);
+  CHECK_EQ(v.max, 100);
+
+  // The window slides a slot at a time, and empties when the samples stop
+  rolling_stats_get(&rs, 0, 2050000, &v);
+  CHECK_EQ(v.count, 900);
+  CHECK_EQ(v.min, 1100);
+  rolling_stats_get(&rs, 0, 2950000, &v);
+  CHECK_EQ(v.count, 0);
+
+  // A late sample whose slot was reused already is dropped
+  rolling_stats_add(&rs, 0, 900000, 5000);
+  rolling_stats_get(&rs, 0, 1999000, &v);
+  CHECK_EQ(v.max, 1999);
+  // Unknown channels are ignored
+  rolling_stats_add(&rs, 3, 1999000, 1);
+  rolling_stats_get(&rs, 3, 1999000, &v);
+  CHECK_EQ(v.count, 0);
+
+  // Extremes: the sums do not overflow
+  rolling_stats_init(&rs, channels, 1, 1000);
+  for (uint32_t t = 0; t < 100000; t++) {
+    rolling_stats_add(&rs, 0, t, -32768);
+  }
+  rolling_stats_get(&rs, 0, 99999, &v);
+  CHECK_EQ(v.count, 65535);                 // one slot, saturated
+  CHECK_EQ(v.mean, -32768);
+  CHECK_EQ(v.rms, 32768);
+
+  // STATS_ANS round trip
+  rolling_stats_init(&rs, channels, 3, 500);
+  for (uint32_t t = 0; t < 500; t++) {
+    rolling_stats_add(&rs, 0, t * 1000, (int16_t)(t % 10));
+    rolling_stats_add(&rs, 2, t * 1000, -300);
+  }
+  uint8_t buf[ROLLING_STATS_MAX_LEN];
+  size_t len = rolling_stats_encode(buf, sizeof(buf), &rs, 499000);
+  CHECK_EQ(len, ROLLING_STATS_HDR_LEN + 3 * ROLLING_STATS_CHANNEL_LEN);
+  CHECK_EQ(rolling_stats_encode(buf, len - 1, &rs, 499000), 0);
+  struct rolling_stats_value values[ROLLING_STATS_MAX_CHANNELS];
+  uint16_t window_ms = 0;
+  CHECK_EQ(rolling_stats_decode(buf, len, &window_ms, values, ROLLING_STATS_MAX_CHANNELS), 3);
+  CHECK_EQ(window_ms, 500);
+  CHECK_EQ(values[0].count, 500);
+  CHECK_EQ(values[0].min, 0);
+  CHECK_EQ(values[0].max, 9);
+  CHECK_EQ(values[0].mean, 5);              // 4.5
+  CHECK_EQ(values[0].rms, 5);               // sqrt(28.5)
+  CHECK_EQ(values[1].count, 0);
+  CHECK_EQ(values[2].channel.is_motor, 1);
+  CHECK_EQ(values[2].channel.id, 2);
+  CHECK_EQ(values[2].mean, -300);
+  CHECK_EQ(values[2].rms, 300);
+  CHECK_EQ(rolling_stats_decode(buf, len, &window_ms, values, 1), 3);   // only the first is stored
+  CHECK_EQ(rolling_stats_decode(buf, len - 1, &window_ms, values, 3), -1);
+  CHECK_EQ(rolling_stats_decode(buf, 2, &window_ms, values, 3), -1);
+
+  // A snapshot of every channel is longer than a short message: it goes out in
+  // fragments and comes back whole from the reassembler
+  struct telemetry_channel all[ROLLING_STATS_MAX_CHANNELS];
+  for (int c = 0; c < ROLLING_STATS_MAX_CHANNELS; c++) {
+    all[c].is_motor = c >= 8;
+    all[c].id = (uint8_t)(c % 8);
+  }
+  rolling_stats_init(&rs, all, ROLLING_STATS_MAX_CHANNELS, 1000);
+  CHECK_EQ(rs.channel_count, ROLLING_STATS_MAX_CHANNELS);
+  for (uint8_t c = 0; c < ROLLING_STATS_MAX_CHANNELS; c++) {
+    rolling_stats_add(&rs, c, 1000, (int16_t)(c * 10));
+  }
+  uint8_t full[ROLLING_STATS_MAX_LEN];
+  len = rolling_stats_encode(full, sizeof(full), &rs, 1000);
+  CHECK_EQ(len, ROLLING_STATS_MAX_LEN);
+  CHECK(len > MAX_MSG_LEN);
+  std::vector<std::vector<uint8_t> > sent;
+  send_msg(STATS_ANS, full, len, WIRE_DEFAULT_MTU, capture_frame, &sent);
+  CHECK(sent.size() > 1);
+  struct wire_reassembler reasm;
+  memset(&reasm, 0, sizeof(reasm));
+  uint8_t* joined = NULL;
+  size_t joined_len = 0;
+  for (size_t i = 0; i < sent.size(); i++) {
+    struct wire_frame frame;
+    CHECK(decode_frame(sent[i].data(), sent[i].size(), &frame));
+    joined = reassemble_fragment(&reasm, &frame, &joined_len);
+  }
+  CHECK(joined != NULL && joined_len == len);
+  CHECK_EQ(rolling_stats_decode(joined, joined_len, &window_ms, values, ROLLING_STATS_MAX_CHANNELS), ROLLING_STATS_MAX_CHANNELS);
+  CHECK_EQ(values[15].channel.is_motor, 1);
+  CHECK_EQ(values[15].channel.id, 7);
+  CHECK_EQ(values[15].mean, 150);
+  free(joined);
+}
+
+// Keeps every decoded frame
+static void collect_export_frame(const struct export_frame* frame, void* ctx){
+  ((std::vector<struct export_frame>*)ctx)->push_back(*frame);
+}
+
+static void test_serial_export(){
+  uint8_t buf[EXPORT_MAX_FRAME_LEN];
+  int16_t values[EXPORT_MAX_VALUES];
+  for (int i = 0; i < EXPORT_MAX_VALUES; i++) {
+    values[i] = (int16_t)(i * 1000 - 8000);
+  }
+  CHECK_EQ(export_samples_encode(buf, sizeof(buf), 1, 2, values, EXPORT_MAX_VALUES), EXPORT_MAX_FRAME_LEN);
+  CHECK_EQ(export_samples_encode(buf, sizeof(buf), 1, 2, values, EXPORT_MAX_VALUES + 1), 0);
+  CHECK_EQ(export_samples_encode(buf, 12 + 2 * 3 + 1, 1, 2, values, 3), 0);
+  CHECK_EQ(export_samples_encode(buf, sizeof(buf), 1, 2, values, 0), EXPORT_HDR_LEN + EXPORT_CRC_LEN);
+
+  // A capture: channel map, 100 frames of 5 values, text in between, frames 40..44 lost
+  struct telemetry_channel channels[5] = {{0, 0}, {0, 1}, {0, 2}, {1, 0}, {1, 1}};
+  std::vector<uint8_t> stream;
+  size_t len = export_channels_encode(buf, sizeof(buf), 1000, 1000, channels, 5);
+  CHECK_EQ(len, EXPORT_HDR_LEN + 10 + EXPORT_CRC_LEN);
+  stream.insert(stream.end(), buf, buf + len);
+  const char* text = "Recived emergency stop request\n\xA5\xA5Z";
+  for (uint32_t tick = 1000; tick < 1100; tick++) {
+    int16_t v[5];
+    for (int c = 0; c < 5; c++) {
+      v[c] = (int16_t)(tick * 10 + c - 20000);
+    }
+    len = export_samples_encode(buf, sizeof(buf), tick, tick * 1000 + 7, v, 5);
+    if (tick >= 1040 && tick < 1045) {
+      continue;
+    }
+    stream.insert(stream.end(), buf, buf + len);
+    if (tick == 1020) {
+      stream.insert(stream.end(), text, text + strlen(text));
+    }
+  }
+  size_t text_len = strlen(text);
+
+  // Fed in pieces of every size, the result is the same
+  for (size_t piece = 1; piece <= 64; piece++) {
+    struct export_decoder d;
+    export_decoder_reset(&d);
+    std::vector<struct export_frame> frames;
+    int found = 0;
+    for (size_t pos = 0; pos < stream.size(); pos += piece) {
+      size_t n = std::min(piece, stream.size() - pos);
+      found += export_decoder_feed(&d, &stream[pos], n, collect_export_frame, &frames);
+    }
+    CHECK_EQ(found, 96);
+    CHECK_EQ(frames.size(), 96u);
+    CHECK_EQ(d.frames, 95);
+    CHECK_EQ(d.dropped, 5);
+    CHECK_EQ(d.crc_errors, 0);
+    CHECK_EQ(d.skipped_bytes, text_len);
+    if (frames.size() != 96) {
+      continue;
+    }
+    CHECK_EQ(frames[0].type, EXPORT_CHANNELS);
+    CHECK_EQ(frames[0].count, 5);
+    CHECK_EQ(frames[0].t_us, 1000);
+    CHECK_EQ(frames[0].channels[3].is_motor, 1);
+    CHECK_EQ(frames[0].channels[4].id, 1);
+    bool values_ok = true;
+    for (size_t i = 1; i < frames.size(); i++) {
+      const struct export_frame& f = frames[i];
+      uint32_t tick = f.seq;
+      values_ok = values_ok && f.type == EXPORT_SAMPLES && f.count == 5 && f.t_us == tick * 1000 + 7;
+      for (int c = 0; c < 5; c++) {
+        values_ok = values_ok && f.values[c] == (int16_t)(tick * 10 + c - 20000);
+      }
+    }
+    CHECK(values_ok);
+    CHECK_EQ(frames[40].seq, 1039);
+    CHECK_EQ(frames[41].seq, 1045);
+  }
+
+  // A damaged frame is refused and the next one found
+  std::vector<uint8_t> damaged(stream);
+  damaged[EXPORT_HDR_LEN + 10 + EXPORT_CRC_LEN + EXPORT_HDR_LEN + 1] ^= 0x40;   // a value of tick 1000
+  struct export_decoder d;
+  export_decoder_reset(&d);
+  std::vector<struct export_frame> frames;
+  export_decoder_feed(&d, &damaged[0], damaged.size(), collect_export_frame, &frames);
+  CHECK_EQ(d.crc_errors, 1);
+  CHECK_EQ(d.frames, 94);
+  CHECK_EQ(d.dropped, 5);                   // 1000 was never seen, 1001 starts the sequence
+  CHECK_EQ(frames[1].seq, 1001);
+
+  // A count too large for a frame is skipped, not read
+  export_decoder_reset(&d);
+  frames.clear();
+  uint8_t bogus[] = {EXPORT_SYNC0, EXPORT_SYNC1, EXPORT_SAMPLES, 200, 0, 0, 0, 0, 0, 0, 0, 0};
+  export_decoder_feed(&d, bogus, sizeof(bogus), collect_export_frame, &frames);
+  export_decoder_feed(&d, &stream[0], stream.size(), collect_export_frame, &frames);
+  CHECK_EQ(frames.size(), 96u);
+  CHECK_EQ(d.skipped_bytes, sizeof(bogus) + text_len);
+
+  // A restart (older tick) is not counted as dropped
+  export_decoder_reset(&d);
+  len = export_samples_encode(buf, sizeof(buf), 500, 0, values, 1);
+  export_decoder_feed(&d, buf, len, NULL, NULL);
+  len = export_samples_encode(buf, sizeof(buf), 0, 0, values, 1);
+  export_decoder_feed(&d, buf, len, NULL, NULL);
+  len = export_samples_encode(buf, sizeof(buf), 1, 0, values, 1);
+  export_decoder_feed(&d, buf, len, NULL, NULL);
+  CHECK_EQ(d.frames, 3);
+  CHECK_EQ(d.dropped, 0);
+}
+
+// Keeps every parsed entry with its strings copied
+struct parsed_entry {
+  struct config_entry entry;
+  std::string name, status, type, function_name, protocol_type, mac, first_param, first_pin;
+};
+
+static void collect_config_entry(const struct config_entry* e, void* ctx){
+  struct parsed_entry p;
+  p.entry = *e;
+  p.name.assign(e->name.text ? e->name.text : "", e->name.len);
+  p.status.assign(e->status.text ? e->status.text : "", e->status.len);
+  p.type.assign(e->type.text ? e->type.text : "", e->type.len);
+  p.function_name.assign(e->function_name.text ? e->function_name.text : "", e->function_name.len);
+  p.protocol_type.assign(e->protocol_type.text ? e->protocol_type.text : "", e->protocol_type.len);
+  p.mac.assign(e->mac.text ? e->mac.text : "", e->mac.len);
+  if (e->param_count > 0) {
+    p.first_param.assign(e->params[0].name.text, e->params[0].name.len);
+  }
+  if (e->pin_count > 0 && e->pins[0].type.len > 0) {
+    p.first_pin.assign(e->pins[0].type.text, e->pins[0].type.len);
+  }
+  ((std::vector<struct parsed_entry>*)ctx)->push_back(p);
+}
+
+static void test_config_parse(){
+  const char* yaml =
+    "file_type: 'hand_system_configuration'   # the schema\r\n"
+    "\r\n"
+    "general:\r\n"
+    "  - name: 'Technician_code'\r\n"
+    "    code: -222\r\n"
+    "communications:\r\n"
+    "  - name: \"BLE # client\"  # quoted # is not a comment\r\n"
+    "    mac: 11-11-11-11\r\n"
+    "    SERVICE1_UUID \"6c09a8a9\"\r\n"                 // no colon: skipped
+    "sensors:\r\n"
+    "- name: leg_pressure_sensor\r\n"                     // list at the indent of its key
+    "  status: 'on'\r\n"
+    "  function:\r\n"
+    "    name: 'leg_function'\r\n"
+    "    parameters:\r\n"
+    "      param_1: [ 80, 20 ,100,true ]\r\n"
+    "      broken: [1,2,3]\r\n"                           // three values: skipped
+    "      high_thld: [90,20,100,FALSE]\r\n"
+    "  type: 'BLE_input'\r\n"                             // back in the entry after the nested blocks
+    "unknown_section:\r\n"
+    "  - name: 'ignored'\r\n"
+    "motors:\r\n"
+    "  - name: 'finger1_dc'\r\n"
+    "    pins:\r\n"
+    "      - type: 'in1_pin'\r\n"
+    "        pin_number: 19\r\n"
+    "      - pin_number: 21\r\n"
+    "        type: 'in2_pin'\r\n"
+    "    safety_threshold: [20,10,50,true]\r\n"
+    "    type: 'DC_motor'\r\n"
+    "  - name: 'turn_dc'\r\n"
+    "functions:\r\n"
+    "  - name: 'rock'\r\n"
+    "    protocol_type: 'gesture'";                       // no newline at the end
+  std::vector<struct parsed_entry> entries;
+  struct config_parse_result result;
+  CHECK_EQ(config_parse(yaml, strlen(yaml), collect_config_entry, &entries, &result), 6);
+  CHECK_EQ(entries.size(), 6u);
+  CHECK_EQ(result.entries, 6);
+  CHECK_EQ(result.lines, 34);
+  CHECK_EQ(result.skipped_lines, 2);
+  CHECK_EQ(result.first_skipped_line, 9);
+  CHECK(config_text_equals(&result.file_type, "hand_system_configuration"));
+  if (entries.size() == 6) {
+    CHECK_EQ(entries[0].entry.section, CONFIG_GENERAL);
+    CHECK(entries[0].name == "Technician_code");
+    CHECK_EQ(entries[0].entry.code, -222);
+    CHECK_EQ(entries[1].entry.section, CONFIG_COMMUNICATIONS);
+    CHECK(entries[1].name == "BLE # client");
+    CHECK(entries[1].mac == "11-11-11-11");
+    CHECK_EQ(entries[1].entry.service_uuid.len, 0);
+    const struct config_entry& sensor = entries[2].entry;
+    CHECK_EQ(sensor.section, CONFIG_SENSORS);
+    CHECK(entries[2].name == "leg_pressure_sensor");
+    CHECK(entries[2].status == "on");
+    CHECK(entries[2].type == "BLE_input");
+    CHECK(entries[2].function_name == "leg_function");
+    CHECK_EQ(sensor.param_count, 2);
+    CHECK(entries[2].first_param == "param_1");
+    CHECK_EQ(sensor.params[0].current_val, 80);
+    CHECK_EQ(sensor.params[0].min, 20);
+    CHECK_EQ(sensor.params[0].max, 100);
+    CHECK(sensor.params[0].modify_permission);
+    CHECK(config_text_equals(&sensor.params[1].name, "high_thld"));
+    CHECK(!sensor.params[1].modify_permission);
+    const struct config_entry& motor = entries[3].entry;
+    CHECK_EQ(motor.section, CONFIG_MOTORS);
+    CHECK(entries[3].type == "DC_motor");
+    CHECK_EQ(motor.pin_count, 2);
+    CHECK(entries[3].first_pin == "in1_pin");
+    CHECK_EQ(motor.pins[0].pin_number, 19);
+    CHECK(config_text_equals(&motor.pins[1].type, "in2_pin"));
+    CHECK_EQ(motor.pins[1].pin_number, 21);
+    CHECK(motor.has_safety_threshold);
+    CHECK_EQ(motor.safety_threshold.max, 50);
+    CHECK(entries[4].name == "turn_dc");
+    CHECK_EQ(entries[4].entry.pin_count, 0);
+    CHECK(!entries[4].entry.has_safety_threshold);
+    CHECK_EQ(entries[5].entry.section, CONFIG_FUNCTIONS);
+    CHECK(entries[5].protocol_type == "gesture");
+  }
+
+  // One section on its own, as the screen gets them; the text does not need a 0
+  std::string section = "motors:\n  - name: 'a'\n    pins:\n      - type: 'x'\n        pin_number: 1\n";
+  std::vector<char> unterminated(section.begin(), section.end());
+  entries.clear();
+  CHECK_EQ(config_parse(&unterminated[0], unterminated.size(), collect_config_entry, &entries, NULL), 1);
+  CHECK_EQ(entries.size() == 1 ? entries[0].entry.pins[0].pin_number : -1, 1);
+
+  // Limits: the parameters past CONFIG_MAX_PARAMS are skipped
+  std::string many = "sensors:\n  - name: 's'\n    function:\n      parameters:\n";
+  for (int i = 0; i < CONFIG_MAX_PARAMS + 3; i++) {
+    many += "        p" + std::to_string(i) + ": [1,2,3,true]\n";
+  }
+  entries.clear();
+  config_parse(many.data(), many.size(), collect_config_entry, &entries, &result);
+  CHECK_EQ(entries.size() == 1 ? entries[0].entry.param_count : 0, CONFIG_MAX_PARAMS);
+  CHECK_EQ(result.skipped_lines, 3);
+
+  // Nothing to parse
+  CHECK_EQ(config_parse(NULL, 0, collect_config_entry, &entries, &result), 0);
+  CHECK_EQ(config_parse("# only a comment\n\n", 18, NULL, NULL, &result), 0);
+  CHECK_EQ(result.lines, 2);
+  CHECK_EQ(result.skipped_lines, 0);
+}
+
+static struct config_model test_model;    // static: the model is a few KB
+
+static const char* test_config_yaml =
+  "file_type: hand_system_configuration\n"
+  "general:\n"
+  "  - name: 'Technician_code'\n"
+  "    code: 28282\n"
+  "communications:\n"
+  "  - name: 'BLE_client'\n"
+  "    status: 'ON'\n"
+  "sensors:\n"
+  "  - name: 'leg_sensor'\n"
+  "    status: 'on'\n"
+  "    type: 'BLE_input'\n"
+  "    function:\n"
+  "      name: 'leg_function'\n"
+  "      parameters:\n"
+  "        param_1: [80,20,100,false]\n"
+  "        high_thld: [90,20,100,true]\n"
+  "        low_thld: [60,20,100,false]\n"
+  "  - name: 'shoulder_sensor'\n"
+  "    status: 'Off'\n"
+  "    type: 'BLE_input'\n"
+  "    function:\n"
+  "      name: 'leg_function'\n"
+  "      parameters:\n"
+  "        param_1: [60,20,100,true]\n"
+  "motors:\n"
+  "  - name: 'finger1_dc'\n"
+  "    type: 'DC_motor'\n"
+  "    pins:\n"
+  "      - type: 'in1_pin'\n"
+  "        pin_number: 19\n"
+  "      - type: 'in2_pin'\n"
+  "        pin_number: 21\n"
+  "    safety_threshold: [20,10,50,true]\n"
+  "  - name: 'turn_dc'\n"
+  "    type: 'DC_motor'\n"
+  "    pins:\n"
+  "      - type: 'in1_pin'\n"
+  "        pin_number: 26\n"
+  "functions:\n"
+  "  - name: 'rock'\n"
+  "    protocol_type: 'gesture'\n"
+  "  - name: 'run_motors'\n"
+  "    protocol_type: 'modify_only'\n";
+
+static void test_config_model(){
+  const char* yaml = test_config_yaml;
+  struct config_model* m = &test_model;
+  config_model_reset(m);
+  CHECK_EQ(config_model_load(m, yaml, strlen(yaml), NULL), 8);
+  CHECK_EQ(m->dropped, 0);
+  CHECK(strcmp(config_model_str(m, m->file_type), "hand_system_configuration") == 0);
+  CHECK_EQ(m->general_count, 1);
+  CHECK_EQ(m->general[0].code, 28282);
+  CHECK_EQ(m->communication_count, 1);
+  CHECK_EQ(m->communications[0].status, CONFIG_STATUS_ON);
+  CHECK_EQ(m->communications[0].ssid, CONFIG_NAME_EMPTY);
+
+  // Sensors: enum status in any case, parameters in name order in one array
+  CHECK_EQ(m->sensor_count, 2);
+  CHECK(strcmp(config_model_str(m, m->sensors[0].name), "leg_sensor") == 0);
+  CHECK_EQ(m->sensors[0].status, CONFIG_STATUS_ON);
+  CHECK_EQ(m->sensors[1].status, CONFIG_STATUS_OFF);
+  CHECK_EQ(m->sensors[0].param_count, 3);
+  CHECK_EQ(m->sensors[1].first_param, 3);
+  CHECK_EQ(m->param_count, 4);
+  const struct config_model_param* params = config_model_sensor_params(m, &m->sensors[0]);
+  CHECK(strcmp(config_model_str(m, params[0].name), "high_thld") == 0);
+  CHECK(strcmp(config_model_str(m, params[1].name), "low_thld") == 0);
+  CHECK(strcmp(config_model_str(m, params[2].name), "param_1") == 0);
+  CHECK_EQ(params[0].current_val, 90);
+  CHECK(params[0].modify_permission);
+  CHECK(!params[2].modify_permission);
+  CHECK_EQ(config_model_sensor_params(m, &m->sensors[1])[0].current_val, 60);
+
+  // Interned: a repeated string is stored once and compares as its name
+  CHECK_EQ(m->sensors[0].type, m->sensors[1].type);
+  CHECK_EQ(m->sensors[0].function_name, m->sensors[1].function_name);
+  CHECK_EQ(params[2].name, config_model_sensor_params(m, &m->sensors[1])[0].name);
+  CHECK_EQ(m->motors[0].type, m->motors[1].type);
+  CHECK_EQ(config_model_find(m, "DC_motor"), m->motors[0].type);
+  CHECK_EQ(config_model_find(m, "gesture"), m->functions[0].protocol_type);
+  CHECK_EQ(config_model_find(m, "paper"), CONFIG_NAME_MISSING);
+  CHECK_EQ(config_model_find(m, ""), CONFIG_NAME_EMPTY);
+  CHECK_EQ(config_model_intern(m, "rock", 4), m->functions[0].name);
+  uint16_t names = m->name_count;
+  uint16_t pool_len = m->pool_len;
+
+  // Motors: pins in one array, threshold inline
+  CHECK_EQ(m->motor_count, 2);
+  CHECK_EQ(m->motors[0].pin_count, 2);
+  CHECK_EQ(m->motors[1].first_pin, 2);
+  CHECK_EQ(config_model_motor_pins(m, &m->motors[1])[0].pin_number, 26);
+  CHECK_EQ(m->motors[0].safety_threshold.max, 50);
+  CHECK_EQ(m->function_count, 2);
+
+  // A section reloaded on its own keeps the ids of the others and adds no strings
+  const char* sensors = strstr(yaml, "sensors:");
+  config_model_clear_section(m, CONFIG_SENSORS);
+  CHECK_EQ(m->sensor_count, 0);
+  CHECK_EQ(m->param_count, 0);
+  CHECK_EQ(m->motor_count, 2);
+  config_model_load(m, sensors, strstr(yaml, "motors:") - sensors, NULL);
+  CHECK_EQ(m->sensor_count, 2);
+  CHECK_EQ(m->param_count, 4);
+  CHECK_EQ(m->name_count, names);
+  CHECK_EQ(m->pool_len, pool_len);
+
+  // Limits: entries past the arrays are dropped and counted
+  std::string many = "sensors:\n";
+  for (int i = 0; i < CONFIG_MODEL_MAX_SENSORS + 2; i++) {
+    many += "  - name: 's" + std::to_string(i) + "'\n    function:\n      parameters:\n"
+            "        a: [1,0,2,true]\n        b: [1,0,2,true]\n        c: [1,0,2,true]\n        d: [1,0,2,true]\n        e: [1,0,2,true]\n";
+  }
+  config_model_reset(m);
+  config_model_load(m, many.data(), many.size(), NULL);
+  CHECK_EQ(m->sensor_count, CONFIG_MODEL_MAX_SENSORS);
+  CHECK_EQ(m->param_count, CONFIG_MODEL_MAX_PARAMS);
+  CHECK_EQ(m->dropped, 2 + (CONFIG_MODEL_MAX_SENSORS * 5 - CONFIG_MODEL_MAX_PARAMS));
+  CHECK_EQ(m->sensors[CONFIG_MODEL_MAX_SENSORS - 1].param_count, 0);
+
+  // The string pool: a full pool gives the empty name
+  config_model_reset(m);
+  char text[100];
+  memset(text, 'x', sizeof(text));
+  int interned = 0;
+  for (int i = 0; i < 40; i++) {
+    text[0] = (char)('A' + i);
+    interned += config_model_intern(m, text, sizeof(text)) != CONFIG_NAME_EMPTY;
+  }
+  CHECK_EQ(interned, (CONFIG_MODEL_POOL_SIZE - 1) / (sizeof(text) + 1));
+  CHECK(m->pool_len <= CONFIG_MODEL_POOL_SIZE);
+  CHECK_EQ(m->dropped, 40 - interned);
+
+  // A zeroed model (a global) loads like a reset one
+  memset(m, 0, sizeof(*m));
+  CHECK_EQ(config_model_load(m, yaml, strlen(yaml), NULL), 8);
+  CHECK(strcmp(config_model_str(m, m->motors[1].name), "turn_dc") == 0);
+  CHECK_EQ(config_model_find(m, ""), CONFIG_NAME_EMPTY);
+}
+
+static struct config_model test_snapshot_model;
+
+static void test_config_snapshot(){
+  struct config_model* m = &test_model;
+  config_model_reset(m);
+  config_model_load(m, test_config_yaml, strlen(test_config_yaml), NULL);
+  uint32_t digest = config_digest((const uint8_t*)test_config_yaml, strlen(test_config_yaml));
+  static uint32_t storage[CONFIG_SNAPSHOT_MAX_LEN / 4 + 1];   // 4 byte aligned
+  uint8_t* buf = (uint8_t*)storage;
+  size_t len = config_snapshot_encode(m, digest, buf, sizeof(storage));
+  CHECK_EQ(len, config_snapshot_size(m));
+  CHECK_EQ(len % 4, 0);
+  CHECK(len < strlen(test_config_yaml));
+  CHECK_EQ(config_snapshot_encode(m, digest, buf, len - 1), 0);
+  CHECK_EQ(config_snapshot_encode(m, digest, buf, len), len);
+
+  // Opened in place: the records are the model's, the pointers are into buf
+  struct config_snapshot view;
+  CHECK(config_snapshot_open(buf, len, &view));
+  CHECK_EQ(view.total_len, len);
+  CHECK_EQ(view.source_digest, digest);
+  CHECK_EQ(view.sensor_count, 2);
+  CHECK_EQ(view.param_count, 4);
+  CHECK((const uint8_t*)view.sensors == buf + CONFIG_SNAPSHOT_HDR_LEN);
+  CHECK((const uint8_t*)view.pool > buf && (const uint8_t*)view.pool + view.pool_len <= buf + len);
+  CHECK(strcmp(config_snapshot_str(&view, view.file_type), "hand_system_configuration") == 0);
+  CHECK(strcmp(config_snapshot_str(&view, view.sensors[1].name), "shoulder_sensor") == 0);
+  CHECK_EQ(view.params[view.sensors[0].first_param].current_val, 90);
+  CHECK_EQ(view.pins[view.motors[1].first_pin].pin_number, 26);
+  CHECK_EQ(view.motors[0].safety_threshold.max, 50);
+  CHECK_EQ(view.communications[0].status, CONFIG_STATUS_ON);
+  CHECK_EQ(view.general[0].code, 28282);
+  CHECK(strcmp(config_snapshot_str(&view, view.functions[1].protocol_type), "modify_only") == 0);
+  CHECK(strcmp(config_snapshot_str(&view, 0xFFF0), "") == 0);
+
+  // Loaded: the same model as parsing the YAML, lookups included
+  struct config_model* loaded = &test_snapshot_model;
+  memset(loaded, 0xA5, sizeof(*loaded));
+  CHECK(config_snapshot_load(loaded, buf, len));
+  CHECK_EQ(loaded->dropped, 0);
+  CHECK_EQ(loaded->sensor_count, m->sensor_count);
+  CHECK_EQ(loaded->motor_count, m->motor_count);
+  CHECK_EQ(loaded->function_count, m->function_count);
+  CHECK_EQ(loaded->general_count, m->general_count);
+  CHECK_EQ(loaded->communication_count, m->communication_count);
+  CHECK_EQ(loaded->param_count, m->param_count);
+  CHECK_EQ(loaded->pin_count, m->pin_count);
+  CHECK_EQ(loaded->name_count, m->name_count);
+  CHECK_EQ(loaded->pool_len, m->pool_len);
+  CHECK(memcmp(loaded->sensors, m->sensors, m->sensor_count * sizeof(m->sensors[0])) == 0);
+  CHECK(memcmp(loaded->params, m->params, m->param_count * sizeof(m->params[0])) == 0);
+  CHECK(memcmp(loaded->pool, m->pool, m->pool_len) == 0);
+  CHECK_EQ(config_model_find(loaded, "DC_motor"), loaded->motors[0].type);
+  CHECK_EQ(config_model_find(loaded, "paper"), CONFIG_NAME_MISSING);
+  CHECK_EQ(config_model_intern(loaded, "rock", 4), loaded->functions[0].name);
+  CHECK_EQ(config_model_intern(loaded, "paper", 5), m->pool_len);
+
+  // Rejected: truncated, corrupted, another version, misaligned
+  CHECK(!config_snapshot_open(buf, len - 1, &view));
+  CHECK(!config_snapshot_open(buf, 10, &view));
+  buf[len - 1] ^= 0x01;
+  CHECK(!config_snapshot_open(buf, len, &view));
+  buf[len - 1] ^= 0x01;
+  buf[4] = CONFIG_SNAPSHOT_VERSION + 1;
+  CHECK(!config_snapshot_open(buf, len, &view));
+  buf[4] = CONFIG_SNAPSHOT_VERSION;
+  CHECK(config_snapshot_open(buf, len, &view));
+  std::vector<uint8_t> shifted(len + 4);
+  memcpy(&shifted[1], buf, len);
+  CHECK(!config_snapshot_open(&shifted[1], len, &view));
+  CHECK(!config_snapshot_load(loaded, NULL, 0));
+  CHECK_EQ(loaded->sensor_count, m->sensor_count);
+
+  // A header that passes the CRC but points past the arrays is rejected as well
+  struct config_model* bad = &test_snapshot_model;
+  *bad = *m;
+  bad->sensors[1].first_param = 3;
+  bad->sensors[1].param_count = 2;
+  len = config_snapshot_encode(bad, digest, buf, sizeof(storage));
+  CHECK(!config_snapshot_open(buf, len, &view));
+
+  // An empty (zeroed) model still makes a valid snapshot
+  memset(bad, 0, sizeof(*bad));
+  len = config_snapshot_encode(bad, 0, buf, sizeof(storage));
+  CHECK(config_snapshot_open(buf, len, &view));
+  CHECK_EQ(view.pool_len, 1);
+  CHECK_EQ(view.sensor_count, 0);
+}
+
+static struct config_model test_stream_model;
+
+static bool same_model(const struct config_model* a, const struct config_model* b){
+  return a->file_type == b->file_type && a->sensor_count == b->sensor_count && a->motor_count == b->motor_count &&
+         a->function_count == b->function_count && a->general_count == b->general_count &&
+         a->communication_count == b->communication_count && a->param_count == b->param_count &&
+         a->pin_count == b->pin_count && a->dropped == b->dropped && a->pool_len == b->pool_len &&
+         memcmp(a->sensors, b->sensors, a->sensor_count * sizeof(a->sensors[0])) == 0 &&
+         memcmp(a->motors, b->motors, a->motor_count * sizeof(a->motors[0])) == 0 &&
+         memcmp(a->functions, b->functions, a->function_count * sizeof(a->functions[0])) == 0 &&
+         memcmp(a->general, b->general, a->general_count * sizeof(a->general[0])) == 0 &&
+         memcmp(a->communications, b->communications, a->communication_count * sizeof(a->communications[0])) == 0 &&
+         memcmp(a->params, b->params, a->param_count * sizeof(a->params[0])) == 0 &&
+         memcmp(a->pins, b->pins, a->pin_count * sizeof(a->pins[0])) == 0 &&
+         memcmp(a->pool, b->pool, a->pool_len) == 0;
+}
+
+// Feeds text to a config_parse_stream in pieces of chunk bytes
+static int parse_in_chunks(const std::string& text, size_t chunk, std::vector<struct parsed_entry>* entries,
+                           struct config_parse_result* result){
+  static struct config_parse_stream st;
+  config_parse_begin(&st, collect_config_entry, entries);
+  for (size_t pos = 0; pos < text.size(); pos += chunk) {
+    std::vector<char> piece(text.begin() + pos, text.begin() + std::min(text.size(), pos + chunk));
+    config_parse_feed(&st, &piece[0], piece.size());   // a copy, gone after the call
+  }
+  return config_parse_end(&st, result);
+}
+
+static bool same_entries(const std::vector<struct parsed_entry>& a, const std::vector<struct parsed_entry>& b){
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].name != b[i].name || a[i].status != b[i].status || a[i].type != b[i].type ||
+        a[i].function_name != b[i].function_name || a[i].protocol_type != b[i].protocol_type || a[i].mac != b[i].mac ||
+        a[i].first_param != b[i].first_param || a[i].first_pin != b[i].first_pin ||
+        a[i].entry.section != b[i].entry.section || a[i].entry.code != b[i].entry.code ||
+        a[i].entry.param_count != b[i].entry.param_count || a[i].entry.pin_count != b[i].entry.pin_count) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Streams the sections of text as fragments through a reassembler, in the given
+// order of fragment indices per section; sections the stream skips are parsed
+// whole once complete, as the screen does
+static void stream_sections(struct config_model* m, const std::vector<std::string>& sections, bool lz, bool swap,
+                            int* streamed, int* swapped){
+  static struct config_stream cs;
+  struct wire_reassembler reasm;
+  memset(&reasm, 0, sizeof(reasm));
+  *streamed = 0;
+  *swapped = 0;
+  for (size_t s = 0; s < sections.size(); s++) {
+    std::string on_air = sections[s];
+    if (lz) {
+      struct lz_compressor* st = (struct lz_compressor*)malloc(sizeof(struct lz_compressor));
+      std::vector<uint8_t> packed(lz_compress_bound(on_air.size()));
+      size_t packed_len = lz_compress(st, (const uint8_t*)on_air.data(), on_air.size(), packed.data(), packed.size());
+      free(st);
+      on_air.assign((const char*)packed.data(), packed_len);
+    }
+    std::vector<std::vector<uint8_t> > frames = fragment(on_air, (uint8_t)(YML_SENSOR_ANS + s), (uint8_t)s, 20);
+    if (swap && frames.size() > 3) {
+      std::swap(frames[1], frames[2]);
+      (*swapped)++;
+    }
+    for (size_t i = 0; i < frames.size(); i++) {
+      struct wire_frame frame;
+      wire_frame_decode(frames[i].data(), frames[i].size(), &frame);
+      int status = wire_reasm_push(&reasm, &frame, 0);
+      int parsed = config_stream_fragment(&cs, m, &frame);
+      if (status != WIRE_REASM_DONE) {
+        continue;
+      }
+      size_t len = 0;
+      uint8_t* text = wire_reasm_take(&reasm, &len);
+      if (parsed == CONFIG_STREAM_DONE) {
+        uint8_t* raw = NULL;
+        size_t raw_len = 0;
+        config_stream_end(&cs, NULL, &raw, &raw_len);
+        CHECK_EQ(raw != NULL, lz);
+        CHECK(!lz || (raw_len == sections[s].size() && memcmp(raw, sections[s].data(), raw_len) == 0 && raw[raw_len] == '\0'));
+        free(raw);
+        (*streamed)++;
+      } else {
+        size_t raw_len = len;
+        uint8_t* raw = lz ? lz_decompress(text, len, &raw_len) : text;
+        config_model_clear_section(m, s == 0 ? CONFIG_SENSORS : s == 1 ? CONFIG_MOTORS : s == 2 ? CONFIG_FUNCTIONS : CONFIG_GENERAL);
+        if (s == 3) {
+          config_model_clear_section(m, CONFIG_COMMUNICATIONS);
+        }
+        config_model_load(m, (const char*)raw, raw_len, NULL);
+        if (raw != text) {
+          free(raw);
+        }
+      }
+      free(text);
+    }
+  }
+  config_stream_reset(&cs);
+}
+
+static void test_config_stream(){
+  // Split anywhere, the entries and the counts are the ones of a parse of the whole text
+  std::string yaml = test_config_yaml;
+  yaml += "general:\r\n  - name: 'crlf'   # comment\r\n    code: 7\r\n  SERVICE1_UUID \"6c09a8a9\"\r\n  - name: 'last'";
+  std::vector<struct parsed_entry> whole, pieces;
+  struct config_parse_result whole_result, result;
+  int whole_entries = config_parse(yaml.data(), yaml.size(), collect_config_entry, &whole, &whole_result);
+  CHECK_EQ(whole_entries, 10);
+  CHECK_EQ(whole_result.skipped_lines, 1);
+  const size_t chunks[] = {1, 2, 3, 7, 20, 64, 244, 5000};
+  for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+    pieces.clear();
+    CHECK_EQ(parse_in_chunks(yaml, chunks[c], &pieces, &result), whole_entries);
+    CHECK(same_entries(whole, pieces));
+    CHECK_EQ(result.lines, whole_result.lines);
+    CHECK_EQ(result.skipped_lines, whole_result.skipped_lines);
+    CHECK_EQ(result.first_skipped_line, whole_result.first_skipped_line);
+    CHECK(config_text_equals(&result.file_type, "hand_system_configuration"));
+  }
+
+  // An entry longer than the buffer is handed out with what fit, the rest of its lines are skipped
+  std::string big = "sensors:\n  - name: 'big'\n";
+  while (big.size() < CONFIG_STREAM_BUF_SIZE + 100) {
+    big += "    # a comment that only takes room in the buffer\n";
+  }
+  big += "    type: 'late'\n  - name: 'next'\n    type: 'BLE_input'\n";
+  pieces.clear();
+  CHECK_EQ(parse_in_chunks(big, 50, &pieces, &result), 2);
+  CHECK(pieces.size() == 2 && pieces[0].name == "big" && pieces[0].type.empty());
+  CHECK(pieces.size() == 2 && pieces[1].name == "next" && pieces[1].type == "BLE_input");
+  CHECK_EQ(result.skipped_lines, 1);
+
+  // A line longer than the buffer is skipped, and ends its entry
+  std::string long_line = "sensors:\n  - name: 'a'\n    type: '" + std::string(CONFIG_STREAM_BUF_SIZE * 2, 'x') + "'\n"
+                          "    status: 'on'\n  - name: 'b'\n";
+  pieces.clear();
+  CHECK_EQ(parse_in_chunks(long_line, 100, &pieces, &result), 2);
+  CHECK(pieces.size() == 2 && pieces[0].name == "a" && pieces[0].type.empty() && pieces[1].name == "b");
+  CHECK_EQ(result.skipped_lines, 2);
+  CHECK_EQ(result.first_skipped_line, 3);
+  CHECK_EQ(result.lines, 5);
+
+  // Sections as fragments, plain and LZ, in order and with a resend out of order:
+  // the same model as parsing each section when it is complete
+  const char* keys[] = {"sensors:", "motors:", "functions:", "general:"};
+  std::vector<std::string> sections;
+  std::string full = test_config_yaml;
+  for (int i = 0; i < 4; i++) {
+    size_t start = full.find(keys[i]);
+    size_t end = std::string::npos;
+    for (int k = 0; k < 4; k++) {
+      size_t next = full.find(keys[k], start + 1);
+      if (next != std::string::npos && next > start && (end == std::string::npos || next < end)) {
+        end = next;
+      }
+    }
+    sections.push_back(full.substr(start, end == std::string::npos ? std::string::npos : end - start));
+  }
+  struct config_model* expected = &test_model;
+  config_model_reset(expected);
+  for (size_t i = 0; i < sections.size(); i++) {
+    config_model_load(expected, sections[i].data(), sections[i].size(), NULL);
+  }
+  struct config_model* m = &test_stream_model;
+  for (int lz = 0; lz < 2; lz++) {
+    for (int swap = 0; swap < 2; swap++) {
+      config_model_reset(m);
+      int streamed = 0, swapped = 0;
+      stream_sections(m, sections, lz != 0, swap != 0, &streamed, &swapped);
+      CHECK(same_model(m, expected));
+      CHECK_EQ(streamed, 4 - swapped);
+      CHECK_EQ(swapped > 0, swap);
+    }
+  }
+
+  // A download replaces what the model had (the demo config), section by section
+  config_model_reset(m);
+  config_model_load(m, test_config_yaml, strlen(test_config_yaml), NULL);
+  int streamed = 0, swapped = 0;
+  stream_sections(m, sections, false, false, &streamed, &swapped);
+  CHECK_EQ(streamed, 4);
+  CHECK_EQ(m->sensor_count, expected->sensor_count);
+  CHECK_EQ(m->param_count, expected->param_count);
+  CHECK_EQ(m->pin_count, expected->pin_count);
+  CHECK_EQ(m->communication_count, 1);
+  CHECK_EQ(m->functions[1].protocol_type, config_model_find(m, "modify_only"));
+
+  // An empty section (the mock sends "" for a missing one) empties the section
+  // of the model, as a section parsed whole does; general also drops the communications
+  std::vector<std::string> empty = sections;
+  empty[0] = "";
+  empty[3] = "";
+  config_model_reset(m);
+  config_model_load(m, test_config_yaml, strlen(test_config_yaml), NULL);
+  stream_sections(m, empty, false, false, &streamed, &swapped);
+  CHECK_EQ(streamed, 4);
+  CHECK_EQ(m->sensor_count, 0);
+  CHECK_EQ(m->param_count, 0);
+  CHECK_EQ(m->general_count, 0);
+  CHECK_EQ(m->communication_count, 0);
+  CHECK_EQ(m->motor_count, expected->motor_count);
+  CHECK_EQ(m->function_count, expected->function_count);
+}
+
+static struct config_index test_index;
+
+static void test_config_index(){
+  struct config_model* m = &test_model;
+  struct config_index* idx = &test_index;
+  memset(idx, 0, sizeof(*idx));
+  config_model_reset(m);
+  config_model_load(m, test_config_yaml, strlen(test_config_yaml), NULL);
+
+  // A zeroed index finds nothing until it is built
+  CHECK_EQ(config_index_find(idx, m, CONFIG_INDEX_SENSORS, "leg_sensor"), -1);
+  CHECK(strcmp(config_index_options(idx, CONFIG_INDEX_SENSORS), "") == 0);
+  CHECK(config_index_refresh(idx, m));
+  CHECK(!config_index_refresh(idx, m));
+
+  // Ids by name, per kind
+  CHECK_EQ(config_index_find(idx, m, CONFIG_INDEX_SENSORS, "leg_sensor"), 0);
+  CHECK_EQ(config_index_find(idx, m, CONFIG_INDEX_SENSORS, "shoulder_sensor"), 1);
+  CHECK_EQ(config_index_find(idx, m, CONFIG_INDEX_MOTORS, "turn_dc"), 1);
+  CHECK_EQ(config_index_find(idx, m, CONFIG_INDEX_FUNCTIONS, "run_motors"), 1);
+  CHECK_EQ(config_index_find(idx, m, CONFIG_INDEX_GENERAL, "Technician_code"), 0);
+  CHECK_EQ(config_index_id(idx, CONFIG_INDEX_MOTORS, m->motors[0].name), 0);
+  CHECK_EQ(config_index_find(idx, m, CONFIG_INDEX_MOTORS, "leg_sensor"), -1);
+  CHECK_EQ(config_index_find(idx, m, CONFIG_INDEX_SENSORS, "paper"), -1);
+  CHECK_EQ(config_index_find(idx, m, CONFIG_INDEX_SENSORS, ""), -1);
+
+  // Ids by type, in config order
+  uint8_t count = 0;
+  const uint8_t* ids = config_index_of_type(idx, CONFIG_INDEX_FUNCTIONS, config_model_find(m, "gesture"), &count);
+  CHECK_EQ(count, 1);
+  CHECK_EQ(ids[0], 0);
+  ids = config_index_of_type(idx, CONFIG_INDEX_MOTORS, config_model_find(m, "DC_motor"), &count);
+  CHECK_EQ(count, 2);
+  CHECK_EQ(ids[0], 0);
+  CHECK_EQ(ids[1], 1);
+  config_index_of_type(idx, CONFIG_INDEX_FUNCTIONS, config_model_find(m, "DC_motor"), &count);
+  CHECK_EQ(count, 0);
+  config_index_of_type(idx, CONFIG_INDEX_SENSORS, CONFIG_NAME_MISSING, &count);
+  CHECK_EQ(count, 0);
+
+  // Dropdown options
+  CHECK(strcmp(config_index_options(idx, CONFIG_INDEX_SENSORS), "leg_sensor\nshoulder_sensor") == 0);
+  CHECK(strcmp(config_index_options(idx, CONFIG_INDEX_MOTORS), "finger1_dc\nturn_dc") == 0);
+  CHECK(strcmp(config_index_options(idx, CONFIG_INDEX_GENERAL), "") == 0);
+
+  // Rebuilt only after the entries changed: a section reloaded, a status edited in place is not
+  m->sensors[1].status = CONFIG_STATUS_ON;
+  CHECK(!config_index_refresh(idx, m));
+  const char* motors = strstr(test_config_yaml, "motors:");
+  config_model_clear_section(m, CONFIG_MOTORS);
+  CHECK(config_index_refresh(idx, m));
+  CHECK_EQ(config_index_find(idx, m, CONFIG_INDEX_MOTORS, "turn_dc"), -1);
+  CHECK(strcmp(config_index_options(idx, CONFIG_INDEX_MOTORS), "") == 0);
+  config_model_load(m, motors, strstr(test_config_yaml, "functions:") - motors, NULL);
+  CHECK(config_index_refresh(idx, m));
+  CHECK_EQ(config_index_find(idx, m, CONFIG_INDEX_MOTORS, "turn_dc"), 1);
+
+  // Of two entries with one name the first is found; the options stop at the last name that fits
+  std::string many = "sensors:\n";
+  const int name_len = 45;
+  for (int i = 0; i < 12; i++) {
+    std::string name = "s" + std::to_string(i) + "_";
+    name.resize(name_len, 'x');
+    many += "  - name: '" + name + "'\n";
+  }
+  many += "  - name: 's0_" + std::string(name_len - 3, 'x') + "'\n";
+  config_model_reset(m);
+  config_model_load(m, many.data(), many.size(), NULL);
+  CHECK(config_index_refresh(idx, m));
+  CHECK_EQ(m->sensor_count, 13);
+  CHECK_EQ(config_index_id(idx, CONFIG_INDEX_SENSORS, m->sensors[12].name), 0);
+  const char* options = config_index_options(idx, CONFIG_INDEX_SENSORS);
+  size_t fit = CONFIG_INDEX_OPTIONS_SIZE / (name_len + 1);
+  CHECK_EQ(strlen(options), fit * (name_len + 1) - 1);
+  CHECK(strncmp(options + strlen(options) - name_len, config_model_str(m, m->sensors[fit - 1].name), name_len) == 0);
+  config_index_of_type(idx, CONFIG_INDEX_SENSORS, CONFIG_NAME_EMPTY, &count);
+  CHECK_EQ(count, 13);
+
+  // A snapshot load counts as a change
+  static uint32_t storage[CONFIG_SNAPSHOT_MAX_LEN / 4 + 1];
+  size_t len = config_snapshot_encode(m, 0, (uint8_t*)storage, sizeof(storage));
+  CHECK(len > 0);
+  CHECK(config_snapshot_load(m, (const uint8_t*)storage, len));
+  CHECK(config_index_refresh(idx, m));
+}
+
+static void test_config_helpers(){
+  CHECK_EQ(config_digest((const uint8_t*)"", 0), 0x811c9dc5u);
+  CHECK_EQ(config_digest((const uint8_t*)"a", 1), 0xe40c292cu);
+  CHECK_EQ(config_digest((const uint8_t*)"foobar", 6), 0xbf9cf968u);
+  CHECK_EQ(yaml_req_caps("Please send YAML data caps=1"), YAML_CAP_LZ);
+  CHECK_EQ(yaml_req_caps("Please send YAML data"), 0);
+  CHECK_EQ(yaml_req_caps("Please send YAML data caps=3"), YAML_CAP_LZ | YAML_CAP_SNAPSHOT);
+  CHECK_EQ(yaml_stream_window(wire_frag_payload_size(WIRE_DEFAULT_MTU)), YAML_STREAM_WINDOW_BYTES / 10);
+  CHECK_EQ(yaml_stream_window(wire_frag_payload_size(WIRE_MAX_MTU)), 4);
+  // Message type values are part of the protocol: both devices must agree on them
+  CHECK_EQ(EMERGENCY_STOP, 26);
+  CHECK_EQ(FRAG_RESEND_REQ, 27);
+  CHECK_EQ(CONFIG_DIGEST_ANS, 31);
+  CHECK_EQ(TELEMETRY_DATA, 34);
+  CHECK_EQ(CLOCK_SYNC_ANS, 36);
+  CHECK_EQ(RECORD_DATA, 39);
+  CHECK_EQ(STATS_ANS, 41);
+  CHECK_EQ(CONFIG_SNAPSHOT_ANS, 42);
+  CHECK_EQ(RECORD_DATA_ACK, 43);
+}
+
+struct test_case {
+  const char* name;
+  void (*run)();
+};
+
+int main(){
+  const struct test_case tests[] = {
+    {"crc16", test_crc16},
+    {"frame round trip", test_frame_round_trip},
+    {"fragment sizes", test_fragment_sizes},
+    {"reassembly orders", test_reassembly_orders},
+    {"selective resend", test_selective_resend},
+    {"send and resend", test_send_and_resend},
+    {"tx history", test_tx_history},
+    {"batch commands", test_batch_cmd},
+    {"lz codec", test_lz},
+    {"telemetry", test_telemetry},
+    {"sample ring", test_sample_ring},
+    {"telemetry feed", test_telemetry_feed},
+    {"clock sync", test_clock_sync},
+    {"downsample", test_downsample},
+    {"plot damage", test_plot_damage},
+    {"history", test_history},
+    {"telemetry log", test_telemetry_log},
+    {"rolling stats", test_rolling_stats},
+    {"serial export", test_serial_export},
+    {"config helpers", test_config_helpers},
+    {"config parse", test_config_parse},
+    {"config model", test_config_model},
+    {"config snapshot", test_config_snapshot},
+    {"config stream", test_config_stream},
+    {"config index", test_config_index},
+  };
+  for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+    int before = failures;
+    tests[i].run();
+    printf("%-20s %s\n", tests[i].name, failures == before ? "ok" : "FAILED");
+  }
+  printf("%d checks, %d failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,334 @@
+// Host test for the fragment reassembly engine (wire_reassembler in the ProsthesisProtocol library).
+// Replays YAML sections over a simulated lossy / reordering BLE link and compares
+// selective resend (FRAG_RESEND_REQ) with restarting the whole transfer.
+// Every completed transfer is checked byte for byte against what was sent.
+//
+// Build and run from this folder:
+//   make reassembly_sim
+//   ./reassembly_sim [path/to/hand_configuration.yaml]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "ProsthesisProtocol.h"
+
+#define DEFAULT_YAML_PATH "../../Assests/example_hand_configuration.yaml"
+#define SECTION_REQ_TIMEOUT_MS 1000 // app level retry when nothing of the section arrives
+#define POLL_PERIOD_MS 20           // how often the receiver calls wire_reasm_poll
+#define GIVE_UP_MS 30000
+#define TRIALS 200
+
+static std::string read_file(const char* path){
+  std::string content;
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    exit(1);
+  }
+  char chunk[1024];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    content.append(chunk, n);
+  }
+  fclose(f);
+  return content;
+}
+
+// Largest top level section, the one that needs the most fragments.
+static std::string largest_section(const std::string& yaml){
+  const char* keys[] = {"general:", "sensors:", "motors:", "functions:"};
+  std::string best;
+  for (int i = 0; i < 4; i++) {
+    size_t start = yaml.find(keys[i]);
+    if (start == std::string::npos) {
+      continue;
+    }
+    size_t end = (i < 3) ? yaml.find(keys[i + 1], start) : std::string::npos;
+    std::string section = yaml.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    if (section.size() > best.size()) {
+      best = section;
+    }
+  }
+  return best;
+}
+
+static uint32_t rng_state = 0x2545F491;
+static uint32_t rng_next(){
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+static double rng_unit(){
+  return (rng_next() & 0xFFFFFF) / (double)0x1000000;
+}
+
+// Airtime of one ATT value on a 1M PHY link without data length extension (ms).
+static double airtime_ms(size_t att_value_len){
+  size_t l2cap_len = att_value_len + 7;
+  double us = 0;
+  while (l2cap_len > 0) {
+    size_t pdu = l2cap_len > 27 ? 27 : l2cap_len;
+    us += (10 + pdu) * 8 + 150 + 10 * 8 + 150;
+    l2cap_len -= pdu;
+  }
+  return us / 1000.0;
+}
+
+struct link_model {
+  double loss;          // probability that a frame is lost
+  double reorder;       // probability that a frame is held back
+  double reorder_ms;    // maximum hold back
+};
+
+struct sim_event {
+  double t_ms;
+  int kind;             // EV_DATA, EV_RESEND_REQ, EV_SECTION_REQ, EV_POLL
+  std::vector<uint8_t> bytes;
+  bool operator<(const sim_event& other) const { return t_ms > other.t_ms; }
+};
+enum { EV_DATA, EV_RESEND_REQ, EV_SECTION_REQ, EV_POLL };
+
+struct trial_result {
+  bool completed;
+  bool corrupted;
+  double time_ms;
+  size_t frames_sent;
+  uint32_t duplicates;
+};
+
+// One section download. selective: answer stalls with FRAG_RESEND_REQ,
+// otherwise drop the partial transfer and request the whole section again.
+static struct trial_result run_trial(const std::string& msg, size_t stride, const struct link_model& link, bool selective){
+  std::priority_queue<sim_event> events;
+  struct wire_reassembler reasm;
+  memset(&reasm, 0, sizeof(reasm));
+  struct wire_tx_history history;
+  memset(&history, 0, sizeof(history));
+  uint8_t frame[WIRE_FRAME_MAX_LEN];
+  double downlink_free = 0;
+  double uplink_free = 0;
+  double last_section_req = 0;
+  uint8_t next_seq = 0;
+  struct trial_result res = {false, false, 0, 0, 0};
+
+  // Puts one frame on a link; it is lost, delayed or delivered in order.
+  auto transmit = [&](double now, double* link_free, int kind, const uint8_t* bytes, size_t len) {
+    double start = std::max(now, *link_free);
+    *link_free = start + airtime_ms(len);
+    if (kind == EV_DATA) {
+      res.frames_sent++;
+    }
+    if (rng_unit() < link.loss) {
+      return;
+    }
+    double arrival = *link_free;
+    if (rng_unit() < link.reorder) {
+      arrival += rng_unit() * link.reorder_ms;
+    }
+    events.push(sim_event{arrival, kind, std::vector<uint8_t>(bytes, bytes + len)});
+  };
+  auto send_fragment = [&](double now, const struct wire_tx_record* rec, uint16_t idx) {
+    size_t len = wire_frag_encode(frame, sizeof(frame), rec->req_type, rec->seq, rec->msg, rec->msg_len, rec->stride, idx);
+    transmit(now, &downlink_free, EV_DATA, frame, len);
+  };
+  auto send_section = [&](double now) {
+    uint8_t seq = next_seq++;
+    wire_tx_history_add(&history, 14, seq, (const uint8_t*)msg.data(), msg.size(), stride);
+    const struct wire_tx_record* rec = wire_tx_history_find(&history, 14, seq);
+    uint16_t frags = wire_frag_count(msg.size(), stride);
+    for (uint16_t i = 1; i <= frags; i++) {
+      send_fragment(now, rec, i);
+    }
+  };
+  auto request_section = [&](double now) {
+    last_section_req = now;
+    size_t len = wire_frame_encode(frame, sizeof(frame), 10, 0, 1, 1, (const uint8_t*)"Please send sensors data", 24);
+    transmit(now, &uplink_free, EV_SECTION_REQ, frame, len);
+  };
+
+  request_section(0);
+  events.push(sim_event{POLL_PERIOD_MS, EV_POLL, std::vector<uint8_t>()});
+  while (!events.empty()) {
+    sim_event ev = events.top();
+    events.pop();
+    double now = ev.t_ms;
+    if (now > GIVE_UP_MS) {
+      break;
+    }
+    struct wire_frame decoded;
+    if (ev.kind == EV_SECTION_REQ) {
+      send_section(now);
+    } else if (ev.kind == EV_RESEND_REQ) {
+      if (wire_frame_decode(ev.bytes.data(), ev.bytes.size(), &decoded) != WIRE_OK) {
+        continue;
+      }
+      std::string text((const char*)decoded.payload, decoded.payload_len);
+      uint8_t seq, req_type;
+      struct wire_frag_range ranges[WIRE_RESEND_MAX_RANGES];
+      int count = wire_resend_parse(text.c_str(), &seq, &req_type, ranges, WIRE_RESEND_MAX_RANGES);
+      const struct wire_tx_record* rec = wire_tx_history_find(&history, req_type, seq);
+      for (int r = 0; rec && r < count; r++) {
+        for (uint32_t idx = ranges[r].first; idx <= ranges[r].last; idx++) {
+          send_fragment(now, rec, (uint16_t)idx);
+        }
+      }
+    } else if (ev.kind == EV_DATA) {
+      if (wire_frame_decode(ev.bytes.data(), ev.bytes.size(), &decoded) != WIRE_OK) {
+        continue;
+      }
+      if (wire_reasm_push(&reasm, &decoded, (uint32_t)now) == WIRE_REASM_DONE) {
+        size_t len = 0;
+        uint8_t* out = wire_reasm_take(&reasm, &len);
+        res.completed = true;
+        res.corrupted = len != msg.size() || memcmp(out, msg.data(), len) != 0;
+        res.time_ms = now;
+        free(out);
+        break;
+      }
+    } else if (ev.kind == EV_POLL) {
+      char resend_req[128];
+      bool active = false;
+      for (int i = 0; i < WIRE_REASM_SLOTS; i++) {
+        active = active || reasm.slots[i].active;
+      }
+      if (wire_reasm_poll(&reasm, (uint32_t)now, resend_req, sizeof(resend_req))) {
+        if (selective) {
+          size_t len = wire_frame_encode(frame, sizeof(frame), FRAG_RESEND_REQ, 0, 1, 1,
+                                         (const uint8_t*)resend_req, (uint16_t)strlen(resend_req));
+          transmit(now, &uplink_free, EV_RESEND_REQ, frame, len);
+        } else {
+          wire_reasm_reset(&reasm);
+          request_section(now);
+        }
+      } else if (!active && now - last_section_req >= SECTION_REQ_TIMEOUT_MS) {
+        // Nothing of the section arrived (or the transfer expired): ask again
+        request_section(now);
+      }
+      events.push(sim_event{now + POLL_PERIOD_MS, EV_POLL, std::vector<uint8_t>()});
+    }
+  }
+  res.duplicates = reasm.duplicates;
+  wire_reasm_reset(&reasm);
+  for (int i = 0; i < WIRE_TX_HISTORY_SIZE; i++) {
+    free(history.records[i].msg);
+  }
+  return res;
+}
+
+static double percentile(std::vector<double> values, double p){
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[(size_t)(p * (values.size() - 1))];
+}
+
+// Pushes the fragments of msg in a shuffled order with duplicates and checks the result.
+static bool shuffled_replay(const std::string& msg, size_t stride){
+  uint16_t frags = wire_frag_count(msg.size(), stride);
+  std::vector<std::vector<uint8_t> > frames;
+  uint8_t frame[WIRE_FRAME_MAX_LEN];
+  for (uint16_t i = 1; i <= frags; i++) {
+    size_t len = wire_frag_encode(frame, sizeof(frame), 14, 9, (const uint8_t*)msg.data(), msg.size(), stride, i);
+    frames.push_back(std::vector<uint8_t>(frame, frame + len));
+    if (rng_next() % 4 == 0) {
+      frames.push_back(frames.back());
+    }
+  }
+  for (size_t i = frames.size() - 1; i > 0; i--) {
+    std::swap(frames[i], frames[rng_next() % (i + 1)]);
+  }
+  struct wire_reassembler reasm;
+  memset(&reasm, 0, sizeof(reasm));
+  bool ok = false;
+  for (size_t i = 0; i < frames.size(); i++) {
+    struct wire_frame decoded;
+    wire_frame_decode(frames[i].data(), frames[i].size(), &decoded);
+    int status = wire_reasm_push(&reasm, &decoded, 0);
+    if (status == WIRE_REASM_ERROR) {
+      break;
+    }
+    if (status == WIRE_REASM_DONE) {
+      size_t len = 0;
+      uint8_t* out = wire_reasm_take(&reasm, &len);
+      ok = len == msg.size() && memcmp(out, msg.data(), len) == 0;
+      free(out);
+    }
+  }
+  wire_reasm_reset(&reasm);
+  return ok;
+}
+
+int main(int argc, char** argv){
+  const char* yaml_path = argc > 1 ? argv[1] : DEFAULT_YAML_PATH;
+  std::string section = largest_section(read_file(yaml_path));
+  int failures = 0;
+
+  printf("== Shuffled replay with duplicates ==\n");
+  const uint16_t mtus[] = {23, 48, 185, 517};
+  for (size_t m = 0; m < sizeof(mtus) / sizeof(mtus[0]); m++) {
+    int ok = 0;
+    for (int t = 0; t < TRIALS; t++) {
+      ok += shuffled_replay(section, wire_frag_payload_size(mtus[m]));
+    }
+    printf("  MTU %3u: %d/%d transfers reassembled correctly\n", mtus[m], ok, TRIALS);
+    failures += TRIALS - ok;
+  }
+
+  printf("\n== Lossy link: selective resend vs full restart (%zu byte section, %d trials each) ==\n", section.size(), TRIALS);
+  const struct link_model links[] = {
+    {0.00, 0.0, 0}, {0.01, 0.0, 0}, {0.05, 0.0, 0}, {0.10, 0.0, 0}, {0.20, 0.0, 0},
+    {0.05, 0.3, 20}, {0.10, 0.3, 20},
+  };
+  const uint16_t sim_mtus[] = {23, 185};
+  for (size_t m = 0; m < 2; m++) {
+    size_t stride = wire_frag_payload_size(sim_mtus[m]);
+    printf("MTU %u (%u fragments):\n", sim_mtus[m], wire_frag_count(section.size(), stride));
+    printf("  %5s %8s | %-36s | %-36s\n", "loss", "reorder", "selective: done  mean/p95 ms  frames", "restart: done  mean/p95 ms  frames");
+    for (size_t l = 0; l < sizeof(links) / sizeof(links[0]); l++) {
+      int done[2] = {0, 0};
+      size_t frames[2] = {0, 0};
+      uint32_t dups = 0;
+      std::vector<double> times[2];
+      for (int mode = 0; mode < 2; mode++) {
+        for (int t = 0; t < TRIALS; t++) {
+          struct trial_result r = run_trial(section, stride, links[l], mode == 0);
+          if (r.corrupted) {
+            failures++;
+          }
+          if (r.completed) {
+            done[mode]++;
+            times[mode].push_back(r.time_ms);
+          }
+          frames[mode] += r.frames_sent;
+          dups += r.duplicates;
+        }
+      }
+      double mean[2];
+      for (int mode = 0; mode < 2; mode++) {
+        double sum = 0;
+        for (size_t i = 0; i < times[mode].size(); i++) {
+          sum += times[mode][i];
+        }
+        mean[mode] = times[mode].empty() ? 0 : sum / times[mode].size();
+      }
+      printf("  %4.0f%% %7.0f%% | %4d/%d %8.0f/%-7.0f %8.1f | %4d/%d %8.0f/%-7.0f %8.1f   (dups dropped %u)\n",
+             links[l].loss * 100, links[l].reorder * 100,
+             done[0], TRIALS, mean[0], percentile(times[0], 0.95), (double)frames[0] / TRIALS,
+             done[1], TRIALS, mean[1], percentile(times[1], 0.95), (double)frames[1] / TRIALS, dups);
+    }
+  }
+  if (failures) {
+    printf("\nFAILED: %d transfers were reassembled incorrectly\n", failures);
+    return 1;
+  }
+  printf("\nAll completed transfers matched the sent data\n");
+  return 0;
+}
@@ -0,0 +1,286 @@
+// Host simulation of the Debug chart timing: how far from the real time the screen
+// puts a telemetry sample, over a BLE link with injected jitter and a prosthesis
+// clock that is offset (and drifts) from the screen's.
+//
+// The prosthesis samples 2 channels at 100 Hz and pushes a TELEMETRY_DATA every
+// 10 ticks; the screen sends a CLOCK_SYNC_REQ every CLOCK_SYNC_INTERVAL_MS. Every
+// message waits for the next connection event plus a random delay (retransmissions,
+// busy radio) and stays in order with the other messages in its direction.
+// The placements compared:
+//   arrival       no timestamps: the newest sample of a batch is "now", the others
+//                 are spaced by the nominal period before it (what the chart did)
+//   one exchange  timestamps mapped with the first clock sync only
+//   clock sync    timestamps mapped with clock_sync (shortest round trip of the
+//                 last CLOCK_SYNC_WINDOW exchanges), as the screen does
+// Clock sync is run twice: with CLOCK_SYNC_ANS sent from the BLE callback, where it
+// always waits for the next connection event while the request did not (so the legs
+// differ by about half an interval), and from the next loop() pass as the mock does.
+//
+// Build and run from this folder:
+//   make telemetry_sim
+//   ./telemetry_sim
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <queue>
+#include <vector>
+
+#include "ProsthesisProtocol.h"
+
+#define CONN_INTERVAL_MS 15.0
+#define AIRTIME_MS 0.5              // one short notification / write
+#define ANSWER_MS 0.2               // prosthesis: CLOCK_SYNC_REQ in, CLOCK_SYNC_ANS out (callback)
+#define LOOP_PERIOD_MS 10.0         // mock loop(): answered on the next pass
+#define CHART_PERIOD_MS 20.0        // screen: the chart timer sends the clock sync
+#define SAMPLER_PERIOD_MS 1.0
+#define RATE_HZ 100
+#define CHANNELS 2
+#define TICKS_PER_BATCH 10
+#define SIM_SECONDS 120
+#define DEVICE_START_US 0xFFF00000u // the prosthesis' micros() wraps a second into the run
+
+static uint32_t rng_state = 0x2545F491;
+static uint32_t rng_next(){
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+static double rng_unit(){
+  return (rng_next() & 0xFFFFFF) / (double)0x1000000;
+}
+
+struct link_model {
+  double jitter_ms;             // extra delay per message, uniform 0..jitter_ms
+  double drift_ppm;             // prosthesis clock runs this much fast
+  bool answer_in_loop;          // CLOCK_SYNC_ANS from loop() instead of the BLE callback
+};
+
+// One direction of the link: messages leave at a connection event and arrive in order.
+struct link_dir {
+  double phase_ms;
+  double last_arrival_ms;
+};
+
+static double link_deliver(struct link_dir* dir, double ready_ms, double jitter_ms){
+  double t = ready_ms + rng_unit() * jitter_ms;
+  double event = dir->phase_ms + ceil((t - dir->phase_ms) / CONN_INTERVAL_MS) * CONN_INTERVAL_MS;
+  double arrival = event + AIRTIME_MS;
+  if (arrival < dir->last_arrival_ms) {
+    arrival = dir->last_arrival_ms;
+  }
+  dir->last_arrival_ms = arrival;
+  return arrival;
+}
+
+struct sim_event {
+  double t_ms;
+  int kind;                     // EV_SAMPLE, EV_SYNC, EV_REQ_IN, EV_ANS_IN, EV_DATA_IN
+  std::vector<uint8_t> bytes;
+  bool operator<(const sim_event& other) const { return t_ms > other.t_ms; }
+};
+enum { EV_SAMPLE, EV_SYNC, EV_REQ_IN, EV_ANS_IN, EV_DATA_IN };
+
+struct sim_state {
+  struct link_model link;
+  std::priority_queue<sim_event> events;
+  struct link_dir down;         // screen -> prosthesis
+  struct link_dir up;           // prosthesis -> screen
+  double now_ms;
+  struct telemetry_sender sender;
+  std::vector<double> sample_ms; // real time every sample was taken, by seq
+};
+
+// Both clocks in micros(); the screen's is the reference.
+static uint32_t screen_us(double t_ms){
+  return (uint32_t)(int64_t)llround(t_ms * 1000.0);
+}
+
+static uint32_t device_us(const struct sim_state* sim, double t_ms){
+  return DEVICE_START_US + (uint32_t)(int64_t)llround(t_ms * 1000.0 * (1.0 + sim->link.drift_ppm * 1e-6));
+}
+
+static int sim_sample(uint8_t is_motor, uint8_t id, void* ctx){
+  struct sim_state* sim = (struct sim_state*)ctx;
+  sim->sample_ms.push_back(sim->now_ms);
+  return id;
+}
+
+static void sim_emit(const uint8_t* payload, size_t len, void* ctx){
+  struct sim_state* sim = (struct sim_state*)ctx;
+  struct sim_event ev;
+  ev.t_ms = link_deliver(&sim->up, sim->now_ms, sim->link.jitter_ms);
+  ev.kind = EV_DATA_IN;
+  ev.bytes.assign(payload, payload + len);
+  sim->events.push(ev);
+}
+
+static double percentile(std::vector<double> values, double p){
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[(size_t)(p * (values.size() - 1))];
+}
+
+enum { PLACE_ARRIVAL, PLACE_ONE_EXCHANGE, PLACE_CLOCK_SYNC, PLACE_COUNT };
+
+struct run_result {
+  std::vector<double> error_ms[PLACE_COUNT];  // |placed - real| per sample
+  uint32_t syncs;
+  uint32_t best_rtt_us;
+};
+
+static struct run_result run(const struct link_model& link){
+  struct sim_state sim;
+  sim.link = link;
+  sim.down.phase_ms = rng_unit() * CONN_INTERVAL_MS;
+  sim.down.last_arrival_ms = 0;
+  sim.up = sim.down;
+  sim.now_ms = 0;
+
+  struct telemetry_sub sub;
+  sub.rate_hz = RATE_HZ;
+  sub.batch = TICKS_PER_BATCH * CHANNELS;
+  sub.channel_count = CHANNELS;
+  for (uint8_t c = 0; c < CHANNELS; c++) {
+    sub.channels[c].is_motor = 0;
+    sub.channels[c].id = c;
+  }
+  telemetry_sender_start(&sim.sender, &sub, TELEMETRY_MAX_BATCH, device_us(&sim, 0));
+
+  struct clock_sync windowed;
+  struct clock_sync single;
+  clock_sync_reset(&windowed);
+  clock_sync_reset(&single);
+  struct run_result res;
+  res.syncs = 0;
+
+  struct sim_event ev;
+  ev.t_ms = 0;
+  ev.kind = EV_SAMPLE;
+  sim.events.push(ev);
+  ev.kind = EV_SYNC;
+  sim.events.push(ev);
+  const double end_ms = SIM_SECONDS * 1000.0;
+  while (!sim.events.empty()) {
+    ev = sim.events.top();
+    sim.events.pop();
+    sim.now_ms = ev.t_ms;
+    switch (ev.kind) {
+      case EV_SAMPLE:{
+        // The sampler task: one frame per period, fed straight to the sender
+        uint32_t d = device_us(&sim, sim.now_ms);
+        telemetry_sender_feed(&sim.sender, d, d, sim_sample, sim_emit, &sim);
+        if (sim.now_ms + SAMPLER_PERIOD_MS < end_ms) {
+          ev.t_ms = sim.now_ms + SAMPLER_PERIOD_MS;
+          sim.events.push(ev);
+        }
+        break;
+      }
+      case EV_SYNC:{
+        uint8_t req[CLOCK_SYNC_REQ_LEN];
+        clock_sync_req_encode(req, sizeof(req), screen_us(sim.now_ms));
+        struct sim_event out;
+        out.t_ms = link_deliver(&sim.down, sim.now_ms, link.jitter_ms);
+        out.kind = EV_REQ_IN;
+        out.bytes.assign(req, req + sizeof(req));
+        sim.events.push(out);
+        if (sim.now_ms + CLOCK_SYNC_INTERVAL_MS < end_ms) {
+          ev.t_ms = sim.now_ms + CLOCK_SYNC_INTERVAL_MS + rng_unit() * CHART_PERIOD_MS;
+          sim.events.push(ev);
+        }
+        break;
+      }
+      case EV_REQ_IN:{
+        uint32_t t1;
+        clock_sync_req_decode(ev.bytes.data(), ev.bytes.size(), &t1);
+        double answer_ms = sim.now_ms + (link.answer_in_loop ? rng_unit() * LOOP_PERIOD_MS : ANSWER_MS);
+        uint8_t ans[CLOCK_SYNC_ANS_LEN];
+        clock_sync_ans_encode(ans, sizeof(ans), t1, device_us(&sim, sim.now_ms), device_us(&sim, answer_ms));
+        struct sim_event out;
+        out.t_ms = link_deliver(&sim.up, answer_ms, link.jitter_ms);
+        out.kind = EV_ANS_IN;
+        out.bytes.assign(ans, ans + sizeof(ans));
+        sim.events.push(out);
+        break;
+      }
+      case EV_ANS_IN:{
+        uint32_t t1, t2, t3;
+        clock_sync_ans_decode(ev.bytes.data(), ev.bytes.size(), &t1, &t2, &t3);
+        uint32_t t4 = screen_us(sim.now_ms);
+        clock_sync_add(&windowed, t1, t2, t3, t4);
+        if (!single.valid) {
+          clock_sync_add(&single, t1, t2, t3, t4);
+        }
+        res.syncs++;
+        break;
+      }
+      case EV_DATA_IN:{
+        struct telemetry_batch batch;
+        if (telemetry_batch_decode(ev.bytes.data(), ev.bytes.size(), CHANNELS, &batch) <= 0) {
+          break;
+        }
+        // Same fallback as QueueTelemetry() until an exchange completed
+        uint32_t newest = telemetry_sample_time(&batch, CHANNELS, batch.count - 1);
+        clock_sync_seed(&windowed, newest, screen_us(sim.now_ms));
+        clock_sync_seed(&single, newest, screen_us(sim.now_ms));
+        uint32_t last_tick = (batch.first_seq + batch.count - 1) / CHANNELS;
+        for (int i = 0; i < batch.count; i++) {
+          uint32_t seq = batch.first_seq + i;
+          double real_ms = sim.sample_ms[seq];
+          uint32_t device = telemetry_sample_time(&batch, CHANNELS, i);
+          double arrival_ms = sim.now_ms - (double)(last_tick - seq / CHANNELS) * 1000.0 / RATE_HZ;
+          res.error_ms[PLACE_ARRIVAL].push_back(fabs(arrival_ms - real_ms));
+          res.error_ms[PLACE_ONE_EXCHANGE].push_back(
+              fabs((int32_t)(clock_sync_to_local(&single, device) - screen_us(real_ms)) / 1000.0));
+          res.error_ms[PLACE_CLOCK_SYNC].push_back(
+              fabs((int32_t)(clock_sync_to_local(&windowed, device) - screen_us(real_ms)) / 1000.0));
+        }
+        break;
+      }
+    }
+  }
+  res.best_rtt_us = windowed.rtt_us;
+  return res;
+}
+
+static void print_error(const std::vector<double>& error_ms){
+  printf(" %6.2f %6.2f %6.2f |", percentile(error_ms, 0.5), percentile(error_ms, 0.95), percentile(error_ms, 1.0));
+}
+
+int main(){
+  const double jitters[] = {0, 5, 15, 30};
+  const double drifts[] = {0, 50};
+  int failures = 0;
+  printf("== Chart timing error: %d channels at %d Hz, %d ticks per notification, conn interval %.0f ms, "
+         "clock sync every %d ms, %d s per run ==\n",
+         CHANNELS, RATE_HZ, TICKS_PER_BATCH, CONN_INTERVAL_MS, CLOCK_SYNC_INTERVAL_MS, SIM_SECONDS);
+  printf("  |error| of the sample position on the screen clock, p50 / p95 / max in ms\n");
+  printf("  %6s %7s | %-22s | %-22s | %-22s | %-22s | %s\n", "jitter", "drift", "arrival", "one exchange",
+         "sync, answer in cb", "sync, answer in loop", "best rtt");
+  for (size_t d = 0; d < sizeof(drifts) / sizeof(drifts[0]); d++) {
+    for (size_t j = 0; j < sizeof(jitters) / sizeof(jitters[0]); j++) {
+      struct link_model in_callback = {jitters[j], drifts[d], false};
+      struct link_model in_loop = {jitters[j], drifts[d], true};
+      struct run_result cb = run(in_callback);
+      struct run_result r = run(in_loop);
+      printf("  %3.0f ms %3.0f ppm |", jitters[j], drifts[d]);
+      print_error(r.error_ms[PLACE_ARRIVAL]);
+      print_error(r.error_ms[PLACE_ONE_EXCHANGE]);
+      print_error(cb.error_ms[PLACE_CLOCK_SYNC]);
+      print_error(r.error_ms[PLACE_CLOCK_SYNC]);
+      printf(" %5.1f ms (%u syncs)\n", r.best_rtt_us / 1000.0, r.syncs);
+      // The point of the timestamps: clock sync must beat placing samples on arrival
+      if (percentile(r.error_ms[PLACE_CLOCK_SYNC], 0.95) > percentile(r.error_ms[PLACE_ARRIVAL], 0.95)) {
+        printf("    FAILED: clock sync placed samples worse than arrival order\n");
+        failures++;
+      }
+    }
+  }
+  return failures ? 1 : 0;
+}
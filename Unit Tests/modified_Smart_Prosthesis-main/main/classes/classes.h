@@ -194,11 +194,15 @@ public:
   Hand(){}
   void add_output(Output* output){
       outputs.push_back(output);
+      outputs_by_name.insert(std::make_pair(output->name, output));   // keeps the first output of a name
   }
   void add_input(Input* input){
       inputs.push_back(input);
+      inputs_by_id.insert(std::make_pair(input->id, input));
   }
   void clear_hand(){
+    inputs_by_id.clear();
+    outputs_by_name.clear();
     int inputs_size = inputs.size();
     for (int i=0; i < inputs_size; i++){
       Input* input_ptr = inputs.back();  
@@ -227,21 +231,27 @@ public:
     Serial.println(" ---------------------------------");
   }
 
+  /**
+   * @brief Finds an input by its id, NULL if there is none.
+   */
   Input* get_input_by_id(int id) {
-    for (Input* input_ptr : inputs) {
-      if (input_ptr->id == id)
-        return input_ptr;
-    }
-    return NULL;
+    std::map<int, Input*>::const_iterator it = inputs_by_id.find(id);
+    return it == inputs_by_id.end() ? NULL : it->second;
   }
 
-  Output* get_output_by_name(String name) {
-    for (Output* output_ptr : outputs) {
-      if (output_ptr->name == name)
-        return output_ptr;
-    }
-    return NULL;
+  /**
+   * @brief Finds an output by its name, NULL if there is none.
+   */
+  Output* get_output_by_name(const String& name) {
+    std::map<String, Output*>::const_iterator it = outputs_by_name.find(name);
+    return it == outputs_by_name.end() ? NULL : it->second;
   }
+
+private:
+  // Filled by add_input() / add_output() as the config is loaded and emptied by
+  // clear_hand(), so the lookups of every command do not walk the vectors.
+  std::map<int, Input*> inputs_by_id;
+  std::map<String, Output*> outputs_by_name;
 };
 
 #endif